@@ -32,11 +32,12 @@ struct scalar_cont_typer_t<El::DistMatrix<F, U, V> > {
     }
 };
 
-template<typename F>
-struct scalar_cont_typer_t<base::sparse_matrix_t<F> > {
+template<typename F, typename I>
+struct scalar_cont_typer_t<base::sparse_matrix_t<F, I> > {
     typedef El::Matrix<F> type;
 
-    static type build_compatible(int m, int n, const base::sparse_matrix_t<F>& A) {
+    static type build_compatible(int m, int n,
+        const base::sparse_matrix_t<F, I>& A) {
         return type(m, n);
     }
 };
@@ -3,12 +3,21 @@
 
 #if SKYLARK_HAVE_OPENMP
 
+#include <algorithm>
+#include <vector>
+
+#include <omp.h>
+
 namespace skylark {
 namespace algorithms {
 
 namespace internal {
 
-template<typename T1, typename T2, typename T3>
+/**
+ * One Gauss-Seidel step on unknown i. If Atomic is false, the caller must
+ * guarantee that no other thread updates unknown i concurrently.
+ */
+template<bool Atomic, typename T1, typename T2, typename T3>
 inline void jstep(const int *colptr, const int *rowind, const T1 *vals,
     T2 *B, T3 *X, int k, T3 *xvals, int i) {
 
@@ -32,12 +41,15 @@ inline void jstep(const int *colptr, const int *rowind, const T1 *vals,
     for(int r = 0; r < k; r++) {
         int idx = i * k + r;
         v = xvals[r] / diag;
-#       pragma omp atomic
-        X[idx] += v;
+        if (Atomic) {
+#           pragma omp atomic
+            X[idx] += v;
+        } else
+            X[idx] += v;
     }
 }
 
-template<typename T1, typename T2, typename T3>
+template<bool Atomic, typename T1, typename T2, typename T3>
 inline void jstep1(const int *colptr, const int *rowind, const T1 *vals,
     T2 *b, T3 *x, int i) {
 
@@ -54,8 +66,78 @@ inline void jstep1(const int *colptr, const int *rowind, const T1 *vals,
     }
 
     v /= diag;
-#   pragma omp atomic
-    x[i] += v;
+    if (Atomic) {
+#       pragma omp atomic
+        x[i] += v;
+    } else
+        x[i] += v;
+}
+
+/// Step indices generated at once (per thread) in the partitioned mode.
+static const int asy_step_batch = 1024;
+
+/**
+ * Owner-computes partition of the n unknowns for the partitioned mode:
+ * part[t]..part[t + 1] - 1 is the range of the t-th part. There is one part
+ * per thread (but no more parts than unknowns).
+ */
+inline std::vector<int> asy_partition(int n) {
+    int nparts = std::max(1, std::min(omp_get_max_threads(), n));
+    std::vector<int> part(nparts + 1);
+    for(int t = 0; t <= nparts; t++)
+        part[t] = static_cast<int>(static_cast<long long>(n) * t / nparts);
+    return part;
+}
+
+/**
+ * Allocates the step indices of sweeps sweeps in the partitioned mode: the
+ * t-th array has sweeps * (size of part t) steps, uniform in part t. Every
+ * unknown is thus expected to be updated sweeps times, as in the shared mode.
+ */
+template<typename Distribution>
+std::vector<base::random_samples_array_t<Distribution> >
+asy_partitioned_steps(const std::vector<int>& part, int sweeps,
+    base::context_t& context) {
+
+    std::vector<base::random_samples_array_t<Distribution> > stepidxs;
+    for(size_t t = 0; t + 1 < part.size(); t++) {
+        Distribution distribution(part[t], part[t + 1] - 1);
+        stepidxs.push_back(context.allocate_random_samples_array(
+                static_cast<size_t>(sweeps) * (part[t + 1] - part[t]),
+                distribution));
+    }
+    return stepidxs;
+}
+
+/**
+ * Runs the steps of the partitioned mode. Each part is processed by a single
+ * thread, so step (called as step(i)) may update unknown i without atomics.
+ * The indices are generated in bulk, asy_step_batch at a time. Every thread
+ * uses its own copy of step, which can therefore hold scratch space.
+ */
+template<typename Distribution, typename StepType>
+void asy_run_partitioned(const std::vector<int>& part, int sweeps,
+    const std::vector<base::random_samples_array_t<Distribution> >& stepidxs,
+    const StepType& step) {
+
+    const int nparts = part.size() - 1;
+
+#   pragma omp parallel default(shared)
+    {
+        StepType thread_step(step);
+        int idxs[asy_step_batch];
+
+        for(int t = omp_get_thread_num(); t < nparts;
+            t += omp_get_num_threads()) {
+            size_t steps = static_cast<size_t>(sweeps) * (part[t + 1] - part[t]);
+            for(size_t s = 0; s < steps; s += asy_step_batch) {
+                size_t c = std::min(steps - s, size_t(asy_step_batch));
+                stepidxs[t].fill(s, c, idxs);
+                for(size_t j = 0; j < c; j++)
+                    thread_step(idxs[j]);
+            }
+        }
+    }
 }
 
 
@@ -74,6 +156,12 @@ inline void jstep1(const int *colptr, const int *rowind, const T1 *vals,
  * Provable Convergence Rate Through Randomization
  * IPDPS 2014
  *
+ * By default all threads draw steps from all unknowns, and updates use
+ * atomics. With params.partitioned, every thread owns a contiguous range of
+ * unknowns and updates only those (reads are still asynchronous), so no
+ * atomics are needed and contention on shared entries of X disappears. The
+ * achieved sweeps/sec are reported at log level 1.
+ *
  * @param A input matrix
  * @param B right hand side.
  * @param X output - must be preallocated. The content is used as initial X.
@@ -97,6 +185,13 @@ int AsyRGS(const base::sparse_matrix_t<T1>& A, const El::Matrix<T2>& B,
     typedef boost::random::uniform_int_distribution<int> dtype;
     dtype distribution(0, n-1);
 
+    std::vector<int> part;
+    if (params.partitioned)
+        part = internal::asy_partition(n);
+
+    int done_sweeps = 0;
+    double elapsed = 0.0;
+
     if (B.Width() == 1) {
        int j;
 
@@ -106,18 +201,29 @@ int AsyRGS(const base::sparse_matrix_t<T1>& A, const El::Matrix<T2>& B,
        T3 *Xd = X.Buffer();
 
        int sweeps_left = params.sweeps_lim;
-       int done_sweeps = 0;
        while (sweeps_left > 0) {
 
            int sweeps = params.syn_sweeps > 0 ?
                std::min(params.syn_sweeps, sweeps_left) : sweeps_left;
 
-           base::random_samples_array_t<dtype> stepidxs =
-               context.allocate_random_samples_array(sweeps * n, distribution);
-
-#          pragma omp parallel for default(shared) private(j)
-           for(j = 0; j < sweeps * n ; j++)
-               internal::jstep1(colptr, rowind, vals, Bd, Xd, stepidxs[j]);
+           double start = omp_get_wtime();
+           if (params.partitioned) {
+               internal::asy_run_partitioned(part, sweeps,
+                   internal::asy_partitioned_steps<dtype>(part, sweeps, context),
+                   [=](int i) {
+                       internal::jstep1<false>(colptr, rowind, vals, Bd, Xd, i);
+                   });
+           } else {
+               base::random_samples_array_t<dtype> stepidxs =
+                   context.allocate_random_samples_array(sweeps * n,
+                       distribution);
+
+#              pragma omp parallel for default(shared) private(j)
+               for(j = 0; j < sweeps * n ; j++)
+                   internal::jstep1<true>(colptr, rowind, vals, Bd, Xd,
+                       stepidxs[j]);
+           }
+           elapsed += omp_get_wtime() - start;
 
            sweeps_left -= sweeps;
            done_sweeps += sweeps;
@@ -131,7 +237,10 @@ int AsyRGS(const base::sparse_matrix_t<T1>& A, const El::Matrix<T2>& B,
                if (log_lev2)
                    params.log_stream << "AsyRGS: Sweeps = " << done_sweeps
                                      << ", Relres = "
-                                     << boost::format("%.2e") % relres << std::endl;
+                                     << boost::format("%.2e") % relres
+                                     << ", Sweeps/sec = "
+                                     << boost::format("%.2e") %
+                                         (done_sweeps / elapsed) << std::endl;
 
                if(res < nrmb * params.tolerance) {
                    if (log_lev1)
@@ -171,18 +280,31 @@ int AsyRGS(const base::sparse_matrix_t<T1>& A, const El::Matrix<T2>& B,
         scalar_cont_type ressqr(nrmb);
 
         int sweeps_left = params.sweeps_lim;
-        int done_sweeps = 0;
         while (sweeps_left > 0) {
 
             int sweeps = params.syn_sweeps > 0 ?
                 std::min(params.syn_sweeps, sweeps_left) : sweeps_left;
 
-            base::random_samples_array_t<dtype> stepidxs =
-                context.allocate_random_samples_array(sweeps * n, distribution);
-
-#           pragma omp parallel for default(shared) private(j, d)
-            for(j = 0; j < sweeps * n ; j++)
-                internal::jstep(colptr, rowind, vals, Bd, Xd, k, d, stepidxs[j]);
+            double start = omp_get_wtime();
+            if (params.partitioned) {
+                std::vector<T3> scratch(k);
+                internal::asy_run_partitioned(part, sweeps,
+                    internal::asy_partitioned_steps<dtype>(part, sweeps, context),
+                    [=](int i) mutable {
+                        internal::jstep<false>(colptr, rowind, vals, Bd, Xd, k,
+                            scratch.data(), i);
+                    });
+            } else {
+                base::random_samples_array_t<dtype> stepidxs =
+                    context.allocate_random_samples_array(sweeps * n,
+                        distribution);
+
+#               pragma omp parallel for default(shared) private(j, d)
+                for(j = 0; j < sweeps * n ; j++)
+                    internal::jstep<true>(colptr, rowind, vals, Bd, Xd, k, d,
+                        stepidxs[j]);
+            }
+            elapsed += omp_get_wtime() - start;
 
            sweeps_left -= sweeps;
            done_sweeps += sweeps;
@@ -207,7 +329,10 @@ int AsyRGS(const base::sparse_matrix_t<T1>& A, const El::Matrix<T2>& B,
                    params.log_stream << "AsyRGS: Sweeps = " << done_sweeps
                                      << ", Relres = "
                                      << boost::format("%.2e") % relres
-                                     << ", " << convg << " rhs converged" << std::endl;
+                                     << ", " << convg << " rhs converged"
+                                     << ", Sweeps/sec = "
+                                     << boost::format("%.2e") %
+                                         (done_sweeps / elapsed) << std::endl;
                }
 
                if(convg == k) {
@@ -230,6 +355,12 @@ int AsyRGS(const base::sparse_matrix_t<T1>& A, const El::Matrix<T2>& B,
 
  cleanup:
 
+    if (log_lev1 && done_sweeps > 0)
+        params.log_stream << "AsyRGS: " << done_sweeps << " sweeps in "
+                          << boost::format("%.2e") % elapsed << " sec ("
+                          << boost::format("%.2e") % (done_sweeps / elapsed)
+                          << " sweeps/sec)" << std::endl;
+
     return ret;
 }
 
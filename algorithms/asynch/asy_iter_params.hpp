@@ -22,6 +22,12 @@ struct asy_iter_params_t : public base::params_t {
     int iter_lim;
     int iter_res_print;
 
+    bool partitioned;    /**< Owner-computes mode: the unknowns are split into
+                              one contiguous range per thread, and each thread
+                              only updates its own range, without atomics.
+                              Steps are uniform within each range, and every
+                              range gets sweeps times its size of them. */
+
     asy_iter_params_t(double tolerance = 1e-3,
         int syn_sweeps = 10,
         int sweeps_lim = 100,
@@ -31,13 +37,15 @@ struct asy_iter_params_t : public base::params_t {
         int log_level = 0,
         std::ostream &log_stream = std::cout,
         std::string prefix = "", 
-        int debug_level = 0) :
+        int debug_level = 0,
+        bool partitioned = false) :
         base::params_t(am_i_printing, log_level, log_stream, prefix, debug_level),
         tolerance(tolerance),
         syn_sweeps(syn_sweeps),
         sweeps_lim(sweeps_lim),
         iter_lim(iter_lim),
-        iter_res_print(iter_res_print) {
+        iter_res_print(iter_res_print),
+        partitioned(partitioned) {
     }
 
 };
@@ -5,6 +5,7 @@
 #include "exception.hpp"
 #include "sparse_matrix.hpp"
 #include "computed_matrix.hpp"
+#include "detail/spmm.hpp"
 #include "../utility/typer.hpp"
 
 // Defines a generic Gemm function that receives both dense and sparse matrices.
@@ -206,309 +207,67 @@ inline void Gemm(El::Orientation oA, El::Orientation oB,
 
 /**
  * Gemm between mixed Elemental, sparse input. Output is dense Elemental.
+ *
+ * Both directions run on the kernels in detail/spmm.hpp: the product is
+ * (for dense-sparse: its transpose is) expressed as S * In or S^T * In, with
+ * the dense operands addressed through strides rather than transposed.
  */
 
-template<typename T>
+template<typename T, typename I>
 inline void Gemm(El::Orientation oA, El::Orientation oB,
-    T alpha, const El::Matrix<T>& A, const sparse_matrix_t<T>& B,
+    T alpha, const El::Matrix<T>& A, const sparse_matrix_t<T, I>& B,
     T beta, El::Matrix<T>& C) {
     // TODO verify sizes etc.
 
-    const int* indptr = B.indptr();
-    const int* indices = B.indices();
-    const T *values = B.locked_values();
-
-    if (oA == El::ADJOINT && std::is_same<T, El::Base<T> >::value)
-        oA = El::TRANSPOSE;
-
-    if (oB == El::ADJOINT && std::is_same<T, El::Base<T> >::value)
-        oB = El::TRANSPOSE;
-
-    if (oA == El::ADJOINT || oB == El::ADJOINT)
-        SKYLARK_THROW_EXCEPTION(base::unsupported_base_operation());
-
-    // NN
-    if (oA == El::NORMAL && oB == El::NORMAL) {
-        int k = A.Width();
-        int n = B.width();
-        int m = A.Height();
-
-        El::Scale(beta, C);
-
-        El::Matrix<T> Ac;
-        El::Matrix<T> Cc;
-
-#       if SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for private(Cc, Ac)
-#       endif
-        for(int col = 0; col < n; col++) {
-            El::View(Cc, C, 0, col, m, 1);
-            for (int j = indptr[col]; j < indptr[col + 1]; j++) {
-                int row = indices[j];
-                T val = values[j];
-                El::LockedView(Ac, A, 0, row, m, 1);
-                El::Axpy(alpha * val, Ac, Cc);
-            }
-        }
-    }
-
-    // NT
-    if (oA == El::NORMAL && oB == El::TRANSPOSE) {
-        int k = A.Width();
-        int n = B.width();
-        int m = A.Height();
-
-        El::Scale(beta, C);
-
-        El::Matrix<T> Ac;
-        El::Matrix<T> Cc;
-
-        // Now, we simply think of B has being in CSR mode...
-        int row = 0;
-        for(int row = 0; row < n; row++) {
-            El::LockedView(Ac, A, 0, row, m, 1);
-#           if SKYLARK_HAVE_OPENMP
-#           pragma omp parallel for private(Cc)
-#           endif
-            for (int j = indptr[row]; j < indptr[row + 1]; j++) {
-                int col = indices[j];
-                T val = values[j];
-                El::View(Cc, C, 0, col, m, 1);
-                El::Axpy(alpha * val, Ac, Cc);
-            }
-        }
-    }
+    El::Scale(beta, C);
 
+    // C^T = op(B)^T op(A)^T, with C^T(i, j) = C(j, i).
+    bool gather = (oB == El::NORMAL);
+    bool conj_s = (oB == El::ADJOINT);
+    bool conj_d = (oA == El::ADJOINT);
+    size_t in_rs = (oA == El::NORMAL) ? A.LDim() : 1;
+    size_t in_cs = (oA == El::NORMAL) ? 1 : A.LDim();
 
-    // TN - TODO: Not tested!
-    if (oA == El::TRANSPOSE && oB == El::NORMAL) {
-        int k = A.Height();
-        int n = B.width();
-        int m = A.Width();
-
-        T *c = C.Buffer();
-        int ldc = C.LDim();
-
-        const T *a = A.LockedBuffer();
-        int lda = A.LDim();
-
-#       if SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for collapse(2)
-#       endif
-        for (int j = 0; j < n; j++)
-            for(int row = 0; row < m; row++) {
-                c[j * ldc + row] *= beta;
-                 for (int l = indptr[j]; l < indptr[j + 1]; l++) {
-                     int rr = indices[l];
-                     T val = values[l];
-                     c[j * ldc + row] += val * a[row * lda + rr];
-                 }
-            }
-    }
-
-    // TT - TODO: Not tested!
-    if (oA == El::TRANSPOSE && oB == El::TRANSPOSE) {
-        int k = A.Height();
-        int n = B.width();
-        int m = A.Width();
-
-        El::Scale(beta, C);
-
-        T *c = C.Buffer();
-        int ldc = C.LDim();
-
-        const T *a = A.LockedBuffer();
-        int lda = A.LDim();
-
-#       if SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for
-#       endif
-        for(int row = 0; row < k; row++)
-            for(int rb = 0; rb < n; rb++)
-                for (int l = indptr[rb]; l < indptr[rb + 1]; l++) {
-                    int col = indices[l];
-                    c[col * ldc + row] += values[l] * a[row * lda + rb];
-                }
-    }
+    detail::spmm(gather, conj_s, conj_d,
+        B.width(), B.indptr(), B.indices(), B.locked_values(), alpha,
+        A.LockedBuffer(), in_rs, in_cs, C.Buffer(), C.LDim(), 1, C.Height());
 }
 
-template<typename T>
+template<typename T, typename I>
 inline void Gemm(El::Orientation oA, El::Orientation oB,
-    T alpha, const sparse_matrix_t<T>& A, const El::Matrix<T>& B,
+    T alpha, const sparse_matrix_t<T, I>& A, const El::Matrix<T>& B,
     T beta, El::Matrix<T>& C) {
     // TODO verify sizes etc.
 
-    const int* indptr = A.indptr();
-    const int* indices = A.indices();
-    const T *values = A.locked_values();
-
-    int k = A.width();
-    int n = B.Width();
-    int m = B.Height();
-
-    if (oA == El::ADJOINT && std::is_same<T, El::Base<T> >::value)
-        oA = El::TRANSPOSE;
-
-    if (oB == El::ADJOINT && std::is_same<T, El::Base<T> >::value)
-        oB = El::TRANSPOSE;
-
-    // NN
-    if (oA == El::NORMAL && oB == El::NORMAL) {
+    El::Scale(beta, C);
 
-        El::Scale(beta, C);
+    bool gather = (oA != El::NORMAL);
+    bool conj_s = (oA == El::ADJOINT);
+    bool conj_d = (oB == El::ADJOINT);
+    size_t in_rs = (oB == El::NORMAL) ? 1 : B.LDim();
+    size_t in_cs = (oB == El::NORMAL) ? B.LDim() : 1;
 
-        T *c = C.Buffer();
-        int ldc = C.LDim();
-
-        const T *b = B.LockedBuffer();
-        int ldb = B.LDim();
-
-#       if SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for
-#       endif
-        for(int i = 0; i < n; i++)
-            for(int col = 0; col < k; col++)
-                 for (int j = indptr[col]; j < indptr[col + 1]; j++) {
-                     int row = indices[j];
-                     T val = values[j];
-                     c[i * ldc + row] += alpha * val * b[i * ldb + col];
-                 }
-    }
-
-    // NT
-    if (oA == El::NORMAL && (oB == El::TRANSPOSE || oB == El::ADJOINT)) {
-
-        El::Scale(beta, C);
-
-        El::Matrix<T> Bc;
-        El::Matrix<T> BTr;
-        El::Matrix<T> Cr;
-
-        for(int col = 0; col < k; col++) {
-            El::LockedView(Bc, B, 0, col, m, 1);
-            El::Transpose(Bc, BTr, oB == El::ADJOINT);
-#           if SKYLARK_HAVE_OPENMP
-#           pragma omp parallel for private(Cr)
-#           endif
-            for (int j = indptr[col]; j < indptr[col + 1]; j++) {
-                int row = indices[j];
-                T val = values[j];
-                El::View(Cr, C, row, 0, 1, m);
-                El::Axpy(alpha * val, BTr, Cr);
-            }
-        }
-    }
-
-    // TN - TODO: Not tested!
-    if (oA == El::TRANSPOSE && oB == El::NORMAL) {
-        T *c = C.Buffer();
-        int ldc = C.LDim();
-
-        const T *b = B.LockedBuffer();
-        int ldb = B.LDim();
-
-#       if SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for collapse(2)
-#       endif
-        for (int j = 0; j < n; j++)
-            for(int row = 0; row < k; row++) {
-                c[j * ldc + row] *= beta;
-                 for (int l = indptr[row]; l < indptr[row + 1]; l++) {
-                     int col = indices[l];
-                     T val = values[l];
-                     c[j * ldc + row] += val * b[j * ldb + col];
-                 }
-            }
-    }
-
-    // AN - TODO: Not tested!
-    if (oA == El::ADJOINT && oB == El::NORMAL) {
-        T *c = C.Buffer();
-        int ldc = C.LDim();
-
-        const T *b = B.LockedBuffer();
-        int ldb = B.LDim();
-
-#       if SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for collapse(2)
-#       endif
-        for (int j = 0; j < n; j++)
-            for(int row = 0; row < k; row++) {
-                c[j * ldc + row] *= beta;
-                 for (int l = indptr[row]; l < indptr[row + 1]; l++) {
-                     int col = indices[l];
-                     T val = El::Conj(values[l]);
-                     c[j * ldc + row] += val * b[j * ldb + col];
-                 }
-            }
-    }
-
-
-    // TT - TODO: Not tested!
-    if (oA == El::TRANSPOSE && (oB == El::TRANSPOSE || oB == El::ADJOINT)) {
-
-        El::Scale(beta, C);
-
-        El::Matrix<T> Bc;
-        El::Matrix<T> BTr;
-        El::Matrix<T> Cr;
-
-#       if SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for private(Cr, Bc, BTr)
-#       endif
-        for(int row = 0; row < k; row++) {
-            El::View(Cr, C, row, 0, 1, m);
-            for (int l = indptr[row]; l < indptr[row + 1]; l++) {
-                int col = indices[l];
-                T val = values[l];
-                El::LockedView(Bc, B, 0, col, m, 1);
-                El::Transpose(Bc, BTr, oB == El::ADJOINT);
-                El::Axpy(alpha * val, BTr, Cr);
-            }
-        }
-    }
-
-    // AT - TODO: Not tested!
-    if (oA == El::ADJOINT && (oB == El::TRANSPOSE || oB == El::ADJOINT)) {
-
-        El::Scale(beta, C);
-
-        El::Matrix<T> Bc;
-        El::Matrix<T> BTr;
-        El::Matrix<T> Cr;
-
-#       if SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for private(Cr, Bc, BTr)
-#       endif
-        for(int row = 0; row < k; row++) {
-            El::View(Cr, C, row, 0, 1, m);
-            for (int l = indptr[row]; l < indptr[row + 1]; l++) {
-                int col = indices[l];
-                T val = El::Conj(values[l]);
-                El::LockedView(Bc, B, 0, col, m, 1);
-                El::Transpose(Bc, BTr, oB == El::ADJOINT);
-                El::Axpy(alpha * val, BTr, Cr);
-            }
-        }
-    }
+    detail::spmm(gather, conj_s, conj_d,
+        A.width(), A.indptr(), A.indices(), A.locked_values(), alpha,
+        B.LockedBuffer(), in_rs, in_cs, C.Buffer(), 1, C.LDim(), C.Width());
 }
 
-template<typename T>
+template<typename T, typename I>
 inline void Gemm(El::Orientation oA, El::Orientation oB,
-    T alpha, const sparse_matrix_t<T>& A, const El::Matrix<T>& B,
+    T alpha, const sparse_matrix_t<T, I>& A, const El::Matrix<T>& B,
     El::Matrix<T>& C) {
-    int C_height = (oA == El::NORMAL ? A.height() : A.width());
-    int C_width = (oB == El::NORMAL ? B.Width() : B.Height());
+    El::Int C_height = (oA == El::NORMAL ? A.height() : A.width());
+    El::Int C_width = (oB == El::NORMAL ? B.Width() : B.Height());
     El::Zeros(C, C_height, C_width);
     base::Gemm(oA, oB, alpha, A, B, T(0), C);
 }
 
-template<typename T>
+template<typename T, typename I>
 inline void Gemm(El::Orientation oA, El::Orientation oB,
-    T alpha, const El::Matrix<T>& A, const sparse_matrix_t<T>& B,
+    T alpha, const El::Matrix<T>& A, const sparse_matrix_t<T, I>& B,
     El::Matrix<T>& C) {
-    int C_height = (oA == El::NORMAL ? A.Height() : A.Width());
-    int C_width = (oB == El::NORMAL ? B.width() : B.height());
+    El::Int C_height = (oA == El::NORMAL ? A.Height() : A.Width());
+    El::Int C_width = (oB == El::NORMAL ? B.width() : B.height());
     El::Zeros(C, C_height, C_width);
     base::Gemm(oA, oB, alpha, A, B, T(0), C);
 }
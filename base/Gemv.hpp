@@ -102,19 +102,19 @@ inline void Gemv(El::Orientation oA,
     base::Gemv(oA, alpha, A, x, T(0), y);
 }
 
-template<typename T>
+template<typename T, typename I>
 inline void Gemv(El::Orientation oA,
-    T alpha, const sparse_matrix_t<T>& A, const El::Matrix<T>& x,
+    T alpha, const sparse_matrix_t<T, I>& A, const El::Matrix<T>& x,
     T beta, El::Matrix<T>& y) {
     // TODO verify sizes etc.
 
-    const int* indptr = A.indptr();
-    const int* indices = A.indices();
+    const I* indptr = A.indptr();
+    const I* indices = A.indices();
     const double *values = A.locked_values();
     double *yd = y.Buffer();
     const double *xd = x.LockedBuffer();
 
-    int n = A.width();
+    I n = A.width();
 
     if (oA == El::NORMAL) {
         El::Scale(beta, y);
@@ -122,10 +122,10 @@ inline void Gemv(El::Orientation oA,
 #       if SKYLARK_HAVE_OPENMP
 #       pragma omp parallel for
 #       endif
-        for(int col = 0; col < n; col++) {
+        for(I col = 0; col < n; col++) {
             T xv = alpha * xd[col];
-            for (int j = indptr[col]; j < indptr[col + 1]; j++) {
-                     int row = indices[j];
+            for (I j = indptr[col]; j < indptr[col + 1]; j++) {
+                     I row = indices[j];
                      T val = values[j];
                      yd[row] += val * xv;
                  }
@@ -136,10 +136,10 @@ inline void Gemv(El::Orientation oA,
 #       if SKYLARK_HAVE_OPENMP
 #       pragma omp parallel for
 #       endif
-        for(int col = 0; col < n; col++) {
+        for(I col = 0; col < n; col++) {
             double yv = beta * yd[col];
-            for (int j = indptr[col]; j < indptr[col + 1]; j++) {
-                     int row = indices[j];
+            for (I j = indptr[col]; j < indptr[col + 1]; j++) {
+                     I row = indices[j];
                      T val = values[j];
                      yv += alpha * val * xd[row];
                  }
@@ -6,6 +6,7 @@
 #include "exception.hpp"
 #include "sparse_matrix.hpp"
 #include "computed_matrix.hpp"
+#include "detail/spmm.hpp"
 
 
 // Defines a generic Symm function that receives both dense and sparse matrices.
@@ -82,84 +83,42 @@ inline void Symm(El::LeftOrRight side, El::UpperOrLower uplo,
 
 /**
  * Symm between mixed Elemental, sparse input. Output is dense Elemental.
+ *
+ * Only the uplo triangle of A is referenced. A is traversed once for all
+ * the columns (LEFT) or rows (RIGHT) of B; see detail/spmm.hpp.
  */
-template<typename T>
+template<typename T, typename I>
 inline void Symm(El::LeftOrRight side, El::UpperOrLower uplo,
-    T alpha, const sparse_matrix_t<T>& A, const El::Matrix<T>& B,
+    T alpha, const sparse_matrix_t<T, I>& A, const El::Matrix<T>& B,
     T beta, El::Matrix<T>& C) {
-    // TODO verify sizes etc.
 
-    const int* indptr = A.indptr();
-    const int* indices = A.indices();
-    const T *values = A.locked_values();
+    const I n = A.width();
+    if (A.height() != n || C.Height() != B.Height() ||
+        C.Width() != B.Width() ||
+        (side == El::LEFT ? B.Height() : B.Width()) != n)
+        SKYLARK_THROW_EXCEPTION (
+            base::invalid_parameters()
+                << base::error_msg("Dimension mismatch in sparse Symm"));
 
-    int k = A.width();
-    int n = B.Width();
-    int m = B.Height();
-
-    // LEFT
-    if (side == El::LEFT) {
-        El::Scale(beta, C);
-
-        T *c = C.Buffer();
-        int ldc = C.LDim();
-
-        const T *b = B.LockedBuffer();
-        int ldb = B.LDim();
-
-#       if SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for
-#       endif
-        for (int i = 0; i < n; i++)
-            for (int col = 0; col < k; col++)
-                 for (int j = indptr[col]; j < indptr[col + 1]; j++) {
-                     int row = indices[j];
-
-                     if ((uplo == El::UPPER && row > col) ||
-                         (uplo == El::LOWER && row < col))
-                         continue;
-
-                     T val = values[j];
-                     c[i * ldc + row] += alpha * val * b[i * ldb + col];
-                     if (row != col)
-                         c[i * ldc + col] += alpha * val * b[i * ldb + row];
-                 }
-    }
+    El::Scale(beta, C);
 
-    // RIGHT - TODO: Not tested!
-    if (side == El::RIGHT) {
-        int k = A.width();
-        int n = B.Width();
-        int m = A.height();
-
-        El::Scale(beta, C);
-
-        El::Matrix<T> Bc;
-        El::Matrix<T> Cc;
-
-#       if SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for private(Cc, Bc)
-#       endif
-        for (int col = 0; col < n; col++) {
-            El::View(Cc, C, 0, col, m, 1);
-            for (int j = indptr[col]; j < indptr[col + 1]; j++) {
-                int row = indices[j];
-
-                if ((uplo == El::UPPER && row > col) ||
-                    (uplo == El::LOWER && row < col))
-                    continue;
-
-                T val = values[j];
-                El::LockedView(Bc, B, 0, row, m, 1);
-                El::Axpy(alpha * val, Bc, Cc);
-            }
-        }
-    }
+    const size_t ldb = B.LDim(), ldc = C.LDim();
+
+    // LEFT: the right-hand sides are the columns of B and C, RIGHT: rows
+    // (C^T = A B^T).
+    if (side == El::LEFT)
+        detail::spmm_symmetric(uplo == El::LOWER, n, A.indptr(),
+            A.indices(), A.locked_values(), alpha,
+            B.LockedBuffer(), 1, ldb, C.Buffer(), 1, ldc, B.Width());
+    else
+        detail::spmm_symmetric(uplo == El::LOWER, n, A.indptr(),
+            A.indices(), A.locked_values(), alpha,
+            B.LockedBuffer(), ldb, 1, C.Buffer(), ldc, 1, B.Height());
 }
 
-template<typename T>
+template<typename T, typename I>
 inline void Symm(El::LeftOrRight side, El::UpperOrLower uplo,
-    T alpha, const sparse_matrix_t<T>& A, const El::Matrix<T>& B,
+    T alpha, const sparse_matrix_t<T, I>& A, const El::Matrix<T>& B,
     El::Matrix<T>& C) {
 
     base::Symm(side, uplo, alpha, A, B, static_cast<T>(0.0), C);
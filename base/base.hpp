@@ -27,6 +27,7 @@
 #include "Gemv.hpp"
 #include "inner.hpp"
 #include "distance.hpp"
+#include "kernel_matrix.hpp"
 #include "QR.hpp"
 #include "randgen.hpp"
 #include "quasirand.hpp"
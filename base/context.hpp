@@ -121,9 +121,7 @@ struct context_t {
                 allocation_exception()
                     << error_msg(ba.what()) );
         }
-        for(size_t i = 0; i < size; i++) {
-            random_samples_array[i] = allocated_random_samples_array[i];
-        }
+        allocated_random_samples_array.fill(0, size, random_samples_array.data());
         return random_samples_array;
     }
 
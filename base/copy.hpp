@@ -19,15 +19,15 @@ inline void Copy(const El::AbstractDistMatrix<T>& A,
 /**
  * Copy matrix A into B, densifiying it in the process.
  */
-template<typename T>
-inline void DenseCopy(const sparse_matrix_t<T>& A, El::Matrix<T>& B) {
+template<typename T, typename I>
+inline void DenseCopy(const sparse_matrix_t<T, I>& A, El::Matrix<T>& B) {
     El::Zeros(B, A.height(), A.width());
 
-    const int *indptr = A.indptr();
-    const int *indices = A.indices();
+    const I *indptr = A.indptr();
+    const I *indices = A.indices();
     const T *values = A.locked_values();
-    for(int col = 0; col < A.width(); col++)
-        for(int idx = indptr[col]; idx < indptr[col + 1]; idx++)
+    for(I col = 0; col < A.width(); col++)
+        for(I idx = indptr[col]; idx < indptr[col + 1]; idx++)
             B.Set(indices[idx], col, values[idx]);
 }
 
@@ -48,17 +48,17 @@ inline void DenseSubmatrixCopy(const El::Matrix<T>& A, El::Matrix<T> &B,
     El::Copy(Av, B);
 }
 
-template<typename T>
-inline void DenseSubmatrixCopy(const sparse_matrix_t<T>& A, El::Matrix<T> &B,
-    El::Int i, El::Int j, El::Int height, El::Int width) {
+template<typename T, typename I>
+inline void DenseSubmatrixCopy(const sparse_matrix_t<T, I>& A,
+    El::Matrix<T> &B, El::Int i, El::Int j, El::Int height, El::Int width) {
 
     El::Zeros(B, height, width);
 
-    const int *indptr = A.indptr();
-    const int *indices = A.indices();
+    const I *indptr = A.indptr();
+    const I *indices = A.indices();
     const T *values = A.locked_values();
-    for(int col = j; col < j + width; col++)
-        for(int idx = indptr[col]; idx < indptr[col + 1]; idx++)
+    for(I col = j; col < j + width; col++)
+        for(I idx = indptr[col]; idx < indptr[col + 1]; idx++)
             if (indices[idx] >= i && indices[idx] < i + height)
                 B.Set(indices[idx] - i, col - j, values[idx]);
 }
@@ -0,0 +1,329 @@
+#ifndef SKYLARK_COO_ASSEMBLY_HPP
+#define SKYLARK_COO_ASSEMBLY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#ifdef SKYLARK_HAVE_OPENMP
+#include <omp.h>
+#endif
+
+namespace skylark { namespace base { namespace detail {
+
+/**
+ * Stable LSD radix sort of (key, value) pairs, 8 bits per pass. Byte
+ * positions that are zero in all keys are skipped, so small matrices only
+ * need a few passes.
+ *
+ * With parallel set the keys are split into contiguous chunks (which keeps
+ * the sort stable), and the histograms and scatters of the chunks are
+ * shared by the OpenMP threads. The chunks do not depend on the size of the
+ * team, so the result is the same if the team is smaller than requested
+ * (e.g. in a nested region).
+ */
+template<typename ValueType>
+void radix_sort_pairs(std::vector<uint64_t>& keys,
+    std::vector<ValueType>& values, bool parallel) {
+
+    const size_t n = keys.size();
+    if (n < 2)
+        return;
+
+    uint64_t used = 0;
+    for(size_t k = 0; k < n; k++)
+        used |= keys[k];
+
+    int nchunks = 1;
+#   ifdef SKYLARK_HAVE_OPENMP
+    if (parallel)
+        nchunks = std::max(1, std::min(omp_get_max_threads(),
+                static_cast<int>(n / 65536)));
+#   endif
+
+    std::vector<uint64_t> keys_tmp(n);
+    std::vector<ValueType> values_tmp(n);
+    std::vector<size_t> hist(256 * nchunks);
+
+    for(int shift = 0; shift < 64; shift += 8) {
+        if (((used >> shift) & 0xff) == 0)
+            continue;
+
+        std::fill(hist.begin(), hist.end(), 0);
+
+#       ifdef SKYLARK_HAVE_OPENMP
+#       pragma omp parallel num_threads(nchunks) if (nchunks > 1)
+#       endif
+        {
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp for schedule(static, 1)
+#           endif
+            for(int t = 0; t < nchunks; t++) {
+                size_t lo = n * t / nchunks, hi = n * (t + 1) / nchunks;
+                size_t *h = &hist[256 * t];
+                for(size_t k = lo; k < hi; k++)
+                    h[(keys[k] >> shift) & 0xff]++;
+            }
+
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp single
+#           endif
+            {
+                // Offsets: digit major, then chunk.
+                size_t sum = 0;
+                for(int d = 0; d < 256; d++)
+                    for(int s = 0; s < nchunks; s++) {
+                        size_t c = hist[256 * s + d];
+                        hist[256 * s + d] = sum;
+                        sum += c;
+                    }
+            }
+
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp for schedule(static, 1)
+#           endif
+            for(int t = 0; t < nchunks; t++) {
+                size_t lo = n * t / nchunks, hi = n * (t + 1) / nchunks;
+                size_t *h = &hist[256 * t];
+                for(size_t k = lo; k < hi; k++) {
+                    size_t pos = h[(keys[k] >> shift) & 0xff]++;
+                    keys_tmp[pos] = keys[k];
+                    values_tmp[pos] = values[k];
+                }
+            }
+        }
+
+        keys.swap(keys_tmp);
+        values.swap(values_tmp);
+    }
+}
+
+/**
+ * Sum the values of equal keys in sorted (key, value) pairs, in order.
+ * Keys and values are shrunk to the distinct keys.
+ */
+template<typename ValueType>
+void reduce_sorted_pairs(std::vector<uint64_t>& keys,
+    std::vector<ValueType>& values) {
+
+    size_t u = 0;
+    for(size_t k = 0; k < keys.size(); k++) {
+        if (k > 0 && keys[k] == keys[u - 1])
+            values[u - 1] += values[k];
+        else {
+            keys[u] = keys[k];
+            values[u] = values[k];
+            u++;
+        }
+    }
+
+    keys.resize(u);
+    values.resize(u);
+}
+
+/**
+ * Temporary storage for assembling a local CSC matrix from (row, col, value)
+ * updates, with duplicates summed.
+ *
+ * Every OpenMP thread of a (non-nested) parallel region appends to its own
+ * coordinate buffer, so updates can be queued concurrently. Updates from
+ * nested regions, or from threads beyond those counted at construction, go
+ * to a shared buffer under a critical section. A buffer that grows beyond a
+ * threshold is sorted and reduced in place, which bounds the memory by the
+ * number of distinct entries (plus the threshold). Assembly is a parallel
+ * radix sort on (col, row) keys followed by a segmented reduction.
+ * Duplicates are summed in thread order (the shared buffer last) and,
+ * within a buffer, in the order they were queued; so single threaded use
+ * sums in queue order.
+ */
+template<typename ValueType>
+class coo_assembly_buffer_t {
+
+public:
+
+    typedef ValueType value_type;
+
+    coo_assembly_buffer_t(size_t compact_threshold = size_t(1) << 22)
+        : _compact_threshold(compact_threshold) {
+
+        int nthreads = 1;
+#       ifdef SKYLARK_HAVE_OPENMP
+        nthreads = std::max(omp_get_max_threads(), omp_get_num_procs());
+#       endif
+        _buffers.resize(nthreads + 1);     // the last one is shared
+        for(size_t t = 0; t < _buffers.size(); t++)
+            _buffers[t].compact_at = _compact_threshold;
+    }
+
+    /**
+     * Queue an update. Safe to call concurrently from different threads of
+     * an OpenMP parallel region.
+     */
+    void push(int i, int j, value_type value) {
+
+        const int shared = static_cast<int>(_buffers.size()) - 1;
+        int t = 0;
+#       ifdef SKYLARK_HAVE_OPENMP
+        t = omp_get_level() > 1 ? shared : omp_get_thread_num();
+        if (t >= shared) {
+#           pragma omp critical(skylark_coo_assembly_push)
+            push(_buffers[shared], i, j, value);
+            return;
+        }
+#       endif
+
+        push(_buffers[t], i, j, value);
+    }
+
+    /**
+     * Assemble the queued updates into CSC arrays, and clear the buffer.
+     * Row indices are sorted within columns.
+     *
+     * \param n_rows in: minimum number of rows, out: enlarged to cover all
+     *               queued rows
+     * \param n_cols in: minimum number of columns, out: enlarged to cover all
+     *               queued columns
+     * \param indptr output column pointers
+     * \param indices output row indices
+     * \param values output values
+     */
+    void assemble(int& n_rows, int& n_cols, std::vector<int>& indptr,
+        std::vector<int>& indices, std::vector<value_type>& values) {
+
+        // Concatenate thread buffers, releasing them as we go.
+        std::vector<size_t> offset(_buffers.size() + 1, 0);
+        for(size_t t = 0; t < _buffers.size(); t++)
+            offset[t + 1] = offset[t] + _buffers[t].keys.size();
+
+        const size_t n = offset[_buffers.size()];
+        std::vector<uint64_t> keys(n);
+        std::vector<value_type> vals(n);
+
+#       ifdef SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for schedule(dynamic, 1)
+#       endif
+        for(int t = 0; t < static_cast<int>(_buffers.size()); t++) {
+            thread_buffer_t &b = _buffers[t];
+            std::copy(b.keys.begin(), b.keys.end(), keys.begin() + offset[t]);
+            std::copy(b.values.begin(), b.values.end(),
+                vals.begin() + offset[t]);
+            std::vector<uint64_t>().swap(b.keys);
+            std::vector<value_type>().swap(b.values);
+            b.compact_at = _compact_threshold;
+        }
+
+        radix_sort_pairs(keys, vals, true);
+
+        if (n > 0)
+            n_cols = std::max(n_cols, col(keys[n - 1]) + 1);
+
+        // Segmented reduction. Chunks start at segment boundaries, and are
+        // shared by the threads of the team (whatever its size).
+        int nchunks = 1;
+#       ifdef SKYLARK_HAVE_OPENMP
+        nchunks = std::max(1, std::min(omp_get_max_threads(),
+                static_cast<int>(n / 65536)));
+#       endif
+        std::vector<size_t> start(nchunks + 1, n), count(nchunks + 1, 0);
+        for(int t = 0; t < nchunks; t++) {
+            size_t s = n * t / nchunks;
+            while (s > 0 && s < n && keys[s] == keys[s - 1])
+                s++;
+            start[t] = s;
+        }
+
+        int max_row = -1;
+
+#       ifdef SKYLARK_HAVE_OPENMP
+#       pragma omp parallel num_threads(nchunks) if (nchunks > 1) \
+            reduction(max:max_row)
+#       endif
+        {
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp for schedule(static, 1)
+#           endif
+            for(int t = 0; t < nchunks; t++) {
+                size_t c = 0;
+                for(size_t k = start[t]; k < start[t + 1]; k++)
+                    if (k == 0 || keys[k] != keys[k - 1])
+                        c++;
+                count[t + 1] = c;
+            }
+
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp single
+#           endif
+            {
+                for(int s = 0; s < nchunks; s++)
+                    count[s + 1] += count[s];
+                indices.resize(count[nchunks]);
+                values.resize(count[nchunks]);
+                indptr.assign(n_cols + 1, 0);
+            }
+
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp for schedule(static, 1)
+#           endif
+            for(int t = 0; t < nchunks; t++) {
+                long long u = static_cast<long long>(count[t]) - 1;
+                for(size_t k = start[t]; k < start[t + 1]; k++) {
+                    if (k == 0 || keys[k] != keys[k - 1]) {
+                        u++;
+                        indices[u] = row(keys[k]);
+                        values[u] = vals[k];
+                        max_row = std::max(max_row, indices[u]);
+                    } else
+                        values[u] += vals[k];
+
+                    // Last entry of a column marks the end of that column.
+                    if (k + 1 == n || col(keys[k + 1]) != col(keys[k]))
+                        indptr[col(keys[k]) + 1] = u + 1;
+                }
+            }
+        }
+
+        for(int j = 0; j < n_cols; j++)
+            indptr[j + 1] = std::max(indptr[j + 1], indptr[j]);
+
+        n_rows = std::max(n_rows, max_row + 1);
+    }
+
+private:
+
+    struct thread_buffer_t {
+        std::vector<uint64_t> keys;
+        std::vector<value_type> values;
+        size_t compact_at;
+        char pad[64]; // keep threads' bookkeeping on separate cache lines
+    };
+
+    size_t _compact_threshold;
+    std::vector<thread_buffer_t> _buffers;
+
+    void push(thread_buffer_t &b, int i, int j, value_type value) {
+        b.keys.push_back(key(i, j));
+        b.values.push_back(value);
+
+        if (b.keys.size() >= b.compact_at) {
+            radix_sort_pairs(b.keys, b.values, false);
+            reduce_sorted_pairs(b.keys, b.values);
+            b.compact_at = std::max(_compact_threshold, 2 * b.keys.size());
+        }
+    }
+
+    static uint64_t key(int i, int j) {
+        return (static_cast<uint64_t>(j) << 32) | static_cast<uint32_t>(i);
+    }
+
+    static int row(uint64_t key) {
+        return static_cast<int>(key & 0xffffffffu);
+    }
+
+    static int col(uint64_t key) {
+        return static_cast<int>(key >> 32);
+    }
+};
+
+} } } // namespace skylark::base::detail
+
+#endif // SKYLARK_COO_ASSEMBLY_HPP
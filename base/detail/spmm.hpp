@@ -0,0 +1,570 @@
+#ifndef SKYLARK_SPMM_HPP
+#define SKYLARK_SPMM_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#ifdef SKYLARK_HAVE_OPENMP
+#include <omp.h>
+#endif
+
+namespace skylark { namespace base { namespace detail {
+
+/**
+ * Kernels for products of a local CSC matrix S with a dense matrix.
+ *
+ * Every sparse-dense Gemm reduces to one of two operations on a dense input
+ * In and output Out, both addressed through (row, column) strides, so that
+ * transposed operands cost nothing:
+ *
+ *   scatter: Out(r, j) += alpha * sum_c S(r, c) In(c, j)   (Out = S In)
+ *   gather:  Out(c, j) += alpha * sum_r S(r, c) In(r, j)   (Out = S^T In)
+ *
+ * The j's are the right-hand sides. When they are contiguous in both In and
+ * Out, the kernels stream panels of spmm_panel_width right-hand sides with
+ * vector loops. Otherwise spmm_rhs_block right-hand sides are handled per
+ * pass over S, kept in registers. Work is split so that every thread owns
+ * the part of Out it writes, hence no atomics are needed. Only when a
+ * scatter has too few right-hand sides to give every thread a share, S is
+ * split instead, and the threads' contributions are summed at the end.
+ */
+
+/// Right-hand sides per panel in the contiguous kernels.
+static const int spmm_panel_width = 256;
+
+/// Right-hand sides per pass over S in the strided kernels.
+static const int spmm_rhs_block = 4;
+
+/// Most right-hand sides for which a scatter may split S among the threads.
+static const int spmm_split_max_rhs = 16;
+
+template<bool Conj, typename T>
+inline T spmm_conj(const T& x) {
+    return Conj ? El::Conj(x) : x;
+}
+
+/**
+ * Scatter with the columns of S split among the threads, in nnz-balanced
+ * ranges. Each thread accumulates into a private buffer spanning the rows
+ * its range reaches (rows contiguous), and the buffers are added to Out row
+ * range by row range once all threads are done.
+ */
+template<bool ConjS, bool ConjD, typename IndexType, typename T>
+void spmm_scatter_split(int nchunks, IndexType n_cols,
+    const IndexType *indptr, const IndexType *indices, const T *values,
+    T alpha, const T *in, size_t in_rs, size_t in_cs,
+    T *out, size_t out_rs, size_t out_cs, int nj) {
+
+    std::vector<IndexType> bounds(nchunks + 1, n_cols);
+    bounds[0] = 0;
+    const double nnz = indptr[n_cols];
+    for(int t = 1; t < nchunks; t++)
+        bounds[t] = std::max(bounds[t - 1], IndexType(std::lower_bound(indptr,
+                    indptr + n_cols, IndexType(nnz * t / nchunks)) - indptr));
+
+    std::vector<std::vector<T> > bufs(nchunks);
+    std::vector<IndexType> lo(nchunks), hi(nchunks);
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel num_threads(nchunks)
+#   endif
+    {
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(static, 1)
+#       endif
+        for(int t = 0; t < nchunks; t++) {
+            const IndexType c0 = bounds[t], c1 = bounds[t + 1];
+
+            IndexType l0 = 0, h0 = 0;
+            if (indptr[c0] < indptr[c1]) {
+                l0 = *std::min_element(indices + indptr[c0],
+                    indices + indptr[c1]);
+                h0 = *std::max_element(indices + indptr[c0],
+                    indices + indptr[c1]) + 1;
+            }
+            lo[t] = l0;
+            hi[t] = h0;
+            bufs[t].assign(size_t(h0 - l0) * nj, T(0));
+
+            T *buf = bufs[t].data();
+            for(IndexType c = c0; c < c1; c++) {
+                const T *x = in + c * in_rs;
+                for(IndexType l = indptr[c]; l < indptr[c + 1]; l++) {
+                    const T v = alpha * spmm_conj<ConjS>(values[l]);
+                    T *yr = buf + size_t(indices[l] - l0) * nj;
+                    for(int j = 0; j < nj; j++)
+                        yr[j] += v * spmm_conj<ConjD>(x[j * in_cs]);
+                }
+            }
+        }
+
+        // Sum the buffers into Out, each thread a range of the rows reached.
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(static, 1)
+#       endif
+        for(int t = 0; t < nchunks; t++) {
+            const IndexType rows = *std::max_element(hi.begin(), hi.end());
+            const IndexType q0 = IndexType(double(rows) * t / nchunks),
+                q1 = IndexType(double(rows) * (t + 1) / nchunks);
+            for(int s = 0; s < nchunks; s++) {
+                const IndexType r0 = std::max(q0, lo[s]),
+                    r1 = std::min(q1, hi[s]);
+                for(IndexType r = r0; r < r1; r++) {
+                    const T *b = bufs[s].data() + size_t(r - lo[s]) * nj;
+                    T *yr = out + r * out_rs;
+                    for(int j = 0; j < nj; j++)
+                        yr[j * out_cs] += b[j];
+                }
+            }
+        }
+    }
+}
+
+template<bool ConjS, bool ConjD, typename IndexType, typename T>
+void spmm_scatter(IndexType n_cols, const IndexType *indptr,
+    const IndexType *indices, const T *values, T alpha,
+    const T *in, size_t in_rs, size_t in_cs,
+    T *out, size_t out_rs, size_t out_cs, int nj) {
+
+    int nthreads = 1;
+#   ifdef SKYLARK_HAVE_OPENMP
+    nthreads = omp_get_max_threads();
+#   endif
+
+    // Too few panels / blocks of right-hand sides for the team: split S.
+    const bool contiguous = in_cs == 1 && out_cs == 1;
+    const int units = contiguous ? (nj + 7) / 8 :
+        (nj + spmm_rhs_block - 1) / spmm_rhs_block;
+    const int nchunks = int(std::min(IndexType(nthreads), n_cols));
+    if (units < nchunks && nj <= spmm_split_max_rhs) {
+        spmm_scatter_split<ConjS, ConjD>(nchunks, n_cols, indptr, indices,
+            values, alpha, in, in_rs, in_cs, out, out_rs, out_cs, nj);
+        return;
+    }
+
+    if (contiguous) {
+        // Each thread owns a panel of right-hand sides (a tile of Out), and
+        // traverses all of S for it.
+        int width = (nj + nthreads - 1) / nthreads;
+        width = std::min(spmm_panel_width, std::max(8, (width + 7) / 8 * 8));
+        int npanels = (nj + width - 1) / width;
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for schedule(static)
+#       endif
+        for(int p = 0; p < npanels; p++) {
+            const int j0 = p * width, w = std::min(width, nj - j0);
+            for(IndexType c = 0; c < n_cols; c++) {
+                const T *x = in + c * in_rs + j0;
+                for(IndexType l = indptr[c]; l < indptr[c + 1]; l++) {
+                    const T v = alpha * spmm_conj<ConjS>(values[l]);
+                    T *y = out + indices[l] * out_rs + j0;
+#                   if SKYLARK_HAVE_OPENMP
+#                   pragma omp simd
+#                   endif
+                    for(int j = 0; j < w; j++)
+                        y[j] += v * spmm_conj<ConjD>(x[j]);
+                }
+            }
+        }
+
+        return;
+    }
+
+    const int jb = spmm_rhs_block;
+    const int nblocks = (nj + jb - 1) / jb;
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for schedule(static)
+#   endif
+    for(int b = 0; b < nblocks; b++) {
+        const int j0 = b * jb, w = std::min(jb, nj - j0);
+        T *y = out + j0 * out_cs;
+
+        if (w == jb) {
+            for(IndexType c = 0; c < n_cols; c++) {
+                const T *x = in + c * in_rs + j0 * in_cs;
+                const T x0 = alpha * spmm_conj<ConjD>(x[0]);
+                const T x1 = alpha * spmm_conj<ConjD>(x[in_cs]);
+                const T x2 = alpha * spmm_conj<ConjD>(x[2 * in_cs]);
+                const T x3 = alpha * spmm_conj<ConjD>(x[3 * in_cs]);
+                for(IndexType l = indptr[c]; l < indptr[c + 1]; l++) {
+                    const T v = spmm_conj<ConjS>(values[l]);
+                    T *yr = y + indices[l] * out_rs;
+                    yr[0] += v * x0;
+                    yr[out_cs] += v * x1;
+                    yr[2 * out_cs] += v * x2;
+                    yr[3 * out_cs] += v * x3;
+                }
+            }
+        } else {
+            for(IndexType c = 0; c < n_cols; c++) {
+                const T *x = in + c * in_rs + j0 * in_cs;
+                for(IndexType l = indptr[c]; l < indptr[c + 1]; l++) {
+                    const T v = alpha * spmm_conj<ConjS>(values[l]);
+                    T *yr = y + indices[l] * out_rs;
+                    for(int k = 0; k < w; k++)
+                        yr[k * out_cs] += v * spmm_conj<ConjD>(x[k * in_cs]);
+                }
+            }
+        }
+    }
+}
+
+template<bool ConjS, bool ConjD, typename IndexType, typename T>
+void spmm_gather(IndexType n_cols, const IndexType *indptr,
+    const IndexType *indices, const T *values, T alpha,
+    const T *in, size_t in_rs, size_t in_cs,
+    T *out, size_t out_rs, size_t out_cs, int nj) {
+
+    if (in_cs == 1 && out_cs == 1) {
+        // Tasks are (column of S, panel); four nonzeros are combined per
+        // update of the output panel.
+        const int width = spmm_panel_width;
+        const int npanels = (nj + width - 1) / width;
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for collapse(2) schedule(dynamic, 16)
+#       endif
+        for(IndexType c = 0; c < n_cols; c++)
+            for(int p = 0; p < npanels; p++) {
+                const int j0 = p * width, w = std::min(width, nj - j0);
+                T *y = out + c * out_rs + j0;
+                const T *xb = in + j0;
+
+                IndexType l = indptr[c];
+                for(; l + 3 < indptr[c + 1]; l += 4) {
+                    const T v0 = alpha * spmm_conj<ConjS>(values[l]);
+                    const T v1 = alpha * spmm_conj<ConjS>(values[l + 1]);
+                    const T v2 = alpha * spmm_conj<ConjS>(values[l + 2]);
+                    const T v3 = alpha * spmm_conj<ConjS>(values[l + 3]);
+                    const T *x0 = xb + indices[l] * in_rs;
+                    const T *x1 = xb + indices[l + 1] * in_rs;
+                    const T *x2 = xb + indices[l + 2] * in_rs;
+                    const T *x3 = xb + indices[l + 3] * in_rs;
+#                   if SKYLARK_HAVE_OPENMP
+#                   pragma omp simd
+#                   endif
+                    for(int j = 0; j < w; j++)
+                        y[j] += v0 * spmm_conj<ConjD>(x0[j]) +
+                            v1 * spmm_conj<ConjD>(x1[j]) +
+                            v2 * spmm_conj<ConjD>(x2[j]) +
+                            v3 * spmm_conj<ConjD>(x3[j]);
+                }
+
+                for(; l < indptr[c + 1]; l++) {
+                    const T v = alpha * spmm_conj<ConjS>(values[l]);
+                    const T *x = xb + indices[l] * in_rs;
+#                   if SKYLARK_HAVE_OPENMP
+#                   pragma omp simd
+#                   endif
+                    for(int j = 0; j < w; j++)
+                        y[j] += v * spmm_conj<ConjD>(x[j]);
+                }
+            }
+
+        return;
+    }
+
+    const int jb = spmm_rhs_block;
+    const int nblocks = (nj + jb - 1) / jb;
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for collapse(2) schedule(dynamic, 16)
+#   endif
+    for(IndexType c = 0; c < n_cols; c++)
+        for(int b = 0; b < nblocks; b++) {
+            const int j0 = b * jb, w = std::min(jb, nj - j0);
+            const T *x = in + j0 * in_cs;
+            T *y = out + c * out_rs + j0 * out_cs;
+
+            if (w == jb) {
+                T acc0 = T(0), acc1 = T(0), acc2 = T(0), acc3 = T(0);
+                for(IndexType l = indptr[c]; l < indptr[c + 1]; l++) {
+                    const T v = spmm_conj<ConjS>(values[l]);
+                    const T *xr = x + indices[l] * in_rs;
+                    acc0 += v * spmm_conj<ConjD>(xr[0]);
+                    acc1 += v * spmm_conj<ConjD>(xr[in_cs]);
+                    acc2 += v * spmm_conj<ConjD>(xr[2 * in_cs]);
+                    acc3 += v * spmm_conj<ConjD>(xr[3 * in_cs]);
+                }
+                y[0] += alpha * acc0;
+                y[out_cs] += alpha * acc1;
+                y[2 * out_cs] += alpha * acc2;
+                y[3 * out_cs] += alpha * acc3;
+            } else {
+                for(int k = 0; k < w; k++) {
+                    T acc = T(0);
+                    for(IndexType l = indptr[c]; l < indptr[c + 1]; l++)
+                        acc += spmm_conj<ConjS>(values[l]) *
+                            spmm_conj<ConjD>(x[indices[l] * in_rs + k * in_cs]);
+                    y[k * out_cs] += alpha * acc;
+                }
+            }
+        }
+}
+
+/**
+ * Out += alpha * S In (gather = false) or alpha * S^T In (gather = true),
+ * optionally conjugating S and/or In. In(i, j) is in[i * in_rs + j * in_cs],
+ * and likewise for Out; nj is the number of right-hand sides.
+ */
+template<typename IndexType, typename T>
+void spmm(bool gather, bool conj_s, bool conj_d,
+    IndexType n_cols, const IndexType *indptr, const IndexType *indices,
+    const T *values, T alpha, const T *in, size_t in_rs, size_t in_cs,
+    T *out, size_t out_rs, size_t out_cs, int nj) {
+
+    if (nj == 0 || n_cols == 0)
+        return;
+
+#   define SKYLARK_SPMM_DISPATCH(KERNEL)                                     \
+    if (conj_s && conj_d)                                                    \
+        KERNEL<true, true>(n_cols, indptr, indices, values, alpha,           \
+            in, in_rs, in_cs, out, out_rs, out_cs, nj);                      \
+    else if (conj_s)                                                         \
+        KERNEL<true, false>(n_cols, indptr, indices, values, alpha,          \
+            in, in_rs, in_cs, out, out_rs, out_cs, nj);                      \
+    else if (conj_d)                                                         \
+        KERNEL<false, true>(n_cols, indptr, indices, values, alpha,          \
+            in, in_rs, in_cs, out, out_rs, out_cs, nj);                      \
+    else                                                                     \
+        KERNEL<false, false>(n_cols, indptr, indices, values, alpha,         \
+            in, in_rs, in_cs, out, out_rs, out_cs, nj);
+
+    if (gather) {
+        SKYLARK_SPMM_DISPATCH(spmm_gather)
+    } else {
+        SKYLARK_SPMM_DISPATCH(spmm_scatter)
+    }
+
+#   undef SKYLARK_SPMM_DISPATCH
+}
+
+/**
+ * Kernels for products of a symmetric matrix, given by one triangle of a
+ * local CSC matrix S (the nonzeros in the other triangle are ignored), with
+ * a dense matrix: Out += alpha * sym(S) In.
+ *
+ * S is traversed once for all right-hand sides. Every stored S(r, c) of the
+ * triangle contributes to row c of the output (mirrored update) and, off
+ * the diagonal, to row r (direct update). The columns of S are split among
+ * the threads in nnz-balanced ranges, and each thread owns the output rows
+ * of its range: mirrored updates and direct updates to its own rows go
+ * there, direct updates to other rows go to a private buffer spanning only
+ * the rows the thread actually reaches. The buffers are summed, row range
+ * by row range, once all threads are done.
+ *
+ * Rows of In and of the accumulated output are kept contiguous (In is
+ * packed if needed), so the updates for all right-hand sides are vector
+ * loops; for up to spmm_symmetric_max_unrolled right-hand sides they are
+ * unrolled at compile time and the mirrored sums stay in registers.
+ */
+
+/// Largest number of right-hand sides with a compile-time unrolled kernel.
+static const int spmm_symmetric_max_unrolled = 8;
+
+template<bool Lower, int K, typename IndexType, typename T>
+void spmm_symmetric_columns(IndexType c0, IndexType c1,
+    const IndexType *indptr, const IndexType *indices, const T *values,
+    const T *x, size_t ldx, T *y, T *buf, IndexType buf_lo) {
+
+    // K right-hand sides, the mirrored sums in registers.
+    for(IndexType c = c0; c < c1; c++) {
+        const T *xc = x + c * ldx;
+        T acc[K];
+        for(int j = 0; j < K; j++)
+            acc[j] = T(0);
+
+        for(IndexType l = indptr[c]; l < indptr[c + 1]; l++) {
+            const IndexType r = indices[l];
+            if (Lower ? (r < c) : (r > c))
+                continue;
+
+            const T v = values[l];
+            const T *xr = x + r * ldx;
+            for(int j = 0; j < K; j++)
+                acc[j] += v * xr[j];
+
+            if (r != c) {
+                T *yr = (r >= c0 && r < c1) ?
+                    y + size_t(r) * K : buf + size_t(r - buf_lo) * K;
+                for(int j = 0; j < K; j++)
+                    yr[j] += v * xc[j];
+            }
+        }
+
+        T *yc = y + size_t(c) * K;
+        for(int j = 0; j < K; j++)
+            yc[j] += acc[j];
+    }
+}
+
+template<bool Lower, typename IndexType, typename T>
+void spmm_symmetric_columns_generic(IndexType c0, IndexType c1,
+    const IndexType *indptr, const IndexType *indices, const T *values,
+    const T *x, size_t ldx, T *y, T *buf, IndexType buf_lo, int nj) {
+
+    // The mirrored sums go directly to the (own) output row.
+    for(IndexType c = c0; c < c1; c++) {
+        const T *xc = x + c * ldx;
+        T *yc = y + size_t(c) * nj;
+
+        for(IndexType l = indptr[c]; l < indptr[c + 1]; l++) {
+            const IndexType r = indices[l];
+            if (Lower ? (r < c) : (r > c))
+                continue;
+
+            const T v = values[l];
+            const T *xr = x + r * ldx;
+            for(int j = 0; j < nj; j++)
+                yc[j] += v * xr[j];
+
+            if (r != c) {
+                T *yr = (r >= c0 && r < c1) ?
+                    y + size_t(r) * nj : buf + size_t(r - buf_lo) * nj;
+                for(int j = 0; j < nj; j++)
+                    yr[j] += v * xc[j];
+            }
+        }
+    }
+}
+
+template<bool Lower, typename IndexType, typename T>
+void spmm_symmetric_dispatch(IndexType c0, IndexType c1,
+    const IndexType *indptr, const IndexType *indices, const T *values,
+    const T *x, size_t ldx, T *y, T *buf, IndexType buf_lo, int nj) {
+
+    switch (nj) {
+    case 1:
+        spmm_symmetric_columns<Lower, 1>(c0, c1, indptr, indices, values,
+            x, ldx, y, buf, buf_lo);
+        break;
+    case 2:
+        spmm_symmetric_columns<Lower, 2>(c0, c1, indptr, indices, values,
+            x, ldx, y, buf, buf_lo);
+        break;
+    case 4:
+        spmm_symmetric_columns<Lower, 4>(c0, c1, indptr, indices, values,
+            x, ldx, y, buf, buf_lo);
+        break;
+    case 8:
+        spmm_symmetric_columns<Lower, 8>(c0, c1, indptr, indices, values,
+            x, ldx, y, buf, buf_lo);
+        break;
+    default:
+        spmm_symmetric_columns_generic<Lower>(c0, c1, indptr, indices,
+            values, x, ldx, y, buf, buf_lo, nj);
+    }
+}
+
+/**
+ * Out += alpha * sym(S) In, where S is n x n and only its lower (lower =
+ * true) or upper triangle is referenced. Strides as in spmm.
+ */
+template<typename IndexType, typename T>
+void spmm_symmetric(bool lower, IndexType n, const IndexType *indptr,
+    const IndexType *indices, const T *values, T alpha,
+    const T *in, size_t in_rs, size_t in_cs,
+    T *out, size_t out_rs, size_t out_cs, int nj) {
+
+    if (nj == 0 || n == 0)
+        return;
+
+    // Rows of In contiguous.
+    std::vector<T> packed;
+    const T *x = in;
+    size_t ldx = in_rs;
+    if (in_cs != 1) {
+        packed.resize(size_t(n) * nj);
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for
+#       endif
+        for(IndexType r = 0; r < n; r++)
+            for(int j = 0; j < nj; j++)
+                packed[size_t(r) * nj + j] = in[r * in_rs + j * in_cs];
+        x = packed.data();
+        ldx = nj;
+    }
+
+    // nnz-balanced column ranges, one per thread if the team is complete.
+    // The threads share the ranges, so a smaller team (e.g. in a nested
+    // region) still covers all of them.
+    int nchunks = 1;
+#   ifdef SKYLARK_HAVE_OPENMP
+    nchunks = int(std::max(IndexType(1),
+            std::min(IndexType(omp_get_max_threads()), n)));
+#   endif
+
+    std::vector<IndexType> bounds(nchunks + 1, n);
+    bounds[0] = 0;
+    const double nnz = indptr[n];
+    for(int t = 1; t < nchunks; t++)
+        bounds[t] = std::max(bounds[t - 1], IndexType(std::lower_bound(indptr,
+                    indptr + n, IndexType(nnz * t / nchunks)) - indptr));
+
+    std::vector<T> y(size_t(n) * nj, T(0));
+    std::vector<std::vector<T> > bufs(nchunks);
+    std::vector<IndexType> lo(nchunks), hi(nchunks);
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel num_threads(nchunks) if (nchunks > 1)
+#   endif
+    {
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(static, 1)
+#       endif
+        for(int t = 0; t < nchunks; t++) {
+            const IndexType c0 = bounds[t], c1 = bounds[t + 1];
+
+            // Span of the rows of other ranges reached by direct updates.
+            IndexType l0 = n, h0 = 0;
+            for(IndexType c = c0; c < c1 && nchunks > 1; c++)
+                for(IndexType l = indptr[c]; l < indptr[c + 1]; l++) {
+                    const IndexType r = indices[l];
+                    if ((lower ? (r > c) : (r < c)) && (r < c0 || r >= c1)) {
+                        l0 = std::min(l0, r);
+                        h0 = std::max(h0, IndexType(r + 1));
+                    }
+                }
+            lo[t] = l0;
+            hi[t] = std::max(l0, h0);
+            bufs[t].assign(size_t(hi[t] - lo[t]) * nj, T(0));
+
+            if (lower)
+                spmm_symmetric_dispatch<true>(c0, c1, indptr, indices,
+                    values, x, ldx, y.data(), bufs[t].data(), lo[t], nj);
+            else
+                spmm_symmetric_dispatch<false>(c0, c1, indptr, indices,
+                    values, x, ldx, y.data(), bufs[t].data(), lo[t], nj);
+        }
+
+        // Sum the buffers into the rows of each range, and add to Out.
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(static, 1)
+#       endif
+        for(int t = 0; t < nchunks; t++) {
+            const IndexType c0 = bounds[t], c1 = bounds[t + 1];
+            for(int s = 0; s < nchunks; s++) {
+                const IndexType r0 = std::max(c0, lo[s]),
+                    r1 = std::min(c1, hi[s]);
+                for(IndexType r = r0; r < r1; r++) {
+                    const T *b = bufs[s].data() + size_t(r - lo[s]) * nj;
+                    T *yr = y.data() + size_t(r) * nj;
+                    for(int j = 0; j < nj; j++)
+                        yr[j] += b[j];
+                }
+            }
+
+            for(IndexType r = c0; r < c1; r++)
+                for(int j = 0; j < nj; j++)
+                    out[r * out_rs + j * out_cs] +=
+                        alpha * y[size_t(r) * nj + j];
+        }
+    }
+}
+
+} } } // namespace skylark::base::detail
+
+#endif // SKYLARK_SPMM_HPP
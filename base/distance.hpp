@@ -1,6 +1,13 @@
 #ifndef SKYLARK_DISTANCE_HPP
 #define SKYLARK_DISTANCE_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#ifdef SKYLARK_HAVE_OPENMP
+#include <omp.h>
+#endif
 
 namespace skylark { namespace base {
 
@@ -26,6 +33,9 @@ void EuclideanDistanceMatrix(direction_t dirA, direction_t dirB, T alpha,
         El::Int m = base::Width(A);
         El::Int n = base::Width(B);
 
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for
+#       endif
         for(El::Int j = 0; j < n; j++)
             for(El::Int i = 0; i < m; i++)
                 c[j * ldC + i] += alpha * (na[i] * na[i] + nb[j] * nb[j]);
@@ -98,6 +108,9 @@ void SymmetricEuclideanDistanceMatrix(El::UpperOrLower uplo, direction_t dir,
 
         int n = base::Width(A);
 
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for
+#       endif
         for(El::Int j = 0; j < n; j++)
             for(El::Int i = ((uplo == El::UPPER) ? 0 : j);
                 i < ((uplo == El::UPPER) ? (j + 1) : n); i++)
@@ -497,6 +510,429 @@ void SymmetricExpsemigroupDistanceMatrix(El::UpperOrLower uplo, direction_t dir,
         "SymmetricExpsemigroupDistanceMatrix has not yet been implemented for that kind of matrices"));
 }
 
+/**
+ * Fused Gram matrices: C(i, j) = f(m(a_i, b_j)) where a_i and b_j are the
+ * points (columns or rows, per the directions) of A and B, and m is an
+ * inner product or a distance.
+ *
+ * Unlike computing the distance matrix and then mapping f over it, the local
+ * versions compute C one cache tile at a time, and apply f while the tile is
+ * still in cache. Tiles are processed in parallel, and the symmetric
+ * versions only compute the tiles that intersect the uplo triangle (and only
+ * write that triangle). C must already have the right size.
+ *
+ * The distributed versions compute the measure as before, and apply f
+ * (together with the norms, for the Euclidean distance) in one local pass.
+ */
+
+namespace detail {
+
+/// Points per side of a tile when the tile is a small Gemm.
+static const El::Int gram_gemm_tile = 256;
+
+/// Points per side of a tile when the measure is computed directly.
+static const El::Int gram_direct_tile = 64;
+
+/** Point i, coordinate k of a local matrix is at point(i)[k * stride]. */
+template<typename T>
+struct gram_points_t {
+
+    gram_points_t(direction_t dir, const El::Matrix<T> &A) :
+        _A(A), _dir(dir), _buf(A.LockedBuffer()) {
+
+        if (dir == base::COLUMNS) {
+            size = A.Width(); dim = A.Height();
+            _pstride = A.LDim(); stride = 1;
+        } else {
+            size = A.Height(); dim = A.Width();
+            _pstride = 1; stride = A.LDim();
+        }
+    }
+
+    const T *point(El::Int i) const { return _buf + i * _pstride; }
+
+    /** Squared norms of all points. */
+    void squared_norms(std::vector<T> &nrms) const {
+        nrms.resize(size);
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for
+#       endif
+        for(El::Int i = 0; i < size; i++) {
+            const T *a = point(i);
+            T v = 0;
+            for(El::Int k = 0; k < dim; k++)
+                v += a[k * stride] * a[k * stride];
+            nrms[i] = v;
+        }
+    }
+
+    /** V = inner products of points i0..i0+ni-1 and points of B. */
+    void inner(El::Int i0, El::Int ni, const gram_points_t<T> &B,
+        El::Int j0, El::Int nj, El::Matrix<T> &V) const {
+
+        El::Matrix<T> Av, Bv;
+        if (_dir == base::COLUMNS)
+            El::LockedView(Av, _A, 0, i0, dim, ni);
+        else
+            El::LockedView(Av, _A, i0, 0, ni, dim);
+        if (B._dir == base::COLUMNS)
+            El::LockedView(Bv, B._A, 0, j0, dim, nj);
+        else
+            El::LockedView(Bv, B._A, j0, 0, nj, dim);
+
+        El::Gemm(_dir == base::COLUMNS ? El::ADJOINT : El::NORMAL,
+            B._dir == base::COLUMNS ? El::NORMAL : El::ADJOINT,
+            T(1.0), Av, Bv, T(0.0), V);
+    }
+
+    El::Int size, dim, stride;
+
+private:
+    const El::Matrix<T> &_A;
+    const direction_t _dir;
+    const T *_buf;
+    El::Int _pstride;
+};
+
+/**
+ * Calls tile(i0, ni, j0, nj, V) for the tiles of an m x n matrix (only those
+ * intersecting the uplo triangle if symmetric), in parallel, where V is an
+ * ni x nj thread-local scratch matrix the tile fills. Then sets
+ * C(i, j) = entry(V(i - i0, j - j0), i, j) for the (triangle) entries.
+ */
+template<typename T, typename TileType, typename EntryType>
+void gram_tiled(bool symmetric, El::UpperOrLower uplo, El::Int m, El::Int n,
+    El::Int tile, const TileType &compute_tile, const EntryType &entry,
+    El::Matrix<T> &C) {
+
+    T *c = C.Buffer();
+    const El::Int ldC = C.LDim();
+    const El::Int mt = (m + tile - 1) / tile;
+    const El::Int nt = (n + tile - 1) / tile;
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel
+#   endif
+    {
+        El::Matrix<T> buf(tile, tile), V;
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for collapse(2) schedule(dynamic)
+#       endif
+        for(El::Int bj = 0; bj < nt; bj++)
+            for(El::Int bi = 0; bi < mt; bi++) {
+                if (symmetric && (uplo == El::LOWER ? bi < bj : bi > bj))
+                    continue;
+
+                const El::Int i0 = bi * tile, ni = std::min(tile, m - i0);
+                const El::Int j0 = bj * tile, nj = std::min(tile, n - j0);
+
+                El::View(V, buf, 0, 0, ni, nj);
+                compute_tile(i0, ni, j0, nj, V);
+
+                const T *v = V.LockedBuffer();
+                const El::Int ldV = V.LDim();
+                for(El::Int j = 0; j < nj; j++) {
+                    const El::Int gj = j0 + j;
+                    El::Int ib = 0, ie = ni;
+                    if (symmetric) {
+                        if (uplo == El::LOWER)
+                            ib = std::max(El::Int(0), gj - i0);
+                        else
+                            ie = std::min(ni, gj - i0 + 1);
+                    }
+                    for(El::Int i = ib; i < ie; i++)
+                        c[gj * ldC + i0 + i] = entry(v[j * ldV + i], i0 + i, gj);
+                }
+            }
+    }
+}
+
+/** Tile of sum_k op(a_ik, b_jk), computed directly. */
+template<typename T, typename OpType>
+struct gram_direct_tile_t {
+
+    gram_direct_tile_t(const gram_points_t<T> &A, const gram_points_t<T> &B,
+        OpType op) : _A(A), _B(B), _op(op) {
+
+    }
+
+    void operator()(El::Int i0, El::Int ni, El::Int j0, El::Int nj,
+        El::Matrix<T> &V) const {
+
+        T *v = V.Buffer();
+        const El::Int ldV = V.LDim(), d = _A.dim;
+        const El::Int sa = _A.stride, sb = _B.stride;
+        for(El::Int j = 0; j < nj; j++) {
+            const T *b = _B.point(j0 + j);
+            for(El::Int i = 0; i < ni; i++) {
+                const T *a = _A.point(i0 + i);
+                T s = 0;
+                for(El::Int k = 0; k < d; k++)
+                    s += _op(a[k * sa], b[k * sb]);
+                v[j * ldV + i] = s;
+            }
+        }
+    }
+
+private:
+    const gram_points_t<T> &_A, &_B;
+    const OpType _op;
+};
+
+template<typename T>
+struct gram_l1_op_t {
+    T operator()(T a, T b) const { return std::abs(a - b); }
+};
+
+template<typename T>
+struct gram_expsemigroup_op_t {
+    T operator()(T a, T b) const { return std::sqrt(std::abs(a + b)); }
+};
+
+/** Gram matrix of a measure computed directly, sum_k op(a_ik, b_jk). */
+template<typename T, typename OpType, typename F>
+void direct_gram(bool symmetric, El::UpperOrLower uplo,
+    direction_t dirA, direction_t dirB,
+    const El::Matrix<T> &A, const El::Matrix<T> &B, El::Matrix<T> &C,
+    OpType op, F f) {
+
+    gram_points_t<T> a(dirA, A), b(dirB, B);
+    gram_direct_tile_t<T, OpType> tile(a, b, op);
+    gram_tiled(symmetric, uplo, a.size, b.size, gram_direct_tile, tile,
+        [&f] (T v, El::Int, El::Int) { return f(v); }, C);
+}
+
+/** Applies f to the local entries of C, in parallel. */
+template<typename T, typename F>
+void gram_local_map(El::Matrix<T> &C, F f) {
+    T *c = C.Buffer();
+    const El::Int m = C.Height(), n = C.Width(), ldC = C.LDim();
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for
+#   endif
+    for(El::Int j = 0; j < n; j++)
+        for(El::Int i = 0; i < m; i++)
+            c[j * ldC + i] = f(c[j * ldC + i]);
+}
+
+} // namespace detail
+
+/**
+ * C(i, j) = f(<a_i, b_j>)
+ */
+template<typename T, typename F>
+void InnerProductGram(direction_t dirA, direction_t dirB,
+    const El::Matrix<T> &A, const El::Matrix<T> &B, El::Matrix<T> &C, F f) {
+
+    detail::gram_points_t<T> a(dirA, A), b(dirB, B);
+    detail::gram_tiled(false, El::LOWER, a.size, b.size,
+        detail::gram_gemm_tile,
+        [&a, &b] (El::Int i0, El::Int ni, El::Int j0, El::Int nj,
+            El::Matrix<T> &V) { a.inner(i0, ni, b, j0, nj, V); },
+        [&f] (T v, El::Int, El::Int) { return f(v); }, C);
+}
+
+template<typename T, typename F>
+void InnerProductGram(direction_t dirA, direction_t dirB,
+    const El::ElementalMatrix<T> &A, const El::ElementalMatrix<T> &B,
+    El::ElementalMatrix<T> &C, F f) {
+
+    El::Gemm(dirA == base::COLUMNS ? El::ADJOINT : El::NORMAL,
+        dirB == base::COLUMNS ? El::NORMAL : El::ADJOINT,
+        T(1.0), A, B, T(0.0), C);
+    detail::gram_local_map(C.Matrix(), f);
+}
+
+/**
+ * C(i, j) = f(<a_i, a_j>), only the uplo triangle.
+ */
+template<typename T, typename F>
+void SymmetricInnerProductGram(El::UpperOrLower uplo, direction_t dir,
+    const El::Matrix<T> &A, El::Matrix<T> &C, F f) {
+
+    detail::gram_points_t<T> a(dir, A);
+    detail::gram_tiled(true, uplo, a.size, a.size, detail::gram_gemm_tile,
+        [&a] (El::Int i0, El::Int ni, El::Int j0, El::Int nj,
+            El::Matrix<T> &V) { a.inner(i0, ni, a, j0, nj, V); },
+        [&f] (T v, El::Int, El::Int) { return f(v); }, C);
+}
+
+template<typename T, typename F>
+void SymmetricInnerProductGram(El::UpperOrLower uplo, direction_t dir,
+    const El::ElementalMatrix<T> &A, El::ElementalMatrix<T> &C, F f) {
+
+    El::Herk(uplo, dir == base::COLUMNS ? El::ADJOINT : El::NORMAL,
+        T(1.0), A, C);
+    detail::gram_local_map(C.Matrix(), f);
+}
+
+/**
+ * C(i, j) = f(||a_i - b_j||_2^2)
+ */
+template<typename T, typename F>
+void EuclideanGram(direction_t dirA, direction_t dirB,
+    const El::Matrix<T> &A, const El::Matrix<T> &B, El::Matrix<T> &C, F f) {
+
+    detail::gram_points_t<T> a(dirA, A), b(dirB, B);
+    std::vector<T> na, nb;
+    a.squared_norms(na);
+    b.squared_norms(nb);
+
+    detail::gram_tiled(false, El::LOWER, a.size, b.size,
+        detail::gram_gemm_tile,
+        [&a, &b] (El::Int i0, El::Int ni, El::Int j0, El::Int nj,
+            El::Matrix<T> &V) { a.inner(i0, ni, b, j0, nj, V); },
+        [&f, &na, &nb] (T v, El::Int i, El::Int j) {
+            return f(std::max(T(0), na[i] + nb[j] - 2 * v)); },
+        C);
+}
+
+template<typename T, typename F>
+void EuclideanGram(direction_t dirA, direction_t dirB,
+    const El::ElementalMatrix<T> &A, const El::ElementalMatrix<T> &B,
+    El::ElementalMatrix<T> &C, F f) {
+
+    if (dirA != base::COLUMNS || dirB != base::COLUMNS) {
+        // TODO the rest of the cases.
+        SKYLARK_THROW_EXCEPTION (
+        base::ml_exception()
+          << base::error_msg(
+           "EuclideanGram has not yet been implemented for that kind of matrices"));
+    }
+
+    El::Gemm(El::ADJOINT, El::NORMAL, T(-2.0), A, B, T(0.0), C);
+
+    El::DistMatrix<T, El::STAR, El::STAR> NA, NB;
+    ColumnNrm2(A, NA);
+    ColumnNrm2(B, NB);
+    const T *na = NA.LockedBuffer(), *nb = NB.LockedBuffer();
+
+    T *c = C.Buffer();
+    const El::Int ldC = C.LDim();
+    const El::Int m = C.LocalHeight(), n = C.LocalWidth();
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for
+#   endif
+    for(El::Int j = 0; j < n; j++) {
+        const T b = nb[C.GlobalCol(j)];
+        for(El::Int i = 0; i < m; i++) {
+            const T a = na[C.GlobalRow(i)];
+            c[j * ldC + i] = f(std::max(T(0), c[j * ldC + i] + a * a + b * b));
+        }
+    }
+}
+
+/**
+ * C(i, j) = f(||a_i - a_j||_2^2), only the uplo triangle.
+ */
+template<typename T, typename F>
+void SymmetricEuclideanGram(El::UpperOrLower uplo, direction_t dir,
+    const El::Matrix<T> &A, El::Matrix<T> &C, F f) {
+
+    detail::gram_points_t<T> a(dir, A);
+    std::vector<T> na;
+    a.squared_norms(na);
+
+    detail::gram_tiled(true, uplo, a.size, a.size, detail::gram_gemm_tile,
+        [&a] (El::Int i0, El::Int ni, El::Int j0, El::Int nj,
+            El::Matrix<T> &V) { a.inner(i0, ni, a, j0, nj, V); },
+        [&f, &na] (T v, El::Int i, El::Int j) {
+            return f(std::max(T(0), na[i] + na[j] - 2 * v)); },
+        C);
+}
+
+template<typename T, typename F>
+void SymmetricEuclideanGram(El::UpperOrLower uplo, direction_t dir,
+    const El::ElementalMatrix<T> &A, El::ElementalMatrix<T> &C, F f) {
+
+    // The distance is computed in the triangle only; f is harmless outside.
+    SymmetricEuclideanDistanceMatrix(uplo, dir, T(1.0), A, T(0.0), C);
+    detail::gram_local_map(C.Matrix(),
+        [&f] (T x) { return f(std::max(T(0), x)); });
+}
+
+/**
+ * C(i, j) = f(||a_i - b_j||_1)
+ */
+template<typename T, typename F>
+void L1Gram(direction_t dirA, direction_t dirB,
+    const El::Matrix<T> &A, const El::Matrix<T> &B, El::Matrix<T> &C, F f) {
+
+    detail::direct_gram(false, El::LOWER, dirA, dirB, A, B, C,
+        detail::gram_l1_op_t<T>(), f);
+}
+
+template<typename T, typename F>
+void L1Gram(direction_t dirA, direction_t dirB,
+    const El::ElementalMatrix<T> &A, const El::ElementalMatrix<T> &B,
+    El::ElementalMatrix<T> &C, F f) {
+
+    L1DistanceMatrix(dirA, dirB, T(1.0), A, B, T(0.0), C);
+    detail::gram_local_map(C.Matrix(), f);
+}
+
+/**
+ * C(i, j) = f(||a_i - a_j||_1), only the uplo triangle.
+ */
+template<typename T, typename F>
+void SymmetricL1Gram(El::UpperOrLower uplo, direction_t dir,
+    const El::Matrix<T> &A, El::Matrix<T> &C, F f) {
+
+    detail::direct_gram(true, uplo, dir, dir, A, A, C,
+        detail::gram_l1_op_t<T>(), f);
+}
+
+template<typename T, typename F>
+void SymmetricL1Gram(El::UpperOrLower uplo, direction_t dir,
+    const El::ElementalMatrix<T> &A, El::ElementalMatrix<T> &C, F f) {
+
+    SymmetricL1DistanceMatrix(uplo, dir, T(1.0), A, T(0.0), C);
+    detail::gram_local_map(C.Matrix(), f);
+}
+
+/**
+ * C(i, j) = f(sum_k sqrt(|a_ik + b_jk|))
+ */
+template<typename T, typename F>
+void ExpsemigroupGram(direction_t dirA, direction_t dirB,
+    const El::Matrix<T> &A, const El::Matrix<T> &B, El::Matrix<T> &C, F f) {
+
+    detail::direct_gram(false, El::LOWER, dirA, dirB, A, B, C,
+        detail::gram_expsemigroup_op_t<T>(), f);
+}
+
+template<typename T, typename F>
+void ExpsemigroupGram(direction_t dirA, direction_t dirB,
+    const El::ElementalMatrix<T> &A, const El::ElementalMatrix<T> &B,
+    El::ElementalMatrix<T> &C, F f) {
+
+    ExpsemigroupDistanceMatrix(dirA, dirB, T(1.0), A, B, T(0.0), C);
+    detail::gram_local_map(C.Matrix(), f);
+}
+
+/**
+ * C(i, j) = f(sum_k sqrt(|a_ik + a_jk|)), only the uplo triangle.
+ * The distributed version computes all of C.
+ */
+template<typename T, typename F>
+void SymmetricExpsemigroupGram(El::UpperOrLower uplo, direction_t dir,
+    const El::Matrix<T> &A, El::Matrix<T> &C, F f) {
+
+    detail::direct_gram(true, uplo, dir, dir, A, A, C,
+        detail::gram_expsemigroup_op_t<T>(), f);
+}
+
+template<typename T, typename F>
+void SymmetricExpsemigroupGram(El::UpperOrLower uplo, direction_t dir,
+    const El::ElementalMatrix<T> &A, El::ElementalMatrix<T> &C, F f) {
+
+    ExpsemigroupGram(dir, dir, A, A, C, f);
+}
+
 } } // namespace skylark::base
 
 #endif // SKYLARK_DISTANCE_HPP
@@ -3,25 +3,36 @@
 
 namespace skylark { namespace base {
 
+/**
+ * Views a local sparse matrix (with index type IndexType) as an unweighted
+ * graph: column v holds the neighbors of vertex v.
+ */
+template<typename IndexType = int>
 struct unweighted_local_graph_adapter_t {
 
+    typedef IndexType index_type;
+
     template<typename T>
-    unweighted_local_graph_adapter_t(const sparse_matrix_t<T>& A)
+    unweighted_local_graph_adapter_t(const sparse_matrix_t<T, IndexType>& A)
         : _indptr(A.indptr()), _indices(A.indices()),
           _num_vertices(A.height()), _num_edges(A.nonzeros()) {
 
     }
 
-    int num_vertices() const { return _num_vertices; }
-    int num_edges() const { return _num_edges; }
-    int degree(int vertex) const { return _indptr[vertex+1] - _indptr[vertex]; }
-    const int *adjanct(int vertex) const { return _indices + _indptr[vertex]; }
+    index_type num_vertices() const { return _num_vertices; }
+    index_type num_edges() const { return _num_edges; }
+    index_type degree(index_type vertex) const {
+        return _indptr[vertex+1] - _indptr[vertex];
+    }
+    const index_type *adjanct(index_type vertex) const {
+        return _indices + _indptr[vertex];
+    }
 
 private:
-    const int *_indptr;
-    const int *_indices;
-    int _num_vertices;
-    int _num_edges;
+    const index_type *_indptr;
+    const index_type *_indices;
+    index_type _num_vertices;
+    index_type _num_edges;
 };
 
 } } // namespace skylark::base
@@ -0,0 +1,290 @@
+#ifndef SKYLARK_KERNEL_MATRIX_HPP
+#define SKYLARK_KERNEL_MATRIX_HPP
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <boost/mpi.hpp>
+
+#include "exception.hpp"
+#include "computed_matrix.hpp"
+
+namespace skylark { namespace base {
+
+/**
+ * The regularized kernel matrix K + lambda I of n points, as a computed
+ * matrix that is never formed: products with it (Symm, Gemm) recompute the
+ * kernel in tiles of tile x tile entries, so it can be handed to the Krylov
+ * solvers (e.g. CG for kernel ridge regression) when K does not fit in
+ * memory.
+ *
+ * The points are kept [VC] distributed, so every rank stores n d / p
+ * values. A product B -> (K + lambda I) B redistributes B to [VC, STAR],
+ * and circulates the points and the matching rows of B around the ranks
+ * in a ring. Every rank computes the rows of the product for its own
+ * points, and the transfer of the next block overlaps the kernel
+ * computation on the current one.
+ *
+ * KernelType is anything that provides gram(dirX, dirY, X, Y, K) on local
+ * matrices (e.g. the kernels in ml/kernels.hpp). The kernel is kept by
+ * reference, and has to outlive the matrix.
+ */
+template<typename T, typename KernelType>
+struct kernel_matrix_t : public computed_matrix_t<El::DistMatrix<T> > {
+    typedef T value_type;
+    typedef El::Int index_type;
+    typedef El::DistMatrix<T> materialized_type;
+
+    /**
+     * @param dir whether the points are the columns or the rows of X.
+     * @param k kernel.
+     * @param X points.
+     * @param lambda added to the diagonal.
+     * @param tile size of the kernel tiles computed at once.
+     */
+    kernel_matrix_t(direction_t dir, const KernelType &k,
+        const El::ElementalMatrix<T> &X, T lambda = T(0),
+        El::Int tile = 2048) :
+        _dir(dir), _k(k), _lambda(lambda), _tile(tile),
+        _n(dir == COLUMNS ? X.Width() : X.Height()),
+        _d(dir == COLUMNS ? X.Height() : X.Width()) {
+
+        // Align at zero, so that the point with global index i is owned by
+        // VC rank i % p, and is the (i / p)-th local point.
+        if (_dir == COLUMNS) {
+            El::DistMatrix<T, El::STAR, El::VC> *XP =
+                new El::DistMatrix<T, El::STAR, El::VC>(X.Grid());
+            XP->AlignRows(0);
+            _X.reset(XP);
+        } else {
+            El::DistMatrix<T, El::VC, El::STAR> *XP =
+                new El::DistMatrix<T, El::VC, El::STAR>(X.Grid());
+            XP->AlignCols(0);
+            _X.reset(XP);
+        }
+        El::Copy(X, *_X);
+    }
+
+    index_type height() const {
+        return _n;
+    }
+
+    index_type width() const {
+        return _n;
+    }
+
+    void materialize(materialized_type &Z) const {
+        // The distributed Gram matrices take points as columns.
+        if (_dir == COLUMNS)
+            _k.gram(COLUMNS, COLUMNS, *_X, *_X, Z);
+        else {
+            El::DistMatrix<T> XT(_X->Grid());
+            El::Transpose(*_X, XT);
+            _k.gram(COLUMNS, COLUMNS, XT, XT, Z);
+        }
+        if (_lambda != T(0))
+            El::ShiftDiagonal(Z, _lambda);
+    }
+
+    materialized_type materialize() const {
+        materialized_type Z(_X->Grid());
+        materialize(Z);
+        return Z;
+    }
+
+    /**
+     * C = alpha (K + lambda I) B + beta C.
+     */
+    void multiply(T alpha, const El::ElementalMatrix<T> &B, T beta,
+        El::ElementalMatrix<T> &C) const {
+
+        if (B.Height() != _n || C.Height() != _n || C.Width() != B.Width())
+            SKYLARK_THROW_EXCEPTION (
+                base::invalid_parameters()
+                    << base::error_msg("Dimension mismatch in kernel matrix "
+                        "product"));
+
+        const El::Grid &g = _X->Grid();
+        const El::Int k = B.Width();
+        const int p = g.Size();
+        const int r = g.VCRank();
+        MPI_Comm comm = g.VCComm().comm;
+
+        El::DistMatrix<T, El::VC, El::STAR> B_VC_STAR(g), C_VC_STAR(g);
+        B_VC_STAR.AlignCols(0);
+        C_VC_STAR.AlignCols(0);
+        El::Copy(B, B_VC_STAR);
+        if (beta == T(0))
+            El::Zeros(C_VC_STAR, _n, k);
+        else {
+            El::Copy(C, C_VC_STAR);
+            El::Scale(beta, C_VC_STAR);
+        }
+        if (_lambda != T(0))
+            El::Axpy(alpha * _lambda, B_VC_STAR, C_VC_STAR);
+
+        // Blocks travel from rank r + 1 to rank r, so at step s rank r
+        // holds the points (and rows of B) of rank (r + s) % p.
+        const int to = (r + p - 1) % p, from = (r + 1) % p;
+        MPI_Datatype type = boost::mpi::get_mpi_datatype<T>();
+
+        // Blocks are received into plain buffers (of varying sizes), so that
+        // they are contiguous.
+        std::vector<T> XB[2], BB[2];
+        pack(_X->LockedMatrix(), XB[0]);
+        pack(B_VC_STAR.LockedMatrix(), BB[0]);
+
+        El::Matrix<T> Xq, Bq;
+        for(int s = 0; s < p; s++) {
+            std::vector<T> &Xc = XB[s % 2], &Bc = BB[s % 2];
+            std::vector<T> &Xn = XB[(s + 1) % 2], &Bn = BB[(s + 1) % 2];
+
+            MPI_Request requests[4];
+            int nrequests = 0;
+            if (s + 1 < p) {
+                El::Int nn = El::Length(_n, (r + s + 1) % p, p);
+                Xn.resize(nn * _d);
+                Bn.resize(nn * k);
+
+                MPI_Irecv(Xn.data(), Xn.size(), type, from, 0, comm,
+                    &requests[nrequests++]);
+                MPI_Irecv(Bn.data(), Bn.size(), type, from, 1, comm,
+                    &requests[nrequests++]);
+                MPI_Isend(Xc.data(), Xc.size(), type, to, 0, comm,
+                    &requests[nrequests++]);
+                MPI_Isend(Bc.data(), Bc.size(), type, to, 1, comm,
+                    &requests[nrequests++]);
+            }
+
+            El::Int nq = El::Length(_n, (r + s) % p, p);
+            if (_dir == COLUMNS)
+                Xq.LockedAttach(_d, nq, Xc.data(), std::max(_d, El::Int(1)));
+            else
+                Xq.LockedAttach(nq, _d, Xc.data(), std::max(nq, El::Int(1)));
+            Bq.LockedAttach(nq, k, Bc.data(), std::max(nq, El::Int(1)));
+
+            accumulate(alpha, Xq, Bq, C_VC_STAR.Matrix());
+
+            MPI_Waitall(nrequests, requests, MPI_STATUSES_IGNORE);
+        }
+
+        El::Copy(C_VC_STAR, C);
+    }
+
+private:
+    const direction_t _dir;
+    const KernelType &_k;
+    const T _lambda;
+    const El::Int _tile;
+    const El::Int _n, _d;
+
+    std::unique_ptr<El::ElementalMatrix<T> > _X;
+
+    /** Copy A to a column-major buffer without padding. */
+    static void pack(const El::Matrix<T> &A, std::vector<T> &buf) {
+        const El::Int h = A.Height(), w = A.Width();
+        buf.resize(h * w);
+        for(El::Int j = 0; j < w; j++)
+            std::copy(A.LockedBuffer(0, j), A.LockedBuffer(0, j) + h,
+                buf.begin() + j * h);
+    }
+
+    /**
+     * C += alpha K(X, Xq) Bq for the local points X, tile by tile.
+     */
+    void accumulate(T alpha, const El::Matrix<T> &Xq, const El::Matrix<T> &Bq,
+        El::Matrix<T> &C) const {
+
+        const El::Matrix<T> &X = _X->LockedMatrix();
+        const El::Int m = C.Height(), nq = Bq.Height(), k = Bq.Width();
+
+        El::Matrix<T> Xi, Xj, Bj, Ci, Kij;
+        for(El::Int i = 0; i < m; i += _tile) {
+            const El::Int mi = std::min(_tile, m - i);
+            if (_dir == COLUMNS)
+                El::LockedView(Xi, X, 0, i, _d, mi);
+            else
+                El::LockedView(Xi, X, i, 0, mi, _d);
+            El::View(Ci, C, i, 0, mi, k);
+
+            for(El::Int j = 0; j < nq; j += _tile) {
+                const El::Int nj = std::min(_tile, nq - j);
+                if (_dir == COLUMNS)
+                    El::LockedView(Xj, Xq, 0, j, _d, nj);
+                else
+                    El::LockedView(Xj, Xq, j, 0, nj, _d);
+                El::LockedView(Bj, Bq, j, 0, nj, k);
+
+                _k.gram(_dir, _dir, Xi, Xj, Kij);
+                El::Gemm(El::NORMAL, El::NORMAL, alpha, Kij, Bj, T(1), Ci);
+            }
+        }
+    }
+};
+
+template<typename T, typename KernelType>
+int Height(const kernel_matrix_t<T, KernelType>& A) {
+    return A.height();
+}
+
+template<typename T, typename KernelType>
+int Width(const kernel_matrix_t<T, KernelType>& A) {
+    return A.width();
+}
+
+/**
+ * Symm and Gemm with a kernel matrix: the product is computed without
+ * forming the matrix (uplo and the orientation of A are irrelevant, the
+ * matrix is symmetric).
+ */
+template<typename T, typename KernelType>
+inline void Symm(El::LeftOrRight side, El::UpperOrLower uplo,
+    T alpha, const kernel_matrix_t<T, KernelType>& A,
+    const El::ElementalMatrix<T>& B, T beta, El::ElementalMatrix<T>& C) {
+
+    if (side == El::LEFT) {
+        A.multiply(alpha, B, beta, C);
+        return;
+    }
+
+    // B K = (K B^T)^T
+    El::DistMatrix<T> BT(B.Grid()), CT(C.Grid());
+    El::Transpose(B, BT);
+    El::Transpose(C, CT);
+    A.multiply(alpha, BT, beta, CT);
+    El::Transpose(CT, C);
+}
+
+template<typename T, typename KernelType>
+inline void Symm(El::LeftOrRight side, El::UpperOrLower uplo,
+    T alpha, const kernel_matrix_t<T, KernelType>& A,
+    const El::ElementalMatrix<T>& B, El::ElementalMatrix<T>& C) {
+    base::Symm(side, uplo, alpha, A, B, T(0), C);
+}
+
+template<typename T, typename KernelType, typename RT, typename OT>
+inline void Gemm(El::Orientation oA, El::Orientation oB,
+    T alpha, const kernel_matrix_t<T, KernelType>& A,
+    const RT& B, T beta, OT& C) {
+
+    if (oB == El::NORMAL) {
+        A.multiply(alpha, B, beta, C);
+        return;
+    }
+
+    El::DistMatrix<T> BT(B.Grid());
+    El::Transpose(B, BT, oB == El::ADJOINT);
+    A.multiply(alpha, BT, beta, C);
+}
+
+template<typename T, typename KernelType, typename RT, typename OT>
+inline void Gemm(El::Orientation oA, El::Orientation oB,
+    T alpha, const kernel_matrix_t<T, KernelType>& A,
+    const RT& B, OT& C) {
+    base::Gemm(oA, oB, alpha, A, B, T(0), C);
+}
+
+} } // namespace skylark::base
+
+#endif // SKYLARK_KERNEL_MATRIX_HPP
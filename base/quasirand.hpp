@@ -1,9 +1,23 @@
 #ifndef SKYLARK_QUASIRAND_HPP
 #define SKYLARK_QUASIRAND_HPP
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "boost/cstdint.hpp"
+#include "boost/version.hpp"
 #include "boost/property_tree/ptree.hpp"
 #include "boost/math/special_functions/prime.hpp"
 
+#if BOOST_VERSION >= 107100
+#include "boost/random/detail/sobol_table.hpp"
+#endif
+
+#ifdef SKYLARK_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 namespace skylark { namespace base {
 
 inline double RadialInverseFunction(int base, size_t idx)
@@ -19,6 +33,83 @@ inline double RadialInverseFunction(int base, size_t idx)
     return r;
 }
 
+namespace detail {
+
+/// Points per tile in the block generators.
+static const size_t qmc_fill_tile = 64;
+
+/**
+ * Radical inverses, in the given base, of n0, n0 + step, ...,
+ * n0 + (count - 1) * step, written to out[0], out[stride], ...
+ *
+ * Instead of redoing the divisions for every value, the base digits of n
+ * are kept and the digits of step are added to them with carries, while the
+ * digit-reversed integer R is updated alongside; the radical inverse is
+ * R / base^D, with D the number of digits of the largest n. Falls back to
+ * RadialInverseFunction when base^D does not fit in 62 bits.
+ */
+template<typename T>
+void radical_inverse_walk(unsigned base, boost::uint64_t n0,
+    boost::uint64_t step, size_t count, T *out, size_t stride) {
+
+    if (count == 0)
+        return;
+
+    const boost::uint64_t nmax = n0 + (count - 1) * step;
+    const boost::uint64_t limit = static_cast<boost::uint64_t>(1) << 62;
+
+    int D = 0;
+    boost::uint64_t pD = 1;
+    while (pD <= nmax) {
+        if (pD > limit / base) {
+            for(size_t k = 0; k < count; k++)
+                out[k * stride] =
+                    static_cast<T>(RadialInverseFunction(base, n0 + k * step - 1));
+            return;
+        }
+        pD *= base;
+        D++;
+    }
+
+    // pw[j] = base^(D-1-j) is the weight of the j-th digit in R.
+    unsigned digits[64], steps[64];
+    boost::int64_t pw[64];
+    boost::int64_t R = 0;
+    boost::uint64_t n = n0, s = step, w = pD;
+    int sD = 0;
+    for(int j = 0; j < D; j++) {
+        w /= base;
+        pw[j] = static_cast<boost::int64_t>(w);
+        digits[j] = n % base;
+        n /= base;
+        steps[j] = s % base;
+        s /= base;
+        if (steps[j] != 0)
+            sD = j + 1;
+        R += digits[j] * pw[j];
+    }
+
+    const double scale = 1.0 / static_cast<double>(pD);
+    for(size_t k = 0; k < count; k++) {
+        out[k * stride] = static_cast<T>(static_cast<double>(R) * scale);
+        if (k + 1 == count)
+            break;
+
+        unsigned carry = 0;
+        for(int j = 0; j < D && (j < sD || carry); j++) {
+            unsigned t = digits[j] + steps[j] + carry;
+            carry = t >= base;
+            if (carry)
+                t -= base;
+            R += (static_cast<boost::int64_t>(t) -
+                static_cast<boost::int64_t>(digits[j])) * pw[j];
+            digits[j] = t;
+        }
+    }
+}
+
+} // namespace detail
+
 template<typename ValueType>
 struct qmc_sequence_t {
     typedef ValueType value_type;
@@ -26,6 +117,22 @@ struct qmc_sequence_t {
     virtual value_type coordinate(size_t idx, size_t i) const = 0;
     virtual boost::property_tree::ptree to_ptree() const  = 0;
 
+    /**
+     * Block access: coordinates i_begin,...,i_end-1 of the points
+     * idx_begin,...,idx_begin+count-1, written point after point, i.e.
+     * out[k * (i_end - i_begin) + (i - i_begin)] = coordinate(idx_begin + k, i).
+     *
+     * Sequences should override this with something faster than
+     * calling coordinate() for every entry.
+     */
+    virtual void fill(size_t idx_begin, size_t count,
+        size_t i_begin, size_t i_end, value_type *out) const {
+        const size_t nd = i_end - i_begin;
+        for(size_t k = 0; k < count; k++)
+            for(size_t i = i_begin; i < i_end; i++)
+                out[k * nd + (i - i_begin)] = coordinate(idx_begin + k, i);
+    }
+
     virtual ~qmc_sequence_t() {
 
     }
@@ -61,6 +168,34 @@ struct leaped_halton_sequence_t : public qmc_sequence_t<ValueType> {
         return RadialInverseFunction(boost::math::prime(i), idx * _leap);
     }
 
+    /**
+     * Each coordinate is a walk with constant step (the leap) over the
+     * integers, so it is generated incrementally. Work is done in tiles of
+     * points, so that writes stay in cache.
+     */
+    void fill(size_t idx_begin, size_t count,
+        size_t i_begin, size_t i_end, value_type *out) const {
+        const size_t nd = i_end - i_begin;
+        const size_t tile = detail::qmc_fill_tile;
+        const size_t ntiles = (count + tile - 1) / tile;
+
+        std::vector<unsigned> primes(nd);
+        for(size_t i = i_begin; i < i_end; i++)
+            primes[i - i_begin] = boost::math::prime(i);
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for if (count * nd >= 16384)
+#       endif
+        for(size_t t = 0; t < ntiles; t++) {
+            const size_t k0 = t * tile;
+            const size_t c = std::min(tile, count - k0);
+            for(size_t i = 0; i < nd; i++)
+                detail::radical_inverse_walk(primes[i],
+                    (idx_begin + k0) * _leap + 1, _leap, c,
+                    out + k0 * nd + i, nd);
+        }
+    }
+
     boost::property_tree::ptree to_ptree() const {
         boost::property_tree::ptree pt;
         pt.put("skylark_object_type", "qmc_sequence");
@@ -76,6 +211,213 @@ private:
     size_t _leap;
 };
 
+/**
+ * Sobol sequence (with Joe-Kuo direction numbers, in Gray code order, like
+ * boost::random::sobol), optionally scrambled.
+ *
+ * Scrambling is a nested uniform (Owen) scramble of the digits, implemented
+ * by hashing (Burley, "Practical Hash-based Owen Scrambling", 2020), with an
+ * independent seed per coordinate. Unlike the Halton sequence, the quality of
+ * the points does not degrade with the dimension, and scrambling removes the
+ * correlation between coordinates of the unscrambled sequence.
+ *
+ * Points have 32 bits of resolution, are never exactly 0 or 1, and the
+ * index of a point must be less than 2^32 - 1. Point k is point k of
+ * boost::random::sobol (which skips the zero point). Requires Boost 1.71 or newer, and
+ * at most 3667 coordinates.
+ */
+template<typename ValueType>
+struct sobol_sequence_t : public qmc_sequence_t<ValueType> {
+
+    typedef ValueType value_type;
+
+    sobol_sequence_t() :
+        _d(0), _scrambled(false), _seed(0) {
+    }
+
+    sobol_sequence_t(size_t d, bool scrambled = true, boost::uint32_t seed = 0) :
+        _d(d), _scrambled(scrambled), _seed(seed) {
+        build();
+    }
+
+    sobol_sequence_t (const boost::property_tree::ptree& json) {
+        _d = json.get<size_t>("d");
+        _scrambled = json.get<bool>("scrambled");
+        _seed = json.get<boost::uint32_t>("seed");
+        build();
+    }
+
+    inline value_type coordinate(size_t idx, size_t i) const {
+        check_range(idx, 1);
+        return to_value(gray_code_point(idx, i), i);
+    }
+
+    /**
+     * Points are in Gray code order, so consecutive points differ in one
+     * direction number per coordinate: the one of the lowest zero bit of
+     * the index.
+     */
+    void fill(size_t idx_begin, size_t count,
+        size_t i_begin, size_t i_end, value_type *out) const {
+        check_range(idx_begin, count);
+        const size_t nd = i_end - i_begin;
+        const size_t tile = detail::qmc_fill_tile;
+        const size_t ntiles = (count + tile - 1) / tile;
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for if (count * nd >= 16384)
+#       endif
+        for(size_t t = 0; t < ntiles; t++) {
+            const size_t k0 = t * tile;
+            const size_t c = std::min(tile, count - k0);
+            for(size_t i = i_begin; i < i_end; i++) {
+                const boost::uint32_t *v = &_directions[i * 32];
+                boost::uint32_t x = gray_code_point(idx_begin + k0, i);
+                value_type *o = out + k0 * nd + (i - i_begin);
+                for(size_t k = 0; k < c; k++) {
+                    o[k * nd] = to_value(x, i);
+                    int j = 0;
+                    for(size_t m = idx_begin + k0 + k + 1; m & 1; m >>= 1)
+                        j++;
+                    if (j < 32)
+                        x ^= v[j];
+                }
+            }
+        }
+    }
+
+    boost::property_tree::ptree to_ptree() const {
+        boost::property_tree::ptree pt;
+        pt.put("skylark_object_type", "qmc_sequence");
+        pt.put("skylark_version", VERSION);
+        pt.put("sequence_type", "sobol");
+        pt.put("d", _d);
+        pt.put("scrambled", _scrambled);
+        pt.put("seed", _seed);
+        return pt;
+    }
+
+private:
+    size_t _d;
+    bool _scrambled;
+    boost::uint32_t _seed;
+
+    /// 32 direction numbers per coordinate, and the scrambling seeds.
+    std::vector<boost::uint32_t> _directions;
+    std::vector<boost::uint32_t> _seeds;
+
+    void build() {
+#if BOOST_VERSION >= 107100
+        typedef boost::random::detail::qrng_tables::sobol table_t;
+
+        if (_d > table_t::max_dimension)
+            SKYLARK_THROW_EXCEPTION(base::skylark_exception() <<
+                base::error_msg("Sobol sequence supports at most 3667 "
+                    "coordinates"));
+
+        _directions.assign(_d * 32, 0);
+        _seeds.resize(_d);
+
+        for(size_t i = 0; i < _d; i++) {
+            boost::uint32_t *v = &_directions[i * 32];
+
+            if (i == 0) {
+                for(int j = 0; j < 32; j++)
+                    v[j] = 1;
+            } else {
+                // m_j = m_{j-s} ^ (m_{j-s} << s) ^ sum_k a_k (m_{j-k} << k),
+                // for the primitive polynomial of degree s of coordinate i.
+                const boost::uint32_t poly = table_t::polynomial(i - 1);
+                int degree = 0;
+                while ((poly >> (degree + 1)) != 0)
+                    degree++;
+
+                for(int j = 0; j < degree && j < 32; j++)
+                    v[j] = table_t::minit(i - 1, j);
+                for(int j = degree; j < 32; j++) {
+                    boost::uint32_t m = v[j - degree];
+                    for(int k = 0; k < degree; k++)
+                        if ((poly >> k) & 1)
+                            m ^= v[j - (degree - k)] << (degree - k);
+                    v[j] = m;
+                }
+            }
+
+            for(int j = 0; j < 32; j++)
+                v[j] <<= 31 - j;
+
+            _seeds[i] = hash(_seed ^ hash(static_cast<boost::uint32_t>(i)));
+        }
+#else
+        SKYLARK_THROW_EXCEPTION(base::skylark_exception() <<
+            base::error_msg("Sobol sequence requires Boost 1.71 or newer"));
+#endif
+    }
+
+    /**
+     * Point idx is the one of Gray code index idx + 1: as in
+     * boost::random::sobol, the zero point is skipped (it would map to
+     * about 2^-33 in every coordinate, far out in the tails of the quantile
+     * functions applied to the points).
+     */
+    boost::uint32_t gray_code_point(size_t idx, size_t i) const {
+        const boost::uint32_t *v = &_directions[i * 32];
+        boost::uint32_t x = 0;
+        const size_t n = idx + 1;
+        for(size_t g = n ^ (n >> 1); g != 0; g >>= 1, v++)
+            if (g & 1)
+                x ^= *v;
+        return x;
+    }
+
+    void check_range(size_t idx_begin, size_t count) const {
+        if (static_cast<boost::uint64_t>(idx_begin) + count >=
+            (static_cast<boost::uint64_t>(1) << 32))
+            SKYLARK_THROW_EXCEPTION(base::skylark_exception() <<
+                base::error_msg("Sobol sequence index out of range"));
+    }
+
+    static boost::uint32_t hash(boost::uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x85ebca6bu;
+        x ^= x >> 13;
+        x *= 0xc2b2ae35u;
+        x ^= x >> 16;
+        return x;
+    }
+
+    static boost::uint32_t reverse_bits(boost::uint32_t x) {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    inline value_type to_value(boost::uint32_t x, size_t i) const {
+        if (_scrambled) {
+            // Laine-Karras style hash on the reversed bits: each bit is
+            // flipped depending only on the bits above it.
+            const boost::uint32_t seed = _seeds[i];
+            x = reverse_bits(x);
+            x ^= x * 0x3d20adeau;
+            x += seed;
+            x *= (seed >> 16) | 1;
+            x ^= x * 0x05526c56u;
+            x ^= x * 0x53a22864u;
+            x = reverse_bits(x);
+        }
+
+        // Keep as many bits as value_type holds exactly, and take the
+        // midpoint of the cell, so the value is in (0, 1).
+        const int bits = std::numeric_limits<value_type>::digits - 1 < 32 ?
+            std::numeric_limits<value_type>::digits - 1 : 32;
+        return static_cast<value_type>(
+            ((x >> (32 - bits)) + 0.5) / static_cast<double>(
+                static_cast<boost::uint64_t>(1) << bits));
+    }
+};
+
 template<typename ValueType>
 struct qmc_sequence_container_t : public qmc_sequence_t<ValueType> {
     typedef ValueType value_type;
@@ -85,12 +427,22 @@ struct qmc_sequence_container_t : public qmc_sequence_t<ValueType> {
         if (sequence_type == "leaped halton")
             _sequence = boost::shared_ptr<qmc_sequence_t<value_type> >(new
                 leaped_halton_sequence_t<value_type>(json));
+        else if (sequence_type == "sobol")
+            _sequence = boost::shared_ptr<qmc_sequence_t<value_type> >(new
+                sobol_sequence_t<value_type>(json));
         else 
             SKYLARK_THROW_EXCEPTION(base::skylark_exception() <<
                 base::error_msg("Unknown QMC sequence type"));
         // TODO throw exception if type not found...
     }
 
+    /// Wrap a copy of a concrete sequence, e.g. a sobol_sequence_t.
+    template<typename SequenceType>
+    explicit qmc_sequence_container_t(const SequenceType& sequence) :
+        _sequence(new SequenceType(sequence)) {
+
+    }
+
     qmc_sequence_container_t() {
 
     }
@@ -99,6 +451,11 @@ struct qmc_sequence_container_t : public qmc_sequence_t<ValueType> {
         return _sequence->coordinate(idx, i);
     }
 
+    virtual void fill(size_t idx_begin, size_t count,
+        size_t i_begin, size_t i_end, value_type *out) const {
+        _sequence->fill(idx_begin, count, i_begin, i_end, out);
+    }
+
     virtual boost::property_tree::ptree to_ptree() const {
         return _sequence->to_ptree();
     }
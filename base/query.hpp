@@ -5,13 +5,13 @@
 
 namespace skylark { namespace base {
 
-template<typename T>
-int Height(const sparse_matrix_t<T>& A) {
+template<typename T, typename I>
+I Height(const sparse_matrix_t<T, I>& A) {
     return A.height();
 }
 
-template<typename T>
-int Width(const sparse_matrix_t<T>& A) {
+template<typename T, typename I>
+I Width(const sparse_matrix_t<T, I>& A) {
     return A.width();
 }
 
@@ -1,6 +1,8 @@
 #ifndef SKYLARK_RANDGEN_HPP
 #define SKYLARK_RANDGEN_HPP
 
+#include <algorithm>
+#include <limits>
 #include <sstream>
 
 #include <Random123/threefry.h>
@@ -114,7 +116,104 @@ public:
         return cloned_distribution(urng);
     }
 
+    /**
+     * Bulk generation: writes the samples with indices
+     * [begin, begin + count) to out. Produces exactly the same values as
+     * successive calls to operator[], but bounds-checks once and computes
+     * the first Threefry block of all counters in a batch before handing
+     * them to the distribution.
+     *
+     * @param[in] begin Index of the first sample.
+     * @param[in] count Number of samples.
+     * @param[out] out Output buffer (at least count entries).
+     */
+    template<typename OutputType>
+    void fill(size_t begin, size_t count, OutputType *out) const {
+        if (count == 0)
+            return;
+
+        if (begin >= _size || count > _size - begin) {
+            std::ostringstream msg;
+            msg << "Range is out of bounds:\n";
+            msg << "[" << begin << ", " << begin + count << ") not in expected ";
+            msg << "[0, " << _size << ") range\n";
+            SKYLARK_THROW_EXCEPTION (
+                base::random123_exception()
+                << base::error_msg(msg.str()) );
+        }
+
+        const size_t numblks = (count + _fill_block_size - 1) / _fill_block_size;
+
+#       ifdef SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for schedule(static) if(numblks > 4)
+#       endif
+        for(ptrdiff_t blk = 0; blk < static_cast<ptrdiff_t>(numblks); blk++) {
+            size_t s = blk * _fill_block_size;
+            size_t len = count - s < _fill_block_size ? count - s : _fill_block_size;
+            size_t first = _base + begin + s;
+
+            // Straight-line Threefry rounds over consecutive counters.
+            RNG_t rng;
+            ctr_t ctr[_fill_block_size];
+            for(size_t k = 0; k < len; k++) {
+                ctr_t c;
+                c.v[0] = static_cast<ctr_t::value_type>(first + k);
+                c.v[1] = static_cast<ctr_t::value_type>(0);
+                ctr[k] = rng(c, _key);
+            }
+
+            for(size_t k = 0; k < len; k++) {
+                block_urng_t urng(first + k, _key, ctr[k]);
+                distribution_type cloned_distribution = _distribution;
+                out[s + k] = static_cast<OutputType>(cloned_distribution(urng));
+            }
+        }
+    }
+
 private:
+
+    /// Number of consecutive counters generated at once by fill().
+    static const size_t _fill_block_size = 256;
+
+    /**
+     * Uniform generator that reproduces the MicroURNG stream for counter
+     * (index, 0), with the first Threefry output block precomputed.
+     * MicroURNG hands out the block elements last to first, and tags
+     * further blocks in the upper 32 bits of the last counter element.
+     */
+    struct block_urng_t {
+        typedef ctr_t::value_type result_type;
+
+        static result_type min() { return 0; }
+        static result_type max() {
+            return std::numeric_limits<result_type>::max();
+        }
+
+        block_urng_t(size_t index, const key_t& key, const ctr_t& first)
+            : _key(key), _rdata(first), _last(ctr_t::static_size), _n(1) {
+            _c0.v[0] = static_cast<result_type>(index);
+            _c0.v[1] = static_cast<result_type>(0);
+        }
+
+        result_type operator()() {
+            if (_last == 0) {
+                ctr_t c = _c0;
+                c.v[ctr_t::static_size - 1] |=
+                    static_cast<result_type>(_n++) << 32;
+                _rdata = RNG_t()(c, _key);
+                _last = ctr_t::static_size;
+            }
+            return _rdata.v[--_last];
+        }
+
+    private:
+        ctr_t _c0;
+        key_t _key;
+        ctr_t _rdata;
+        size_t _last;
+        size_t _n;
+    };
+
     size_t _base;
     size_t _size;
     key_t _key;
@@ -27,14 +27,7 @@ void RandomMatrix(El::Matrix<T> &A, El::Int m, El::Int n,
         context.allocate_random_samples_array(m * n, dist);
 
     A.Resize(m, n);
-    T *data = A.Buffer();
-
-#ifdef SKYLARK_HAVE_OPENMP
-#pragma omp parallel for collapse(2)
-#endif
-    for(size_t j = 0; j < n; j++)
-        for(size_t i = 0; i < m; i++)
-            data[j * m + i] = entries[j * m + i];
+    entries.fill(0, m * n, A.Buffer());
 }
 
 template<typename T, template<typename, typename> class DistributionType>
@@ -45,14 +38,7 @@ void RandomMatrix(El::Matrix<T> &A, El::Int m, El::Int n,
         context.allocate_random_samples_array(m * n, dist);
 
     A.Resize(m, n);
-    T *data = A.Buffer();
-
-#ifdef SKYLARK_HAVE_OPENMP
-#pragma omp parallel for collapse(2)
-#endif
-    for(size_t j = 0; j < n; j++)
-        for(size_t i = 0; i < m; i++)
-            data[j * m + i] = entries[j * m + i];
+    entries.fill(0, m * n, A.Buffer());
 }
 
 /**
@@ -153,8 +139,8 @@ void UniformMatrix(MatrixType &A, El::Int m, El::Int n,
     RandomMatrix(A, m, n, dist, context);
 }
 
-template<typename T>
-void UniformMatrix(sparse_matrix_t<T> &A, El::Int m, El::Int n,
+template<typename T, typename I>
+void UniformMatrix(sparse_matrix_t<T, I> &A, El::Int m, El::Int n,
     context_t &context) {
 
     SKYLARK_THROW_EXCEPTION(unsupported_base_operation() <<
@@ -11,21 +11,10 @@
 #include <El.hpp>
 
 #include "sparse_matrix.hpp"
+#include "detail/coo_assembly.hpp"
 
 namespace skylark { namespace base {
 
-namespace detail {
-
-    struct compare_t {
-        bool operator()(const std::pair<int, int>& x, const std::pair<int, int>& y) const {
-            if(x.second == y.second)
-                return x.first < y.first;
-
-            return x.second < y.second;
-        }
-    };
-}
-
 
 /**
  *  This implements a very crude CSC sparse matrix container only intended to
@@ -101,7 +90,8 @@ struct sparse_dist_matrix_t {
      * If the global value is not owned by the calling rank, nothing will be
      * queued.
      *
-     * Note that this method is currently NOT thread safe! (FIXME)
+     * Can be called concurrently from the threads of an OpenMP parallel
+     * region (but not from nested regions).
      */
     void queue_update(El::Int i, El::Int j, value_type value) {
 
@@ -117,7 +107,8 @@ struct sparse_dist_matrix_t {
     /**
      * Queue a local value to be inserted into the matrix when finalized.
      *
-     * Note that this method is currently NOT thread safe! (FIXME)
+     * Can be called concurrently from the threads of an OpenMP parallel
+     * region (but not from nested regions).
      */
     void queue_update_local(El::Int i, El::Int j, value_type value) {
 
@@ -125,56 +116,26 @@ struct sparse_dist_matrix_t {
         assert(i < height());
         assert(j < width());
 
-        _n_local_rows = std::max(_n_local_rows, i + 1);
-        _n_local_cols = std::max(_n_local_cols, j + 1);
-
-        //XXX: we should use a nicer structure for the temporary storage..
-        _temp_buffer[std::make_pair(i, j)] += value;
+        _temp_buffer.push(i, j, value);
     }
 
     /**
      * Finalizes the matrix, no subsequent updates to values possible.
-     *
-     * FIXME: use a more adequate internal data structure
+     * Duplicate updates are summed.
      */
     void finalize() {
 
         assert(_finalized == false);
         _finalized = true;
 
-        _nnz = _temp_buffer.size();
-
-        _indptr.resize(_n_local_cols + 1);
-        _indices.resize(_nnz);
-        _values.resize(_nnz);
-
-        size_t nnz = 0;
-        int indptr_idx = 0;
-        _indptr[indptr_idx] = 0;
-
-        typename std::map< std::pair<int, int>, value_type >::const_iterator itr;
-        for(itr = _temp_buffer.begin(); itr != _temp_buffer.end();
-                itr++, nnz++) {
-
-            int cur_row = itr->first.first;
-            int cur_col = itr->first.second;
-            value_type cur_val = itr->second;
-
-            // fill empty cols
-            for(; indptr_idx < cur_col; ++indptr_idx)
-                _indptr[indptr_idx + 1] = nnz;
-
-            _indices[nnz] = cur_row;
-            _values[nnz]  = cur_val;
-        }
-
-        for(; indptr_idx < _n_local_cols; ++indptr_idx)
-            _indptr[indptr_idx + 1] = nnz;
-
-        assert(nnz == _nnz);
-        _temp_buffer.clear();
+        int n_local_rows = _n_local_rows, n_local_cols = _n_local_cols;
+        _temp_buffer.assemble(n_local_rows, n_local_cols,
+            _indptr, _indices, _values);
+        _n_local_rows = n_local_rows;
+        _n_local_cols = n_local_cols;
+        _nnz = _values.size();
 
-        _local_buffer->attach(&_indptr[0], &_indices[0], &_values[0],
+        _local_buffer->attach(_indptr.data(), _indices.data(), _values.data(),
                 _nnz, _n_local_rows, _n_local_cols, false, false, false);
 
         _global_nnz = 0;
@@ -352,7 +313,7 @@ struct sparse_dist_matrix_t {
 private:
 
     std::unique_ptr< sparse_matrix_t<value_type> > _local_buffer;
-    std::map< std::pair<int, int>, value_type, detail::compare_t > _temp_buffer;
+    detail::coo_assembly_buffer_t<value_type> _temp_buffer;
 
     const boost::mpi::communicator _comm;
 
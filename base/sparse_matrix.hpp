@@ -5,10 +5,20 @@
 
 #include <boost/unordered_map.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
+#ifdef SKYLARK_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 #include "exception.hpp"
 
 namespace skylark { namespace base {
@@ -20,11 +30,22 @@ namespace skylark { namespace base {
  *  Row indices are not sorted.
  *  Structure is always constants, and can only be attached by Attached.
  *  Values of non-zeros can be modified.
+ *
+ *  IndexType is used for the structure (indptr and indices) and for the
+ *  dimensions. The default int keeps the structure compact; use a 64-bit
+ *  type (e.g. int64_t) for local blocks with 2^31 or more non-zeros.
+ *
+ *  For row-oriented access the matrix can carry a CSR companion (see
+ *  transposed()), built on first use and kept until the matrix changes.
  */
-template<typename ValueType=double>
+template<typename ValueType=double, typename IndexType=int>
 struct sparse_matrix_t {
 
-    typedef int index_type;
+    static_assert(std::is_integral<IndexType>::value &&
+        std::is_signed<IndexType>::value,
+        "The index type of a sparse matrix must be a signed integer");
+
+    typedef IndexType index_type;
     typedef ValueType value_type;
 
     typedef std::tuple<index_type, index_type, value_type> coord_tuple_t;
@@ -37,18 +58,19 @@ struct sparse_matrix_t {
     {}
 
     // The following relies on C++11
-    sparse_matrix_t(sparse_matrix_t<ValueType>&& A) :
+    sparse_matrix_t(sparse_matrix_t&& A) :
         _ownindptr(A._ownindptr), _ownindices(A._ownindices),
         _ownvalues(A._ownvalues), _readonly(A._readonly), _dirty_struct(A._dirty_struct),
         _height(A._height), _width(A._width), _nnz(A._nnz),
-        _indptr(A._indptr), _indices(A._indices), _values(A._values)
+        _indptr(A._indptr), _indices(A._indices), _values(A._values),
+        _transposed(std::move(A._transposed))
     {
         A._ownindptr = false;
         A._ownindices = false;
         A._ownvalues = false;
     }
 
-    sparse_matrix_t(const sparse_matrix_t<ValueType> &A)
+    sparse_matrix_t(const sparse_matrix_t &A)
         : _ownindptr(false), _ownindices(false), _ownvalues(false),
           _readonly(false), _dirty_struct(false), _height(0), _width(0), _nnz(0),
           _indptr(nullptr), _indices(nullptr), _values(nullptr) {
@@ -66,8 +88,7 @@ struct sparse_matrix_t {
     }
 
 
-    const sparse_matrix_t<ValueType> &operator=(const
-        sparse_matrix_t<ValueType> &A) {
+    const sparse_matrix_t &operator=(const sparse_matrix_t &A) {
         Copy(A, *this);
         return *this;
     }
@@ -94,7 +115,8 @@ struct sparse_matrix_t {
      * Attach new structure and values.
      */
     void attach(const index_type *indptr, const index_type *indices,
-        value_type *values, int nnz, int n_rows, int n_cols, bool _own = false) {
+        value_type *values, index_type nnz, index_type n_rows,
+        index_type n_cols, bool _own = false) {
         attach(indptr, indices, values, nnz, n_rows, n_cols, _own, _own, _own);
     }
 
@@ -102,8 +124,8 @@ struct sparse_matrix_t {
      * Attach new structure and values.
      */
     void attach(const index_type *indptr, const index_type *indices,
-        value_type *values, int nnz, int n_rows, int n_cols,
-        bool ownindptr, bool ownindices, bool ownvalues) {
+        value_type *values, index_type nnz, index_type n_rows,
+        index_type n_cols, bool ownindptr, bool ownindices, bool ownvalues) {
         _free_data();
 
         _indptr = indptr;
@@ -125,7 +147,8 @@ struct sparse_matrix_t {
      * Attach new structure and values. Values are read-only;
      */
     void readonly_attach(const index_type *indptr, const index_type *indices,
-        value_type *values, int nnz, int n_rows, int n_cols, bool _own = false) {
+        value_type *values, index_type nnz, index_type n_rows,
+        index_type n_cols, bool _own = false) {
         attach(indptr, indices, values, nnz, n_rows, n_cols, _own, _own, _own);
     }
 
@@ -133,8 +156,8 @@ struct sparse_matrix_t {
      * Attach new structure and values. Values are read-only;
      */
     void readonly_attach(const index_type *indptr, const index_type *indices,
-        const value_type *values, int nnz, int n_rows, int n_cols,
-        bool ownindptr, bool ownindices, bool ownvalues) {
+        const value_type *values, index_type nnz, index_type n_rows,
+        index_type n_cols, bool ownindptr, bool ownindices, bool ownvalues) {
         _free_data();
 
         _indptr = indptr;
@@ -155,15 +178,22 @@ struct sparse_matrix_t {
 
     // attaching a coordinate structure facilitates going from distributed
     // input to local output.
-    void set(coords_t coords, int n_rows = 0, int n_cols = 0) {
+    void set(coords_t coords, index_type n_rows = 0, index_type n_cols = 0) {
+
+        if (coords.size() >
+            static_cast<size_t>(std::numeric_limits<index_type>::max()))
+            SKYLARK_THROW_EXCEPTION (
+              invalid_parameters()
+                  << base::error_msg("Too many non-zeros for the index type "
+                      "of the sparse matrix"));
 
         sort(coords.begin(), coords.end(), &sparse_matrix_t::_sort_coords);
 
-        n_cols = std::max(n_cols, std::get<1>(coords.back()) + 1);
+        n_cols = std::max(n_cols, index_type(std::get<1>(coords.back()) + 1));
         index_type *indptr = new index_type[n_cols + 1];
 
         // Count non-zeros
-        int nnz = 0;
+        index_type nnz = 0;
         for(size_t i = 0; i < coords.size(); ++i) {
             nnz++;
             index_type cur_row = std::get<0>(coords[i]);
@@ -178,7 +208,7 @@ struct sparse_matrix_t {
         value_type *values = new value_type[nnz];
 
         nnz = 0;
-        int indptr_idx = 0;
+        index_type indptr_idx = 0;
         indptr[indptr_idx] = 0;
         for(size_t i = 0; i < coords.size(); ++i) {
             index_type cur_row = std::get<0>(coords[i]);
@@ -201,7 +231,7 @@ struct sparse_matrix_t {
             indices[nnz - 1] = cur_row;
             values[nnz - 1] = cur_val;
 
-            n_rows = std::max(cur_row + 1, n_rows);
+            n_rows = std::max(index_type(cur_row + 1), n_rows);
         }
 
         for(; indptr_idx < n_cols; ++indptr_idx)
@@ -210,15 +240,15 @@ struct sparse_matrix_t {
         attach(indptr, indices, values, nnz, n_rows, n_cols, true);
     }
 
-    int height() const {
+    index_type height() const {
         return _height;
     }
 
-    int width() const {
+    index_type width() const {
         return _width;
     }
 
-    int nonzeros() const {
+    index_type nonzeros() const {
         return _nnz;
     }
 
@@ -230,10 +260,15 @@ struct sparse_matrix_t {
         return _indices;
     }
 
+    /**
+     * Values may be modified through the returned pointer, so this drops
+     * the CSR companion.
+     */
     value_type* values() {
         if (_readonly)
             SKYLARK_THROW_EXCEPTION(base::invalid_usage());
 
+        release_transposed();
         return _values;
     }
 
@@ -244,26 +279,26 @@ struct sparse_matrix_t {
     bool operator==(const sparse_matrix_t &rhs) const {
 
         // column pointer arrays have to be exactly the same
-        if (std::vector<int>(_indptr, _indptr+_width) !=
-            std::vector<int>(rhs._indptr, rhs._indptr + rhs._width))
+        if (std::vector<index_type>(_indptr, _indptr+_width) !=
+            std::vector<index_type>(rhs._indptr, rhs._indptr + rhs._width))
             return false;
 
         // check more carefully for unordered row indices
-        const int* indptr  = _indptr;
-        const int* indices = _indices;
+        const index_type* indptr  = _indptr;
+        const index_type* indices = _indices;
         const value_type* values = _values;
 
-        const int* indices_rhs   = rhs.indices();
+        const index_type* indices_rhs   = rhs.indices();
         const value_type* values_rhs = rhs.locked_values();
 
-        for(int col = 0; col < width(); col++) {
+        for(index_type col = 0; col < width(); col++) {
 
-            boost::unordered_map<int, value_type> col_values;
+            boost::unordered_map<index_type, value_type> col_values;
 
-            for(int idx = indptr[col]; idx < indptr[col + 1]; idx++)
+            for(index_type idx = indptr[col]; idx < indptr[col + 1]; idx++)
                 col_values.insert(std::make_pair(indices[idx], values[idx]));
 
-            for(int idx = indptr[col]; idx < indptr[col + 1]; idx++) {
+            for(index_type idx = indptr[col]; idx < indptr[col + 1]; idx++) {
                 if(col_values[indices_rhs[idx]] != values_rhs[idx])
                     return false;
             }
@@ -275,14 +310,51 @@ struct sparse_matrix_t {
     /**
      * Make the other matrix a view of this matrix.
      */
-    void view(sparse_matrix_t<ValueType> &B) const {
+    void view(sparse_matrix_t &B) const {
         B.attach(_indptr, _indices, _values, _nnz, _height, _width, false);
     }
 
-    void readonly_view(sparse_matrix_t<ValueType> &B) const {
+    void readonly_view(sparse_matrix_t &B) const {
         B.readonly_attach(_indptr, _indices, _values, _nnz, _height, _width, false);
     }
 
+    /**
+     * The CSR companion: the transpose of the matrix in CSC form, i.e. the
+     * matrix itself in CSR form, with the column indices of each row in
+     * increasing order. It is built (by Transpose) on the first call and
+     * cached, so that repeated rowwise operations pay for the conversion
+     * once. It costs as much memory as the matrix itself.
+     *
+     * The reference is valid until the matrix is attached to new data,
+     * values() is called or the companion is released. Values modified
+     * through a pointer obtained before the call are not reflected.
+     */
+    const sparse_matrix_t& transposed() const {
+        std::lock_guard<std::mutex> lock(_transposed_lock);
+        if (!_transposed) {
+            std::shared_ptr<sparse_matrix_t> T(new sparse_matrix_t());
+            Transpose(*this, *T);
+            _transposed = T;
+        }
+        return *_transposed;
+    }
+
+    /**
+     * Is the CSR companion currently built?
+     */
+    bool has_transposed() const {
+        std::lock_guard<std::mutex> lock(_transposed_lock);
+        return static_cast<bool>(_transposed);
+    }
+
+    /**
+     * Drop the CSR companion (e.g. to reclaim its memory).
+     */
+    void release_transposed() const {
+        std::lock_guard<std::mutex> lock(_transposed_lock);
+        _transposed.reset();
+    }
+
 private:
     bool _ownindptr;
     bool _ownindices;
@@ -292,15 +364,20 @@ private:
 
     bool _dirty_struct;
 
-    int _height;
-    int _width;
-    int _nnz;
+    index_type _height;
+    index_type _width;
+    index_type _nnz;
 
     const index_type* _indptr;
     const index_type* _indices;
     value_type* _values;
 
+    mutable std::mutex _transposed_lock;
+    mutable std::shared_ptr<sparse_matrix_t> _transposed;
+
     void _free_data() {
+        release_transposed();
+
         if (_ownindptr)
             delete[] _indptr;
         if (_ownindices)
@@ -317,57 +394,184 @@ private:
     }
 };
 
-template<typename T>
-void Transpose(const sparse_matrix_t<T>& A, sparse_matrix_t<T>& B) {
+namespace detail {
+
+/**
+ * Transposes an m x n CSC matrix (aindptr, aindices, avalues) into the
+ * caller provided arrays indptr (m + 1 entries), indices and values (nnz
+ * entries each), i.e. converts it from CSC to CSR (or back). The row
+ * indices of every output column come out in increasing order.
+ *
+ * The columns of the input are split among the threads in nnz-balanced
+ * ranges. Each thread counts the entries per row of its range into its
+ * own histogram; a prefix sum over rows, then over threads, turns the
+ * histograms into the first output slot of each (thread, row), and every
+ * thread scatters its range without synchronization. Since the ranges are
+ * in order, so are the output columns, as in the sequential transpose.
+ *
+ * The histograms take nthreads * m indices, so the number of threads is
+ * limited to keep them within the size of the matrix. With a single thread
+ * indptr itself is used as the histogram, and no memory besides the output
+ * is needed.
+ */
+template<typename IndexType, typename ValueType>
+void transpose_csc(IndexType m, IndexType n, const IndexType *aindptr,
+    const IndexType *aindices, const ValueType *avalues,
+    IndexType *indptr, IndexType *indices, ValueType *values) {
+
+    const IndexType nnz = aindptr[n];
+
+    IndexType nthreads = 1;
+#   ifdef SKYLARK_HAVE_OPENMP
+    nthreads = std::max(IndexType(1), std::min(
+            IndexType(omp_get_max_threads()),
+            std::min(n, nnz / std::max(m, IndexType(1)))));
+#   endif
+
+    if (nthreads == 1) {
+        std::fill(indptr, indptr + m + 1, 0);
+        for(IndexType idx = 0; idx < nnz; idx++)
+            indptr[aindices[idx] + 1]++;
+        for(IndexType row = 0; row < m; row++)
+            indptr[row + 1] += indptr[row];
+
+        // Use indptr[row] as the insertion point, then shift back.
+        for(IndexType col = 0; col < n; col++)
+            for(IndexType idx = aindptr[col]; idx < aindptr[col + 1]; idx++) {
+                IndexType pos = indptr[aindices[idx]]++;
+                indices[pos] = col;
+                values[pos] = avalues[idx];
+            }
+        for(IndexType row = m; row > 0; row--)
+            indptr[row] = indptr[row - 1];
+        indptr[0] = 0;
+
+        return;
+    }
 
-    typedef typename sparse_matrix_t<T>::index_type index_type;
-    typedef typename sparse_matrix_t<T>::value_type value_type;
+    std::vector<IndexType> bounds(nthreads + 1, n);
+    bounds[0] = 0;
+    for(IndexType t = 1; t < nthreads; t++)
+        bounds[t] = std::max(bounds[t - 1], IndexType(std::lower_bound(
+                    aindptr, aindptr + n, IndexType(double(nnz) * t / nthreads))
+                - aindptr));
 
-    const index_type* aindptr = A.indptr();
-    const index_type* aindices = A.indices();
-    const value_type* avalues = A.locked_values();
+    // Rows are also split in nthreads blocks for the prefix sums.
+    auto row_block = [m, nthreads](IndexType b) {
+        return IndexType(int64_t(m) * b / nthreads);
+    };
 
-    int m = A.width();
-    int n = A.height();
-    int nnz = A.nonzeros();
+    std::vector<IndexType> hist(size_t(nthreads) * m, 0);
+    std::vector<IndexType> block_sums(nthreads + 1, 0);
 
-    index_type *indptr = new int[n + 1];
-    index_type *indices = new int[nnz];
-    value_type *values = new value_type[nnz];
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel num_threads(nthreads)
+#   endif
+    {
+        // Histograms
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(static, 1)
+#       endif
+        for(IndexType t = 0; t < nthreads; t++) {
+            IndexType *h = hist.data() + size_t(t) * m;
+            for(IndexType idx = aindptr[bounds[t]];
+                idx < aindptr[bounds[t + 1]]; idx++)
+                h[aindices[idx]]++;
+        }
 
-    // Count nonzeros in each row
-    index_type *nzrow = new int[n];
-    std::fill(nzrow, nzrow + n, 0);
-    for(int col = 0; col < m; col++)
-        for(int idx = aindptr[col]; idx < aindptr[col + 1]; idx++)
-            nzrow[aindices[idx]]++;
-
-    // Set indptr
-    indptr[0] = 0;
-    for(int col = 1; col <= n; col++)
-        indptr[col] = indptr[col - 1] + nzrow[col - 1];
-
-    // Fill values
-    std::fill(nzrow, nzrow + n, 0);
-    for(int col = 0; col < m; col++)
-        for(int idx = aindptr[col]; idx < aindptr[col + 1]; idx++) {
-            int row = aindices[idx];
-            T val = avalues[idx];
-            indices[indptr[row] + nzrow[row]] = col;
-            values[indptr[row] + nzrow[row]] = val;
-            nzrow[row]++;
+        // Exclusive prefix over threads for each row, row counts into
+        // indptr[row + 1], and their sum over blocks of rows.
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(static, 1)
+#       endif
+        for(IndexType b = 0; b < nthreads; b++) {
+            IndexType r0 = row_block(b), r1 = row_block(b + 1);
+            IndexType sum = 0;
+            for(IndexType row = r0; row < r1; row++) {
+                IndexType count = 0;
+                for(IndexType t = 0; t < nthreads; t++) {
+                    IndexType &h = hist[size_t(t) * m + row];
+                    IndexType c = h;
+                    h = count;
+                    count += c;
+                }
+                indptr[row + 1] = count;
+                sum += count;
+            }
+            block_sums[b + 1] = sum;
         }
 
-    delete[] nzrow;
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp single
+#       endif
+        {
+            indptr[0] = 0;
+            for(IndexType b = 0; b < nthreads; b++)
+                block_sums[b + 1] += block_sums[b];
+        }
+
+        // Prefix over rows.
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(static, 1)
+#       endif
+        for(IndexType b = 0; b < nthreads; b++) {
+            IndexType r0 = row_block(b), r1 = row_block(b + 1);
+            IndexType offset = block_sums[b];
+            for(IndexType row = r0; row < r1; row++) {
+                offset += indptr[row + 1];
+                indptr[row + 1] = offset;
+            }
+        }
+
+        // Scatter
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(static, 1)
+#       endif
+        for(IndexType t = 0; t < nthreads; t++) {
+            IndexType *h = hist.data() + size_t(t) * m;
+            for(IndexType col = bounds[t]; col < bounds[t + 1]; col++)
+                for(IndexType idx = aindptr[col]; idx < aindptr[col + 1];
+                    idx++) {
+                    IndexType row = aindices[idx];
+                    IndexType pos = indptr[row] + h[row]++;
+                    indices[pos] = col;
+                    values[pos] = avalues[idx];
+                }
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * B = A^T, which is also the conversion of A between CSC and CSR. B may be
+ * A itself.
+ */
+template<typename T, typename I>
+void Transpose(const sparse_matrix_t<T, I>& A, sparse_matrix_t<T, I>& B) {
+
+    typedef typename sparse_matrix_t<T, I>::index_type index_type;
+    typedef typename sparse_matrix_t<T, I>::value_type value_type;
+
+    index_type m = A.width();
+    index_type n = A.height();
+    index_type nnz = A.nonzeros();
+
+    index_type *indptr = new index_type[n + 1];
+    index_type *indices = new index_type[nnz];
+    value_type *values = new value_type[nnz];
+
+    detail::transpose_csc(n, m, A.indptr(), A.indices(), A.locked_values(),
+        indptr, indices, values);
 
     B.attach(indptr, indices, values, nnz, m, n, true);
 }
 
-template<typename T>
-void Copy(const sparse_matrix_t<T>& A, sparse_matrix_t<T>& B) {
+template<typename T, typename I>
+void Copy(const sparse_matrix_t<T, I>& A, sparse_matrix_t<T, I>& B) {
 
-    typedef typename sparse_matrix_t<T>::index_type index_type;
-    typedef typename sparse_matrix_t<T>::value_type value_type;
+    typedef typename sparse_matrix_t<T, I>::index_type index_type;
+    typedef typename sparse_matrix_t<T, I>::value_type value_type;
 
     index_type *indptr = new index_type[A.width() + 1];
     index_type *indices = new index_type[A.nonzeros()];
@@ -375,7 +579,7 @@ void Copy(const sparse_matrix_t<T>& A, sparse_matrix_t<T>& B) {
 
     std::copy(A.indptr(), A.indptr() + A.width() + 1, indptr);
     std::copy(A.indices(), A.indices() + A.nonzeros(), indices);
-    std::copy(A.values(), A.values() + A.nonzeros(), values);
+    std::copy(A.locked_values(), A.locked_values() + A.nonzeros(), values);
 
     B.attach(indptr, indices, values, A.nonzeros(), A.height(), A.width(), true);
 
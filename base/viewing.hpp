@@ -66,31 +66,44 @@ inline void RowView(El::ElementalMatrix<T>& A,
     El::LockedView(A, B, i, 0, height, B.Width());
 }
 
-template<typename T>
+template<typename T, typename I>
 inline
-void ColumnView(sparse_matrix_t<T>& A, sparse_matrix_t<T>& B,
+void ColumnView(sparse_matrix_t<T, I>& A, sparse_matrix_t<T, I>& B,
     El::Int j, El::Int width) {
-    const int *bindptr = B.indptr();
-    const int *bindices = B.indices();
+    const I *bindptr = B.indptr();
+    const I *bindices = B.indices();
     T *bvalues = B.values();
 
-    int start = bindptr[j];
-    int *indptr = new int[width + 1];
-    for (int i = 0; i <= width; i++)
+    I start = bindptr[j];
+    I *indptr = new I[width + 1];
+    for (El::Int i = 0; i <= width; i++)
         indptr[i] = bindptr[j + i] - start;
-    const int *indices = bindices + start;
+    const I *indices = bindices + start;
     T *values = bvalues + start;
 
     A.attach(indptr, indices, values, indptr[width], B.height(), width,
         true, false, false);
 }
 
-template<typename T>
+/**
+ * Read-only view of columns of a const matrix. Unlike the mutable view it
+ * does not touch B (e.g. its CSR companion is kept), and B may itself be
+ * read-only.
+ */
+template<typename T, typename I>
 inline
-sparse_matrix_t<T> ColumnView(const sparse_matrix_t<T>& B,
+sparse_matrix_t<T, I> ColumnView(const sparse_matrix_t<T, I>& B,
     El::Int j, El::Int width) {
-    sparse_matrix_t<T> A;
-    ColumnView(A, const_cast<sparse_matrix_t<T>&>(B), j, width);
+    const I *bindptr = B.indptr();
+
+    I start = bindptr[j];
+    I *indptr = new I[width + 1];
+    for (El::Int i = 0; i <= width; i++)
+        indptr[i] = bindptr[j + i] - start;
+
+    sparse_matrix_t<T, I> A;
+    A.readonly_attach(indptr, B.indices() + start, B.locked_values() + start,
+        indptr[width], B.height(), width, true, false, false);
     return A;
 }
 
@@ -49,6 +49,14 @@ int main(int argc, char** argv) {
     skyalg::AsyRGS(A, b, x, context, asy_params);
     std::cout <<"Took " << boost::format("%.2e") % timer.elapsed() << " sec\n";
 
+    std::cout << "Using AsyRGS (partitioned)... " << std::endl;
+    timer.restart();
+    El::Zero(x);
+    asy_params.partitioned = true;
+    skyalg::AsyRGS(A, b, x, context, asy_params);
+    asy_params.partitioned = false;
+    std::cout <<"Took " << boost::format("%.2e") % timer.elapsed() << " sec\n";
+
     std::cout << "Using CG... " << std::endl;
     timer.restart();
     El::Zero(x);
@@ -0,0 +1,112 @@
+/**
+ * Compares the batched FFTW execution in the FUTs (one fftw_plan_many_r2r
+ * plan per 16 columns or rows, through an aligned buffer per thread) with
+ * the previous path (one fftw_execute_r2r per column, with the aligned or
+ * the unaligned plan, rowwise via explicit transposition).
+ *
+ * Usage: fft_benchmark [m] [n] [repetitions]
+ *
+ * Applies the DCT columnwise to an m x n matrix and rowwise to its n x m
+ * transpose, so that both directions transform vectors of length m.
+ */
+
+#include <iostream>
+#include <cstdlib>
+
+#include <El.hpp>
+#include <boost/mpi.hpp>
+#include <boost/format.hpp>
+#include <skylark.hpp>
+
+#if SKYLARK_HAVE_FFTW
+
+namespace skys = skylark::sketch;
+
+typedef skys::fft_futs<double>::DCT_t dct_t;
+typedef skys::internal::fftw_plan_cache_t<double> plan_cache_t;
+
+/** The per-column path, as the FUTs did before batching. */
+void per_column_dct(El::Matrix<double>& A) {
+    plan_cache_t &cache = plan_cache_t::instance();
+    fftw_plan plan = cache.r2r(A.Height(), FFTW_REDFT10, true);
+    fftw_plan plan_unaligned = cache.r2r(A.Height(), FFTW_REDFT10, false);
+    double *AA = A.Buffer();
+    int j;
+
+#   ifdef SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for private(j)
+#   endif
+    for (j = 0; j < A.Width(); j++) {
+        double *x = AA + j * A.LDim();
+        fftw_execute_r2r(plan_cache_t::precision_type::aligned(x) ?
+            plan : plan_unaligned, x, x);
+    }
+}
+
+void per_column_dct_rowwise(El::Matrix<double>& A) {
+    El::Matrix<double> AT;
+    El::Transpose(A, AT);
+    per_column_dct(AT);
+    El::Transpose(AT, A);
+}
+
+template<typename F>
+double time_it(F f, El::Matrix<double>& A, int reps) {
+    f(A);   // warm up, and plan
+    boost::mpi::timer timer;
+    for(int r = 0; r < reps; r++)
+        f(A);
+    return timer.elapsed() / reps;
+}
+
+int main(int argc, char* argv[]) {
+
+    El::Initialize(argc, argv);
+
+    int m = argc > 1 ? std::atoi(argv[1]) : 1024;
+    int n = argc > 2 ? std::atoi(argv[2]) : 4096;
+    int reps = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    dct_t dct(m);
+
+    El::Matrix<double> A, B, AT, BT;
+    El::Uniform(A, m, n);
+    B = A;
+    El::Transpose(A, AT);
+    BT = AT;
+
+    double t_col_old = time_it(per_column_dct, A, reps);
+    double t_col_new = time_it([&](El::Matrix<double>& X) {
+            dct.apply(X, skys::columnwise_tag()); }, B, reps);
+    double t_row_old = time_it(per_column_dct_rowwise, AT, reps);
+    double t_row_new = time_it([&](El::Matrix<double>& X) {
+            dct.apply(X, skys::rowwise_tag()); }, BT, reps);
+
+    // Both paths applied the same (unscaled) transform equally often.
+    double scale = std::max(El::MaxNorm(A), El::MaxNorm(AT));
+    El::Axpy(-1.0, A, B);
+    El::Axpy(-1.0, AT, BT);
+    double err = std::max(El::MaxNorm(B), El::MaxNorm(BT)) / scale;
+
+    std::cout << boost::format("DCT of length %d, %d vectors, %d repetitions\n")
+        % m % n % reps;
+    std::cout << boost::format("columnwise: per-column %.4f sec, "
+        "batched %.4f sec (%.2fx)\n")
+        % t_col_old % t_col_new % (t_col_old / t_col_new);
+    std::cout << boost::format("rowwise:    transposed %.4f sec, "
+        "batched %.4f sec (%.2fx)\n")
+        % t_row_old % t_row_new % (t_row_old / t_row_new);
+    std::cout << boost::format("max relative difference: %.2e\n") % err;
+
+    El::Finalize();
+    return 0;
+}
+
+#else
+
+int main(int argc, char* argv[]) {
+    std::cout << "FFTW is required for this benchmark." << std::endl;
+    return 0;
+}
+
+#endif
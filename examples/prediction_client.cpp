@@ -0,0 +1,119 @@
+/**
+ * A stand-in client for the prediction server of skylark_ml
+ * (skylark_ml --modelfile model --serve socket-path).
+ *
+ * Usage: prediction_client socket-path libsvm-file [clients] [repetitions]
+ *
+ * Every client connects to the server, and sends the lines of the file one
+ * at a time, waiting for the answer to each before sending the next. The
+ * answers of the first client are written to stdout; the latencies seen by
+ * all the clients are reported at the end.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <El.hpp>
+#include <boost/mpi.hpp>
+#include <boost/format.hpp>
+#include <skylark.hpp>
+
+namespace skyml = skylark::ml;
+
+typedef std::chrono::steady_clock clock_type;
+
+/** Sends the requests in order; returns false if the server went away. */
+bool run_client(const char *path, const std::vector<std::string>& requests,
+    int reps, bool echo, skyml::latency_histogram_t& latencies) {
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    FILE *stream = fdopen(fd, "r+");
+    std::vector<char> answer(1 << 16);
+    for(int r = 0; r < reps; r++)
+        for(size_t i = 0; i < requests.size(); i++) {
+            clock_type::time_point start = clock_type::now();
+            std::fprintf(stream, "%s\n", requests[i].c_str());
+            std::fflush(stream);
+            if (std::fgets(answer.data(), answer.size(), stream) == NULL) {
+                std::fclose(stream);
+                return false;
+            }
+            latencies.add(std::chrono::duration<double>(
+                    clock_type::now() - start).count());
+            if (echo && r == 0)
+                std::cout << answer.data();
+        }
+
+    std::fclose(stream);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " socket-path libsvm-file [clients] [repetitions]"
+                  << std::endl;
+        return -1;
+    }
+
+    const char *path = argv[1];
+    int clients = argc > 3 ? std::atoi(argv[3]) : 1;
+    int reps = argc > 4 ? std::atoi(argv[4]) : 1;
+
+    std::vector<std::string> requests;
+    std::ifstream in(argv[2]);
+    std::string line;
+    while (std::getline(in, line))
+        if (!line.empty() && line[0] != '#')
+            requests.push_back(line);
+
+    std::vector<skyml::latency_histogram_t> latencies(clients);
+    std::vector<int> ok(clients, 0);
+    std::vector<std::thread> threads;
+
+    clock_type::time_point start = clock_type::now();
+    for(int c = 0; c < clients; c++)
+        threads.push_back(std::thread([&, c] () {
+                    ok[c] = run_client(path, requests, reps, c == 0,
+                        latencies[c]);
+                }));
+    for(int c = 0; c < clients; c++)
+        threads[c].join();
+    double elapsed =
+        std::chrono::duration<double>(clock_type::now() - start).count();
+
+    skyml::latency_histogram_t all;
+    for(int c = 0; c < clients; c++) {
+        if (!ok[c])
+            std::cerr << "Client " << c << " failed." << std::endl;
+        all.add(latencies[c]);
+    }
+
+    std::cerr << boost::format("%d clients, %.1f requests/sec\n")
+        % clients % (all.count() / elapsed);
+    all.print(std::cerr);
+
+    return 0;
+}
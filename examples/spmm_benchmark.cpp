@@ -0,0 +1,107 @@
+/**
+ * Micro-benchmark for the local sparse-dense Gemm kernels.
+ *
+ * Usage: spmm_benchmark [n] [k] [repetitions]
+ *
+ * S is a random n x n sparse matrix, the dense operands have k free rows
+ * (dense x sparse) or columns (sparse x dense); without k, the benchmark
+ * runs for k = 1, ..., 8 and k = 256. Reports GFLOP/s
+ * (2 * nnz * k flops per product) for all orientations versus the number of
+ * nonzeros per row of S.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include <El.hpp>
+#include <boost/mpi.hpp>
+#include <boost/format.hpp>
+#include <boost/random.hpp>
+#include <skylark.hpp>
+
+namespace skyb = skylark::base;
+
+typedef El::Matrix<double> dense_t;
+typedef skyb::sparse_matrix_t<double> sparse_t;
+
+template<typename F>
+double gflops(F f, double flops, int reps) {
+    f();    // warm up
+    boost::mpi::timer timer;
+    for(int r = 0; r < reps; r++)
+        f();
+    return flops * reps / timer.elapsed() / 1e9;
+}
+
+/** One table: all orientations versus the nonzeros per row of S. */
+void benchmark(int n, int k, int reps) {
+
+    const El::Orientation o[] = { El::NORMAL, El::TRANSPOSE };
+    const char *names[] = { "NN", "NT", "TN", "TT" };
+
+    boost::random::mt19937 gen(38734);
+    boost::random::uniform_int_distribution<int> index(0, n - 1);
+
+    std::cout << boost::format("n = %d, k = %d, GFLOP/s\n") % n % k;
+    std::cout << boost::format("%8s") % "nnz/row";
+    for(int c = 0; c < 4; c++)
+        std::cout << boost::format(" %10s") % (std::string("DxS ") + names[c]);
+    for(int c = 0; c < 4; c++)
+        std::cout << boost::format(" %10s") % (std::string("SxD ") + names[c]);
+    std::cout << std::endl;
+
+    for(int d = 1; d <= 64; d *= 2) {
+        sparse_t::coords_t coords;
+        for(int i = 0; i < n; i++)
+            for(int l = 0; l < d; l++)
+                coords.push_back(std::make_tuple(i, index(gen), 1.0));
+        sparse_t S;
+        S.set(coords, n, n);
+
+        double flops = 2.0 * S.nonzeros() * k;
+
+        std::cout << boost::format("%8d") % d;
+
+        // Dense x sparse: C = op(A) op(S), C is k x n.
+        for(int c = 0; c < 4; c++) {
+            El::Orientation oA = o[c / 2], oB = o[c % 2];
+            dense_t A, C;
+            El::Uniform(A, oA == El::NORMAL ? k : n, oA == El::NORMAL ? n : k);
+            El::Zeros(C, k, n);
+            double r = gflops([&]() {
+                    skyb::Gemm(oA, oB, 1.0, A, S, 0.0, C); }, flops, reps);
+            std::cout << boost::format(" %10.3f") % r;
+        }
+
+        // Sparse x dense: C = op(S) op(B), C is n x k.
+        for(int c = 0; c < 4; c++) {
+            El::Orientation oA = o[c / 2], oB = o[c % 2];
+            dense_t B, C;
+            El::Uniform(B, oB == El::NORMAL ? n : k, oB == El::NORMAL ? k : n);
+            El::Zeros(C, n, k);
+            double r = gflops([&]() {
+                    skyb::Gemm(oA, oB, 1.0, S, B, 0.0, C); }, flops, reps);
+            std::cout << boost::format(" %10.3f") % r;
+        }
+
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    El::Initialize(argc, argv);
+
+    int n = argc > 1 ? std::atoi(argv[1]) : 100000;
+    std::vector<int> ks = { 1, 2, 3, 4, 5, 6, 7, 8, 256 };
+    if (argc > 2)
+        ks.assign(1, std::atoi(argv[2]));
+    int reps = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    for(int k : ks)
+        benchmark(n, k, reps);
+
+    El::Finalize();
+    return 0;
+}
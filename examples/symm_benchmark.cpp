@@ -0,0 +1,122 @@
+/**
+ * Micro-benchmark for the local sparse Symm (C = A B, A symmetric sparse,
+ * given by its lower triangle) as used by CG with k right-hand sides.
+ *
+ * Usage: symm_benchmark [n] [nnz per column] [repetitions]
+ *
+ * Compares the single-pass engine of base::Symm with the previous kernel,
+ * which traverses A once per right-hand side. Both are reported as
+ * effective bandwidth: the minimal traffic (A once, B read, C written)
+ * divided by the time, so that the numbers compare to the STREAM bandwidth
+ * of the machine, whatever k is.
+ */
+
+#include <iostream>
+#include <cstdlib>
+
+#include <El.hpp>
+#include <boost/mpi.hpp>
+#include <boost/format.hpp>
+#include <boost/random.hpp>
+#include <skylark.hpp>
+
+namespace skyb = skylark::base;
+
+typedef El::Matrix<double> dense_t;
+typedef skyb::sparse_matrix_t<double> sparse_t;
+
+/** The previous kernel: parallel over columns of B, A traversed for each. */
+void per_column_symm(El::UpperOrLower uplo, double alpha, const sparse_t& A,
+    const dense_t& B, double beta, dense_t& C) {
+
+    const int* indptr = A.indptr();
+    const int* indices = A.indices();
+    const double *values = A.locked_values();
+
+    int k = A.width();
+    int n = B.Width();
+
+    El::Scale(beta, C);
+
+    double *c = C.Buffer();
+    int ldc = C.LDim();
+    const double *b = B.LockedBuffer();
+    int ldb = B.LDim();
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for
+#   endif
+    for (int i = 0; i < n; i++)
+        for (int col = 0; col < k; col++)
+            for (int j = indptr[col]; j < indptr[col + 1]; j++) {
+                int row = indices[j];
+
+                if ((uplo == El::UPPER && row > col) ||
+                    (uplo == El::LOWER && row < col))
+                    continue;
+
+                double val = values[j];
+                c[i * ldc + row] += alpha * val * b[i * ldb + col];
+                if (row != col)
+                    c[i * ldc + col] += alpha * val * b[i * ldb + row];
+            }
+}
+
+template<typename F>
+double seconds(F f, int reps) {
+    f();    // warm up
+    boost::mpi::timer timer;
+    for(int r = 0; r < reps; r++)
+        f();
+    return timer.elapsed() / reps;
+}
+
+int main(int argc, char* argv[]) {
+
+    El::Initialize(argc, argv);
+
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int d = argc > 2 ? std::atoi(argv[2]) : 16;
+    int reps = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    boost::random::mt19937 gen(38734);
+    boost::random::uniform_int_distribution<int> index(0, n - 1);
+
+    // Lower triangle: the diagonal, and d - 1 random entries per column.
+    sparse_t::coords_t coords;
+    for(int c = 0; c < n; c++) {
+        coords.push_back(std::make_tuple(c, c, double(d)));
+        for(int l = 1; l < d; l++) {
+            int r = index(gen);
+            coords.push_back(std::make_tuple(std::max(r, c), std::min(r, c),
+                    -0.5));
+        }
+    }
+    sparse_t A;
+    A.set(coords, n, n);
+
+    std::cout << boost::format("n = %d, nnz = %d, effective GB/s\n")
+        % n % A.nonzeros();
+    std::cout << boost::format("%6s %12s %12s %10s\n")
+        % "k" % "per-column" % "single-pass" % "speedup";
+
+    for(int k = 1; k <= 32; k *= 2) {
+        dense_t B, C;
+        El::Uniform(B, n, k);
+        El::Zeros(C, n, k);
+
+        double bytes = A.nonzeros() * (sizeof(double) + sizeof(int)) +
+            (n + 1) * sizeof(int) + 2.0 * n * k * sizeof(double);
+
+        double t0 = seconds([&]() {
+                per_column_symm(El::LOWER, 1.0, A, B, 0.0, C); }, reps);
+        double t1 = seconds([&]() {
+                skyb::Symm(El::LEFT, El::LOWER, 1.0, A, B, 0.0, C); }, reps);
+
+        std::cout << boost::format("%6d %12.3f %12.3f %10.2f\n")
+            % k % (bytes / t0 / 1e9) % (bytes / t1 / 1e9) % (t0 / t1);
+    }
+
+    El::Finalize();
+    return 0;
+}
@@ -3,7 +3,14 @@
 
 #include <El.hpp>
 #include <skylark.hpp>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
 #include <boost/mpi.hpp>
 
 #ifdef SKYLARK_HAVE_OPENMP
@@ -11,6 +18,8 @@
 #endif
 
 #include "../utility/timer.hpp"
+#include "block_factor.hpp"
+#include "transform_cache.hpp"
 
 template <class InputType>
 struct BlockADMMSolver {
@@ -68,10 +77,39 @@ struct BlockADMMSolver {
     void set_tol(double TOL) { this->TOL = TOL; }
     void set_cache_transform(bool CacheTransforms) {this->CacheTransforms = CacheTransforms;}
 
+    /**
+     * How the feature matrices are cached (with set_cache_transform): in
+     * which precision, how many bytes of memory (per process, 0 for no
+     * limit) they may take, and a directory for the partitions that do not
+     * fit (the others are recomputed in every iteration if it is empty).
+     */
+    void set_cache_precision(
+        skylark::ml::transform_cache_precision_t CachePrecision) {
+        this->CachePrecision = CachePrecision;
+    }
+    void set_cache_budget(size_t CacheBudget) {
+        this->CacheBudget = CacheBudget;
+    }
+    void set_cache_scratch(const std::string& CacheScratch) {
+        this->CacheScratch = CacheScratch;
+    }
+
+    /**
+     * Keep the factorizations of the first iteration in fname.<rank>: read
+     * them at the start of training if the file is there, and write them
+     * when they had to be computed, so a restarted training on the same data
+     * and feature maps skips that (most expensive) iteration.
+     */
+    void set_factorization_cache(const std::string& fname) {
+        this->FactorizationCacheFile = fname;
+    }
+
     ~BlockADMMSolver();
 
     void InitializeFactorizationCache();
     void InitializeTransformCache(int n);
+    bool LoadFactorizationCache(const std::string& fname);
+    void SaveFactorizationCache(const std::string& fname) const;
 
     skylark::ml::hilbert_model_t* train(data_matrix_t& X,
         target_matrix_t& Y, data_matrix_t& Xv, target_matrix_t& Yv,
@@ -84,6 +122,7 @@ struct BlockADMMSolver {
 private:
 
     typedef El::Matrix<value_type> local_matrix_t;
+    typedef skylark::ml::block_factor_t<value_type> factor_t;
 
     feature_transform_array_t featureMaps;
     int NumFeatures;
@@ -93,8 +132,9 @@ private:
     std::vector<int> starts, finishes;
     bool ScaleFeatureMaps;
     bool OwnFeatureMaps;
-    local_matrix_t **Cache;
-    local_matrix_t **TransformCache;
+    std::vector<factor_t> Cache;
+    std::unique_ptr<skylark::ml::transform_cache_t<value_type> >
+    TransformCache;
     int NumThreads;
 
     double lambda;
@@ -103,28 +143,72 @@ private:
     double TOL;
 
     bool CacheTransforms;
+    skylark::ml::transform_cache_precision_t CachePrecision;
+    size_t CacheBudget;
+    std::string CacheScratch;
+    std::string FactorizationCacheFile;
 };
 
 template <class InputType>
 void BlockADMMSolver<InputType>::InitializeFactorizationCache() {
-    Cache = new local_matrix_t*[NumFeaturePartitions];
-    for(int j=0; j<NumFeaturePartitions; j++) {
-        int start = starts[j];
-        int finish = finishes[j];
-        int sj = finish - start  + 1;
-        Cache[j]  = new local_matrix_t(sj, sj);
-    }
+    // Factors are computed (or read) in the first iteration.
+    Cache.assign(NumFeaturePartitions, factor_t());
 }
 
 template <class InputType>
 void BlockADMMSolver<InputType>::InitializeTransformCache(int n) {
-    TransformCache = new local_matrix_t*[NumFeaturePartitions];
-    for(int j=0; j<NumFeaturePartitions; j++) {
-        int start = starts[j];
-        int finish = finishes[j];
-        int sj = finish - start  + 1;
-        TransformCache[j]  = new local_matrix_t(sj, n);
-    }
+    std::vector<El::Int> heights(NumFeaturePartitions);
+    for(int j=0; j<NumFeaturePartitions; j++)
+        heights[j] = finishes[j] - starts[j] + 1;
+    TransformCache.reset(new skylark::ml::transform_cache_t<value_type>(
+            heights, n, CachePrecision, CacheBudget, CacheScratch));
+}
+
+template <class InputType>
+bool BlockADMMSolver<InputType>::LoadFactorizationCache(
+    const std::string& fname) {
+
+    std::ifstream is(fname.c_str(), std::ios::binary);
+    if (!is)
+        return false;
+
+    namespace detail = skylark::ml::detail;
+    char magic[sizeof(detail::block_factor_magic)];
+    int32_t header[3];
+    is.read(magic, sizeof(magic));
+    is.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!is ||
+        std::memcmp(magic, detail::block_factor_magic, sizeof(magic)) ||
+        header[0] != detail::block_factor_version ||
+        header[1] != int32_t(sizeof(value_type)) ||
+        header[2] != NumFeaturePartitions)
+        return false;
+
+    for(int j = 0; j < NumFeaturePartitions; j++)
+        if (!Cache[j].load(is)) {
+            InitializeFactorizationCache();
+            return false;
+        }
+    return true;
+}
+
+template <class InputType>
+void BlockADMMSolver<InputType>::SaveFactorizationCache(
+    const std::string& fname) const {
+
+    namespace detail = skylark::ml::detail;
+    std::ofstream os(fname.c_str(), std::ios::binary | std::ios::trunc);
+    int32_t header[3] = { detail::block_factor_version,
+                          int32_t(sizeof(value_type)), NumFeaturePartitions };
+    os.write(detail::block_factor_magic, sizeof(detail::block_factor_magic));
+    os.write(reinterpret_cast<const char *>(header), sizeof(header));
+    for(int j = 0; j < NumFeaturePartitions; j++)
+        Cache[j].save(os);
+
+    if (!os)
+        SKYLARK_THROW_EXCEPTION(skylark::base::io_exception() <<
+            skylark::base::error_msg("Could not write the factorization "
+                "cache " + fname));
 }
 
 
@@ -155,6 +239,8 @@ BlockADMMSolver<InputType>::BlockADMMSolver(
     OwnFeatureMaps = false;
     InitializeFactorizationCache();
     CacheTransforms = false;
+    CachePrecision = skylark::ml::CACHE_NATIVE;
+    CacheBudget = 0;
 }
 
 // Easy interface, aka kernel based.
@@ -190,6 +276,8 @@ BlockADMMSolver<InputType>::BlockADMMSolver(skylark::base::context_t& context,
     OwnFeatureMaps = true;
     InitializeFactorizationCache();
     CacheTransforms = false;
+    CachePrecision = skylark::ml::CACHE_NATIVE;
+    CacheBudget = 0;
 }
 
 // Easy interface, aka kernel based, with quasi-random features.
@@ -229,6 +317,8 @@ BlockADMMSolver<InputType>::BlockADMMSolver(skylark::base::context_t& context,
     OwnFeatureMaps = true;
     InitializeFactorizationCache();
     CacheTransforms = false;
+    CachePrecision = skylark::ml::CACHE_NATIVE;
+    CacheBudget = 0;
 }
 
 // Guru interface
@@ -256,16 +346,15 @@ BlockADMMSolver<InputType>::BlockADMMSolver(
     OwnFeatureMaps = false;
     InitializeFactorizationCache();
     CacheTransforms = false;
+    CachePrecision = skylark::ml::CACHE_NATIVE;
+    CacheBudget = 0;
 }
 
 template <class InputType>
 BlockADMMSolver<InputType>::~BlockADMMSolver() {
-    for(int i=0; i  < NumFeaturePartitions; i++) {
-        delete Cache[i];
-        if (OwnFeatureMaps)
+    if (OwnFeatureMaps)
+        for(int i=0; i  < NumFeaturePartitions; i++)
             delete featureMaps[i];
-    }
-    delete[] Cache;
 }
 
 
@@ -354,6 +443,13 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
     if (CacheTransforms)
         InitializeTransformCache(ni);
 
+    std::string factorfile;
+    if (!FactorizationCacheFile.empty()) {
+        factorfile = FactorizationCacheFile + "." + std::to_string(rank);
+        LoadFactorizationCache(factorfile);
+    }
+    int factored = 0;
+
     SKYLARK_TIMER_INITIALIZE(ITERATIONS_PROFILE);
     SKYLARK_TIMER_INITIALIZE(COMMUNICATION_PROFILE);
     SKYLARK_TIMER_INITIALIZE(TRANSFORM_PROFILE);
@@ -397,7 +493,7 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
         SKYLARK_TIMER_RESTART(TRANSFORM_PROFILE);
 
 #       ifdef SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for if(NumThreads > 1) private(j, start, finish, sj, featureMap) num_threads(NumThreads)
+#       pragma omp parallel for if(NumThreads > 1) private(j, start, finish, sj, featureMap) reduction(+:factored) num_threads(NumThreads)
 #       endif
         for(j = 0; j < NumFeaturePartitions; j++) {
             start = starts[j];
@@ -407,8 +503,8 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
             local_matrix_t Z;
 
             // Get the Z matrix
-            if (CacheTransforms && (iter > 1))
-                El::View(Z, *TransformCache[j], 0, 0, sj, ni);
+            if (CacheTransforms && (iter > 1) && TransformCache->cached(j))
+                TransformCache->load(j, Z);
             else {
                 if (featureMaps.size() > 0) {
                     featureMap = featureMaps[j];
@@ -430,14 +526,19 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
 
             if(iter==1) {
 
-                local_matrix_t Ones;
-                El::Ones(Ones, sj, 1);
-                El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, Z, Z, 0.0, *Cache[j]);
-                El::UpdateDiagonal(*Cache[j], 1.0, Ones);
-                El::Inverse(*Cache[j]);
-
-                if (CacheTransforms)
-                    *TransformCache[j] = Z;
+                // From now on Z is used as cached (possibly rounded), also
+                // for the factors, so all iterations solve the same problem.
+                if (CacheTransforms && TransformCache->cached(j)) {
+                    TransformCache->store(j, Z);
+                    TransformCache->load(j, Z);
+                }
+
+                // Factors read from the cache (or of a previous training)
+                // are reused if they are for the same Z.
+                if (!Cache[j].matches(Z)) {
+                    Cache[j].factor(Z);
+                    factored++;
+                }
             }
 
             El::View(tmp, Wbar, start, 0, sj, k); //tmp = Wbar[J,:]
@@ -468,8 +569,9 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
                 1.0/(NumFeaturePartitions + 1.0), Z, dsum, 1.0, rhs); // rhs = rhs + z'*(1/(n+1) * del_o + nu)
             SKYLARK_TIMER_ACCUMULATE(ZMULT_PROFILE);
 
+            Cache[j].apply(Z, rhs); // rhs = (I + Z*Z')^{-1} * rhs
             El::View(tmp, Wi, start, 0, sj, k);
-            El::Gemm(El::NORMAL, El::NORMAL, 1.0, *Cache[j], rhs, 0.0, tmp); // ]tmp = Wi[J,:] = Cache[j]*rhs
+            El::Copy(rhs, tmp); // tmp = Wi[J,:] = rhs
 
             SKYLARK_TIMER_RESTART(ZMULT_PROFILE);
             El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, tmp, Z, 0.0, o); // o = (z*tmp)' = (z*Wi[J,:])'
@@ -498,6 +600,9 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
 
         SKYLARK_TIMER_ACCUMULATE(TRANSFORM_PROFILE);
 
+        if (iter == 1 && factored > 0 && !factorfile.empty())
+            SaveFactorizationCache(factorfile);
+
         localloss = 0.0 ;
         //  El::Zeros(o, ni, k);
         local_matrix_t o(k, ni);
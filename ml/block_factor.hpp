@@ -0,0 +1,162 @@
+#ifndef SKYLARK_ML_BLOCK_FACTOR_HPP
+#define SKYLARK_ML_BLOCK_FACTOR_HPP
+
+#include <El.hpp>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+namespace skylark { namespace ml {
+
+/**
+ * Factorization of I + Z Z', the system solved for a feature partition in
+ * every iteration of BlockADMMSolver (Z is the sj x ni feature matrix of the
+ * partition).
+ *
+ * If sj <= ni, L is the Cholesky factor of I + Z Z' (sj x sj). Otherwise the
+ * Woodbury identity
+ *
+ *      (I + Z Z')^{-1} = I - Z (I + Z' Z)^{-1} Z'
+ *
+ * reduces the system to the smaller one, and L is the Cholesky factor of
+ * I + Z' Z (ni x ni).
+ *
+ * The dimensions and a hash of the entries of Z (which depends on their
+ * positions, so it changes if examples are reordered) are kept with the
+ * factor, so a factor read from disk is only used for the same Z.
+ */
+template<typename T>
+struct block_factor_t {
+
+    typedef T value_type;
+    typedef El::Matrix<T> matrix_type;
+
+    block_factor_t() : woodbury(false), height(0), width(0), hash(0) {
+
+    }
+
+    bool empty() const { return L.Height() == 0; }
+
+    /** Whether the factor is in the Woodbury form. */
+    bool is_woodbury() const { return woodbury; }
+
+    /** Factors I + Z Z'. */
+    void factor(const matrix_type &Z) {
+        height = Z.Height();
+        width = Z.Width();
+        hash = fingerprint(Z);
+
+        woodbury = width < height;
+        El::Herk(El::LOWER, woodbury ? El::ADJOINT : El::NORMAL,
+            value_type(1.0), Z, L);
+        El::ShiftDiagonal(L, value_type(1.0));
+        El::Cholesky(El::LOWER, L);
+    }
+
+    /** Whether this is the factor of I + Z Z'. */
+    bool matches(const matrix_type &Z) const {
+        return !empty() && Z.Height() == height && Z.Width() == width &&
+            fingerprint(Z) == hash;
+    }
+
+    /** B := (I + Z Z')^{-1} B */
+    void apply(const matrix_type &Z, matrix_type &B) const {
+        if (woodbury) {
+            matrix_type t;
+            El::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), Z, B, t);
+            solve(t);
+            El::Gemm(El::NORMAL, El::NORMAL, value_type(-1.0), Z, t,
+                value_type(1.0), B);
+        } else
+            solve(B);
+    }
+
+    /**
+     * Binary format: form, dimensions and hash of Z, and the lower triangle
+     * of L column by column.
+     */
+    void save(std::ostream &os) const {
+        int64_t header[3] = { woodbury, height, width };
+        os.write(reinterpret_cast<const char *>(header), sizeof(header));
+        os.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+
+        const El::Int n = L.Height();
+        for(El::Int j = 0; j < n; j++)
+            os.write(reinterpret_cast<const char *>(L.LockedBuffer(j, j)),
+                (n - j) * sizeof(value_type));
+    }
+
+    bool load(std::istream &is) {
+        int64_t header[3];
+        is.read(reinterpret_cast<char *>(header), sizeof(header));
+        is.read(reinterpret_cast<char *>(&hash), sizeof(hash));
+        if (!is || header[1] <= 0 || header[2] <= 0)
+            return false;
+
+        woodbury = header[0] != 0;
+        height = header[1];
+        width = header[2];
+
+        const El::Int n = woodbury ? width : height;
+        El::Zeros(L, n, n);
+        for(El::Int j = 0; j < n; j++)
+            is.read(reinterpret_cast<char *>(L.Buffer(j, j)),
+                (n - j) * sizeof(value_type));
+        if (!is) {
+            L.Empty();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    matrix_type L;
+    bool woodbury;
+    El::Int height, width;
+    uint64_t hash;
+
+    void solve(matrix_type &B) const {
+        El::Trsm(El::LEFT, El::LOWER, El::NORMAL, El::NON_UNIT,
+            value_type(1.0), L, B);
+        El::Trsm(El::LEFT, El::LOWER, El::ADJOINT, El::NON_UNIT,
+            value_type(1.0), L, B);
+    }
+
+    /**
+     * FNV-1a over the entries of Z, column-major, one word per entry (with
+     * its upper half folded into the lower one, so that all bits of the
+     * entry reach all bits of the hash).
+     */
+    static uint64_t fingerprint(const matrix_type &Z) {
+        static_assert(sizeof(value_type) <= sizeof(uint64_t),
+            "Entries are hashed as single words");
+
+        uint64_t h = 0xcbf29ce484222325ull;
+        for(El::Int j = 0; j < Z.Width(); j++) {
+            const value_type *z = Z.LockedBuffer(0, j);
+            for(El::Int i = 0; i < Z.Height(); i++) {
+                uint64_t w = 0;
+                std::memcpy(&w, z + i, sizeof(value_type));
+                h = (h ^ w ^ (w >> 32)) * 0x100000001b3ull;
+            }
+        }
+        return h;
+    }
+};
+
+namespace detail {
+
+/**
+ * Header of a factorization cache file (one file per rank): magic, format
+ * version, size of the values, and number of feature partitions.
+ */
+static const char block_factor_magic[8] = { 's', 'k', 'y', 'a', 'd', 'm',
+                                            'm', 'f' };
+static const int32_t block_factor_version = 2;
+
+} // namespace detail
+
+} } // namespace skylark::ml
+
+#endif // SKYLARK_ML_BLOCK_FACTOR_HPP
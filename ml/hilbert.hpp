@@ -214,6 +214,12 @@ BlockADMMSolver<InputType>* GetSolver(skylark::base::context_t& context,
     Solver->set_tol(options.tolerance);
     Solver->set_nthreads(options.numthreads);
     Solver->set_cache_transform(options.cachetransforms);
+    Solver->set_cache_precision(
+        static_cast<skylark::ml::transform_cache_precision_t>(
+            options.cacheprecision));
+    Solver->set_cache_budget(size_t(options.cachememory * 1024 * 1024));
+    Solver->set_cache_scratch(options.cachescratch);
+    Solver->set_factorization_cache(options.factorcache);
 
     return Solver;
 }
@@ -271,7 +277,9 @@ void LargeScaleKernelLearning(const boost::mpi::communicator& comm,
 
     // TODO should be done "outside"
     if (comm.rank() == 0)
-        model->save(options.modelfile, options.print());
+        model->save(options.modelfile, options.print(),
+            options.binarymodel ? skylark::ml::MODEL_FORMAT_BINARY :
+            skylark::ml::MODEL_FORMAT_TEXT);
 }
 
 } }
@@ -1,6 +1,9 @@
 #ifndef SKYLARK_KERNELS_HPP
 #define SKYLARK_KERNELS_HPP
 
+#include <boost/math/special_functions/bessel.hpp>
+#include <boost/math/special_functions/gamma.hpp>
+
 #include "../sketch/sketch.hpp"
 #include "feature_transform_tags.hpp"
 
@@ -394,13 +397,11 @@ struct gaussian_t : public kernel_t {
         El::Int m = dirX == base::COLUMNS ? base::Width(X) : base::Height(X);
         El::Int n = dirY == base::COLUMNS ? base::Width(Y) : base::Height(Y);
 
+        const value_type s = 1.0 / (2 * _sigma * _sigma);
+
         K.Resize(m, n);
-        base::EuclideanDistanceMatrix(dirX, dirY, value_type(1.0), X, Y,
-            value_type(0.0), K);
-        El::EntrywiseMap(K, std::function<value_type(value_type)> (
-            [this] (value_type x) {
-                return std::exp(-x / (2 * _sigma * _sigma));
-            }));
+        base::EuclideanGram(dirX, dirY, X, Y, K,
+            [s] (value_type x) { return std::exp(-s * x); });
     }
 
     template<typename XT, typename KT>
@@ -411,13 +412,11 @@ struct gaussian_t : public kernel_t {
 
         El::Int n = dir == base::COLUMNS ? base::Width(X) : base::Height(X);
 
+        const value_type s = 1.0 / (2 * _sigma * _sigma);
+
         K.Resize(n, n);
-        base::SymmetricEuclideanDistanceMatrix(uplo, dir, value_type(1.0), X,
-            value_type(0.0), K);
-        base::SymmetricEntrywiseMap(uplo, K, std::function<value_type(value_type)> (
-              [this] (value_type x) {
-                  return std::exp(-x / (2 * _sigma * _sigma));
-              }));
+        base::SymmetricEuclideanGram(uplo, dir, X, K,
+            [s] (value_type x) { return std::exp(-s * x); });
     }
 
     /* Instantion of virtual functions in base */
@@ -559,16 +558,12 @@ struct polynomial_t : public kernel_t {
         El::Int m = dirX == base::COLUMNS ? base::Width(X) : base::Height(X);
         El::Int n = dirY == base::COLUMNS ? base::Width(Y) : base::Height(Y);
 
-        El::Orientation xo = dirX == base::COLUMNS ? El::ADJOINT : El::NORMAL;
-        El::Orientation yo = dirY == base::COLUMNS ? El::NORMAL : El::ADJOINT;
+        const value_type gamma = _gamma, c = _c;
+        const int q = _q;
 
         K.Resize(m, n);
-        // TODO should be base::Gemm, not El::Gemm
-        El::Gemm(xo, yo, value_type(1.0), X, Y, value_type(0.0), K);
-        El::EntrywiseMap(K, std::function<value_type(value_type)> (
-            [this] (value_type x) {
-                return std::pow(_gamma * x + _c, _q);
-            }));
+        base::InnerProductGram(dirX, dirY, X, Y, K,
+            [gamma, c, q] (value_type x) { return std::pow(gamma * x + c, q); });
     }
 
     template<typename XT, typename KT>
@@ -578,16 +573,13 @@ struct polynomial_t : public kernel_t {
         typedef typename utility::typer_t<KT>::value_type value_type;
 
         El::Int n = dir == base::COLUMNS ? base::Width(X) : base::Height(X);
-        El::Orientation o = dir == base::COLUMNS ? El::ADJOINT : El::NORMAL;
+
+        const value_type gamma = _gamma, c = _c;
+        const int q = _q;
 
         K.Resize(n, n);
-        // TODO should be base::Herk, not El::Herk
-        El::Herk(uplo, o, value_type(1.0), X, K);
-        // TODO maybe need to use Gemm version.
-        base::SymmetricEntrywiseMap(uplo, K, std::function<value_type(value_type)> (
-              [this] (value_type x) {
-                  return std::pow(_gamma * x + _c, _q);
-              }));
+        base::SymmetricInnerProductGram(uplo, dir, X, K,
+            [gamma, c, q] (value_type x) { return std::pow(gamma * x + c, q); });
     }
 
 
@@ -742,13 +734,11 @@ struct laplacian_t : public kernel_t {
         El::Int m = dirX == base::COLUMNS ? base::Width(X) : base::Height(X);
         El::Int n = dirY == base::COLUMNS ? base::Width(Y) : base::Height(Y);
 
+        const value_type s = 1.0 / _sigma;
+
         K.Resize(m, n);
-        base::L1DistanceMatrix(dirX, dirY, value_type(1.0), X, Y,
-            value_type(0.0), K);
-        El::EntrywiseMap(K, std::function<value_type(value_type)> (
-            [this] (value_type x) {
-                return std::exp(-x / _sigma);
-            }));
+        base::L1Gram(dirX, dirY, X, Y, K,
+            [s] (value_type x) { return std::exp(-s * x); });
     }
 
     template<typename XT, typename KT>
@@ -759,13 +749,11 @@ struct laplacian_t : public kernel_t {
 
         El::Int n = dir == base::COLUMNS ? base::Width(X) : base::Height(X);
 
+        const value_type s = 1.0 / _sigma;
+
         K.Resize(n, n);
-        base::SymmetricL1DistanceMatrix(uplo, dir, value_type(1.0), X,
-            value_type(0.0), K);
-        base::SymmetricEntrywiseMap(uplo, K, std::function<value_type(value_type)> (
-              [this] (value_type x) {
-                  return std::exp(-x / _sigma);
-              }));
+        base::SymmetricL1Gram(uplo, dir, X, K,
+            [s] (value_type x) { return std::exp(-s * x); });
     }
 
     /* Instantion of virtual functions in base */
@@ -914,24 +902,25 @@ struct expsemigroup_t : public kernel_t {
         El::Int m = dirX == base::COLUMNS ? base::Width(X) : base::Height(X);
         El::Int n = dirY == base::COLUMNS ? base::Width(Y) : base::Height(Y);
 
+        const value_type beta = _beta;
+
         K.Resize(m, n);
-        base::ExpsemigroupDistanceMatrix(dirX, dirY, value_type(1.0), X, Y,
-            value_type(0.0), K);
-        El::EntrywiseMap(K, std::function<value_type(value_type)> (
-            [this] (value_type x) {
-                return std::exp(-_beta * x);
-            }));
+        base::ExpsemigroupGram(dirX, dirY, X, Y, K,
+            [beta] (value_type x) { return std::exp(-beta * x); });
     }
 
     template<typename XT, typename KT>
     void symmetric_gram(El::UpperOrLower uplo, base::direction_t dir,
         const XT &X, KT &K) const {
 
-        // TODO: Implement the kernel for symmetric matrices
-        SKYLARK_THROW_EXCEPTION (
-        base::ml_exception()
-          << base::error_msg(
-           "symmetric_gram has not yet been implemented for expsemigroup kernel"));
+        typedef typename utility::typer_t<KT>::value_type value_type;
+
+        El::Int n = dir == base::COLUMNS ? base::Width(X) : base::Height(X);
+        const value_type beta = _beta;
+
+        K.Resize(n, n);
+        base::SymmetricExpsemigroupGram(uplo, dir, X, K,
+            [beta] (value_type x) { return std::exp(-beta * x); });
     }
 
     /* Instantion of virtual functions in base */
@@ -1064,26 +1053,62 @@ struct matern_t : kernel_t {
         return _N;
     }
 
+    /**
+     * k(r) = 2^(1 - nu) / Gamma(nu) (sqrt(2 nu) r / l)^nu K_nu(sqrt(2 nu) r / l)
+     * as a function of the squared distance r^2, with closed forms for
+     * nu = 1/2, 3/2 and 5/2.
+     */
+    template<typename T>
+    struct matern_function_t {
+
+        matern_function_t(double nu, double l) : _nu(nu),
+            _s(std::sqrt(2 * nu) / l),
+            _c(std::pow(2.0, 1 - nu) / boost::math::tgamma(nu)) {
+
+        }
+
+        T operator()(T r2) const {
+            double x = _s * std::sqrt(static_cast<double>(r2));
+            if (_nu == 0.5)
+                return std::exp(-x);
+            if (_nu == 1.5)
+                return (1 + x) * std::exp(-x);
+            if (_nu == 2.5)
+                return (1 + x + x * x / 3) * std::exp(-x);
+            if (x == 0)
+                return 1;
+            return _c * std::pow(x, _nu) * boost::math::cyl_bessel_k(_nu, x);
+        }
+
+    private:
+        const double _nu, _s, _c;
+    };
+
     template<typename XT, typename YT, typename KT>
     void gram(base::direction_t dirX, base::direction_t dirY,
         const XT &X, const YT &Y, KT &K) const {
 
-        // TODO: Implement the kernel
-        SKYLARK_THROW_EXCEPTION (
-        base::ml_exception()
-          << base::error_msg(
-           "gram has not yet been implemented for matern kernel"));
+        typedef typename utility::typer_t<KT>::value_type value_type;
+
+        El::Int m = dirX == base::COLUMNS ? base::Width(X) : base::Height(X);
+        El::Int n = dirY == base::COLUMNS ? base::Width(Y) : base::Height(Y);
+
+        K.Resize(m, n);
+        base::EuclideanGram(dirX, dirY, X, Y, K,
+            matern_function_t<value_type>(_nu, _l));
     }
 
     template<typename XT, typename KT>
     void symmetric_gram(El::UpperOrLower uplo, base::direction_t dir,
         const XT &X, KT &K) const {
 
-        // TODO: Implement the kernel for symmetric matrices
-        SKYLARK_THROW_EXCEPTION (
-        base::ml_exception()
-          << base::error_msg(
-           "symmetric_gram has not yet been implemented for matern kernel"));
+        typedef typename utility::typer_t<KT>::value_type value_type;
+
+        El::Int n = dir == base::COLUMNS ? base::Width(X) : base::Height(X);
+
+        K.Resize(n, n);
+        base::SymmetricEuclideanGram(uplo, dir, X, K,
+            matern_function_t<value_type>(_nu, _l));
     }
 
     /* Instantion of virtual functions in base */
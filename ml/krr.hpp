@@ -20,6 +20,10 @@ struct krr_params_t : public base::params_t {
     int res_print;
     double tolerance;
 
+    // For FasterKRR: do not form the kernel matrix, recompute it in every
+    // iteration instead.
+    bool matrix_free;
+
     // For memory limited methods (SketchedApproximateKRR, LargeScaleKRR)
     El::Int max_split;
 
@@ -40,6 +44,8 @@ struct krr_params_t : public base::params_t {
         res_print = 10;
         iter_lim = 1000;
 
+        matrix_free = false;
+
         max_split = 0;
   }
 
@@ -469,8 +475,8 @@ void FasterKernelRidge(base::direction_t direction, const KernelType &k,
 
     El::DistMatrix<T> K, D;
 
-    // Hack for experiments!
-    if (params.iter_lim == -1)
+    // Hack for experiments! (Nothing to form for the matrix-free solve.)
+    if (params.iter_lim == -1 || params.matrix_free)
         goto skip_kernel_creation;
 
     SymmetricGram(El::LOWER, direction, k, X, K);
@@ -526,7 +532,11 @@ void FasterKernelRidge(base::direction_t direction, const KernelType &k,
             params.log_stream, params.prefix + "\t");
 
         El::Zeros(A, X.Width(), Y.Width());
-        algorithms::CG(El::LOWER, K, Y, A, cg_params, *P);
+        if (params.matrix_free) {
+            base::kernel_matrix_t<T, KernelType> KM(direction, k, X, lambda);
+            algorithms::CG(El::LOWER, KM, Y, A, cg_params, *P);
+        } else
+            algorithms::CG(El::LOWER, K, Y, A, cg_params, *P);
     } else {
         // Hack for experiments!
         El::Zeros(A, X.Width(), Y.Width());
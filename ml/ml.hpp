@@ -12,6 +12,9 @@
 #include "krr.hpp"
 #include "rlsc.hpp"
 #include "model.hpp"
+#include "block_factor.hpp"
+#include "transform_cache.hpp"
+#include "prediction_server.hpp"
 
 // TODO add includes to hilbert
 
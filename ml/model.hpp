@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 #include "kernels.hpp"
+#include "model_io.hpp"
 #include "options.hpp"
 
 #ifdef SKYLARK_HAVE_OPENMP
@@ -79,20 +80,17 @@ struct hilbert_model_t {
     }
 
     hilbert_model_t(const boost::property_tree::ptree &pt) {
-        build_from_ptree(pt);
+        build_from_ptree(model_reader_t(pt));
     }
 
-    hilbert_model_t(const std::string& fname) {
-        std::ifstream is(fname);
-
-        // Skip all lines begining with "#"
-        while(is.peek() == '#')
-            is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-        boost::property_tree::ptree pt;
-        boost::property_tree::read_json(is, pt);
-        is.close();
-        build_from_ptree(pt);
+    /**
+     * Loads the model from a file of either format. For the binary format,
+     * map = true maps the file instead of reading the coefficients.
+     */
+    hilbert_model_t(const std::string& fname, bool map = false) {
+        model_reader_t reader(fname, map);
+        build_from_ptree(reader);
+        _mapping = reader.mapping();
     }
 
     ~hilbert_model_t() {
@@ -101,6 +99,11 @@ struct hilbert_model_t {
     }
 
     boost::property_tree::ptree to_ptree() const {
+        model_writer_t writer(MODEL_FORMAT_TEXT);
+        return to_ptree(writer);
+    }
+
+    boost::property_tree::ptree to_ptree(model_writer_t &writer) const {
         boost::property_tree::ptree pt;
         pt.put("skylark_object_type", "model:linear-on-features");
         pt.put("skylark_version", VERSION);
@@ -123,9 +126,7 @@ struct hilbert_model_t {
 
         pt.add_child("feature_mapping", ptfmap);
 
-        std::stringstream scoef;
-        El::Print(_coef, "", scoef);
-        pt.put("coef_matrix", scoef.str());
+        writer.put(pt, "coef_matrix", _coef);
 
         return pt;
     }
@@ -134,12 +135,11 @@ struct hilbert_model_t {
      * Saves the model to a file named fname. You may want to use this method
      * from only a single rank.
      */
-    void save(const std::string& fname, const std::string& header) const {
-        boost::property_tree::ptree pt = to_ptree();
-        std::ofstream of(fname);
-        of << header;
-        boost::property_tree::write_json(of, pt);
-        of.close();
+    void save(const std::string& fname, const std::string& header,
+        model_format_t format = MODEL_FORMAT_TEXT) const {
+        model_writer_t writer(format);
+        boost::property_tree::ptree pt = to_ptree(writer);
+        writer.write(fname, header, pt, MPI_COMM_SELF);
     }
 
     template<typename InputType, typename LabelType, typename DecisionType>
@@ -218,10 +218,10 @@ struct hilbert_model_t {
 
 protected:
 
-    void build_from_ptree(const boost::property_tree::ptree &pt) {
+    void build_from_ptree(const model_reader_t &reader) {
+        const boost::property_tree::ptree &pt = reader.get_ptree();
         int num_features = pt.get<int>("num_features");
         int num_outputs = pt.get<int>("num_outputs");
-        _coef.Resize(num_features, num_outputs);
 
         _input_size = pt.get<int>("input_size");
         _regression = pt.get<bool>("regression");
@@ -246,19 +246,7 @@ protected:
 
         _scale_maps = pt.get<bool>("feature_mapping.scale_maps");
 
-        std::istringstream coef_str(pt.get<std::string>("coef_matrix"));
-        double *buffer = _coef.Buffer();
-        int ldim = _coef.LDim();
-        for(int i = 0; i < num_features; i++) {
-            std::string line;
-            std::getline(coef_str, line);
-            std::istringstream coefstream(line);
-            for(int j = 0; j < num_outputs; j++) {
-                std::string token;
-                coefstream >> token;
-                buffer[i + j * ldim] = atof(token.c_str());
-            }
-        }
+        reader.get(pt, "coef_matrix", num_features, num_outputs, _coef);
     }
 
 private:
@@ -269,6 +257,8 @@ private:
     bool _regression;
 
     std::vector<int> _starts, _finishes;
+
+    std::shared_ptr<void> _mapping; // If _coef is a view of the model file.
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -291,8 +281,8 @@ struct model_t<OutType, ComputeType,
 
     virtual boost::property_tree::ptree to_ptree() const = 0;
 
-    virtual void save(const std::string& fname, const std::string& header)
-        const = 0;
+    virtual void save(const std::string& fname, const std::string& header,
+        model_format_t format = MODEL_FORMAT_TEXT) const = 0;
 
     virtual El::Int get_input_size() const = 0;
 
@@ -316,8 +306,8 @@ struct model_t<OutType, ComputeType,
 
     virtual boost::property_tree::ptree to_ptree() const = 0;
 
-    virtual void save(const std::string& fname, const std::string& header)
-        const = 0;
+    virtual void save(const std::string& fname, const std::string& header,
+        model_format_t format = MODEL_FORMAT_TEXT) const = 0;
 
     virtual El::Int get_input_size() const = 0;
 
@@ -366,7 +356,11 @@ public model_t<OutType, ComputeType>
     }
 
     kernel_model_t(const boost::property_tree::ptree &pt) {
-        build_from_ptree(pt);
+        build_from_ptree(model_reader_t(pt));
+    }
+
+    kernel_model_t(const model_reader_t &reader) {
+        build_from_ptree(reader);
     }
 
     void predict(base::direction_t direction_XT,
@@ -379,6 +373,11 @@ public model_t<OutType, ComputeType>
     }
 
     boost::property_tree::ptree to_ptree() const {
+        model_writer_t writer(MODEL_FORMAT_TEXT);
+        return to_ptree(writer);
+    }
+
+    boost::property_tree::ptree to_ptree(model_writer_t &writer) const {
         boost::property_tree::ptree pt;
 
         pt.put("skylark_object_type", "model:kernel");
@@ -395,19 +394,20 @@ public model_t<OutType, ComputeType>
 
         pt.add_child("kernel", _k.to_ptree());
 
-        std::stringstream sA;
-        El::Print(_A, "", sA);
-        pt.put("alpha", sA.str());
+        writer.put(pt, "alpha", _A);
 
         return pt;
     }
 
-    void save(const std::string& fname, const std::string& header) const {
-        boost::property_tree::ptree pt = to_ptree();
-        std::ofstream of(fname);
-        of << header;
-        boost::property_tree::write_json(of, pt);
-        of.close();
+    /**
+     * Saves the model to a file named fname. Collective over the grid of
+     * the model.
+     */
+    void save(const std::string& fname, const std::string& header,
+        model_format_t format = MODEL_FORMAT_TEXT) const {
+        model_writer_t writer(format);
+        boost::property_tree::ptree pt = to_ptree(writer);
+        writer.write(fname, header, pt, _A.Grid().VCComm().comm);
     }
 
     virtual ~kernel_model_t() {
@@ -419,7 +419,8 @@ public model_t<OutType, ComputeType>
     }
 
 protected:
-    void build_from_ptree(const boost::property_tree::ptree &pt) {
+    void build_from_ptree(const model_reader_t &reader) {
+        const boost::property_tree::ptree &pt = reader.get_ptree();
 
         _input_size = pt.get<El::Int>("input_size");
         _output_size = pt.get<El::Int>("num_outputs");
@@ -465,42 +466,7 @@ protected:
 
         _direction = base::COLUMNS;
 
-        std::istringstream A_str(pt.get<std::string>("alpha"));
-        if (_A.Grid().Size() == 1) {
-            _A.Resize(_X.Width(), _output_size);
-            compute_type *buffer = _A.Buffer();
-            int ldim = _A.LDim();
-            for(int i = 0; i < _X.Width(); i++) {
-                std::string line;
-                std::getline(A_str, line);
-                std::istringstream Astream(line);
-                for(int j = 0; j < _output_size; j++) {
-                    std::string token;
-                    Astream >> token;
-                    buffer[i + j * ldim] = atof(token.c_str());
-                }
-            }
-        } else {
-            // TODO: can do more memory efficient
-            El::DistMatrix<compute_type, El::CIRC, El::CIRC> A0(_X.Width(),
-                _output_size);
-            if (A0.Grid().Rank() == 0) {
-                compute_type *buffer = A0.Buffer();
-                int ldim = A0.LDim();
-                for(int i = 0; i < _X.Width(); i++) {
-                    std::string line;
-                    std::getline(A_str, line);
-                    std::istringstream Astream(line);
-                    for(int j = 0; j < _output_size; j++) {
-                        std::string token;
-                        Astream >> token;
-                        buffer[i + j * ldim] = atof(token.c_str());
-                    }
-                }
-            }
-
-            _A = A0;
-        }
+        reader.get(pt, "alpha", _X.Width(), _output_size, _A);
     }
 
 private:
@@ -544,7 +510,11 @@ public model_t<OutType, ComputeType> {
     }
 
     kernel_model_t(const boost::property_tree::ptree &pt) {
-        build_from_ptree(pt);
+        build_from_ptree(model_reader_t(pt));
+    }
+
+    kernel_model_t(const model_reader_t &reader) {
+        build_from_ptree(reader);
     }
 
     void predict(base::direction_t direction_XT,
@@ -558,6 +528,11 @@ public model_t<OutType, ComputeType> {
     }
 
     boost::property_tree::ptree to_ptree() const {
+        model_writer_t writer(MODEL_FORMAT_TEXT);
+        return to_ptree(writer);
+    }
+
+    boost::property_tree::ptree to_ptree(model_writer_t &writer) const {
         boost::property_tree::ptree pt;
 
         pt.put("skylark_object_type", "model:kernel");
@@ -579,19 +554,20 @@ public model_t<OutType, ComputeType> {
 
         pt.add_child("kernel", _k.to_ptree());
 
-        std::stringstream sA;
-        El::Print(_A, "", sA);
-        pt.put("alpha", sA.str());
+        writer.put(pt, "alpha", _A);
 
         return pt;
     }
 
-    void save(const std::string& fname, const std::string& header) const {
-        boost::property_tree::ptree pt = to_ptree();
-        std::ofstream of(fname);
-        of << header;
-        boost::property_tree::write_json(of, pt);
-        of.close();
+    /**
+     * Saves the model to a file named fname. Collective over the grid of
+     * the model.
+     */
+    void save(const std::string& fname, const std::string& header,
+        model_format_t format = MODEL_FORMAT_TEXT) const {
+        model_writer_t writer(format);
+        boost::property_tree::ptree pt = to_ptree(writer);
+        writer.write(fname, header, pt, _A.Grid().VCComm().comm);
     }
 
     virtual ~kernel_model_t() {
@@ -610,7 +586,8 @@ public model_t<OutType, ComputeType> {
 
 protected:
 
-    void build_from_ptree(const boost::property_tree::ptree &pt) {
+    void build_from_ptree(const model_reader_t &reader) {
+        const boost::property_tree::ptree &pt = reader.get_ptree();
 
         _input_size = pt.get<El::Int>("input_size");
         _output_size = pt.get<El::Int>("num_outputs");
@@ -660,42 +637,7 @@ protected:
 
         _direction = base::COLUMNS;
 
-        std::istringstream A_str(pt.get<std::string>("alpha"));
-        if (_A.Grid().Size() == 1) {
-            _A.Resize(_X.Width(), _output_size);
-            compute_type *buffer = _A.Buffer();
-            int ldim = _A.LDim();
-            for(int i = 0; i < _X.Width(); i++) {
-                std::string line;
-                std::getline(A_str, line);
-                std::istringstream Astream(line);
-                for(int j = 0; j < _output_size; j++) {
-                    std::string token;
-                    Astream >> token;
-                    buffer[i + j * ldim] = atof(token.c_str());
-                }
-            }
-        } else {
-            // TODO: can do more memory efficient
-            El::DistMatrix<compute_type, El::CIRC, El::CIRC> A0(_X.Width(),
-                _output_size);
-            if (A0.Grid().Rank() == 0) {
-                compute_type *buffer = A0.Buffer();
-                int ldim = A0.LDim();
-                for(int i = 0; i < _X.Width(); i++) {
-                    std::string line;
-                    std::getline(A_str, line);
-                    std::istringstream Astream(line);
-                    for(int j = 0; j < _output_size; j++) {
-                        std::string token;
-                        Astream >> token;
-                        buffer[i + j * ldim] = atof(token.c_str());
-                    }
-                }
-            }
-
-            _A = A0;
-        }
+        reader.get(pt, "alpha", _X.Width(), _output_size, _A);
     }
 
 private:
@@ -763,7 +705,11 @@ public model_t<OutType, ComputeType>
     }
 
     feature_expansion_model_t(const boost::property_tree::ptree &pt) {
-        build_from_ptree(pt);
+        build_from_ptree(model_reader_t(pt));
+    }
+
+    feature_expansion_model_t(const model_reader_t &reader) {
+        build_from_ptree(reader);
     }
 
     void predict(base::direction_t direction_XT,
@@ -805,6 +751,11 @@ public model_t<OutType, ComputeType>
     }
 
     boost::property_tree::ptree to_ptree() const {
+        model_writer_t writer(MODEL_FORMAT_TEXT);
+        return to_ptree(writer);
+    }
+
+    boost::property_tree::ptree to_ptree(model_writer_t &writer) const {
         boost::property_tree::ptree pt;
 
         pt.put("skylark_object_type", "model:feature_expansion");
@@ -826,19 +777,20 @@ public model_t<OutType, ComputeType>
 
         pt.add_child("feature_mapping", ptfmap);
 
-        std::stringstream sW;
-        El::Print(_W, "", sW);
-        pt.put("weights", sW.str());
+        writer.put(pt, "weights", _W);
 
         return pt;
     }
 
-    void save(const std::string& fname, const std::string& header) const {
-        boost::property_tree::ptree pt = to_ptree();
-        std::ofstream of(fname);
-        of << header;
-        boost::property_tree::write_json(of, pt);
-        of.close();
+    /**
+     * Saves the model to a file named fname. Collective over the grid of
+     * the model.
+     */
+    void save(const std::string& fname, const std::string& header,
+        model_format_t format = MODEL_FORMAT_TEXT) const {
+        model_writer_t writer(format);
+        boost::property_tree::ptree pt = to_ptree(writer);
+        writer.write(fname, header, pt, _W.Grid().VCComm().comm);
     }
 
     virtual ~feature_expansion_model_t() {
@@ -850,7 +802,8 @@ public model_t<OutType, ComputeType>
     }
 
 protected:
-    void build_from_ptree(const boost::property_tree::ptree &pt) {
+    void build_from_ptree(const model_reader_t &reader) {
+        const boost::property_tree::ptree &pt = reader.get_ptree();
 
         _input_size = pt.get<El::Int>("input_size");
         _output_size = pt.get<El::Int>("num_outputs");
@@ -868,41 +821,7 @@ protected:
             s += _feature_transforms[i].get_S();
         }
 
-        std::istringstream W_str(pt.get<std::string>("weights"));
-        if (_W.Grid().Size() == 1) {
-            _W.Resize(s, _output_size);
-            compute_type *buffer = _W.Buffer();
-            int ldim = _W.LDim();
-            for(int i = 0; i < s; i++) {
-                std::string line;
-                std::getline(W_str, line);
-                std::istringstream Wstream(line);
-                for(int j = 0; j < _output_size; j++) {
-                    std::string token;
-                    Wstream >> token;
-                    buffer[i + j * ldim] = atof(token.c_str());
-                }
-            }
-        } else {
-            // TODO: can do more memory efficient
-            El::DistMatrix<compute_type, El::CIRC, El::CIRC> W0(s, _output_size);
-            if (W0.Grid().Rank() == 0) {
-                compute_type *buffer = W0.Buffer();
-                int ldim = W0.LDim();
-                for(int i = 0; i < s; i++) {
-                    std::string line;
-                    std::getline(W_str, line);
-                    std::istringstream Wstream(line);
-                    for(int j = 0; j < _output_size; j++) {
-                        std::string token;
-                        Wstream >> token;
-                        buffer[i + j * ldim] = atof(token.c_str());
-                    }
-                }
-            }
-
-            _W = W0;
-        }
+        reader.get(pt, "weights", s, _output_size, _W);
     }
 
 private:
@@ -955,7 +874,11 @@ public model_t<OutType, ComputeType> {
     }
 
     feature_expansion_model_t(const boost::property_tree::ptree &pt) {
-        build_from_ptree(pt);
+        build_from_ptree(model_reader_t(pt));
+    }
+
+    feature_expansion_model_t(const model_reader_t &reader) {
+        build_from_ptree(reader);
     }
 
     void predict(base::direction_t direction_XT,
@@ -1003,6 +926,11 @@ public model_t<OutType, ComputeType> {
     }
 
     boost::property_tree::ptree to_ptree() const {
+        model_writer_t writer(MODEL_FORMAT_TEXT);
+        return to_ptree(writer);
+    }
+
+    boost::property_tree::ptree to_ptree(model_writer_t &writer) const {
         boost::property_tree::ptree pt;
 
         pt.put("skylark_object_type", "model:feature_expansion");
@@ -1028,19 +956,20 @@ public model_t<OutType, ComputeType> {
         ptfmap.add_child("transforms", ptmaps);
         pt.add_child("feature_mapping", ptfmap);
 
-        std::stringstream sW;
-        El::Print(_W, "", sW);
-        pt.put("weights", sW.str());
+        writer.put(pt, "weights", _W);
 
         return pt;
     }
 
-    void save(const std::string& fname, const std::string& header) const {
-        boost::property_tree::ptree pt = to_ptree();
-        std::ofstream of(fname);
-        of << header;
-        boost::property_tree::write_json(of, pt);
-        of.close();
+    /**
+     * Saves the model to a file named fname. Collective over the grid of
+     * the model.
+     */
+    void save(const std::string& fname, const std::string& header,
+        model_format_t format = MODEL_FORMAT_TEXT) const {
+        model_writer_t writer(format);
+        boost::property_tree::ptree pt = to_ptree(writer);
+        writer.write(fname, header, pt, _W.Grid().VCComm().comm);
     }
 
     virtual ~feature_expansion_model_t() {
@@ -1058,7 +987,8 @@ public model_t<OutType, ComputeType> {
     }
 
 protected:
-    void build_from_ptree(const boost::property_tree::ptree &pt) {
+    void build_from_ptree(const model_reader_t &reader) {
+        const boost::property_tree::ptree &pt = reader.get_ptree();
 
         _input_size = pt.get<El::Int>("input_size");
         _output_size = pt.get<El::Int>("num_outputs");
@@ -1081,41 +1011,7 @@ protected:
             s += _feature_transforms[i].get_S();
         }
 
-        std::istringstream W_str(pt.get<std::string>("weights"));
-        if (_W.Grid().Size() == 1) {
-            _W.Resize(s, _output_size);
-            compute_type *buffer = _W.Buffer();
-            int ldim = _W.LDim();
-            for(int i = 0; i < s; i++) {
-                std::string line;
-                std::getline(W_str, line);
-                std::istringstream Wstream(line);
-                for(int j = 0; j < _output_size; j++) {
-                    std::string token;
-                    Wstream >> token;
-                    buffer[i + j * ldim] = atof(token.c_str());
-                }
-            }
-        } else {
-            // TODO: can do more memory efficient
-            El::DistMatrix<compute_type, El::CIRC, El::CIRC> W0(s, _output_size);
-            if (W0.Grid().Rank() == 0) {
-                compute_type *buffer = W0.Buffer();
-                int ldim = W0.LDim();
-                for(int i = 0; i < s; i++) {
-                    std::string line;
-                    std::getline(W_str, line);
-                    std::istringstream Wstream(line);
-                    for(int j = 0; j < _output_size; j++) {
-                        std::string token;
-                        Wstream >> token;
-                        buffer[i + j * ldim] = atof(token.c_str());
-                    }
-                }
-            }
-
-            _W = W0;
-        }
+        reader.get(pt, "weights", s, _output_size, _W);
     }
 
 private:
@@ -1153,16 +1049,11 @@ public model_t<OutType, ComputeType>
     }
 
     model_container_t(const boost::property_tree::ptree &pt) {
-        std::string type = pt.get<std::string>("skylark_object_type");
-
-        if (type == "model:kernel")
-            _m.reset(new kernel_model_t<skylark::ml::kernel_container_t,
-                OutType, ComputeType>(pt));
+        build(model_reader_t(pt));
+    }
 
-        if (type == "model:feature_expansion")
-            _m.reset(new feature_expansion_model_t<
-                sketch::sketch_transform_container_t,
-                OutType, ComputeType>(pt));
+    model_container_t(const model_reader_t &reader) {
+        build(reader);
     }
 
     virtual void predict(base::direction_t direction_XT,
@@ -1174,9 +1065,9 @@ public model_t<OutType, ComputeType>
         return _m->to_ptree();
     }
 
-    virtual void save(const std::string& fname, const std::string& header)
-        const {
-        _m->save(fname, header);
+    virtual void save(const std::string& fname, const std::string& header,
+        model_format_t format = MODEL_FORMAT_TEXT) const {
+        _m->save(fname, header, format);
     }
 
     virtual El::Int get_input_size() const {
@@ -1189,6 +1080,20 @@ public model_t<OutType, ComputeType>
 
 private:
     std::shared_ptr<model_type> _m;
+
+    void build(const model_reader_t &reader) {
+        std::string type =
+            reader.get_ptree().get<std::string>("skylark_object_type");
+
+        if (type == "model:kernel")
+            _m.reset(new kernel_model_t<skylark::ml::kernel_container_t,
+                OutType, ComputeType>(reader));
+
+        if (type == "model:feature_expansion")
+            _m.reset(new feature_expansion_model_t<
+                sketch::sketch_transform_container_t,
+                OutType, ComputeType>(reader));
+    }
 };
 
 /**
@@ -1207,16 +1112,11 @@ public model_t<OutType, ComputeType>
     }
 
     model_container_t(const boost::property_tree::ptree &pt) {
-        std::string type = pt.get<std::string>("skylark_object_type");
-
-        if (type == "model:kernel")
-            _m.reset(new kernel_model_t<skylark::ml::kernel_container_t,
-                OutType, ComputeType>(pt));
+        build(model_reader_t(pt));
+    }
 
-        if (type == "model:feature_expansion")
-            _m.reset(new feature_expansion_model_t<
-                sketch::sketch_transform_container_t,
-                OutType, ComputeType>(pt));
+    model_container_t(const model_reader_t &reader) {
+        build(reader);
     }
 
     virtual void predict(base::direction_t direction_XT,
@@ -1229,9 +1129,9 @@ public model_t<OutType, ComputeType>
         return _m->to_ptree();
     }
 
-    virtual void save(const std::string& fname, const std::string& header)
-        const {
-        _m->save(fname, header);
+    virtual void save(const std::string& fname, const std::string& header,
+        model_format_t format = MODEL_FORMAT_TEXT) const {
+        _m->save(fname, header, format);
     }
 
     virtual El::Int get_input_size() const {
@@ -1248,6 +1148,20 @@ public model_t<OutType, ComputeType>
 
 private:
     std::shared_ptr<model_type> _m;
+
+    void build(const model_reader_t &reader) {
+        std::string type =
+            reader.get_ptree().get<std::string>("skylark_object_type");
+
+        if (type == "model:kernel")
+            _m.reset(new kernel_model_t<skylark::ml::kernel_container_t,
+                OutType, ComputeType>(reader));
+
+        if (type == "model:feature_expansion")
+            _m.reset(new feature_expansion_model_t<
+                sketch::sketch_transform_container_t,
+                OutType, ComputeType>(reader));
+    }
 };
 
 } }
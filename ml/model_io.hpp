@@ -0,0 +1,506 @@
+#ifndef SKYLARK_ML_MODEL_IO_HPP
+#define SKYLARK_ML_MODEL_IO_HPP
+
+#include <El.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/mpi.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+namespace skylark { namespace ml {
+
+/**
+ * Model files come in two formats, both starting with comment lines (lines
+ * beginning with '#').
+ *
+ * Text: the property tree of the model in JSON, with the matrices as
+ * whitespace separated text (as printed by El::Print).
+ *
+ * Binary: a line "skylark-binary-model <n>", followed by n bytes of JSON:
+ * the property tree in which every matrix is replaced by a reference to a
+ * blob (type, height, width and offset). The blobs hold the column-major
+ * values of the matrices. They start at multiples of model_blob_alignment
+ * bytes from the beginning of the file, so they can be memory mapped, and
+ * every rank reads its own part of a distributed matrix directly.
+ */
+enum model_format_t {
+    MODEL_FORMAT_TEXT = 0,
+    MODEL_FORMAT_BINARY = 1
+};
+
+static const size_t model_blob_alignment = 64;
+
+namespace detail {
+
+static const char model_binary_magic[] = "skylark-binary-model";
+
+template<typename T>
+struct model_blob_type_t {
+
+};
+
+template<>
+struct model_blob_type_t<float> {
+    static std::string name() { return "float32"; }
+};
+
+template<>
+struct model_blob_type_t<double> {
+    static std::string name() { return "float64"; }
+};
+
+inline size_t model_blob_align(size_t offset) {
+    return (offset + model_blob_alignment - 1) / model_blob_alignment *
+        model_blob_alignment;
+}
+
+/**
+ * Parses a matrix printed by El::Print (one row per line) into buffer
+ * (column-major, leading dimension ldim).
+ */
+template<typename T>
+void model_parse_text(const std::string &text, El::Int height,
+    El::Int width, T *buffer, El::Int ldim) {
+
+    std::istringstream str(text);
+    for(El::Int i = 0; i < height; i++) {
+        std::string line;
+        std::getline(str, line);
+        std::istringstream linestream(line);
+        for(El::Int j = 0; j < width; j++) {
+            std::string token;
+            linestream >> token;
+            buffer[i + j * ldim] = atof(token.c_str());
+        }
+    }
+}
+
+/**
+ * Collective read (or write) of the blob at offset, a column-major matrix
+ * with the dimensions of A. A is [VC, STAR] aligned at zero, so the part of
+ * rank r are the rows r, r + p, ...; an MPI file view selects exactly these,
+ * and MPI-IO aggregates the accesses.
+ */
+template<typename T>
+void model_blob_io(bool write, MPI_File file, MPI_Offset offset,
+    El::DistMatrix<T, El::VC, El::STAR> &A) {
+
+    const int p = A.Grid().Size();
+    const int r = A.Grid().VCRank();
+    const El::Int height = A.Height(), width = A.Width();
+    El::Matrix<T> &Al = A.Matrix();
+    const El::Int nl = Al.Height();
+
+    MPI_Datatype type = boost::mpi::get_mpi_datatype<T>();
+    MPI_Datatype column, view;
+    MPI_Type_vector(nl, 1, p, type, &column);
+    MPI_Type_create_hvector(width, 1, height * sizeof(T), column, &view);
+    MPI_Type_commit(&view);
+    MPI_Type_free(&column);
+
+    MPI_File_set_view(file, offset + r * sizeof(T), type, view,
+        const_cast<char *>("native"), MPI_INFO_NULL);
+
+    std::vector<T> buf(nl * width);
+    if (write)
+        for(El::Int j = 0; j < width; j++)
+            std::copy(Al.LockedBuffer(0, j), Al.LockedBuffer(0, j) + nl,
+                buf.begin() + j * nl);
+
+    MPI_Status status;
+    int err = write ?
+        MPI_File_write_all(file, buf.data(), buf.size(), type, &status) :
+        MPI_File_read_all(file, buf.data(), buf.size(), type, &status);
+    MPI_Type_free(&view);
+    if (err != MPI_SUCCESS)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception()
+                << base::error_msg(write ? "Error while writing model blob" :
+                    "Error while reading model blob"));
+
+    if (!write)
+        for(El::Int j = 0; j < width; j++)
+            std::copy(buf.begin() + j * nl, buf.begin() + (j + 1) * nl,
+                Al.Buffer(0, j));
+}
+
+} // namespace detail
+
+/**
+ * Writes a model file. Models add their matrices with put() while building
+ * their property tree, and write() then writes the file.
+ */
+struct model_writer_t {
+
+    model_writer_t(model_format_t format) : _format(format), _size(0) {
+
+    }
+
+    model_format_t format() const {
+        return _format;
+    }
+
+    /**
+     * Adds A (which is the same on all ranks) under key. The matrix has to
+     * stay alive until write().
+     */
+    template<typename T>
+    void put(boost::property_tree::ptree &pt, const std::string &key,
+        const El::Matrix<T> &A) {
+
+        if (_format == MODEL_FORMAT_TEXT) {
+            std::stringstream s;
+            El::Print(A, "", s);
+            pt.put(key, s.str());
+            return;
+        }
+
+        MPI_Offset offset = add_blob<T>(pt, key, A.Height(), A.Width());
+        const El::Matrix<T> *AP = &A;
+        _blobs.push_back([AP, offset] (MPI_File file, MPI_Offset data,
+                int rank) {
+                if (rank != 0)
+                    return;
+                MPI_Datatype type = boost::mpi::get_mpi_datatype<T>();
+                for(El::Int j = 0; j < AP->Width(); j++) {
+                    MPI_Status status;
+                    MPI_File_write_at(file,
+                        data + offset + j * AP->Height() * sizeof(T),
+                        const_cast<T *>(AP->LockedBuffer(0, j)),
+                        AP->Height(), type, &status);
+                }
+            });
+    }
+
+    /**
+     * Adds A under key. Collective over the grid of A; the matrix has to
+     * stay alive until write().
+     */
+    template<typename T>
+    void put(boost::property_tree::ptree &pt, const std::string &key,
+        const El::DistMatrix<T> &A) {
+
+        if (_format == MODEL_FORMAT_TEXT) {
+            std::stringstream s;
+            El::Print(A, "", s);
+            pt.put(key, s.str());
+            return;
+        }
+
+        MPI_Offset offset = add_blob<T>(pt, key, A.Height(), A.Width());
+        const El::DistMatrix<T> *AP = &A;
+        _blobs.push_back([AP, offset] (MPI_File file, MPI_Offset data,
+                int) {
+                El::DistMatrix<T, El::VC, El::STAR> A_VC_STAR(AP->Grid());
+                A_VC_STAR.AlignCols(0);
+                El::Copy(*AP, A_VC_STAR);
+                detail::model_blob_io(true, file, data + offset, A_VC_STAR);
+            });
+    }
+
+    /**
+     * Writes the model file: header (comment lines), then pt and the added
+     * matrices. Collective over comm, which has to be the communicator of
+     * the grid of the distributed matrices added (if any). Only rank 0
+     * writes the text format, and the header.
+     */
+    void write(const std::string &fname, const std::string &header,
+        const boost::property_tree::ptree &pt, MPI_Comm comm) const {
+
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+
+        if (_format == MODEL_FORMAT_TEXT) {
+            if (rank == 0) {
+                std::ofstream of(fname);
+                of << header;
+                boost::property_tree::write_json(of, pt);
+                of.close();
+            }
+
+            // As with the binary format (collective close), the file is
+            // complete on all ranks once write() returns.
+            MPI_Barrier(comm);
+            return;
+        }
+
+        std::stringstream json;
+        boost::property_tree::write_json(json, pt);
+        std::stringstream head;
+        head << header << detail::model_binary_magic << " "
+             << json.str().size() << "\n" << json.str();
+        std::string headstr = head.str();
+
+        unsigned long long data = detail::model_blob_align(headstr.size());
+        MPI_Bcast(&data, 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+
+        // Truncate an existing file.
+        if (rank == 0)
+            MPI_File_delete(const_cast<char *>(fname.c_str()), MPI_INFO_NULL);
+        MPI_Barrier(comm);
+
+        MPI_File file;
+        int rc = MPI_File_open(comm, const_cast<char *>(fname.c_str()),
+            MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+        if (rc)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Unable to open file " + fname));
+
+        if (rank == 0) {
+            headstr.resize(data, '\0');
+            MPI_Status status;
+            MPI_File_write_at(file, 0, const_cast<char *>(headstr.data()),
+                headstr.size(), MPI_BYTE, &status);
+        }
+
+        for(size_t b = 0; b < _blobs.size(); b++) {
+            MPI_File_set_view(file, 0, MPI_BYTE, MPI_BYTE,
+                const_cast<char *>("native"), MPI_INFO_NULL);
+            _blobs[b](file, data, rank);
+        }
+
+        MPI_File_close(&file);
+    }
+
+private:
+    const model_format_t _format;
+    MPI_Offset _size;
+    std::vector<std::function<void (MPI_File, MPI_Offset, int)> > _blobs;
+
+    template<typename T>
+    MPI_Offset add_blob(boost::property_tree::ptree &pt,
+        const std::string &key, El::Int height, El::Int width) {
+
+        MPI_Offset offset = _size;
+        pt.put(key + ".type", detail::model_blob_type_t<T>::name());
+        pt.put(key + ".height", height);
+        pt.put(key + ".width", width);
+        pt.put(key + ".offset", offset);
+        _size = detail::model_blob_align(offset + height * width * sizeof(T));
+        return offset;
+    }
+};
+
+/**
+ * Reads a model file of either format, or gives access to the matrices of
+ * an already parsed text format property tree.
+ */
+struct model_reader_t {
+
+    /**
+     * @param fname model file.
+     * @param map for the binary format, memory map the file (copy on
+     *            write), and let local matrices be views of the mapping.
+     */
+    model_reader_t(const std::string &fname, bool map = false) :
+        _fname(fname), _format(MODEL_FORMAT_TEXT), _data(0), _pt(&_own) {
+
+        std::ifstream is(fname, std::ios::binary);
+        if ((is.rdstate() & std::ifstream::failbit) != 0)
+            SKYLARK_THROW_EXCEPTION (
+                base::io_exception()
+                    << base::error_msg("Failed to open file " + fname));
+
+        // Skip all lines begining with "#"
+        while(is.peek() == '#')
+            is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+        std::streampos start = is.tellg();
+        std::string magic;
+        is >> magic;
+        if (magic == detail::model_binary_magic) {
+            size_t n;
+            is >> n;
+            is.ignore(1);
+            std::string json(n, ' ');
+            is.read(&json[0], n);
+            std::istringstream jsonstream(json);
+            boost::property_tree::read_json(jsonstream, _own);
+            _format = MODEL_FORMAT_BINARY;
+            _data = detail::model_blob_align(static_cast<size_t>(is.tellg()));
+        } else {
+            is.clear();
+            is.seekg(start);
+            boost::property_tree::read_json(is, _own);
+        }
+        is.close();
+
+        if (map && _format == MODEL_FORMAT_BINARY) {
+            int fd = open(fname.c_str(), O_RDONLY);
+            struct stat st;
+            void *addr = MAP_FAILED;
+            if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+                addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE, fd, 0);
+            if (fd >= 0)
+                close(fd);
+            if (addr == MAP_FAILED)
+                SKYLARK_THROW_EXCEPTION (
+                    base::io_exception()
+                        << base::error_msg("Failed to map file " + fname));
+            size_t len = st.st_size;
+            _map.reset(addr, [len] (void *p) { munmap(p, len); });
+        }
+    }
+
+    /** Text format property tree, already parsed (not copied). */
+    model_reader_t(const boost::property_tree::ptree &pt) :
+        _format(MODEL_FORMAT_TEXT), _data(0), _pt(&pt) {
+
+    }
+
+    model_format_t format() const {
+        return _format;
+    }
+
+    const boost::property_tree::ptree &get_ptree() const {
+        return *_pt;
+    }
+
+    /** The mapping of the file (if mapped); views of it need to hold it. */
+    std::shared_ptr<void> mapping() const {
+        return _map;
+    }
+
+    /**
+     * Reads the height x width matrix under key into A (on all ranks). If
+     * the file is mapped, A becomes a view of the mapping.
+     */
+    template<typename T>
+    void get(const boost::property_tree::ptree &pt, const std::string &key,
+        El::Int height, El::Int width, El::Matrix<T> &A) const {
+
+        if (_format == MODEL_FORMAT_TEXT) {
+            A.Resize(height, width);
+            detail::model_parse_text(pt.get<std::string>(key), height, width,
+                A.Buffer(), A.LDim());
+            return;
+        }
+
+        std::string type;
+        size_t offset = blob(pt, key, height, width, type);
+
+        if (_map && type == detail::model_blob_type_t<T>::name()) {
+            A.Attach(height, width, reinterpret_cast<T *>(
+                    static_cast<char *>(_map.get()) + _data + offset),
+                std::max(height, El::Int(1)));
+            return;
+        }
+
+        A.Resize(height, width);
+        std::ifstream is(_fname, std::ios::binary);
+        is.seekg(_data + offset);
+        if (type == "float64")
+            read_columns<double>(is, A);
+        else
+            read_columns<float>(is, A);
+    }
+
+    /**
+     * Reads the height x width matrix under key into A. Collective over the
+     * grid of A. For the binary format every rank reads its own part.
+     */
+    template<typename T>
+    void get(const boost::property_tree::ptree &pt, const std::string &key,
+        El::Int height, El::Int width, El::DistMatrix<T> &A) const {
+
+        if (_format == MODEL_FORMAT_TEXT) {
+            El::DistMatrix<T, El::CIRC, El::CIRC> A0(height, width, A.Grid());
+            if (A0.Grid().Rank() == 0)
+                detail::model_parse_text(pt.get<std::string>(key), height,
+                    width, A0.Buffer(), A0.LDim());
+            A = A0;
+            return;
+        }
+
+        std::string type;
+        size_t offset = blob(pt, key, height, width, type);
+
+        MPI_File file;
+        int rc = MPI_File_open(A.Grid().VCComm().comm,
+            const_cast<char *>(_fname.c_str()), MPI_MODE_RDONLY,
+            MPI_INFO_NULL, &file);
+        if (rc)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Unable to open file " + _fname));
+
+        if (type == detail::model_blob_type_t<T>::name()) {
+            El::DistMatrix<T, El::VC, El::STAR> A_VC_STAR(A.Grid());
+            A_VC_STAR.AlignCols(0);
+            A_VC_STAR.Resize(height, width);
+            detail::model_blob_io(false, file, _data + offset, A_VC_STAR);
+            El::Copy(A_VC_STAR, A);
+        } else if (type == "float64") {
+            El::DistMatrix<double, El::VC, El::STAR> A_VC_STAR(A.Grid());
+            A_VC_STAR.AlignCols(0);
+            A_VC_STAR.Resize(height, width);
+            detail::model_blob_io(false, file, _data + offset, A_VC_STAR);
+            El::Copy(A_VC_STAR, A);
+        } else {
+            El::DistMatrix<float, El::VC, El::STAR> A_VC_STAR(A.Grid());
+            A_VC_STAR.AlignCols(0);
+            A_VC_STAR.Resize(height, width);
+            detail::model_blob_io(false, file, _data + offset, A_VC_STAR);
+            El::Copy(A_VC_STAR, A);
+        }
+
+        MPI_File_close(&file);
+    }
+
+private:
+    const std::string _fname;
+    model_format_t _format;
+    size_t _data;
+    boost::property_tree::ptree _own;
+    const boost::property_tree::ptree *_pt;
+    std::shared_ptr<void> _map;
+
+    model_reader_t(const model_reader_t &);
+    model_reader_t &operator=(const model_reader_t &);
+
+    /** Offset (from the data start) and type of the blob under key. */
+    size_t blob(const boost::property_tree::ptree &pt,
+        const std::string &key, El::Int height, El::Int width,
+        std::string &type) const {
+
+        type = pt.get<std::string>(key + ".type");
+        if (pt.get<El::Int>(key + ".height") != height ||
+            pt.get<El::Int>(key + ".width") != width ||
+            (type != "float64" && type != "float32"))
+            SKYLARK_THROW_EXCEPTION (
+                base::io_exception()
+                    << base::error_msg("Invalid matrix " + key +
+                        " in model file " + _fname));
+        return pt.get<size_t>(key + ".offset");
+    }
+
+    template<typename S, typename T>
+    static void read_columns(std::istream &is, El::Matrix<T> &A) {
+        std::vector<S> column(A.Height());
+        for(El::Int j = 0; j < A.Width(); j++) {
+            is.read(reinterpret_cast<char *>(column.data()),
+                column.size() * sizeof(S));
+            std::copy(column.begin(), column.end(), A.Buffer(0, j));
+        }
+    }
+};
+
+} } // namespace skylark::ml
+
+#endif // SKYLARK_ML_MODEL_IO_HPP
@@ -22,6 +22,8 @@ namespace po = boost::program_options;
 #define DEFAULT_SEED 12345
 #define DEFAULT_KERNEL 0
 #define DEFAULT_FILEFORMAT 0
+#define DEFAULT_SERVE_BATCH 64
+#define DEFAULT_SERVE_DELAY 1.0
 
 enum LossType {SQUARED = 0, LAD = 1, HINGE = 2, LOGISTIC = 3};
 std::string Losses[] = {"Squared Loss",
@@ -43,6 +45,9 @@ enum KernelType {K_LINEAR = 0, K_GAUSSIAN = 1, K_POLYNOMIAL = 2,
 std::string Kernels[] = {"Linear", "Gaussian",
                          "Polynomial", "Laplacian", "ExpSemigroup", "Matern"};
 
+enum CachePrecisionType {DOUBLE_CACHE = 0, SINGLE_CACHE = 1, BFLOAT16_CACHE = 2};
+std::string CachePrecisions[] = {"Double", "Single", "BFloat16"};
+
 enum FileFormatType {LIBSVM_DENSE = 0, LIBSVM_SPARSE = 1, HDF5_DENSE = 2, HDF5_SPARSE = 3};
 std::string FileFormats[] = {"libsvm-dense", "libsvm-sparse", "hdf5_dense", "hdf5_sparse"};
 
@@ -81,6 +86,10 @@ struct hilbert_options_t {
     bool usefast;
     SequenceType seqtype;
     bool cachetransforms;
+    int cacheprecision;
+    double cachememory; /**< in megabytes, 0 for no limit */
+    std::string cachescratch;
+    std::string factorcache;
 
     /* parallelization options */
     int numfeaturepartitions;
@@ -95,8 +104,14 @@ struct hilbert_options_t {
     std::string testfile;
     std::string valfile;
     std::string outputfile;
+    bool binarymodel;
     std::string str = "";
 
+    /** Prediction server: "-" for stdin/stdout, else a socket path */
+    std::string serve;
+    int servebatch;
+    double servedelay; /**< in milliseconds */
+
     /** A parameter indicating if we need to continue or not */
     bool exit_on_return;
 
@@ -167,9 +182,27 @@ struct hilbert_options_t {
             ("cachetransforms",
                 "Cache feature expanded data "
                 "(faster, but more memory demanding).")
+            ("cacheprecision",
+                po::value<int>(&cacheprecision)->default_value(DOUBLE_CACHE),
+                "Precision of the cached feature expanded data "
+                "(0:Double, 1:Single, 2:BFloat16)")
+            ("cachememory",
+                po::value<double>(&cachememory)->default_value(0),
+                "Memory (in MB, per process) for cached feature expanded "
+                "data; the rest is spilled or recomputed (default: 0, no limit)")
+            ("cachescratch",
+                po::value<std::string>(&cachescratch)->default_value(""),
+                "Directory for a memory mapped file with the cached feature "
+                "expanded data that exceeds --cachememory")
+            ("factorcache",
+                po::value<std::string>(&factorcache)->default_value(""),
+                "Base name of files keeping the factorizations of the "
+                "first iteration (reused when restarting on the same data)")
             ("decisionvals",
                 "In predict mode, for classification, output the "
                 "decision values instead of class.")
+            ("binarymodel",
+                "Save the model in binary format (default is text).")
             ("fileformat",
                 po::value<int>(&fileformat)->default_value(DEFAULT_FILEFORMAT),
                 "Fileformat (default: 0 (libsvm->dense), 1 (libsvm->sparse), 2 (hdf5->dense), 3 (hdf5->sparse)")
@@ -191,6 +224,17 @@ struct hilbert_options_t {
             ("outputfile",
                 po::value<std::string>(&outputfile)->default_value(""),
                 "Base name for output file (will attach .txt suffix)")
+            ("serve",
+                po::value<std::string>(&serve)->default_value(""),
+                "Serve predictions with the model: - for stdin/stdout, "
+                "otherwise the path of a Unix domain socket")
+            ("servebatch",
+                po::value<int>(&servebatch)->default_value(DEFAULT_SERVE_BATCH),
+                "Maximum number of requests predicted together (default: 64)")
+            ("servedelay",
+                po::value<double>(&servedelay)->
+                default_value(DEFAULT_SERVE_DELAY),
+                "Longest wait (in ms) for a batch to fill up (default: 1)")
             ; /* end options */
 
         po::positional_options_description positionalOptions;
@@ -217,6 +261,23 @@ struct hilbert_options_t {
             usefast = vm.count("usefast");
             cachetransforms = vm.count("cachetransforms");
             decisionvals = vm.count("decisionvals");
+            binarymodel = vm.count("binarymodel");
+
+            if (cacheprecision < DOUBLE_CACHE ||
+                cacheprecision > BFLOAT16_CACHE)
+                throw po::validation_error(
+                    po::validation_error::invalid_option_value,
+                    "cacheprecision");
+
+            if (servebatch < 1)
+                throw po::validation_error(
+                    po::validation_error::invalid_option_value,
+                    "servebatch");
+
+            if (servedelay < 0)
+                throw po::validation_error(
+                    po::validation_error::invalid_option_value,
+                    "servedelay");
         }
         catch(po::error& e) {
             std::cerr << e.what() << std::endl;
@@ -244,11 +305,20 @@ struct hilbert_options_t {
         numfeaturepartitions = DEFAULT_FEATURE_PARTITIONS;
         numthreads = DEFAULT_THREADS;
         usefast = false;
+        binarymodel = false;
         seqtype = MONTECARLO;
         fileformat = DEFAULT_FILEFORMAT;
         MAXITER = DEFAULT_MAXITER;
+        cachetransforms = false;
+        cacheprecision = DOUBLE_CACHE;
+        cachememory = 0;
+        cachescratch = "";
+        factorcache = "";
         valfile = "";
         testfile = "";
+        serve = "";
+        servebatch = DEFAULT_SERVE_BATCH;
+        servedelay = DEFAULT_SERVE_DELAY;
 
         for (int i = 1; i < argc; i += 2) {
             std::string flag = argv[i];
@@ -295,6 +365,18 @@ struct hilbert_options_t {
                 cachetransforms = true;
                 i--;
             }
+            if (flag == "--cacheprecision")
+                cacheprecision = boost::lexical_cast<int>(value);
+            if (flag == "--cachememory")
+                cachememory = boost::lexical_cast<double>(value);
+            if (flag == "--cachescratch")
+                cachescratch = value;
+            if (flag == "--factorcache")
+                factorcache = value;
+            if (flag == "--binarymodel") {
+                binarymodel = true;
+                i--;
+            }
             if (flag == "--decisionvals") {
                 decisionvals = true;
                 i--;
@@ -317,6 +399,33 @@ struct hilbert_options_t {
                 testfile = value;
             if (flag == "--outputfile")
                 outputfile = value;
+            if (flag == "--serve")
+                serve = value;
+            if (flag == "--servebatch")
+                servebatch = boost::lexical_cast<int>(value);
+            if (flag == "--servedelay")
+                servedelay = boost::lexical_cast<double>(value);
+        }
+
+        if (cacheprecision < DOUBLE_CACHE || cacheprecision > BFLOAT16_CACHE) {
+            std::cerr << "Invalid --cacheprecision " << cacheprecision
+                      << " (0:Double, 1:Single, 2:BFloat16)" << std::endl;
+            exit_on_return = true;
+            return;
+        }
+
+        if (servebatch < 1) {
+            std::cerr << "Invalid --servebatch " << servebatch
+                      << " (at least 1)" << std::endl;
+            exit_on_return = true;
+            return;
+        }
+
+        if (servedelay < 0) {
+            std::cerr << "Invalid --servedelay " << servedelay
+                      << " (not negative)" << std::endl;
+            exit_on_return = true;
+            return;
         }
 #endif
 
@@ -364,8 +473,23 @@ struct hilbert_options_t {
         optionstring << "# Random Features = " << randomfeatures << std::endl;
         optionstring << "# Cache transforms? = "
                      << (cachetransforms ? "True" : "False") << std::endl;
+        if (cachetransforms) {
+            optionstring << "# Cache precision = " << cacheprecision
+                         << " (" << CachePrecisions[cacheprecision] << ")"
+                         << std::endl;
+            optionstring << "# Cache memory (MB) = " << cachememory
+                         << std::endl;
+            if (!cachescratch.empty())
+                optionstring << "# Cache scratch directory = "
+                             << cachescratch << std::endl;
+        }
+        if (!factorcache.empty())
+            optionstring << "# Factorization cache = "
+                         << factorcache << std::endl;
         optionstring << "# Use fast, if availble? = "
                      << (usefast ? "True" : "False")  << std::endl;
+        optionstring << "# Binary model? = "
+                     << (binarymodel ? "True" : "False")  << std::endl;
         optionstring << "# Sequence = " << seqtype
                      << " (" << Sequences[seqtype] << ")" << std::endl;
         optionstring << "# Number of feature partitions = "
@@ -0,0 +1,516 @@
+#ifndef SKYLARK_ML_PREDICTION_SERVER_HPP
+#define SKYLARK_ML_PREDICTION_SERVER_HPP
+
+#include <El.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "model.hpp"
+
+namespace skylark { namespace ml {
+
+/**
+ * Histogram of latencies, in power of two buckets of microseconds (bucket b
+ * holds [2^b, 2^(b+1)) us, the first one everything below 2 us).
+ */
+struct latency_histogram_t {
+
+    static const int num_buckets = 32;
+
+    latency_histogram_t() : _count(0), _sum(0.0), _max(0.0),
+                            _buckets(num_buckets, 0) {
+
+    }
+
+    /** Add a latency (in seconds). */
+    void add(double seconds) {
+        double us = seconds * 1e6;
+        int b = 0;
+        while (b < num_buckets - 1 && us >= double(2ULL << b))
+            b++;
+        _buckets[b]++;
+        _count++;
+        _sum += seconds;
+        _max = std::max(_max, seconds);
+    }
+
+    /** Add all the latencies of other. */
+    void add(const latency_histogram_t &other) {
+        for(int b = 0; b < num_buckets; b++)
+            _buckets[b] += other._buckets[b];
+        _count += other._count;
+        _sum += other._sum;
+        _max = std::max(_max, other._max);
+    }
+
+    size_t count() const {
+        return _count;
+    }
+
+    double mean() const {
+        return _count == 0 ? 0.0 : _sum / _count;
+    }
+
+    double max() const {
+        return _max;
+    }
+
+    /** Upper end of the bucket of the q-quantile (in seconds). */
+    double quantile(double q) const {
+        size_t rank = static_cast<size_t>(q * _count);
+        size_t seen = 0;
+        for(int b = 0; b < num_buckets; b++) {
+            seen += _buckets[b];
+            if (seen > rank)
+                return std::min(double(2ULL << b) * 1e-6, _max);
+        }
+        return _max;
+    }
+
+    void print(std::ostream &os) const {
+        os << "Requests: " << _count
+           << ", mean " << mean() * 1e3 << " ms"
+           << ", p50 <= " << quantile(0.5) * 1e3 << " ms"
+           << ", p99 <= " << quantile(0.99) * 1e3 << " ms"
+           << ", max " << _max * 1e3 << " ms" << std::endl;
+        for(int b = 0; b < num_buckets; b++)
+            if (_buckets[b] > 0)
+                os << "  < " << (2ULL << b) << " us: " << _buckets[b]
+                   << std::endl;
+    }
+
+private:
+    size_t _count;
+    double _sum, _max;
+    std::vector<size_t> _buckets;
+};
+
+/**
+ * Parameters for the prediction server.
+ */
+struct prediction_server_params_t {
+
+    /** Maximum number of requests predicted together (at least 1). */
+    int max_batch;
+
+    /**
+     * Longest time (in seconds) the first request of a batch waits for
+     * more requests to arrive (not negative).
+     */
+    double max_delay;
+
+    /** Threads used by the prediction (over the feature maps). */
+    int num_threads;
+
+    /** For classification, answer decision values instead of labels. */
+    bool decision_values;
+
+    /**
+     * Budget for keeping the random feature matrices of the model realized
+     * (see sketch::set_realized_memory). 0 keeps the current setting.
+     */
+    size_t realized_memory;
+
+    prediction_server_params_t(int max_batch = 64, double max_delay = 1e-3,
+        int num_threads = 1, bool decision_values = false,
+        size_t realized_memory = 1024 * 1024 * 1024) :
+        max_batch(max_batch), max_delay(max_delay), num_threads(num_threads),
+        decision_values(decision_values), realized_memory(realized_memory) {
+
+    }
+};
+
+/**
+ * Low latency prediction with a hilbert_model_t that stays loaded.
+ *
+ * Requests are lines in libsvm format (index:value tokens; a leading label,
+ * or any other token without ':', is ignored), each answered by a line with
+ * the label, or the decision values. Requests that arrive close together
+ * (from one or many clients) are coalesced into micro-batches, that are
+ * predicted with one application of every feature map.
+ *
+ * The feature maps stay warm between batches: FFTW plans are cached by the
+ * process, and the realized random matrices of dense maps are kept (within
+ * the params.realized_memory budget). The server predicts a dummy batch on
+ * construction so that the first requests do not pay for either.
+ */
+struct prediction_server_t {
+
+    prediction_server_t(const hilbert_model_t &model,
+        const prediction_server_params_t &params =
+        prediction_server_params_t()) :
+        _model(model), _params(params), _producers(0), _stop(false),
+        _num_batches(0) {
+
+        // A batch must take at least one request, or the batching loop
+        // never drains the queue.
+        if (_params.max_batch < 1 || _params.max_delay < 0)
+            SKYLARK_THROW_EXCEPTION (
+                base::invalid_parameters()
+                    << base::error_msg("Prediction server needs max_batch "
+                        ">= 1 and max_delay >= 0"));
+
+        if (_params.realized_memory > 0)
+            sketch::set_realized_memory(_params.realized_memory);
+
+        El::Matrix<double> X, DV;
+        El::Matrix<El::Int> PV;
+        El::Zeros(X, _model.get_input_size(), _params.max_batch);
+        _model.predict(X, PV, DV, _params.num_threads);
+    }
+
+    /**
+     * Serves requests read from in, answering to out, until the end of the
+     * input or an empty line.
+     */
+    void serve(std::istream &in, std::ostream &out) {
+        std::shared_ptr<sink_t> sink(new stream_sink_t(out));
+
+        start_producer();
+        std::thread reader([this, &in, sink] () {
+                std::string line;
+                while (std::getline(in, line) && !line.empty())
+                    push(line, sink);
+                finish_producer();
+            });
+
+        run();
+        reader.join();
+    }
+
+    /**
+     * Serves requests from clients connecting to a Unix domain socket at
+     * path, until a client sends the line "shutdown". Every connection is
+     * a stream of requests (until an empty line or the client closes it),
+     * and requests of all connections are batched together.
+     */
+    void serve(const std::string &path) {
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(path.c_str());
+        if (listener < 0 ||
+            path.size() >= sizeof(addr.sun_path) ||
+            bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            listen(listener, 64) != 0) {
+            if (listener >= 0)
+                close(listener);
+            SKYLARK_THROW_EXCEPTION (
+                base::io_exception()
+                    << base::error_msg("Unable to listen on " + path));
+        }
+
+        std::vector<std::weak_ptr<socket_sink_t> > connections;
+        std::mutex connections_mutex;
+
+        // The acceptor counts as a producer, so the server keeps running
+        // while there are no clients.
+        start_producer();
+        std::thread acceptor([&] () {
+                while (!stopped()) {
+                    struct pollfd pfd = { listener, POLLIN, 0 };
+                    if (poll(&pfd, 1, 100) <= 0)
+                        continue;
+                    int fd = accept(listener, NULL, NULL);
+                    if (fd < 0)
+                        continue;
+
+                    std::shared_ptr<socket_sink_t> sink(
+                        new socket_sink_t(fd));
+                    {
+                        std::lock_guard<std::mutex> lock(connections_mutex);
+                        connections.erase(std::remove_if(connections.begin(),
+                                connections.end(),
+                                [] (const std::weak_ptr<socket_sink_t> &c) {
+                                    return c.expired();
+                                }), connections.end());
+                        connections.push_back(sink);
+                    }
+
+                    start_producer();
+                    std::thread(&prediction_server_t::read_connection, this,
+                        sink).detach();
+                }
+                finish_producer();
+            });
+
+        run();
+        acceptor.join();
+
+        // Unblock the connections still open, and wait for their readers.
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            for(size_t i = 0; i < connections.size(); i++) {
+                std::shared_ptr<socket_sink_t> c = connections[i].lock();
+                if (c)
+                    shutdown(c->fd, SHUT_RDWR);
+            }
+        }
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this] () { return _producers == 0; });
+        lock.unlock();
+
+        close(listener);
+        unlink(path.c_str());
+    }
+
+    /** Latencies of all requests served, from arrival to answer. */
+    const latency_histogram_t &latencies() const {
+        return _latencies;
+    }
+
+    size_t num_batches() const {
+        return _num_batches;
+    }
+
+private:
+    typedef std::chrono::steady_clock clock_type;
+
+    /** Where the answers of a client go. Only the batcher writes. */
+    struct sink_t {
+        virtual void write(const std::string &answers) = 0;
+        virtual ~sink_t() {
+
+        }
+    };
+
+    struct stream_sink_t : public sink_t {
+        stream_sink_t(std::ostream &os) : os(os) {
+
+        }
+
+        void write(const std::string &answers) {
+            os << answers;
+            os.flush();
+        }
+
+        std::ostream &os;
+    };
+
+    struct socket_sink_t : public sink_t {
+        socket_sink_t(int fd) : fd(fd) {
+
+        }
+
+        ~socket_sink_t() {
+            close(fd);
+        }
+
+        void write(const std::string &answers) {
+            size_t done = 0;
+            while (done < answers.size()) {
+                ssize_t w = send(fd, answers.data() + done,
+                    answers.size() - done, MSG_NOSIGNAL);
+                if (w < 0 && errno == EINTR)
+                    continue;
+                if (w <= 0)
+                    return;      // Client is gone.
+                done += w;
+            }
+        }
+
+        const int fd;
+    };
+
+    struct request_t {
+        std::string line;
+        clock_type::time_point arrival;
+        std::shared_ptr<sink_t> sink;
+    };
+
+    const hilbert_model_t &_model;
+    const prediction_server_params_t _params;
+
+    std::deque<request_t> _queue;
+    int _producers;
+    bool _stop;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+
+    latency_histogram_t _latencies;
+    size_t _num_batches;
+
+    void start_producer() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _producers++;
+    }
+
+    void finish_producer() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _producers--;
+        _cv.notify_all();
+    }
+
+    bool stopped() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _stop;
+    }
+
+    void push(const std::string &line, const std::shared_ptr<sink_t> &sink) {
+        request_t request;
+        request.line = line;
+        request.arrival = clock_type::now();
+        request.sink = sink;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(request);
+        if (_queue.size() == 1 || _queue.size() >= size_t(_params.max_batch))
+            _cv.notify_all();
+    }
+
+    void read_connection(std::shared_ptr<socket_sink_t> sink) {
+        std::string pending;
+        char buffer[4096];
+        bool done = false;
+        while (!done) {
+            ssize_t r = read(sink->fd, buffer, sizeof(buffer));
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0)
+                break;
+
+            pending.append(buffer, r);
+            size_t start = 0, end;
+            while ((end = pending.find('\n', start)) != std::string::npos) {
+                std::string line = pending.substr(start, end - start);
+                start = end + 1;
+                if (!line.empty() && line[line.size() - 1] == '\r')
+                    line.resize(line.size() - 1);
+
+                if (line.empty()) {
+                    done = true;
+                    break;
+                }
+
+                if (line == "shutdown") {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stop = true;
+                    _cv.notify_all();
+                    done = true;
+                    break;
+                }
+
+                push(line, sink);
+            }
+            pending.erase(0, start);
+        }
+
+        finish_producer();
+    }
+
+    /**
+     * The batching loop: wait for a request, then for up to max_delay for
+     * the batch to fill up, and predict. Returns when all producers are
+     * done (or the server is stopped) and all requests are answered.
+     */
+    void run() {
+        std::chrono::duration<double> delay(_params.max_delay);
+        std::vector<request_t> batch;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _cv.wait(lock, [this] () {
+                    return !_queue.empty() || _producers == 0 || _stop;
+                });
+            if (_queue.empty())
+                break;
+
+            clock_type::time_point deadline = _queue.front().arrival +
+                std::chrono::duration_cast<clock_type::duration>(delay);
+            _cv.wait_until(lock, deadline, [this] () {
+                    return _queue.size() >= size_t(_params.max_batch) ||
+                        _producers == 0 || _stop;
+                });
+
+            size_t b = std::min(_queue.size(), size_t(_params.max_batch));
+            batch.assign(_queue.begin(), _queue.begin() + b);
+            _queue.erase(_queue.begin(), _queue.begin() + b);
+
+            lock.unlock();
+            process(batch);
+            lock.lock();
+        }
+    }
+
+    void process(std::vector<request_t> &batch) {
+        const El::Int d = _model.get_input_size();
+        const El::Int n = batch.size();
+
+        El::Matrix<double> X, DV;
+        El::Matrix<El::Int> PV;
+        El::Zeros(X, d, n);
+        for(El::Int i = 0; i < n; i++)
+            parse(batch[i].line, X, i);
+
+        _model.predict(X, PV, DV, _params.num_threads);
+
+        // Group the answers by client, keeping their order.
+        std::vector<std::string> answers(n);
+        for(El::Int i = 0; i < n; i++) {
+            std::ostringstream os;
+            if (_model.is_regression() || _params.decision_values) {
+                for(El::Int j = 0; j < DV.Width(); j++)
+                    os << (j > 0 ? " " : "") << DV.Get(i, j);
+            } else
+                os << PV.Get(i, 0);
+            os << "\n";
+            answers[i] = os.str();
+        }
+
+        std::vector<bool> sent(n, false);
+        for(El::Int i = 0; i < n; i++) {
+            if (sent[i])
+                continue;
+            std::string out;
+            for(El::Int k = i; k < n; k++)
+                if (!sent[k] && batch[k].sink == batch[i].sink) {
+                    out += answers[k];
+                    sent[k] = true;
+                }
+            batch[i].sink->write(out);
+        }
+
+        clock_type::time_point now = clock_type::now();
+        for(El::Int i = 0; i < n; i++)
+            _latencies.add(std::chrono::duration<double>(
+                    now - batch[i].arrival).count());
+        _num_batches++;
+    }
+
+    static void parse(const std::string &line, El::Matrix<double> &X,
+        El::Int col) {
+        std::istringstream tokenstream(line);
+        std::string token;
+        while (tokenstream >> token) {
+            size_t delim = token.find(':');
+            if (delim == std::string::npos)
+                continue;
+            El::Int ind = atol(token.substr(0, delim).c_str()) - 1;
+            if (ind >= 0 && ind < X.Height())
+                X.Set(ind, col, atof(token.substr(delim + 1).c_str()));
+        }
+    }
+};
+
+} } // namespace skylark::ml
+
+#endif // SKYLARK_ML_PREDICTION_SERVER_HPP
@@ -18,6 +18,10 @@ struct rlsc_params_t : public base::params_t {
     int res_print;
     double tolerance;
 
+    // For FasterRLSC: do not form the kernel matrix, recompute it in every
+    // iteration instead.
+    bool matrix_free;
+
     // For memory limited methods (SketchedApproximateRLSC, LargeScaleRLSC)
     El::Int max_split;
 
@@ -37,6 +41,8 @@ struct rlsc_params_t : public base::params_t {
         tolerance = 1e-3;
         res_print = 10;
         iter_lim = 1000;
+
+        matrix_free = false;
   }
 
 };
@@ -78,6 +84,7 @@ void KernelRLSC(base::direction_t direction, const KernelType &k,
     krr_params_t krr_params(params.am_i_printing, params.log_level - 1, 
         params.log_stream, params.prefix + "\t");
     krr_params.use_fast = params.use_fast;
+    krr_params.matrix_free = params.matrix_free;
     krr_params.iter_lim = params.iter_lim;
     krr_params.res_print = params.res_print;
     krr_params.tolerance = params.tolerance;
@@ -130,6 +137,7 @@ void ApproximateKernelRLSC(base::direction_t direction, const KernelType &k,
     krr_params_t krr_params(params.am_i_printing, params.log_level - 1, 
         params.log_stream, params.prefix + "\t");
     krr_params.use_fast = params.use_fast;
+    krr_params.matrix_free = params.matrix_free;
     krr_params.sketched_rr = params.sketched_rls;
     krr_params.sketch_size = params.sketch_size;
     krr_params.fast_sketch = params.fast_sketch;
@@ -185,6 +193,7 @@ void SketchedApproximateKernelRLSC(base::direction_t direction, const KernelType
     krr_params_t krr_params(params.am_i_printing, params.log_level - 1, 
         params.log_stream, params.prefix + "\t");
     krr_params.use_fast = params.use_fast;
+    krr_params.matrix_free = params.matrix_free;
     krr_params.sketched_rr = params.sketched_rls;
     krr_params.sketch_size = params.sketch_size;
     krr_params.fast_sketch = params.fast_sketch;
@@ -237,6 +246,7 @@ void FasterKernelRLSC(base::direction_t direction, const KernelType &k,
     krr_params_t krr_params(params.am_i_printing, params.log_level - 1, 
         params.log_stream, params.prefix + "\t");
     krr_params.use_fast = params.use_fast;
+    krr_params.matrix_free = params.matrix_free;
     krr_params.iter_lim = params.iter_lim;
     krr_params.res_print = params.res_print;
     krr_params.tolerance = params.tolerance;
@@ -292,6 +302,7 @@ void LargeScaleKernelRLSC(base::direction_t direction, const KernelType &k,
     krr_params_t krr_params(params.am_i_printing, params.log_level - 1, 
         params.log_stream, params.prefix + "\t");
     krr_params.use_fast = params.use_fast;
+    krr_params.matrix_free = params.matrix_free;
     krr_params.iter_lim = params.iter_lim;
     krr_params.res_print = params.res_print;
     krr_params.tolerance = params.tolerance;
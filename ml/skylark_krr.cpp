@@ -41,8 +41,9 @@ std::string fname, testname, modelname = "model.dat", logfile = "",
     outputfile = "";
 double kp1 = 10.0, kp2 = 0.0, kp3 = 1.0, lambda = 0.01, tolerance=0;
 bool use_single = false, use_fast = false, regression = false;
-bool predict = false, decisionvals = false;
-boost::property_tree::ptree pt;
+bool predict = false, decisionvals = false, matrix_free = false;
+bool binary_model = false;
+std::shared_ptr<skylark::ml::model_reader_t> model_reader;
 
 #ifndef SKYLARK_AVOID_BOOST_PO
 
@@ -119,6 +120,10 @@ int parse_program_options(int argc, char* argv[]) {
             "decision values instead of class.")
         ("single", "Whether to use single precision instead of double.")
         ("fast", "Try using a fast feature transform.")
+        ("matrixfree", "Do not form the kernel matrix (-a 1), recompute "
+            "it in every iteration instead.")
+        ("binarymodel", "Save the model in binary format (coefficients are "
+            "written and read in parallel).")
         ("regression", "Build a regression model"
             "(default is classification).")
         ("numfeatures,f",
@@ -154,6 +159,8 @@ int parse_program_options(int argc, char* argv[]) {
 
         use_single = vm.count("single");
         use_fast = vm.count("fast");
+        matrix_free = vm.count("matrixfree");
+        binary_model = vm.count("binarymodel");
         regression = vm.count("regression");
         predict = vm.count("predict");
         decisionvals = vm.count("decisionvals");
@@ -254,6 +261,16 @@ int parse_program_options(int argc, char* argv[]) {
             i--;
         }
 
+        if (flag == "--matrixfree") {
+            matrix_free = true;
+            i--;
+        }
+
+        if (flag == "--binarymodel") {
+            binary_model = true;
+            i--;
+        }
+
         if (flag == "--trainfile")
             fname = value;
 
@@ -431,6 +448,7 @@ int execute_classification(skylark::base::context_t &context) {
     case FASTER_KRR:
         rlsc_params.iter_lim = (maxit == 0) ? 1000 : maxit;
         rlsc_params.tolerance = (tolerance == 0) ? 1e-3 : tolerance;
+        rlsc_params.matrix_free = matrix_free;
         skylark::ml::FasterKernelRLSC(skylark::base::COLUMNS, k, X, L,
             T(lambda), A, rcoding, s, context, rlsc_params);
         model =
@@ -505,17 +523,14 @@ int execute_classification(skylark::base::context_t &context) {
             timer.restart();
         }
 
-        pt = model->to_ptree();
+        std::stringstream header;
+        header << "# Generated using kernel_regression ";
+        header << "using the following command-line: " << std::endl;
+        header << "#\t" << cmdline << std::endl;
+        header << "# Number of ranks is " << world.size() << std::endl;
 
-        if (rank == 0) {
-            std::ofstream of(modelname);
-            of << "# Generated using kernel_regression ";
-            of << "using the following command-line: " << std::endl;
-            of << "#\t" << cmdline << std::endl;
-            of << "# Number of ranks is " << world.size() << std::endl;
-            boost::property_tree::write_json(of, pt);
-            of.close();
-        }
+        model->save(modelname, header.str(), binary_model ?
+            skylark::ml::MODEL_FORMAT_BINARY : skylark::ml::MODEL_FORMAT_TEXT);
 
         if (rank == 0)
             *log_stream <<"took " << boost::format("%.2e") % timer.elapsed()
@@ -729,6 +744,7 @@ int execute_regression(skylark::base::context_t &context) {
     case FASTER_KRR:
         krr_params.iter_lim = (maxit == 0) ? 1000 : maxit;
         krr_params.tolerance = (tolerance == 0) ? 1e-3 : tolerance;
+        krr_params.matrix_free = matrix_free;
         skylark::ml::FasterKernelRidge(skylark::base::COLUMNS, k, X, Ytransp,
             T(lambda), A, s, context, krr_params);
         model =
@@ -804,17 +820,14 @@ int execute_regression(skylark::base::context_t &context) {
             timer.restart();
         }
 
-        pt = model->to_ptree();
+        std::stringstream header;
+        header << "# Generated using kernel_regression ";
+        header << "using the following command-line: " << std::endl;
+        header << "#\t" << cmdline << std::endl;
+        header << "# Number of ranks is " << world.size() << std::endl;
 
-        if (rank == 0) {
-            std::ofstream of(modelname);
-            of << "# Generated using kernel_regression ";
-            of << "using the following command-line: " << std::endl;
-            of << "#\t" << cmdline << std::endl;
-            of << "# Number of ranks is " << world.size() << std::endl;
-            boost::property_tree::write_json(of, pt);
-            of.close();
-        }
+        model->save(modelname, header.str(), binary_model ?
+            skylark::ml::MODEL_FORMAT_BINARY : skylark::ml::MODEL_FORMAT_TEXT);
 
         if (rank == 0)
             *log_stream <<"took " << boost::format("%.2e") % timer.elapsed()
@@ -902,7 +915,7 @@ int predict_regression(skylark::base::context_t &context) {
         timer.restart();
     }
 
-    skylark::ml::model_container_t<T, T> model(pt);
+    skylark::ml::model_container_t<T, T> model(*model_reader);
 
     if (rank == 0)
         *log_stream <<"took " << boost::format("%.2e") % timer.elapsed()
@@ -999,7 +1012,7 @@ int predict_classification(skylark::base::context_t &context) {
         timer.restart();
     }
 
-    skylark::ml::model_container_t<El::Int, T> model(pt);
+    skylark::ml::model_container_t<El::Int, T> model(*model_reader);
 
     if (rank == 0)
         *log_stream <<"took " << boost::format("%.2e") % timer.elapsed()
@@ -1119,16 +1132,8 @@ int main(int argc, char* argv[]) {
         // If in predict mode, we need to read the model to see if regression
         // or classification mode.
         if (predict) {
-            std::ifstream is(modelname);
-
-            // Skip all lines begining with "#"
-            while(is.peek() == '#')
-                is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-            boost::property_tree::read_json(is, pt);
-            is.close();
-
-            regression = pt.get<bool>("regression");
+            model_reader.reset(new skylark::ml::model_reader_t(modelname));
+            regression = model_reader->get_ptree().get<bool>("regression");
 
             if (regression) {
                 if (use_single)
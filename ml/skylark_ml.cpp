@@ -58,7 +58,7 @@ int main(int argc, char* argv[]) {
         El::DistMatrix<double, El::VC, El::STAR> DecisionValues;
         El::DistMatrix<El::Int, El::VC, El::STAR> PredictedLabels;
         El::Int n;
-        skylark::ml::hilbert_model_t model(options.modelfile);
+        skylark::ml::hilbert_model_t model(options.modelfile, true);
 
         if (sparse) {
             skylark::base::sparse_matrix_t<double> X;
@@ -131,9 +131,30 @@ int main(int argc, char* argv[]) {
         // fix logistic case
         // option for probabilities in predicition
         // clean up evaluate
+    } else if (!options.serve.empty()) {
+        // Serving predictions (rank 0 only)
+        if (comm.rank() == 0) {
+            skylark::ml::hilbert_model_t model(options.modelfile, true);
+
+            skylark::ml::prediction_server_params_t params(
+                options.servebatch, options.servedelay * 1e-3,
+                options.numthreads, options.decisionvals);
+            skylark::ml::prediction_server_t server(model, params);
+
+            if (options.serve == "-")
+                server.serve(std::cin, std::cout);
+            else {
+                std::cerr << "Serving predictions on " << options.serve
+                          << std::endl;
+                server.serve(options.serve);
+            }
+
+            std::cerr << "Batches: " << server.num_batches() << std::endl;
+            server.latencies().print(std::cerr);
+        }
     } else {
         // Preidicting from stdin mode
-        skylark::ml::hilbert_model_t model(options.modelfile);
+        skylark::ml::hilbert_model_t model(options.modelfile, true);
 
         El::Matrix<double> X, DecisionValues(1, model.get_output_size());
         El::Matrix<El::Int> PredictedLabel(1, 1);
@@ -0,0 +1,234 @@
+#ifndef SKYLARK_ML_TRANSFORM_CACHE_HPP
+#define SKYLARK_ML_TRANSFORM_CACHE_HPP
+
+#include <El.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace skylark { namespace ml {
+
+/**
+ * Precision of the entries kept by transform_cache_t: the value type of the
+ * solver, float, or bfloat16 (the upper half of a float: same range, 8 bits
+ * of mantissa).
+ */
+enum transform_cache_precision_t {
+    CACHE_NATIVE = 0,
+    CACHE_FLOAT = 1,
+    CACHE_BFLOAT16 = 2
+};
+
+namespace detail {
+
+/** Rounds to nearest even; NaNs stay NaNs. */
+inline uint16_t float_to_bfloat16(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    if ((bits & 0x7fffffffu) > 0x7f800000u)
+        return uint16_t((bits >> 16) | 0x40u);
+    bits += 0x7fffu + ((bits >> 16) & 1u);
+    return uint16_t(bits >> 16);
+}
+
+inline float bfloat16_to_float(uint16_t x) {
+    uint32_t bits = uint32_t(x) << 16;
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+template<typename T>
+void cache_narrow(transform_cache_precision_t precision, const T *in,
+    void *out, size_t n) {
+
+    switch (precision) {
+    case CACHE_NATIVE:
+        std::memcpy(out, in, n * sizeof(T));
+        break;
+
+    case CACHE_FLOAT:
+        for(size_t i = 0; i < n; i++)
+            static_cast<float *>(out)[i] = float(in[i]);
+        break;
+
+    case CACHE_BFLOAT16:
+        for(size_t i = 0; i < n; i++)
+            static_cast<uint16_t *>(out)[i] = float_to_bfloat16(float(in[i]));
+        break;
+    }
+}
+
+template<typename T>
+void cache_widen(transform_cache_precision_t precision, const void *in,
+    T *out, size_t n) {
+
+    switch (precision) {
+    case CACHE_NATIVE:
+        std::memcpy(out, in, n * sizeof(T));
+        break;
+
+    case CACHE_FLOAT:
+        for(size_t i = 0; i < n; i++)
+            out[i] = T(static_cast<const float *>(in)[i]);
+        break;
+
+    case CACHE_BFLOAT16:
+        for(size_t i = 0; i < n; i++)
+            out[i] = T(bfloat16_to_float(static_cast<const uint16_t *>(in)[i]));
+        break;
+    }
+}
+
+} // namespace detail
+
+/**
+ * Cache of the feature matrices Z (s_j x n) of the feature partitions of
+ * BlockADMMSolver, stored column-major in the requested precision.
+ *
+ * Partitions are cached in order, as long as they fit into the memory
+ * budget (in bytes, 0 for no limit). If a scratch directory is given, the
+ * partitions that do not fit are kept in a memory mapped file there (which
+ * is unlinked right away, so nothing is left behind), and the operating
+ * system pages them in and out. Otherwise they are not cached, and have to
+ * be recomputed whenever needed.
+ *
+ * Different partitions can be stored and loaded concurrently.
+ */
+template<typename T>
+struct transform_cache_t {
+
+    typedef T value_type;
+    typedef El::Matrix<T> matrix_type;
+
+    transform_cache_t(const std::vector<El::Int> &heights, El::Int n,
+        transform_cache_precision_t precision = CACHE_NATIVE,
+        size_t budget = 0, const std::string &scratch = "") :
+        _heights(heights), _n(n), _precision(precision),
+        _data(heights.size(), nullptr), _memory(heights.size()),
+        _map(MAP_FAILED), _map_size(0) {
+
+        if (_precision == CACHE_FLOAT && std::is_same<T, float>::value)
+            _precision = CACHE_NATIVE;
+
+        // Memory first, then the scratch file (page aligned offsets).
+        size_t used = 0;
+        const size_t page = sysconf(_SC_PAGESIZE);
+        std::vector<size_t> offsets(_heights.size(), 0);
+        std::vector<bool> spill(_heights.size(), false);
+        for(size_t j = 0; j < _heights.size(); j++) {
+            size_t bytes = size(j);
+            if (budget == 0 || used + bytes <= budget) {
+                _memory[j].resize(bytes);
+                _data[j] = _memory[j].data();
+                used += bytes;
+            } else if (!scratch.empty()) {
+                offsets[j] = _map_size;
+                spill[j] = true;
+                _map_size += (bytes + page - 1) / page * page;
+            }
+        }
+
+        if (_map_size > 0) {
+            std::string fname = scratch + "/skylark_transform_cache_XXXXXX";
+            int fd = mkstemp(&fname[0]);
+            if (fd >= 0) {
+                unlink(fname.c_str());
+                if (ftruncate(fd, _map_size) == 0)
+                    _map = mmap(NULL, _map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+                close(fd);
+            }
+            if (_map == MAP_FAILED)
+                SKYLARK_THROW_EXCEPTION (
+                    base::io_exception()
+                        << base::error_msg("Failed to map a scratch file in " +
+                            scratch));
+
+            for(size_t j = 0; j < _heights.size(); j++)
+                if (spill[j])
+                    _data[j] = static_cast<char *>(_map) + offsets[j];
+        }
+    }
+
+    ~transform_cache_t() {
+        if (_map != MAP_FAILED)
+            munmap(_map, _map_size);
+    }
+
+    /** Whether partition j is cached at all. */
+    bool cached(int j) const { return _data[j] != nullptr; }
+
+    /** Whether partition j is cached in memory (not in the scratch file). */
+    bool in_memory(int j) const { return !_memory[j].empty(); }
+
+    /** Bytes taken by partition j. */
+    size_t size(int j) const {
+        return size_t(_heights[j]) * _n * element_size();
+    }
+
+    void store(int j, const matrix_type &Z) {
+        const El::Int height = _heights[j];
+        char *data = _data[j];
+        const size_t column = height * element_size();
+        for(El::Int c = 0; c < _n; c++)
+            detail::cache_narrow(_precision, Z.LockedBuffer(0, c),
+                data + c * column, height);
+    }
+
+    /**
+     * Z := partition j. Cached in the native precision Z is a read-only view,
+     * otherwise it is widened into a (new) matrix.
+     */
+    void load(int j, matrix_type &Z) const {
+        const El::Int height = _heights[j];
+        if (_precision == CACHE_NATIVE) {
+            Z.LockedAttach(height, _n,
+                reinterpret_cast<const value_type *>(_data[j]), height);
+            return;
+        }
+
+        Z.Empty();
+        Z.Resize(height, _n);
+        const char *data = _data[j];
+        const size_t column = height * element_size();
+        for(El::Int c = 0; c < _n; c++)
+            detail::cache_widen(_precision, data + c * column,
+                Z.Buffer(0, c), height);
+    }
+
+private:
+    const std::vector<El::Int> _heights;
+    const El::Int _n;
+    transform_cache_precision_t _precision;
+    std::vector<char *> _data;
+    std::vector<std::vector<char> > _memory;
+    void *_map;
+    size_t _map_size;
+
+    size_t element_size() const {
+        switch (_precision) {
+        case CACHE_FLOAT:
+            return sizeof(float);
+        case CACHE_BFLOAT16:
+            return sizeof(uint16_t);
+        default:
+            return sizeof(value_type);
+        }
+    }
+
+    // No copies (the map is owned).
+    transform_cache_t(const transform_cache_t &);
+    transform_cache_t &operator=(const transform_cache_t &);
+};
+
+} } // namespace skylark::ml
+
+#endif // SKYLARK_ML_TRANSFORM_CACHE_HPP
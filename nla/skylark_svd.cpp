@@ -116,6 +116,58 @@ void execute(bool directory, const std::string &fname,
                   << " sec\n";
 }
 
+template<typename BlockType, typename FactorType>
+void execute_streaming(const std::string &fname, int k,
+    const skylark::nla::approximate_svd_params_t &params,
+    const std::string &prefix,
+    skylark::base::context_t &context) {
+
+    FactorType U, S, V;
+
+    boost::mpi::timer timer;
+
+#   if SKYLARK_HAVE_BOOST_FILESYSTEM
+
+    std::cout << "Scanning the input directory... ";
+    std::cout.flush();
+    timer.restart();
+
+    skylark::utility::io::libsvm_dir_block_reader_t<BlockType> reader(fname);
+
+    std::cout << "took " << boost::format("%.2e") % timer.elapsed()
+              << " sec (" << reader.num_blocks() << " blocks, width "
+              << reader.width() << ")\n";
+
+    std::cout << "Computing approximate SVD (streaming)...";
+    std::cout.flush();
+    timer.restart();
+
+    skylark::nla::StreamingApproximateSVD(reader, U, S, V, k, context, params);
+
+    std::cout <<"Took " << boost::format("%.2e") % timer.elapsed()
+              << " sec\n";
+
+#   else
+
+    SKYLARK_THROW_EXCEPTION(skylark::base::io_exception() <<
+        skylark::base::error_msg("Install Boost Filesystem for streaming "
+            "directory input!"));
+
+#   endif
+
+    /* Write results */
+    std::cout << "Writing results...";
+    std::cout.flush();
+    timer.restart();
+
+    El::Write(U, prefix + ".U", El::ASCII);
+    El::Write(S, prefix + ".S", El::ASCII);
+    El::Write(V, prefix + ".V", El::ASCII);
+
+    std::cout <<"took " << boost::format("%.2e") % timer.elapsed()
+              << " sec\n";
+}
+
 template<typename InputType, typename FactorType, typename UType = FactorType,
          typename YType = FactorType>
 void execute_sym(bool directory, const std::string &fname,
@@ -233,6 +285,7 @@ int main(int argc, char* argv[]) {
     int seed, k, powerits, port;
     std::string fname, ftype, prefix, hdfs;
     bool as_symmetric, as_sparse, skipqr, use_single, lower, directory;
+    bool streaming, singlepass;
     int oversampling_ratio, oversampling_additive;
     std::vector<int> profile;
     
@@ -248,6 +301,9 @@ int main(int argc, char* argv[]) {
             "Input file type (LIBSVM or ARC_LIST).")
         ("directory,d", "Whether inputfile is a directory of files whose"
             " concatination is the input.")
+        ("streaming", "With --directory: do not load the matrix, but stream"
+            " it from the files (one block per file) on every pass."
+            " Single process, non-symmetric only.")
         ("seed,s",
             bpo::value<int>(&seed)->default_value(38734),
             "Seed for random number generation. OPTIONAL.")
@@ -266,6 +322,9 @@ int main(int argc, char* argv[]) {
             "Number of power iterations. OPTIONAL.")
         ("skipqr", "Whether to skip QR in each iteration. Higher than one power"
             " iterations is not recommended in this mode.")
+        ("singlepass", "Sketch range and co-range of the matrix in a single"
+            " pass and reconstruct the SVD from the sketches. Power"
+            " iterations are ignored.")
         ("ratio,r",
             bpo::value<int>(&oversampling_ratio)->default_value(2),
             "Ratio of oversampling of rank. OPTIONAL.")
@@ -327,8 +386,10 @@ int main(int argc, char* argv[]) {
         as_symmetric = vm.count("symmetric");
         as_sparse = vm.count("sparse");
         skipqr = vm.count("skipqr");
+        singlepass = vm.count("singlepass");
         use_single = vm.count("single");
         directory = vm.count("directory");
+        streaming = vm.count("streaming");
         lower = vm.count("lower");
 
     } catch(bpo::error& e) {
@@ -344,13 +405,42 @@ int main(int argc, char* argv[]) {
 
     skylark::nla::approximate_svd_params_t params;
     params.skip_qr = skipqr;
+    params.single_pass = singlepass;
     params.num_iterations = powerits;
     params.oversampling_ratio = oversampling_ratio;
     params.oversampling_additive = oversampling_additive;
 
     SKYLARK_BEGIN_TRY()
 
-        if (size == 1) {
+        if (streaming) {
+            if (!directory || !hdfs.empty() || !profile.empty() ||
+                as_symmetric || size != 1)
+                SKYLARK_THROW_EXCEPTION(skylark::base::skylark_exception() <<
+                    skylark::base::error_msg("--streaming requires a "
+                        "--directory input, a single process, and a "
+                        "non-symmetric matrix."));
+
+            if (use_single) {
+                if (as_sparse)
+                    execute_streaming<skylark::base::sparse_matrix_t<float>,
+                                      El::Matrix<float> >(fname, k, params,
+                                          prefix, context);
+                else
+                    execute_streaming<El::Matrix<float>,
+                                      El::Matrix<float> >(fname, k, params,
+                                          prefix, context);
+            } else {
+                if (as_sparse)
+                    execute_streaming<skylark::base::sparse_matrix_t<double>,
+                                      El::Matrix<double> >(fname, k, params,
+                                          prefix, context);
+                else
+                    execute_streaming<El::Matrix<double>,
+                                      El::Matrix<double> >(fname, k, params,
+                                          prefix, context);
+            }
+
+        } else if (size == 1) {
             if (!as_symmetric) {
 
                 if (use_single) {
@@ -4,7 +4,10 @@
 #include <El.hpp>
 
 #include <algorithm>
+#include <future>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include "../utility/types.hpp"
 
@@ -18,11 +21,16 @@ namespace skylark { namespace nla {
  *   k = oversampling_ratio * r + oversampling_additive
  * num_iterations: number of power iteration to do
  * skip_qr: skip doing QR in every iteration (less accurate).
+ * single_pass: sketch the range and co-range of A in a single pass, and
+ *   reconstruct the factorization from the sketches only (A is not touched
+ *   again). num_iterations and skip_qr are ignored. Less accurate, but
+ *   useful when A is expensive to access.
  */
 struct approximate_svd_params_t : public base::params_t {
     int oversampling_ratio, oversampling_additive;
     int num_iterations;
     bool skip_qr;
+    bool single_pass;
 
     approximate_svd_params_t(int oversampling_ratio = 2,
         int oversampling_additive = 0,
@@ -32,11 +40,13 @@ struct approximate_svd_params_t : public base::params_t {
         int log_level = 0,
         std::ostream &log_stream = std::cout,
         std::string prefix = "",
-        int debug_level = 0) :
+        int debug_level = 0,
+        bool single_pass = false) :
         base::params_t(am_i_printing, log_level, log_stream, prefix, debug_level),
         oversampling_ratio(oversampling_ratio),
         oversampling_additive(oversampling_additive),
-        num_iterations(num_iterations), skip_qr(skip_qr) {}
+        num_iterations(num_iterations), skip_qr(skip_qr),
+        single_pass(single_pass) {}
 
     approximate_svd_params_t(const boost::property_tree::ptree& json)
         : params_t(json) {
@@ -44,6 +54,7 @@ struct approximate_svd_params_t : public base::params_t {
         oversampling_additive = json.get<int>("oversampling_additive");
         num_iterations = json.get<int>("num_iterations");
         skip_qr = json.get<bool>("skip_qr");
+        single_pass = json.get<bool>("single_pass", false);
     }
 };
 
@@ -218,6 +229,91 @@ void SymmetricPowerIteration(El::UpperOrLower uplo, El::Orientation vorientation
     }
 }
 
+namespace internal {
+
+/**
+ * Final step of the single-pass SVD: given an orthonormal basis Q (m x k)
+ * of the range sketch, the co-range sketch W = Psi A (l x n) and Psi Q,
+ * computes U, S, V of rank rank from X = (Psi Q)^+ W.
+ *
+ * V = X^T = W^T (Psi Q) ((Psi Q)^T (Psi Q))^{-1}.
+ */
+template <typename UType, typename SType, typename VType>
+void SinglePassReconstruct(UType &Q, const VType &W, const VType &PsiQ,
+    UType &U, SType &S, VType &V, int rank) {
+
+    typedef typename skylark::utility::typer_t<UType>::value_type
+        value_type;
+
+    int n = base::Width(W);
+    int k = base::Width(Q);
+
+    VType G(k, k);
+    V.Resize(n, k);
+    base::Gemm(El::ADJOINT, El::NORMAL, static_cast<value_type>(1.0),
+        PsiQ, PsiQ, G);
+    base::Gemm(El::ADJOINT, El::NORMAL, static_cast<value_type>(1.0),
+        W, PsiQ, V);
+    El::Cholesky(El::UPPER, G);
+    El::Trsm(El::RIGHT, El::UPPER, El::NORMAL, El::NON_UNIT,
+        static_cast<value_type>(1.0), G, V);
+    El::Trsm(El::RIGHT, El::UPPER, El::ADJOINT, El::NON_UNIT,
+        static_cast<value_type>(1.0), G, V);
+
+    /** Compute factorization & truncate to rank */
+    VType B;
+    El::SVD(V, V, S, B);
+    S.Resize(rank, 1); V.Resize(n, rank);
+    VType B1 = base::ColumnView(B, 0, rank);
+    base::Gemm(El::NORMAL, El::NORMAL,
+        static_cast<value_type>(1.0), Q, B1, U);
+}
+
+/**
+ * Single-pass approximate SVD (Tropp, Yurtsever, Udell and Cevher,
+ * "Practical sketching algorithms for low-rank matrix approximation", 2017).
+ *
+ * With JLTs Omega (k x n) and Psi (l x m), l = 2k + 1 (at most m), sketches
+ * Y = A Omega^T and W = Psi A are computed from A, after which A is not
+ * needed: with Q = orth(Y), A ~= Q X where X = (Psi Q)^+ W is the least
+ * squares solution, and the SVD of X gives the factorization. Since Psi Q is
+ * a well conditioned embedding of an orthonormal basis, X is computed from
+ * the normal equations.
+ */
+template <typename InputType, typename UType, typename SType, typename VType>
+void SinglePassApproximateSVD(const InputType &A, UType &U, SType &S,
+    VType &V, int rank, base::context_t& context,
+    const approximate_svd_params_t &params) {
+
+    int m = base::Height(A);
+    int n = base::Width(A);
+
+    int k = std::max(rank, std::min(std::min(m, n),
+            params.oversampling_ratio * rank +
+            params.oversampling_additive));
+    int l = std::min(m, 2 * k + 1);
+
+    /** The pass over A: range and co-range sketches */
+    UType Q(m, k);
+    sketch::JLT_t<InputType, UType> Omega(n, k, context);
+    Omega.apply(A, Q, sketch::rowwise_tag());
+
+    VType W(l, n);
+    sketch::JLT_t<InputType, VType> Psi(m, l, context);
+    Psi.apply(A, W, sketch::columnwise_tag());
+
+    /** Reconstruction from the sketches */
+    El::qr::ExplicitUnitary(Q);
+
+    VType PsiQ(l, k);
+    sketch::JLT_t<UType, VType> PsiU(Psi);
+    PsiU.apply(Q, PsiQ, sketch::columnwise_tag());
+
+    SinglePassReconstruct(Q, W, PsiQ, U, S, V, rank);
+}
+
+} // namespace internal
+
 template <typename InputType, typename UType, typename SType, typename VType>
 void ApproximateSVD(const InputType &A, UType &U, SType &S, VType &V,
     int rank, base::context_t& context,
@@ -245,6 +341,11 @@ void ApproximateSVD(const InputType &A, UType &U, SType &S, VType &V,
             << base::error_msg(err.str()));
     }
 
+    if (params.single_pass) {
+        internal::SinglePassApproximateSVD(A, U, S, V, rank, context, params);
+        return;
+    }
+
     /** Code for m >= n */
     if (m >= n) {
         int k = std::max(rank, std::min(n,
@@ -392,6 +493,216 @@ void ApproximateSymmetricSVD(El::UpperOrLower uplo,
 }
 
 
+namespace internal {
+
+/**
+ * Calls f(b, A_b) for the row blocks A_0, A_1, ... of the reader in order.
+ * Block b + 1 is read by a background thread while f works on block b, so
+ * that I/O and parsing overlap with computation (double buffering).
+ */
+template<typename BlockType, typename F>
+void StreamRowBlocks(utility::io::row_block_reader_t<BlockType>& reader,
+    F f) {
+
+    int nb = reader.num_blocks();
+    if (nb == 0)
+        return;
+
+    BlockType buffers[2];
+    reader.read(0, buffers[0]);
+
+    for(int b = 0; b < nb; b++) {
+        std::future<void> next;
+        if (b + 1 < nb) {
+            BlockType &nextbuf = buffers[(b + 1) % 2];
+            next = std::async(std::launch::async,
+                [&reader, &nextbuf, b]() { reader.read(b + 1, nextbuf); });
+        }
+
+        // If f throws, the future's destructor waits for the read.
+        f(b, static_cast<const BlockType&>(buffers[b % 2]));
+
+        if (next.valid())
+            next.get();
+    }
+}
+
+} // namespace internal
+
+/**
+ * Approximate SVD of a matrix that is streamed from a block reader instead
+ * of being held in memory, e.g. a directory of libsvm files.
+ *
+ * The algorithm is the one of ApproximateSVD for tall matrices: a Gaussian
+ * range finder of k columns on the row space, num_iterations rounds of
+ * (orthonormalized) power iteration, and an SVD of the k x n projection.
+ * Every multiplication by A or A^T is one pass over the blocks, for a total
+ * of 2 * num_iterations + 2 passes, with the next block read while the
+ * current one is multiplied. Only the sketches (m x k and n x k) are kept in
+ * memory, plus two blocks. With params.single_pass, the co-range sketch is
+ * accumulated in the first pass (see SinglePassApproximateSVD), and that
+ * pass is the only one.
+ *
+ * Works on local matrices: BlockType is El::Matrix or sparse_matrix_t, and
+ * U, S, V are El::Matrix. The number of rows m is the total height of the
+ * blocks; the width of every block must be reader.width().
+ *
+ * \param reader source of the row blocks of A.
+ * \param U,S,V on output A ~= U * diag(S) * V^T, of the given rank.
+ * \param rank target rank.
+ * \param context Skylark context.
+ * \param params parameters (as for ApproximateSVD).
+ */
+template <typename BlockType, typename UType, typename SType, typename VType>
+void StreamingApproximateSVD(
+    utility::io::row_block_reader_t<BlockType>& reader,
+    UType &U, SType &S, VType &V, int rank, base::context_t& context,
+    approximate_svd_params_t params = approximate_svd_params_t()) {
+
+    typedef typename skylark::utility::typer_t<BlockType>::value_type
+        value_type;
+    typedef El::Matrix<value_type> matrix_type;
+
+    bool log_lev1 = params.am_i_printing && params.log_level >= 1;
+
+    int nb = reader.num_blocks();
+    int n = reader.width();
+    int k = std::max(rank, std::min(n,
+            params.oversampling_ratio * rank +
+            params.oversampling_additive));
+
+    /** First pass: Y = A * Omega, block by block; this also finds m. */
+    matrix_type Omega;
+    base::GaussianMatrix(Omega, n, k, context);
+
+    // For a single pass, also W = Psi * A. The height of A is not known
+    // in advance, so Psi(i, r) is entry r * l + i of a random array (with
+    // room for any int number of rows), and Psi_b is regenerated when needed.
+    int l = 2 * k + 1;
+    boost::random::normal_distribution<value_type> psi_dist;
+    auto Psi = context.allocate_random_samples_array(
+        params.single_pass ?
+        static_cast<size_t>(l) * std::numeric_limits<int>::max() : 0,
+        psi_dist);
+    auto Psi_block = [&](int row, int height, matrix_type& Psib) {
+        Psib.Resize(l, height, l);
+        Psi.fill(static_cast<size_t>(row) * l, static_cast<size_t>(l) * height,
+            Psib.Buffer());
+    };
+
+    matrix_type W;
+    if (params.single_pass)
+        El::Zeros(W, l, n);
+
+    std::vector<matrix_type> Yb(nb);
+    std::vector<int> offsets(nb + 1, 0);
+    internal::StreamRowBlocks(reader,
+        [&](int b, const BlockType& Ab) {
+            if (base::Width(Ab) != n) {
+                std::stringstream err;
+                err << "Row block " << b << " has " << base::Width(Ab)
+                    << " columns instead of " << n;
+                SKYLARK_THROW_EXCEPTION(base::skylark_exception()
+                    << base::error_msg(err.str()));
+            }
+            base::Gemm(El::NORMAL, El::NORMAL, static_cast<value_type>(1.0),
+                Ab, Omega, Yb[b]);
+            offsets[b + 1] = offsets[b] + base::Height(Ab);
+
+            if (params.single_pass) {
+                matrix_type Psib;
+                Psi_block(offsets[b], base::Height(Ab), Psib);
+                base::Gemm(El::NORMAL, El::NORMAL,
+                    static_cast<value_type>(1.0), Psib, Ab,
+                    static_cast<value_type>(1.0), W);
+            }
+        });
+
+    int m = offsets[nb];
+    if (rank > std::min(m, n)) {
+        std::stringstream err;
+        err << "Incompatible matrix dimensions (" << std::min(m, n)
+            << ") and target rank (" << rank << ")";
+        if (log_lev1)
+            params.log_stream << err.str() << std::endl;
+        SKYLARK_THROW_EXCEPTION(base::skylark_exception()
+            << base::error_msg(err.str()));
+    }
+
+    matrix_type Y(m, k), Yv;
+    for(int b = 0; b < nb; b++) {
+        El::View(Yv, Y, offsets[b], 0, offsets[b + 1] - offsets[b], k);
+        El::Copy(Yb[b], Yv);
+        Yb[b].Empty();
+    }
+
+    if (params.single_pass) {
+        /** Reconstruction from the sketches, A is not read again. */
+        El::qr::ExplicitUnitary(Y);
+
+        matrix_type PsiQ, Psib;
+        El::Zeros(PsiQ, l, k);
+        for(int b = 0; b < nb; b++) {
+            El::LockedView(Yv, Y, offsets[b], 0,
+                offsets[b + 1] - offsets[b], k);
+            Psi_block(offsets[b], offsets[b + 1] - offsets[b], Psib);
+            base::Gemm(El::NORMAL, El::NORMAL, static_cast<value_type>(1.0),
+                Psib, Yv, static_cast<value_type>(1.0), PsiQ);
+        }
+
+        internal::SinglePassReconstruct(Y, W, PsiQ, U, S, V, rank);
+        return;
+    }
+
+    /** W = A^T * Y and Y = A * W, one pass each. */
+    W.Resize(n, k);
+    auto multiply_adjoint = [&]() {
+        El::Zero(W);
+        internal::StreamRowBlocks(reader,
+            [&](int b, const BlockType& Ab) {
+                matrix_type Yv;
+                El::LockedView(Yv, Y, offsets[b], 0,
+                    offsets[b + 1] - offsets[b], k);
+                base::Gemm(El::ADJOINT, El::NORMAL,
+                    static_cast<value_type>(1.0), Ab, Yv,
+                    static_cast<value_type>(1.0), W);
+            });
+    };
+
+    auto multiply = [&]() {
+        internal::StreamRowBlocks(reader,
+            [&](int b, const BlockType& Ab) {
+                matrix_type Yv;
+                El::View(Yv, Y, offsets[b], 0,
+                    offsets[b + 1] - offsets[b], k);
+                base::Gemm(El::NORMAL, El::NORMAL,
+                    static_cast<value_type>(1.0), Ab, W,
+                    static_cast<value_type>(0.0), Yv);
+            });
+    };
+
+    /** Power iteration */
+    for(int i = 0; i < params.num_iterations; i++) {
+        if (!params.skip_qr) El::qr::ExplicitUnitary(Y);
+        multiply_adjoint();
+        if (!params.skip_qr) El::qr::ExplicitUnitary(W);
+        multiply();
+    }
+
+    /** Project: W = A^T Q, factorize & truncate to rank */
+    El::qr::ExplicitUnitary(Y);
+    multiply_adjoint();
+
+    matrix_type B;
+    El::SVD(W, W, S, B);
+    S.Resize(rank, 1);
+    W.Resize(n, rank);
+    El::Copy(W, V);
+    matrix_type B1 = base::ColumnView(B, 0, rank);
+    base::Gemm(El::NORMAL, El::NORMAL, static_cast<value_type>(1.0), Y, B1, U);
+}
+
+
 /*******  ANY variants ********/
 void ApproximateSymmetricSVD(El::UpperOrLower uplo,
     const boost::any &A, const boost::any &V, const boost::any &S, int rank,
@@ -15,6 +15,7 @@ class SVDParams(base.Params):
         self.oversampling_additive = 0
         self.num_iterations = 2
         self.skip_qr = False
+        self.single_pass = False
 
 class FasterLeastSquaresParams(base.Params):
     """ 
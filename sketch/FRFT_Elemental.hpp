@@ -1,6 +1,8 @@
 #ifndef SKYLARK_FRFT_ELEMENTAL_HPP
 #define SKYLARK_FRFT_ELEMENTAL_HPP
 
+#include "cosine_features.hpp"
+
 namespace skylark {
 namespace sketch {
 
@@ -8,18 +10,20 @@ namespace sketch {
 
 /**
  * Specialization local input (sparse of dense), local output.
- * InputType should either be El::Matrix, or base:spare_matrix_t.
+ * InputType should either be El::Matrix, or base:spare_matrix_t (of any
+ * index type, hence the InputArgs).
  */
 template <typename ValueType,
-          template <typename> class InputType>
+          template <typename...> class InputType,
+          typename... InputArgs>
 struct FastRFT_t <
-    InputType<ValueType>,
+    InputType<ValueType, InputArgs...>,
     El::Matrix<ValueType> > :
         public FastRFT_data_t {
     // Typedef value, matrix, transform, distribution and transform data types
     // so that we can use them regularly and consistently.
     typedef ValueType value_type;
-    typedef InputType<value_type> matrix_type;
+    typedef InputType<value_type, InputArgs...> matrix_type;
     typedef El::Matrix<value_type> output_matrix_type;
     typedef FastRFT_data_t data_type;
 
@@ -129,28 +133,8 @@ private:
                 El::DiagonalScale(El::LEFT, El::NORMAL, Sm, W);
 
                 value_type *sac = sa + ldsa * c;
-                for(int l = s; l < e; l++) {
-                    value_type x = w[l - s];
-                    x += data_type::shifts[l];
-
-#                   ifndef SKYLARK_INEXACT_COSINE
-                    x = std::cos(x);
-#                   else
-                    // x = std::cos(x) is slow
-                    // Instead use low-accuracy approximation
-                    if (x < -3.14159265) x += 6.28318531;
-                    else if (x >  3.14159265) x -= 6.28318531;
-                    x += 1.57079632;
-                    if (x >  3.14159265)
-                        x -= 6.28318531;
-                    x = (x < 0) ?
-                        1.27323954 * x + 0.405284735 * x * x :
-                        1.27323954 * x - 0.405284735 * x * x;
-#                   endif
-
-                    x = data_type::scale * x;
-                    sac[l] = x;
-                }
+                internal::cosine_features(w, sac + s, e - s, nullptr,
+                    data_type::shifts.data() + s, 1, data_type::scale);
             }
         }
 
@@ -218,29 +202,8 @@ private:
             view_sketch_of_A = view_W;
         }
 
-        for(int j = 0; j < data_type::_S; j++)
-            for(int i = 0; i < base::Height(A); i++) {
-                value_type x = sketch_of_A.Get(i, j);
-                x += data_type::shifts[j];
-
-#               ifndef SKYLARK_INEXACT_COSINE
-                x = std::cos(x);
-#               else
-                // x = std::cos(x) is slow
-                // Instead use low-accuracy approximation
-                if (x < -3.14159265) x += 6.28318531;
-                else if (x >  3.14159265) x -= 6.28318531;
-                x += 1.57079632;
-                if (x >  3.14159265)
-                    x -= 6.28318531;
-                x = (x < 0) ?
-                    1.27323954 * x + 0.405284735 * x * x :
-                    1.27323954 * x - 0.405284735 * x * x;
-#               endif
-
-                x = data_type::scale * x;
-                sketch_of_A.Set(i, j, x);
-            }
+        CosineFeatures(sketch_of_A, nullptr, data_type::shifts.data(),
+            0, 1, data_type::scale, tag);
     }
 
 private:
@@ -5,6 +5,12 @@
 #error "Include top-level sketch.hpp instead of including individuals headers"
 #endif
 
+#if SKYLARK_HAVE_FFTW || SKYLARK_HAVE_FFTWF
+#include "../utility/fft/fftw_plan_cache.hpp"
+#ifdef SKYLARK_HAVE_OPENMP
+#include <omp.h>
+#endif
+#endif
 
 namespace skylark { namespace sketch {
 
@@ -24,21 +24,12 @@ struct fftw<double> {
     typedef fftw_complex complex_t;
     typedef fftw_plan plan_t;
 
-    typedef plan_t (*fplanfun_t)(int, double*, complex_t*, unsigned);
-    static fplanfun_t fplanfun;
-    typedef plan_t (*bplanfun_t)(int, complex_t*, double*, unsigned);
-    static bplanfun_t bplanfun;
-    typedef void (*destroyfun_t)(plan_t);
-    static destroyfun_t destroyfun;
     typedef void (*executeffun_t)(plan_t, double*, complex_t*);
     static executeffun_t executeffun;
     typedef void (*executebfun_t)(plan_t, complex_t*, double*);
     static executebfun_t executebfun;
 };
 
-fftw<double>::fplanfun_t fftw<double>::fplanfun = fftw_plan_dft_r2c_1d;
-fftw<double>::bplanfun_t fftw<double>::bplanfun = fftw_plan_dft_c2r_1d;
-fftw<double>::destroyfun_t fftw<double>::destroyfun = fftw_destroy_plan;
 fftw<double>::executeffun_t fftw<double>::executeffun = fftw_execute_dft_r2c;
 fftw<double>::executebfun_t fftw<double>::executebfun = fftw_execute_dft_c2r;
 
@@ -50,21 +41,12 @@ struct fftw<float> {
     typedef fftwf_complex complex_t;
     typedef fftwf_plan plan_t;
 
-    typedef plan_t (*fplanfun_t)(int, float*, complex_t*, unsigned);
-    static fplanfun_t fplanfun;
-    typedef plan_t (*bplanfun_t)(int, complex_t*, float*, unsigned);
-    static bplanfun_t bplanfun;
-    typedef void (*destroyfun_t)(plan_t);
-    static destroyfun_t destroyfun;
     typedef void (*executeffun_t)(plan_t, float*, complex_t*);
     static executeffun_t executeffun;
     typedef void (*executebfun_t)(plan_t, complex_t*, float*);
     static executebfun_t executebfun;
 };
 
-fftw<float>::fplanfun_t fftw<float>::fplanfun = fftwf_plan_dft_r2c_1d;
-fftw<float>::bplanfun_t fftw<float>::bplanfun = fftwf_plan_dft_c2r_1d;
-fftw<float>::destroyfun_t fftw<float>::destroyfun = fftwf_destroy_plan;
 fftw<float>::executeffun_t fftw<float>::executeffun = fftwf_execute_dft_r2c;
 fftw<float>::executebfun_t fftw<float>::executebfun = fftwf_execute_dft_c2r;
 
@@ -120,10 +102,6 @@ struct PPT_t <
         build_internal();
     }
 
-    ~PPT_t() {
-        internal::fftw<value_type>::destroyfun(_fftw_fplan);
-        internal::fftw<value_type>::destroyfun(_fftw_bplan);
-    }
 
     /**
      * Apply columnwise the sketching transform that is described by the
@@ -272,42 +250,28 @@ protected:
             it != data_type::_cwts_data.end(); it++)
             _cwts.push_back(_CWT_t(*it));
 
-        value_type *dtmp = new value_type[S];
-        std::complex<value_type> *ctmp = new std::complex<value_type>[S];
-
-#       ifdef SKYLARK_HAVE_OPENMP
-#       pragma omp critical
-#       endif
-        {
-
-        _fftw_fplan = internal::fftw<value_type>::fplanfun(S, dtmp,
-            reinterpret_cast<_fftw_complex_t*>(ctmp),
-            FFTW_UNALIGNED | FFTW_ESTIMATE);
-        _fftw_bplan = internal::fftw<value_type>::bplanfun(S,
-            reinterpret_cast<_fftw_complex_t*>(ctmp), dtmp,
-            FFTW_UNALIGNED | FFTW_ESTIMATE);
-
-        }
-
-        delete[] dtmp;
-        delete[] ctmp;
-
+        // Plans are owned by the (process-wide) plan cache.
+        internal::fftw_plan_cache_t<value_type> &cache =
+            internal::fftw_plan_cache_t<value_type>::instance();
+        _fftw_fplan = cache.r2c(S, false);
+        _fftw_bplan = cache.c2r(S, false);
     }
 };
 
 /**
  * Specialization for sparse local to local.
  */
-template<typename ValueType>
+template<typename ValueType, typename IndexType>
 struct PPT_t <
-    base::sparse_matrix_t<ValueType>,
+    base::sparse_matrix_t<ValueType, IndexType>,
     El::Matrix<ValueType> > :
         public PPT_data_t,
-        virtual public sketch_transform_t<base::sparse_matrix_t<ValueType>,
-                                          El::Matrix<ValueType> >{
+        virtual public sketch_transform_t<
+            base::sparse_matrix_t<ValueType, IndexType>,
+            El::Matrix<ValueType> >{
 
     typedef ValueType value_type;
-    typedef base::sparse_matrix_t<value_type> matrix_type;
+    typedef base::sparse_matrix_t<value_type, IndexType> matrix_type;
     typedef El::Matrix<value_type> output_matrix_type;
 
     typedef PPT_data_t data_type;
@@ -345,10 +309,6 @@ struct PPT_t <
         build_internal();
     }
 
-    ~PPT_t() {
-        internal::fftw<value_type>::destroyfun(_fftw_fplan);
-        internal::fftw<value_type>::destroyfun(_fftw_bplan);
-    }
     /**
      * Apply columnwise the sketching transform that is described by the
      * the transform with output sketch_of_A.
@@ -379,7 +339,7 @@ struct PPT_t <
 #       ifdef SKYLARK_HAVE_OPENMP
 #       pragma omp for
 #       endif
-        for(int i = 0; i < base::Width(A); i++) {
+        for(El::Int i = 0; i < base::Width(A); i++) {
             const matrix_type Av = base::ColumnView(A, i, 1);
 
             for(int j = 0; j < S; j++)
@@ -403,7 +363,7 @@ struct PPT_t <
             for(int j = 0; j < S; j++)
                 P[j] /= (value_type)S;
 
-            El::View(SAv, sketch_of_A, 0, i, base::Height(A), 1);
+            El::View(SAv, sketch_of_A, 0, i, S, 1);
             internal::fftw<value_type>::executebfun(_fftw_bplan,
                 reinterpret_cast<_fftw_complex_t*>(P), SAv.Buffer());
         }
@@ -421,11 +381,9 @@ struct PPT_t <
     void apply (const matrix_type& A,
                 output_matrix_type& sketch_of_A,
                 rowwise_tag dimension) const {
-        // TODO perhaps not the best way to do this...
-        matrix_type AT;
-        base::Transpose(A, AT);
+        // The columnwise transform on the (cached) CSR companion of A.
         output_matrix_type SAT(sketch_of_A.Width(), sketch_of_A.Height());
-        apply(AT, SAT, columnwise_tag());
+        apply(A.transposed(), SAT, columnwise_tag());
         El::Transpose(SAT, sketch_of_A);
     }
 
@@ -451,25 +409,11 @@ protected:
             it != data_type::_cwts_data.end(); it++)
             _cwts.push_back(_CWT_t(*it));
 
-        value_type *dtmp = new value_type[S];
-        std::complex<value_type> *ctmp = new std::complex<value_type>[S];
-
-#       ifdef SKYLARK_HAVE_OPENMP
-#       pragma omp critical
-#       endif
-        {
-
-        _fftw_fplan = internal::fftw<value_type>::fplanfun(S, dtmp,
-            reinterpret_cast<_fftw_complex_t*>(ctmp),
-            FFTW_UNALIGNED | FFTW_ESTIMATE);
-        _fftw_bplan = internal::fftw<value_type>::bplanfun(S,
-            reinterpret_cast<_fftw_complex_t*>(ctmp), dtmp,
-            FFTW_UNALIGNED | FFTW_ESTIMATE);
-
-        }
-
-        delete[] dtmp;
-        delete[] ctmp;
+        // Plans are owned by the (process-wide) plan cache.
+        internal::fftw_plan_cache_t<value_type> &cache =
+            internal::fftw_plan_cache_t<value_type>::instance();
+        _fftw_fplan = cache.r2c(S, false);
+        _fftw_bplan = cache.c2r(S, false);
     }
 };
 
@@ -88,9 +88,12 @@ protected:
             underlying_data_type(base_t::_N, base_t::_S, _inscale,
                 _sequence, _skip, ctx));
 
+        // The shifts are the last coordinate of the points.
         const double pi = boost::math::constants::pi<double>();
+        _sequence.fill(_skip, base_t::_S, base_t::_N, base_t::_N + 1,
+            _shifts.data());
         for(int i = 0; i < base_t::_S; i++)
-            _shifts[i] =  2 * pi * _sequence.coordinate(_skip + i, base_t::_N);
+            _shifts[i] *=  2 * pi;
 
         return ctx;
     }
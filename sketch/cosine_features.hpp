@@ -0,0 +1,236 @@
+#ifndef SKYLARK_COSINE_FEATURES_HPP
+#define SKYLARK_COSINE_FEATURES_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+#include "sketch_params.hpp"
+
+namespace skylark { namespace sketch {
+
+namespace internal {
+
+/// Arguments are processed in blocks of this size, small enough to stay in
+/// L1 and large enough for the vector loops.
+static const size_t cosine_block_size = 256;
+
+/// Beyond this the three part Cody-Waite reduction looses accuracy, and
+/// std::cos is used instead.
+static const double cosine_reduction_limit = 1e5;
+
+/**
+ * Polynomial approximation of cos for the COSINE_ACCURATE and COSINE_FAST
+ * levels. Branch-free, so that the loop vectorizes (SSE/AVX2/AVX-512,
+ * depending on what the compiler targets).
+ *
+ * Reduction is x = k * pi / 2 + r, |r| <= pi / 4, then cos(x) is +-cos(r)
+ * or +-sin(r) depending on k mod 4. The minimax coefficients are those of
+ * fdlibm's kernel_sin/kernel_cos; the fast level truncates them.
+ *
+ * Arguments have to be below cosine_reduction_limit in magnitude.
+ *
+ * \param y arguments (overwritten)
+ * \param n number of arguments
+ */
+template<bool Accurate>
+void cosine_poly(double *y, size_t n) {
+
+    const double two_over_pi = 6.36619772367581382433e-01;
+    const double pio2_1 = 1.57079632673412561417e+00;
+    const double pio2_2 = 6.07710050630396597660e-11;
+    const double pio2_3 = 2.02226624871116645580e-21;
+
+    const double S1 = -1.66666666666666324348e-01;
+    const double S2 =  8.33333333332248946124e-03;
+    const double S3 = -1.98412698298579493134e-04;
+    const double S4 =  2.75573137070700676789e-06;
+    const double S5 = -2.50507602534068634195e-08;
+    const double S6 =  1.58969099521155010221e-10;
+
+    const double C1 =  4.16666666666666019037e-02;
+    const double C2 = -1.38888888888741095749e-03;
+    const double C3 =  2.48015872894767294178e-05;
+    const double C4 = -2.75573143513906633035e-07;
+    const double C5 =  2.08757232129817482790e-09;
+    const double C6 = -1.13596475577881948265e-11;
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp simd
+#   endif
+    for(size_t k = 0; k < n; k++) {
+        double x = y[k];
+        double q = std::floor(x * two_over_pi + 0.5);
+        double r = ((x - q * pio2_1) - q * pio2_2) - q * pio2_3;
+        double z = r * r;
+
+        double ps = Accurate ? S3 + z * (S4 + z * (S5 + z * S6)) : S3;
+        double pc = Accurate ? C3 + z * (C4 + z * (C5 + z * C6)) : C3;
+        double s = r + r * z * (S1 + z * (S2 + z * ps));
+        double c = 1.0 - 0.5 * z + z * z * (C1 + z * (C2 + z * pc));
+
+        // k mod 4 = 0: c, 1: -s, 2: -c, 3: s
+        int qi = static_cast<int>(q);
+        double v = (qi & 1) ? s : c;
+        y[k] = ((qi + 1) & 2) ? -v : v;
+    }
+}
+
+/**
+ * The low-accuracy parabola approximation formerly enabled by the
+ * SKYLARK_INEXACT_COSINE macro. Valid for |x| <= 3 pi only.
+ */
+inline void cosine_coarse(double *y, size_t n) {
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp simd
+#   endif
+    for(size_t k = 0; k < n; k++) {
+        double x = y[k];
+        x = (x < -3.14159265) ? x + 6.28318531 :
+            ((x > 3.14159265) ? x - 6.28318531 : x);
+        x += 1.57079632;
+        x = (x > 3.14159265) ? x - 6.28318531 : x;
+        y[k] = (x < 0) ?
+            1.27323954 * x + 0.405284735 * x * x :
+            1.27323954 * x - 0.405284735 * x * x;
+    }
+}
+
+/**
+ * y[k] = scales[k * stride] * in[k] + shifts[k * stride], with the common
+ * strides (0 and 1) as separate loops so they vectorize.
+ *
+ * \returns max |y[k]|.
+ */
+template<typename T>
+double cosine_arguments(const T *in, double *y, size_t n,
+    const double *scales, const double *shifts, size_t stride) {
+
+    double amax = 0.0;
+
+    if (stride == 0) {
+        double sc = (scales != nullptr) ? scales[0] : 1.0, sh = shifts[0];
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp simd reduction(max:amax)
+#       endif
+        for(size_t k = 0; k < n; k++) {
+            y[k] = sc * in[k] + sh;
+            double a = std::abs(y[k]);
+            amax = (a > amax) ? a : amax;
+        }
+    } else if (stride == 1 && scales != nullptr) {
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp simd reduction(max:amax)
+#       endif
+        for(size_t k = 0; k < n; k++) {
+            y[k] = scales[k] * in[k] + shifts[k];
+            double a = std::abs(y[k]);
+            amax = (a > amax) ? a : amax;
+        }
+    } else {
+        for(size_t k = 0; k < n; k++) {
+            double sc = (scales != nullptr) ? scales[k * stride] : 1.0;
+            y[k] = sc * in[k] + shifts[k * stride];
+            double a = std::abs(y[k]);
+            amax = (a > amax) ? a : amax;
+        }
+    }
+
+    return amax;
+}
+
+/**
+ * out[k] = outscale * cos(scales[k * stride] * in[k] + shifts[k * stride])
+ * for k < n. A stride of 0 uses the same scale/shift for all entries, and
+ * scales can be nullptr (no scaling). in and out may be the same.
+ */
+template<typename T>
+void cosine_features(const T *in, T *out, size_t n,
+    const double *scales, const double *shifts, size_t stride,
+    double outscale) {
+
+    const cosine_accuracy_t accuracy = get_cosine_accuracy();
+    double y[cosine_block_size];
+
+    for(size_t s = 0; s < n; s += cosine_block_size) {
+        size_t b = std::min(cosine_block_size, n - s);
+
+        double amax = cosine_arguments(in + s, y, b,
+            scales == nullptr ? nullptr : scales + s * stride,
+            shifts + s * stride, stride);
+
+        if (accuracy == COSINE_EXACT || amax > cosine_reduction_limit) {
+            for(size_t k = 0; k < b; k++)
+                y[k] = std::cos(y[k]);
+        } else if (accuracy == COSINE_ACCURATE)
+            cosine_poly<true>(y, b);
+        else if (accuracy == COSINE_FAST)
+            cosine_poly<false>(y, b);
+        else
+            cosine_coarse(y, b);
+
+        T *outb = out + s;
+        for(size_t k = 0; k < b; k++)
+            outb[k] = outscale * y[k];
+    }
+}
+
+} // namespace internal
+
+/**
+ * Apply the random features non-linearity to a (local part of a) sketch:
+ * X(i, j) = outscale * cos(scale * X(i, j) + shift), in place.
+ *
+ * Columnwise, the scale/shift of row i are at offset + i * stride in
+ * scales/shifts, rowwise those of column j. scales can be nullptr.
+ * Work is split over columns and row blocks.
+ */
+template<typename T>
+void CosineFeatures(El::Matrix<T>& X,
+    const double *scales, const double *shifts,
+    size_t offset, size_t stride, double outscale, columnwise_tag) {
+
+    const El::Int m = X.Height(), n = X.Width(), ld = X.LDim();
+    const El::Int bs = internal::cosine_block_size;
+    const El::Int nb = (m + bs - 1) / bs;
+    T *data = X.Buffer();
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for schedule(static)
+#   endif
+    for(El::Int t = 0; t < n * nb; t++) {
+        El::Int j = t / nb, s = (t % nb) * bs;
+        T *x = data + j * ld + s;
+        internal::cosine_features(x, x, std::min(bs, m - s),
+            scales == nullptr ? nullptr : scales + offset + s * stride,
+            shifts + offset + s * stride, stride, outscale);
+    }
+}
+
+template<typename T>
+void CosineFeatures(El::Matrix<T>& X,
+    const double *scales, const double *shifts,
+    size_t offset, size_t stride, double outscale, rowwise_tag) {
+
+    const El::Int m = X.Height(), n = X.Width(), ld = X.LDim();
+    const El::Int bs = internal::cosine_block_size;
+    const El::Int nb = (m + bs - 1) / bs;
+    T *data = X.Buffer();
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for schedule(static)
+#   endif
+    for(El::Int t = 0; t < n * nb; t++) {
+        El::Int j = t / nb, s = (t % nb) * bs;
+        T *x = data + j * ld + s;
+        size_t idx = offset + j * stride;
+        internal::cosine_features(x, x, std::min(bs, m - s),
+            scales == nullptr ? nullptr : scales + idx,
+            shifts + idx, 0, outscale);
+    }
+}
+
+} } /** namespace skylark::sketch */
+
+#endif // SKYLARK_COSINE_FEATURES_HPP
@@ -11,21 +11,145 @@
 
 namespace skylark { namespace sketch {
 
+namespace internal {
+
+/**
+ * Number of columns of an S x N dense transform that fit in a panel, given
+ * the memory budget (see params::panel_memory). If overlap is requested two
+ * panels have to fit.
+ */
+template<typename ValueType>
+int dense_panel_width(int S, int N, bool overlap) {
+    size_t budget = get_panel_memory();
+    if (budget == 0 || S == 0)
+        return N;
+
+    size_t column_bytes = static_cast<size_t>(S) * sizeof(ValueType);
+    if (overlap)
+        column_bytes *= 2;
+
+    size_t width = budget / column_bytes;
+    return static_cast<int>(std::max(size_t(1),
+            std::min(width, static_cast<size_t>(N))));
+}
+
+/**
+ * sketch_of_A = R A[n, n + b) + beta sketch_of_A, with R the S x b panel of
+ * the transform and A[n, n + b) the matching rows (columnwise) or columns
+ * (rowwise) of A.
+ * Rows of a sparse matrix are taken from its CSR companion, which is built
+ * (and kept) on the first panel.
+ */
+template<typename ValueType>
+void dense_panel_gemm(const El::Matrix<ValueType>& R,
+    const El::Matrix<ValueType>& A, int n, int b, ValueType beta,
+    El::Matrix<ValueType>& sketch_of_A, columnwise_tag) {
+
+    base::Gemm(El::NORMAL, El::NORMAL, ValueType(1), R,
+        base::RowView(A, n, b), beta, sketch_of_A);
+}
+
+template<typename ValueType, typename IndexType>
+void dense_panel_gemm(const El::Matrix<ValueType>& R,
+    const base::sparse_matrix_t<ValueType, IndexType>& A, int n, int b,
+    ValueType beta, El::Matrix<ValueType>& sketch_of_A, columnwise_tag) {
+
+    base::Gemm(El::NORMAL, El::TRANSPOSE, ValueType(1), R,
+        base::ColumnView(A.transposed(), n, b), beta, sketch_of_A);
+}
+
+template<typename InputMatrixType, typename ValueType>
+void dense_panel_gemm(const El::Matrix<ValueType>& R,
+    const InputMatrixType& A, int n, int b, ValueType beta,
+    El::Matrix<ValueType>& sketch_of_A, rowwise_tag) {
+
+    base::Gemm(El::NORMAL, El::TRANSPOSE, ValueType(1),
+        base::ColumnView(A, n, b), R, beta, sketch_of_A);
+}
+
+/**
+ * Apply a dense transform to a local matrix.
+ *
+ * By default the whole S x N transform is realized for a single Gemm. With
+ * a memory budget (params::panel_memory) the transform is realized in
+ * panels of columns [n, n + b), and each is multiplied with the matching
+ * rows (columnwise) or columns (rowwise) of A, accumulating into the
+ * sketch; so A is still read only once.
+ *
+ * With overlap, the next panel is realized in one thread while the current
+ * one is multiplied.
+ *
+ * sketch_of_A has to be of the correct size.
+ */
+template<typename TransformType, typename InputMatrixType, typename ValueType,
+         typename Dimension>
+void dense_panel_apply(const TransformType& transform,
+    const InputMatrixType& A, El::Matrix<ValueType>& sketch_of_A,
+    Dimension dimension) {
+
+    const int S = transform.get_S();
+    const int N = transform.get_N();
+    const bool overlap = get_panel_overlap();
+    const int width = dense_panel_width<ValueType>(S, N, overlap);
+
+    El::Matrix<ValueType> R[2];
+    int cur = 0;
+    transform.realize_matrix_view(R[cur], 0, 0, S, std::min(width, N));
+
+    for(int n = 0; n < N; n += width) {
+        int b = std::min(width, N - n);
+        int next = n + b;
+        int bn = std::min(width, N - next);
+
+        int nxt = overlap ? 1 - cur : cur;
+        ValueType beta = n == 0 ? ValueType(0) : ValueType(1);
+
+        if (overlap && bn > 0) {
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp parallel sections num_threads(2)
+#           endif
+            {
+#               ifdef SKYLARK_HAVE_OPENMP
+#               pragma omp section
+#               endif
+                dense_panel_gemm(R[cur], A, n, b, beta, sketch_of_A,
+                    dimension);
+
+#               ifdef SKYLARK_HAVE_OPENMP
+#               pragma omp section
+#               endif
+                transform.realize_matrix_view(R[nxt], 0, next, S, bn);
+            }
+        } else {
+            dense_panel_gemm(R[cur], A, n, b, beta, sketch_of_A,
+                    dimension);
+            if (bn > 0)
+                transform.realize_matrix_view(R[nxt], 0, next, S, bn);
+        }
+
+        cur = nxt;
+    }
+}
+
+} // namespace internal
+
 /**
  * Specialization local input (sparse of dense), local output.
- * InputType should either be El::Matrix, or base:sparse_matrix_t.
+ * InputType should either be El::Matrix, or base:sparse_matrix_t (of any
+ * index type, hence the InputArgs).
  */
 template <typename ValueType,
-          template <typename> class InputType,
+          template <typename...> class InputType,
+          typename... InputArgs,
           typename ValuesAccessor>
 struct dense_transform_t <
-    InputType<ValueType>,
+    InputType<ValueType, InputArgs...>,
     El::Matrix<ValueType>,
     ValuesAccessor> :
         public dense_transform_data_t<ValuesAccessor> {
 
     typedef ValueType value_type;
-    typedef InputType<value_type> matrix_type;
+    typedef InputType<value_type, InputArgs...> matrix_type;
     typedef El::Matrix<value_type> output_matrix_type;
     typedef dense_transform_data_t<ValuesAccessor> data_type;
 
@@ -75,39 +199,12 @@ struct dense_transform_t <
 
 private:
 
-    // TODO: Block-by-block mode
+    template <typename Dimension>
     void apply_impl_local (const matrix_type& A,
                           output_matrix_type& sketch_of_A,
-                          skylark::sketch::rowwise_tag tag) const {
-
-        output_matrix_type R;
-        data_type::realize_matrix_view(R);
-
-        base::Gemm (El::NORMAL,
-                    El::TRANSPOSE,
-                    value_type(1),
-                    A,
-                    R,
-                    value_type(0),
-                    sketch_of_A);
-    }
-
+                          Dimension dimension) const {
 
-    // TODO: Block-by-block mode
-    void apply_impl_local (const matrix_type& A,
-                          output_matrix_type& sketch_of_A,
-                          skylark::sketch::columnwise_tag tag) const {
-
-        output_matrix_type R;
-        data_type::realize_matrix_view(R);
-
-        base::Gemm (El::NORMAL,
-                    El::NORMAL,
-                    value_type(1),
-                    R,
-                    A,
-                    value_type(0),
-                    sketch_of_A);
+        internal::dense_panel_apply(*this, A, sketch_of_A, dimension);
     }
 };
 
@@ -170,39 +267,13 @@ struct dense_transform_t <
 
 private:
 
-    // TODO: Block-by-block mode
+    template <typename Dimension>
     void apply_impl_local (const matrix_type& A,
                           output_matrix_type& sketch_of_A,
-                          skylark::sketch::rowwise_tag tag) const {
-
-        El::Matrix<ValueType> R;
-        data_type::realize_matrix_view(R);
-
-        base::Gemm (El::NORMAL,
-                    El::TRANSPOSE,
-                    value_type(1),
-                    A.LockedMatrix(),
-                    R,
-                    value_type(0),
-                    sketch_of_A.Matrix());
-    }
+                          Dimension dimension) const {
 
-
-    // TODO: Block-by-block mode
-    void apply_impl_local (const matrix_type& A,
-                          output_matrix_type& sketch_of_A,
-                          skylark::sketch::columnwise_tag tag) const {
-
-        El::Matrix<ValueType> R;
-        data_type::realize_matrix_view(R);
-
-        base::Gemm (El::NORMAL,
-                    El::NORMAL,
-                    value_type(1),
-                    R,
-                    A.LockedMatrix(),
-                    value_type(0),
-                    sketch_of_A.Matrix());
+        internal::dense_panel_apply(*this, A.LockedMatrix(),
+            sketch_of_A.Matrix(), dimension);
     }
 };
 
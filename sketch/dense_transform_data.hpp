@@ -5,12 +5,65 @@
 #error "Include top-level sketch.hpp instead of including individuals headers"
 #endif
 
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "boost/smart_ptr.hpp"
 
+#include "sketch_params.hpp"
+
 namespace skylark { namespace sketch {
 
+namespace internal {
+
+/**
+ * Bytes of params::realized_memory claimed by live realized matrices.
+ */
+inline size_t& realized_memory_used() {
+    static size_t used = 0;
+    return used;
+}
+
+inline std::mutex& realized_memory_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+/**
+ * Realized matrix of a dense transform, shared by all copies of the
+ * transform data (the concrete transforms created for every application
+ * are copies).
+ */
+struct realized_dense_t {
+
+    realized_dense_t() : state(UNREALIZED), bytes(0) {
+
+    }
+
+    ~realized_dense_t() {
+        std::lock_guard<std::mutex> lock(realized_memory_mutex());
+        realized_memory_used() -= bytes;
+    }
+
+    /** Claim bytes of the budget, if available. */
+    bool claim(size_t size) {
+        std::lock_guard<std::mutex> lock(realized_memory_mutex());
+        if (realized_memory_used() + size > get_realized_memory())
+            return false;
+        realized_memory_used() += size;
+        bytes = size;
+        return true;
+    }
+
+    enum { UNREALIZED, REALIZED, NOT_KEPT } state;
+    size_t bytes;
+    El::Matrix<double> R;
+    std::mutex mutex;
+};
+
+} // namespace internal
+
 //FIXME: WHY DO WE NEED TO ALLOW COPY CONSTRUCTOR HERE (or more precisely in
 //       dense_transform_Elemental)?
 /**
@@ -34,7 +87,7 @@ struct dense_transform_data_t : public sketch_transform_data_t {
     dense_transform_data_t (int N, int S, double scale,
         base::context_t& context)
         : base_t(N, S, context, "DenseTransform"),
-          scale(scale) {
+          scale(scale), _realized(new internal::realized_dense_t()) {
 
         // No scaling in "raw" form
         context = build();
@@ -60,7 +113,7 @@ struct dense_transform_data_t : public sketch_transform_data_t {
 
     dense_transform_data_t(const dense_transform_data_t& other)
         : base_t(other), scale(other.scale),
-          entries(other.entries)  {
+          entries(other.entries), _realized(other._realized)  {
 
     }
 
@@ -84,20 +137,21 @@ struct dense_transform_data_t : public sketch_transform_data_t {
         A.Resize(height, width);
         T *data = A.Buffer();
 
-#       ifdef SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for
-#       endif
-        for(size_t j_loc = 0; j_loc < width; j_loc++) {
-            size_t j_glob = j + j_loc * row_stride;
-            for (size_t i_loc = 0; i_loc < height; i_loc++) {
-                size_t i_glob = i + i_loc * col_stride;
-                size_t tmp = j_glob * _S;
-                tmp += i_glob;
-                value_type sample = entries[tmp];
-                tmp = j_loc * height;
-                data[tmp + i_loc] = scale * sample;
+        const El::Matrix<double> *R = kept_matrix();
+        if (R != nullptr) {
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp parallel for
+#           endif
+            for(size_t j_loc = 0; j_loc < width; j_loc++) {
+                const double *col =
+                    R->LockedBuffer(i, j + j_loc * row_stride);
+                for (size_t i_loc = 0; i_loc < height; i_loc++)
+                    data[j_loc * height + i_loc] = col[i_loc * col_stride];
             }
+            return;
         }
+
+        generate(data, i, j, height, width, col_stride, row_stride);
     }
 
 
@@ -157,7 +211,7 @@ protected:
     dense_transform_data_t (int N, int S, double scale,
         const base::context_t& context, std::string type)
         : base_t(N, S, context, type),
-          scale(scale) {
+          scale(scale), _realized(new internal::realized_dense_t()) {
 
     }
 
@@ -171,6 +225,74 @@ protected:
 
     double scale; /**< Scaling factor for the samples */
     value_accesor_type entries; /**< Samples (lazily computed) */
+
+private:
+    /**
+     * Generate the (strided) submatrix into data (leading dimension height).
+     */
+    template<typename T>
+    void generate(T *data, int i, int j, int height, int width,
+        int col_stride, int row_stride) const {
+
+        // Local columns are contiguous in the sample stream, so realize
+        // them in bulk.
+        if (col_stride == 1) {
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp parallel for
+#           endif
+            for(size_t j_loc = 0; j_loc < width; j_loc++) {
+                size_t j_glob = j + j_loc * row_stride;
+                T *col = data + j_loc * height;
+                entries.fill(j_glob * _S + i, height, col);
+                for (size_t i_loc = 0; i_loc < height; i_loc++)
+                    col[i_loc] *= scale;
+            }
+            return;
+        }
+
+#       ifdef SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for
+#       endif
+        for(size_t j_loc = 0; j_loc < width; j_loc++) {
+            size_t j_glob = j + j_loc * row_stride;
+            for (size_t i_loc = 0; i_loc < height; i_loc++) {
+                size_t i_glob = i + i_loc * col_stride;
+                size_t tmp = j_glob * _S;
+                tmp += i_glob;
+                value_type sample = entries[tmp];
+                tmp = j_loc * height;
+                data[tmp + i_loc] = scale * sample;
+            }
+        }
+    }
+
+    /** Kept realized matrix (see params::realized_memory) */
+    std::shared_ptr<internal::realized_dense_t> _realized;
+
+    /**
+     * The realized S x N matrix, if the transform keeps it. It is realized
+     * on the first call that finds room for it in the budget.
+     */
+    const El::Matrix<double> *kept_matrix() const {
+        if (get_realized_memory() == 0 || !_realized)
+            return nullptr;
+
+        std::lock_guard<std::mutex> lock(_realized->mutex);
+        if (_realized->state == internal::realized_dense_t::UNREALIZED) {
+            size_t size = static_cast<size_t>(_S) * _N * sizeof(double);
+            if (!_realized->claim(size)) {
+                _realized->state = internal::realized_dense_t::NOT_KEPT;
+                return nullptr;
+            }
+
+            _realized->R.Resize(_S, _N, _S);
+            generate(_realized->R.Buffer(), 0, 0, _S, _N, 1, 1);
+            _realized->state = internal::realized_dense_t::REALIZED;
+        }
+
+        return _realized->state == internal::realized_dense_t::REALIZED ?
+            &_realized->R : nullptr;
+    }
 };
 
 } } /** namespace skylark::sketch */
@@ -1,10 +1,165 @@
 #ifndef SKYLARK_HASH_TRANSFORM_ELEMENTAL_HPP
 #define SKYLARK_HASH_TRANSFORM_ELEMENTAL_HPP
 
+#include <algorithm>
+#include <climits>
+#include <vector>
+
 #include "../utility/get_communicator.hpp"
 
 namespace skylark { namespace sketch {
 
+namespace internal {
+
+/**
+ * Reduce-scatter based hash sketching of distributed matrices.
+ *
+ * Every rank sketches its local part of A into a partial sketch that is
+ * packed by owner: the sketched dimension (of size S) is distributed
+ * round-robin over comm with alignment align, as in an Elemental
+ * distribution, and the part owned by each rank is contiguous. A single
+ * MPI_Reduce_scatter then sums the partial sketches, and every rank only
+ * receives the part it owns. Per rank this communicates O(S x the other
+ * dimension of the local part), instead of reducing the full sketch.
+ *
+ * The local part of the sketch, SA, must already have the local size.
+ */
+template<typename ValueType>
+struct hash_reduce_scatter_t {
+
+    /** Local lengths of the S sketched indices, per rank of comm. */
+    hash_reduce_scatter_t(int S, int align, MPI_Comm comm) : _comm(comm) {
+        MPI_Comm_size(comm, &_size);
+        MPI_Comm_rank(comm, &_rank);
+        _align = align;
+        _len.resize(_size);
+        for(int q = 0; q < _size; q++)
+            _len[q] = El::Length(S, El::Shift(q, align, _size), _size);
+    }
+
+    /**
+     * Columnwise: the local part of A holds global rows shift + i * stride.
+     * SA (local part of the S x width sketch) gets the rows owned here.
+     */
+    void apply(const std::vector<size_t>& row_idx,
+        const std::vector<double>& row_value,
+        const El::Matrix<ValueType>& A, int shift, int stride,
+        El::Matrix<ValueType>& SA, columnwise_tag) const {
+
+        const int lh = A.Height(), lw = A.Width();
+        const ValueType *AA = A.LockedBuffer();
+        const int lda = A.LDim();
+
+        std::vector<int> counts(_size);
+        std::vector<size_t> displs(_size + 1, 0);
+        for(int q = 0; q < _size; q++) {
+            counts[q] = count(static_cast<size_t>(_len[q]) * lw);
+            displs[q + 1] = displs[q] + counts[q];
+        }
+
+        // Partial sketch, with a column-major block per owner.
+        std::vector<ValueType> part(displs[_size], ValueType(0));
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for
+#       endif
+        for(int c = 0; c < lw; c++)
+            for(int i = 0; i < lh; i++) {
+                size_t row = shift + static_cast<size_t>(i) * stride;
+                int nr = row_idx[row];
+                int q = (nr + _align) % _size;
+                part[displs[q] + static_cast<size_t>(c) * _len[q] +
+                    nr / _size] += row_value[row] * AA[i + c * lda];
+            }
+
+        std::vector<ValueType> recv(counts[_rank]);
+        MPI_Reduce_scatter(part.data(), recv.data(), counts.data(),
+            boost::mpi::get_mpi_datatype<ValueType>(), MPI_SUM, _comm);
+
+        ValueType *SAA = SA.Buffer();
+        for(int c = 0; c < lw; c++)
+            std::copy(recv.begin() + static_cast<size_t>(c) * _len[_rank],
+                recv.begin() + static_cast<size_t>(c + 1) * _len[_rank],
+                SAA + static_cast<size_t>(c) * SA.LDim());
+    }
+
+    /**
+     * Rowwise: the local part of A holds global columns shift + j * stride.
+     * SA (local part of the height x S sketch) gets the columns owned here.
+     */
+    void apply(const std::vector<size_t>& row_idx,
+        const std::vector<double>& row_value,
+        const El::Matrix<ValueType>& A, int shift, int stride,
+        El::Matrix<ValueType>& SA, rowwise_tag) const {
+
+        const int lh = A.Height(), lw = A.Width();
+        const ValueType *AA = A.LockedBuffer();
+        const int lda = A.LDim();
+
+        std::vector<int> counts(_size);
+        std::vector<size_t> displs(_size + 1, 0);
+        for(int q = 0; q < _size; q++) {
+            counts[q] = count(static_cast<size_t>(lh) * _len[q]);
+            displs[q + 1] = displs[q] + counts[q];
+        }
+
+        // Partial sketch; the blocks of the owners are column blocks, and
+        // several columns of A can go to the same column of the sketch, so
+        // threads split the rows.
+        std::vector<ValueType> part(displs[_size], ValueType(0));
+
+        const int rb = 256;
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for
+#       endif
+        for(int i0 = 0; i0 < lh; i0 += rb) {
+            const int i1 = std::min(lh, i0 + rb);
+            for(int j = 0; j < lw; j++) {
+                size_t col = shift + static_cast<size_t>(j) * stride;
+                int nc = row_idx[col];
+                int q = (nc + _align) % _size;
+                const ValueType v = row_value[col];
+                ValueType *y = part.data() + displs[q] +
+                    static_cast<size_t>(nc / _size) * lh;
+                const ValueType *x = AA + static_cast<size_t>(j) * lda;
+                for(int i = i0; i < i1; i++)
+                    y[i] += v * x[i];
+            }
+        }
+
+        std::vector<ValueType> recv(counts[_rank]);
+        MPI_Reduce_scatter(part.data(), recv.data(), counts.data(),
+            boost::mpi::get_mpi_datatype<ValueType>(), MPI_SUM, _comm);
+
+        ValueType *SAA = SA.Buffer();
+        for(int c = 0; c < _len[_rank]; c++)
+            std::copy(recv.begin() + static_cast<size_t>(c) * lh,
+                recv.begin() + static_cast<size_t>(c + 1) * lh,
+                SAA + static_cast<size_t>(c) * SA.LDim());
+    }
+
+private:
+    /**
+     * MPI_Reduce_scatter takes int counts. The counts are the same on all
+     * ranks of comm, so either all of them throw or none does.
+     */
+    static int count(size_t n) {
+        if (n > static_cast<size_t>(INT_MAX))
+            SKYLARK_THROW_EXCEPTION (
+                base::mpi_exception()
+                    << base::error_msg("Reduce-scatter of a hash sketch "
+                        "exceeds INT_MAX entries per rank; use more "
+                        "processes or a smaller sketch."));
+        return static_cast<int>(n);
+    }
+
+    MPI_Comm _comm;
+    int _size, _rank, _align;
+    std::vector<int> _len;
+};
+
+} // namespace internal
+
 /**
  * Specialization local input, local output
  */
@@ -127,10 +282,11 @@ private:
  * Specialization sparse local input, local output
  */
 template <typename ValueType,
+          typename IndexType,
           template <typename> class IdxDistributionType,
           template <typename> class ValueDistribution>
 struct hash_transform_t <
-    base::sparse_matrix_t<ValueType>,
+    base::sparse_matrix_t<ValueType, IndexType>,
     El::Matrix<ValueType>,
     IdxDistributionType,
     ValueDistribution > :
@@ -139,7 +295,7 @@ struct hash_transform_t <
 
     // Typedef matrix and distribution types so that we can use them regularly
     typedef ValueType value_type;
-    typedef base::sparse_matrix_t<ValueType> matrix_type;
+    typedef base::sparse_matrix_t<ValueType, IndexType> matrix_type;
     typedef El::Matrix<value_type> output_matrix_type;
     typedef IdxDistributionType<size_t> idx_distribution_type;
     typedef ValueDistribution<value_type> value_distribution_type;
@@ -207,16 +363,16 @@ private:
         value_type *SA = sketch_of_A.Buffer();
         int ld = sketch_of_A.LDim();
 
-        const int* indptr = A.indptr();
-        const int* indices = A.indices();
+        const IndexType* indptr = A.indptr();
+        const IndexType* indices = A.indices();
         const value_type* values = A.locked_values();
 
 #       if SKYLARK_HAVE_OPENMP
 #       pragma omp parallel for
 #       endif
-        for(int col = 0; col < A.width(); col++) {
-            for (int j = indptr[col]; j < indptr[col + 1]; j++) {
-                int row = indices[j];
+        for(IndexType col = 0; col < A.width(); col++) {
+            for (IndexType j = indptr[col]; j < indptr[col + 1]; j++) {
+                IndexType row = indices[j];
                 value_type val = values[j];
                 SA[col * ld + data_type::row_idx[row]] +=
                     data_type::row_value[row] * val;
@@ -227,6 +383,9 @@ private:
     /**
      * Apply the sketching transform that is described in by the sketch_of_A.
      * Implementation for the row-wise direction of sketching.
+     *
+     * Goes over the rows of A, through its (cached) CSR companion, so that
+     * every row of the sketch is written by a single thread.
      */
     void apply_impl (const matrix_type& A,
         output_matrix_type& sketch_of_A,
@@ -237,16 +396,17 @@ private:
         value_type *SA = sketch_of_A.Buffer();
         int ld = sketch_of_A.LDim();
 
-        const int* indptr = A.indptr();
-        const int* indices = A.indices();
-        const value_type* values = A.locked_values();
+        const matrix_type& AT = A.transposed();
+        const IndexType* indptr = AT.indptr();
+        const IndexType* indices = AT.indices();
+        const value_type* values = AT.locked_values();
 
-        for(int col = 0; col < A.width(); col++) {
-#           if SKYLARK_HAVE_OPENMP
-#           pragma omp parallel for
-#           endif
-            for (int j = indptr[col]; j < indptr[col + 1]; j++) {
-                int row = indices[j];
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for schedule(dynamic, 256)
+#       endif
+        for(IndexType row = 0; row < AT.width(); row++) {
+            for (IndexType j = indptr[row]; j < indptr[row + 1]; j++) {
+                IndexType col = indices[j];
                 value_type val = values[j];
                 SA[data_type::row_idx[col] * ld + row] +=
                     data_type::row_value[col] * val;
@@ -706,10 +866,24 @@ private:
      */
     void apply_impl_vdist(const matrix_type& A,
         output_matrix_type& sketch_of_A,
-        skylark::sketch::columnwise_tag) const {
+        skylark::sketch::columnwise_tag tag) const {
+
+        // If the sketch is small compared to A, sketch directly into the
+        // output distribution with a reduce-scatter: O(S d) per rank,
+        // versus O((N + S) d / P) for transposing A and the sketch.
+        const int P = A.ColStride();
+        if (static_cast<size_t>(this->_S) * (P - 1) <=
+            static_cast<size_t>(A.Height())) {
+            internal::hash_reduce_scatter_t<value_type>
+                rs(this->_S, sketch_of_A.ColAlign(),
+                    sketch_of_A.ColComm().comm);
+            rs.apply(data_type::row_idx, data_type::row_value,
+                A.LockedMatrix(), A.ColShift(), A.ColStride(),
+                sketch_of_A.Matrix(), tag);
+            return;
+        }
 
-        // Naive implementation: tranpose and uses the columnwise implementation
-        // Can we do better?
+        // Otherwise: tranpose and uses the rowwise implementation
         matrix_type A_t(A.Grid());
         El::Transpose(A, A_t);
         output_matrix_type sketch_of_A_t(sketch_of_A.Width(),
@@ -838,10 +1012,24 @@ private:
      */
     void apply_impl_vdist(const matrix_type& A,
         output_matrix_type& sketch_of_A,
-        skylark::sketch::columnwise_tag) const {
+        skylark::sketch::columnwise_tag tag) const {
 
-        // Naive implementation: tranpose and uses the columnwise implementation
-        // Can we do better?
+        // If the sketch is small compared to A, sketch directly into the
+        // output distribution with a reduce-scatter: O(S d) per rank,
+        // versus O((N + S) d / P) for transposing A and the sketch.
+        const int P = A.ColStride();
+        if (static_cast<size_t>(this->_S) * (P - 1) <=
+            static_cast<size_t>(A.Height())) {
+            internal::hash_reduce_scatter_t<value_type>
+                rs(this->_S, sketch_of_A.ColAlign(),
+                    sketch_of_A.ColComm().comm);
+            rs.apply(data_type::row_idx, data_type::row_value,
+                A.LockedMatrix(), A.ColShift(), A.ColStride(),
+                sketch_of_A.Matrix(), tag);
+            return;
+        }
+
+        // Otherwise: tranpose and uses the rowwise implementation
         matrix_type A_t(A.Grid());
         El::Transpose(A, A_t);
         output_matrix_type sketch_of_A_t(sketch_of_A.Width(),
@@ -985,8 +1173,22 @@ private:
         output_matrix_type& sketch_of_A,
         skylark::sketch::rowwise_tag tag) const {
 
-        // Naive implementation: tranpose and uses the columnwise implementation
-        // Can we do better?
+        // If the sketch is small compared to A, sketch directly into the
+        // output distribution with a reduce-scatter: O(S m) per rank,
+        // versus O((N + S) m / P) for transposing A and the sketch.
+        const int P = A.RowStride();
+        if (static_cast<size_t>(this->_S) * (P - 1) <=
+            static_cast<size_t>(A.Width())) {
+            internal::hash_reduce_scatter_t<value_type>
+                rs(this->_S, sketch_of_A.RowAlign(),
+                    sketch_of_A.RowComm().comm);
+            rs.apply(data_type::row_idx, data_type::row_value,
+                A.LockedMatrix(), A.RowShift(), A.RowStride(),
+                sketch_of_A.Matrix(), tag);
+            return;
+        }
+
+        // Otherwise: tranpose and uses the columnwise implementation
         matrix_type A_t(A.Grid());
         El::Transpose(A, A_t);
         output_matrix_type sketch_of_A_t(sketch_of_A.Width(),
@@ -1117,8 +1319,22 @@ private:
         output_matrix_type& sketch_of_A,
         skylark::sketch::rowwise_tag tag) const {
 
-        // Naive implementation: tranpose and uses the columnwise implementation
-        // Can we do better?
+        // If the sketch is small compared to A, sketch directly into the
+        // output distribution with a reduce-scatter: O(S m) per rank,
+        // versus O((N + S) m / P) for transposing A and the sketch.
+        const int P = A.RowStride();
+        if (static_cast<size_t>(this->_S) * (P - 1) <=
+            static_cast<size_t>(A.Width())) {
+            internal::hash_reduce_scatter_t<value_type>
+                rs(this->_S, sketch_of_A.RowAlign(),
+                    sketch_of_A.RowComm().comm);
+            rs.apply(data_type::row_idx, data_type::row_value,
+                A.LockedMatrix(), A.RowShift(), A.RowStride(),
+                sketch_of_A.Matrix(), tag);
+            return;
+        }
+
+        // Otherwise: tranpose and uses the columnwise implementation
         matrix_type A_t(A.Grid());
         El::Transpose(A, A_t);
         output_matrix_type sketch_of_A_t(sketch_of_A.Width(),
@@ -1136,7 +1352,12 @@ private:
 
 /**
  * Specialization: [MC, MR] -> [MC, MR]
- * TODO not sure this is the best way to do this
+ *
+ * Every rank sketches its local block, and the partial sketches are
+ * reduce-scattered over the process column (columnwise) or row (rowwise), so
+ * that each rank receives only its part of the [MC, MR] sketch. Sketching
+ * n x d to S x d communicates O(S d / sqrt(P)) per rank, and A is not
+ * redistributed.
  */
 template <typename ValueType,
           template <typename> class IdxDistributionType,
@@ -1232,15 +1453,19 @@ private:
         output_matrix_type& sketch_of_A,
         skylark::sketch::columnwise_tag tag) const {
 
-         typedef El::DistMatrix<value_type, El::STAR, El::VR> redis_type;
+        // Rows of the sketch are spread over the process column, like
+        // the rows of A; columns stay where they are in A.
+        output_matrix_type SA(A.Grid());
+        SA.AlignWith(A);
+        SA.Resize(this->_S, A.Width());
+
+        internal::hash_reduce_scatter_t<value_type>
+            rs(this->_S, SA.ColAlign(), SA.ColComm().comm);
+        rs.apply(data_type::row_idx, data_type::row_value,
+            A.LockedMatrix(), A.ColShift(), A.ColStride(), SA.Matrix(), tag);
 
-        // Naive implementation: redistribute, sketch and redistribute
-        hash_transform_t<redis_type, redis_type,
-                         IdxDistributionType, ValueDistribution> S1(*this);
-        redis_type A1 = A;
-        redis_type SA1(this->_S, A1.Width());
-        S1.apply(A1, SA1, tag);
-        sketch_of_A = SA1;
+        // No communication if sketch_of_A is aligned with A.
+        sketch_of_A = SA;
     }
 
     /**
@@ -1251,15 +1476,19 @@ private:
         output_matrix_type& sketch_of_A,
         skylark::sketch::rowwise_tag tag) const {
 
-        typedef El::DistMatrix<value_type, El::VC, El::STAR> redis_type;
+        // Columns of the sketch are spread over the process row, like
+        // the columns of A; rows stay where they are in A.
+        output_matrix_type SA(A.Grid());
+        SA.AlignWith(A);
+        SA.Resize(A.Height(), this->_S);
+
+        internal::hash_reduce_scatter_t<value_type>
+            rs(this->_S, SA.RowAlign(), SA.RowComm().comm);
+        rs.apply(data_type::row_idx, data_type::row_value,
+            A.LockedMatrix(), A.RowShift(), A.RowStride(), SA.Matrix(), tag);
 
-        // Naive implementation: redistribute, sketch and redistribute
-        hash_transform_t<redis_type, redis_type,
-                         IdxDistributionType, ValueDistribution> S1(*this);
-        redis_type A1 = A;
-        redis_type SA1(A1.Height(), this->_S);
-        S1.apply(A1, SA1, tag);
-        sketch_of_A = SA1;
+        // No communication if sketch_of_A is aligned with A.
+        sketch_of_A = SA;
     }
 };
 
@@ -1,10 +1,13 @@
 #ifndef SKYLARK_HASH_TRANSFORM_MIXED_HPP
 #define SKYLARK_HASH_TRANSFORM_MIXED_HPP
 
+#include <algorithm>
 #include <map>
+#include <vector>
 #include <boost/serialization/map.hpp>
 
 #include "../base/sparse_vc_star_matrix.hpp"
+#include "sketch_params.hpp"
 
 #if SKYLARK_HAVE_COMBBLAS
 #include "../utility/external/combblas_comm_grid.hpp"
@@ -23,6 +26,193 @@ namespace skylark { namespace sketch {
 //    T. Hoefler.
 
 
+
+namespace internal {
+
+/**
+ * Combine the contributions of the local part of a hash sketch into one
+ * compact buffer per target rank. Within each buffer positions are sorted
+ * and duplicates summed in input order, so the final sums do not depend on
+ * the exchange used.
+ *
+ * \param comm_size number of target ranks
+ * \param targets target rank of every contribution
+ * \param pos target position (row * ncols + col) of every contribution
+ * \param vals value of every contribution
+ * \param proc_start_idx output: buffer of rank p is [start[p], start[p+1])
+ * \param indices output: positions
+ * \param values output: summed values
+ */
+template<typename IndexType, typename ValueType>
+void mixed_combine(size_t comm_size, const std::vector<size_t>& targets,
+    const std::vector<IndexType>& pos, const std::vector<ValueType>& vals,
+    std::vector<size_t>& proc_start_idx, std::vector<IndexType>& indices,
+    std::vector<ValueType>& values) {
+
+    const size_t n = targets.size();
+
+    // Stable counting sort by target rank
+    std::vector<size_t> bucket(comm_size + 1, 0);
+    for(size_t k = 0; k < n; ++k)
+        bucket[targets[k] + 1]++;
+    for(size_t p = 0; p < comm_size; ++p)
+        bucket[p + 1] += bucket[p];
+
+    std::vector<size_t> perm(n);
+    std::vector<size_t> next(bucket.begin(), bucket.end() - 1);
+    for(size_t k = 0; k < n; ++k)
+        perm[next[targets[k]]++] = k;
+
+    // Stable sort by position inside every bucket, and sum duplicates.
+    proc_start_idx.assign(comm_size + 1, 0);
+    indices.clear();
+    values.clear();
+    indices.reserve(n);
+    values.reserve(n);
+
+    for(size_t p = 0; p < comm_size; ++p) {
+        std::stable_sort(perm.begin() + bucket[p], perm.begin() + bucket[p + 1],
+            [&pos](size_t a, size_t b) { return pos[a] < pos[b]; });
+
+        for(size_t k = bucket[p]; k < bucket[p + 1]; ++k) {
+            size_t e = perm[k];
+            if (k > bucket[p] && pos[e] == indices.back())
+                values.back() += vals[e];
+            else {
+                indices.push_back(pos[e]);
+                values.push_back(vals[e]);
+            }
+        }
+
+        proc_start_idx[p + 1] = indices.size();
+    }
+}
+
+/**
+ * Ship the combined buffers to their owners, and add the received values to
+ * the local part of sketch_of_A. Contributions are added in rank order for
+ * both engines.
+ *
+ * \param comm communicator of sketch_of_A
+ * \param proc_start_idx, indices, values output of mixed_combine
+ * \param ncols width of sketch_of_A
+ * \param sketch_of_A output matrix
+ */
+template<typename IndexType, typename ValueType,
+         typename OutputMatrixType>
+void mixed_exchange(const boost::mpi::communicator &comm,
+    std::vector<size_t>& proc_start_idx, std::vector<IndexType>& indices,
+    std::vector<ValueType>& values, size_t ncols,
+    OutputMatrixType& sketch_of_A) {
+
+    const size_t comm_size = comm.size();
+    const size_t rank = comm.rank();
+
+    if (get_mixed_exchange() == MIXED_EXCHANGE_ALLTOALL) {
+
+        std::vector<int> scount(comm_size), sdispl(comm_size);
+        for(size_t p = 0; p < comm_size; ++p) {
+            scount[p] = proc_start_idx[p + 1] - proc_start_idx[p];
+            sdispl[p] = proc_start_idx[p];
+        }
+
+        std::vector<int> rcount(comm_size), rdispl(comm_size + 1, 0);
+        MPI_Alltoall(&scount[0], 1, MPI_INT, &rcount[0], 1, MPI_INT, comm);
+        for(size_t p = 0; p < comm_size; ++p)
+            rdispl[p + 1] = rdispl[p] + rcount[p];
+
+        std::vector<IndexType> add_idx(rdispl[comm_size]);
+        std::vector<ValueType> add_val(rdispl[comm_size]);
+
+        MPI_Alltoallv(indices.data(), &scount[0], &sdispl[0],
+            boost::mpi::get_mpi_datatype<IndexType>(),
+            add_idx.data(), &rcount[0], &rdispl[0],
+            boost::mpi::get_mpi_datatype<IndexType>(), comm);
+        MPI_Alltoallv(values.data(), &scount[0], &sdispl[0],
+            boost::mpi::get_mpi_datatype<ValueType>(),
+            add_val.data(), &rcount[0], &rdispl[0],
+            boost::mpi::get_mpi_datatype<ValueType>(), comm);
+
+        for(size_t i = 0; i < add_idx.size(); ++i) {
+            El::Int lrow = sketch_of_A.LocalRow(add_idx[i] / ncols);
+            El::Int lcol = sketch_of_A.LocalCol(add_idx[i] % ncols);
+            sketch_of_A.UpdateLocal(lrow, lcol, add_val[i]);
+        }
+
+        return;
+    }
+
+    // tell MPI that we will not use locks
+    MPI_Info info;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "no_locks", "true");
+
+    MPI_Win start_offset_win, idx_win, val_win;
+
+    MPI_Win_create(&proc_start_idx[0], sizeof(size_t) * (comm_size + 1),
+                   sizeof(size_t), info, comm, &start_offset_win);
+
+    MPI_Win_create(indices.data(), sizeof(IndexType) * indices.size(),
+                   sizeof(IndexType), info, comm, &idx_win);
+
+    MPI_Win_create(values.data(), sizeof(ValueType) * values.size(),
+                   sizeof(ValueType), info, comm, &val_win);
+
+    MPI_Info_free(&info);
+
+    // Synchronize epoch, no subsequent put operations (read only) and no
+    // preceding fence calls.
+    MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, start_offset_win);
+    MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, idx_win);
+    MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, val_win);
+
+    // accumulate values from other procs
+    for(size_t p = 0; p < comm_size; ++p) {
+
+        // get the start/end offset
+        std::vector<size_t> offset(2);
+        MPI_Get(&(offset[0]), 2, boost::mpi::get_mpi_datatype<size_t>(),
+                p, rank, 2, boost::mpi::get_mpi_datatype<size_t>(),
+                start_offset_win);
+
+        MPI_Win_fence(MPI_MODE_NOPUT, start_offset_win);
+        size_t num_values = offset[1] - offset[0];
+
+        // and fill indices/values.
+        std::vector<IndexType> add_idx(num_values);
+        std::vector<ValueType> add_val(num_values);
+        MPI_Get(add_idx.data(), num_values,
+                boost::mpi::get_mpi_datatype<IndexType>(), p, offset[0],
+                num_values, boost::mpi::get_mpi_datatype<IndexType>(),
+                idx_win);
+
+        MPI_Get(add_val.data(), num_values,
+                boost::mpi::get_mpi_datatype<ValueType>(), p, offset[0],
+                num_values, boost::mpi::get_mpi_datatype<ValueType>(),
+                val_win);
+
+        MPI_Win_fence(MPI_MODE_NOPUT, idx_win);
+        MPI_Win_fence(MPI_MODE_NOPUT, val_win);
+
+        // finally, set data in local buffer
+        for(size_t i = 0; i < num_values; ++i) {
+            El::Int lrow = sketch_of_A.LocalRow(add_idx[i] / ncols);
+            El::Int lcol = sketch_of_A.LocalCol(add_idx[i] % ncols);
+            sketch_of_A.UpdateLocal(lrow, lcol, add_val[i]);
+        }
+    }
+
+    MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, start_offset_win);
+    MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, idx_win);
+    MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, val_win);
+
+    MPI_Win_free(&start_offset_win);
+    MPI_Win_free(&idx_win);
+    MPI_Win_free(&val_win);
+}
+
+} // namespace internal
+
 /* Specialization: sparse_vc_star for input, distributed Elemental for output */
 template <typename ValueType,
           El::Distribution ColDist,
@@ -96,12 +286,8 @@ private:
         output_matrix_type &sketch_of_A,
         Dimension dist) const {
 
-        typedef size_t offset_idx_t;
-
         boost::mpi::communicator comm = skylark::utility::get_communicator(A);
 
-        const size_t rank = comm.rank();
-
         const size_t ncols = sketch_of_A.Width();
 
         size_t comm_size = comm.size();
@@ -110,142 +296,41 @@ private:
         const int* A_indices = A.indices();
         const value_type *A_values = A.locked_values();
 
-        std::vector< std::map<size_t, size_t> > array_offsets(comm_size);
-
-        // pre-compute processor targets of local sketch application
-        for(int i = 0; i < A.width(); i++) {
-            for (int j = A_indptr[i]; j < A_indptr[i + 1]; j++) {
-
-                // compute global row and column id, and compress in one
-                // target position index
-                const size_t pos = getPos(
-                        A.global_row(A_indices[j]), i, ncols, dist);
-
-                // compute target processor for this target index
-                const size_t target_rank = utility::owner(
-                        sketch_of_A, pos / ncols, pos % ncols);
-
-                assert(target_rank < comm_size);
-
-                // map the position to the next empty slot
-                if(array_offsets[target_rank].count(pos) == 0) {
-                     size_t next_pos = array_offsets[target_rank].size();
-                     array_offsets[target_rank][pos] = next_pos;
-                }
-            }
-        }
-
-
-        // constructing array holding start/end indices for one-sided access
-        std::vector<offset_idx_t> proc_start_idx(comm_size + 1, 0);
-        for(size_t i = 1; i < comm_size + 1; ++i)
-            proc_start_idx[i] = proc_start_idx[i-1] + array_offsets[i-1].size();
-
-        const size_t my_num_values = proc_start_idx[comm_size];
-        // total number of nnz that will result when applying sketch locally
-        std::vector<index_type> indices(my_num_values, 0);
-        std::vector<value_type> values(my_num_values, 0);
+        const size_t nnz = A_indptr[A.width()];
+        std::vector<size_t> targets(nnz);
+        std::vector<index_type> pos(nnz);
+        std::vector<value_type> vals(nnz);
 
         // Apply sketch for all local values. Note that some of the resulting
-        // values might end up on a different processor. The data structure
-        // fills values (sorted by processor id) in one continuous array.
-        // Subsequently, one-sided operations can be used to access values for
-        // each processor.
+        // values might end up on a different processor.
         for(int i = 0; i < A.width(); i++) {
             for (int j = A_indptr[i]; j < A_indptr[i + 1]; j++) {
 
                 // compute global row and column id, and compress in one
                 // target position index
-                const size_t pos = getPos(
-                        A.global_row(A_indices[j]), i, ncols, dist);
+                pos[j] = getPos(A.global_row(A_indices[j]), i, ncols, dist);
 
                 // compute target processor for this target index
-                const size_t target_rank = utility::owner(
-                        sketch_of_A, pos / ncols, pos % ncols);
-
-                assert(target_rank < comm_size);
-
-                // get offset in array for current element
-                const size_t ar_idx = proc_start_idx[target_rank] +
-                    array_offsets[target_rank][pos];
+                targets[j] = utility::owner(
+                        sketch_of_A, pos[j] / ncols, pos[j] % ncols);
 
-                assert(ar_idx < indices.size());
-                indices[ar_idx] = pos;
+                assert(targets[j] < comm_size);
 
-                assert(ar_idx < values.size());
-                values[ar_idx]  += A_values[j] *
+                vals[j] = A_values[j] *
                     data_type::getValue(A.global_row(A_indices[j]), i, dist);
             }
         }
 
-        // tell MPI that we will not use locks
-        MPI_Info info;
-        MPI_Info_create(&info);
-        MPI_Info_set(info, "no_locks", "true");
+        // values sorted by processor id in one continuous array, one
+        // entry per distinct target position.
+        std::vector<size_t> proc_start_idx;
+        std::vector<index_type> indices;
+        std::vector<value_type> values;
+        internal::mixed_combine(comm_size, targets, pos, vals,
+            proc_start_idx, indices, values);
 
-        MPI_Win start_offset_win, idx_win, val_win;
-
-        MPI_Win_create(&proc_start_idx[0], sizeof(size_t) * (comm_size + 1),
-                       sizeof(size_t), info, comm, &start_offset_win);
-
-        MPI_Win_create(&indices[0], sizeof(index_type) * indices.size(),
-                       sizeof(index_type), info, comm, &idx_win);
-
-        MPI_Win_create(&values[0], sizeof(value_type) * values.size(),
-                       sizeof(value_type), info, comm, &val_win);
-
-        MPI_Info_free(&info);
-
-        // Synchronize epoch, no subsequent put operations (read only) and no
-        // preceding fence calls.
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, start_offset_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, idx_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, val_win);
-
-
-        // accumulate values from other procs
-        for(size_t p = 0; p < comm_size; ++p) {
-
-            // get the start/end offset
-            std::vector<size_t> offset(2);
-            MPI_Get(&(offset[0]), 2, boost::mpi::get_mpi_datatype<size_t>(),
-                    p, rank, 2, boost::mpi::get_mpi_datatype<size_t>(),
-                    start_offset_win);
-
-            MPI_Win_fence(MPI_MODE_NOPUT, start_offset_win);
-            size_t num_values = offset[1] - offset[0];
-
-            // and fill indices/values.
-            std::vector<index_type> add_idx(num_values);
-            std::vector<value_type> add_val(num_values);
-            MPI_Get(&(add_idx[0]), num_values,
-                    boost::mpi::get_mpi_datatype<index_type>(), p, offset[0],
-                    num_values, boost::mpi::get_mpi_datatype<index_type>(),
-                    idx_win);
-
-            MPI_Get(&(add_val[0]), num_values,
-                    boost::mpi::get_mpi_datatype<value_type>(), p, offset[0],
-                    num_values, boost::mpi::get_mpi_datatype<value_type>(),
-                    val_win);
-
-            MPI_Win_fence(MPI_MODE_NOPUT, idx_win);
-            MPI_Win_fence(MPI_MODE_NOPUT, val_win);
-
-            // finally, set data in local buffer
-            for(size_t i = 0; i < num_values; ++i) {
-                index_type lrow = sketch_of_A.LocalRow(add_idx[i] / ncols);
-                index_type lcol = sketch_of_A.LocalCol(add_idx[i] % ncols);
-                sketch_of_A.UpdateLocal(lrow, lcol, add_val[i]);
-            }
-        }
-
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, start_offset_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, idx_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, val_win);
-
-        MPI_Win_free(&start_offset_win);
-        MPI_Win_free(&idx_win);
-        MPI_Win_free(&val_win);
+        internal::mixed_exchange(comm, proc_start_idx, indices, values,
+            ncols, sketch_of_A);
     }
 
     inline index_type getPos(index_type rowid, index_type colid, size_t ncols,
@@ -346,8 +431,6 @@ private:
         // 'const' option is missing from the interface
         matrix_type &A = const_cast<matrix_type&>(A_);
 
-        const size_t rank = A.getcommgrid()->GetRank();
-
         // extract columns of matrix
         col_t &data = A.seq();
 
@@ -357,45 +440,16 @@ private:
         const size_t my_col_offset = utility::cb_my_col_offset(A);
 
         size_t comm_size = A.getcommgrid()->GetSize();
-        std::vector< std::set<size_t> > proc_set(comm_size);
 
-        // pre-compute processor targets of local sketch application
-        for(typename col_t::SpColIter col = data.begcol();
-            col != data.endcol(); col++) {
-            for(typename col_t::SpColIter::NzIter nz = data.begnz(col);
-                nz != data.endnz(col); nz++) {
-
-                // compute global row and column id, and compress in one
-                // target position index
-                const index_type rowid = nz.rowid()  + my_row_offset;
-                const index_type colid = col.colid() + my_col_offset;
-                const size_t pos       = getPos(rowid, colid, ncols, dist);
-
-                // compute target processor for this target index
-                const size_t target = utility::owner(
-                        sketch_of_A, pos / ncols, pos % ncols);
-
-                if(proc_set[target].count(pos) == 0) {
-                    assert(target < comm_size);
-                    proc_set[target].insert(pos);
-                }
-            }
-        }
-
-        // constructing array holding start/end indices for one-sided access
-        std::vector<index_type> proc_start_idx(comm_size + 1, 0);
-        for(size_t i = 1; i < comm_size + 1; ++i)
-            proc_start_idx[i] = proc_start_idx[i-1] + proc_set[i-1].size();
-
-        // total number of nnz that will result when applying sketch locally
-        std::vector<index_type> indicies(proc_start_idx[comm_size], 0);
-        std::vector<value_type> values(proc_start_idx[comm_size], 0);
+        std::vector<size_t> targets;
+        std::vector<index_type> pos;
+        std::vector<value_type> vals;
+        targets.reserve(data.getnnz());
+        pos.reserve(data.getnnz());
+        vals.reserve(data.getnnz());
 
         // Apply sketch for all local values. Note that some of the resulting
-        // values might end up on a different processor. The data structure
-        // fills values (sorted by processor id) in one continuous array.
-        // Subsequently, one-sided operations can be used to access values for
-        // each processor.
+        // values might end up on a different processor.
         for(typename col_t::SpColIter col = data.begcol();
             col != data.endcol(); col++) {
             for(typename col_t::SpColIter::NzIter nz = data.begnz(col);
@@ -405,93 +459,31 @@ private:
                 // target position index
                 const index_type rowid = nz.rowid()  + my_row_offset;
                 const index_type colid = col.colid() + my_col_offset;
-                const size_t pos       = getPos(rowid, colid, ncols, dist);
+                const size_t p         = getPos(rowid, colid, ncols, dist);
 
                 // compute target processor for this target index
-                const size_t proc = utility::owner(
-                        sketch_of_A, pos / ncols, pos % ncols);
-
-                // get offset in array for current element
-                const size_t ar_idx = proc_start_idx[proc] +
-                    std::distance(proc_set[proc].begin(), proc_set[proc].find(pos));
-
-                indicies[ar_idx] = pos;
-                values[ar_idx]  += nz.value() *
-                                   data_type::getValue(rowid, colid, dist);
-            }
-        }
-
-        // Creating windows for all relevant arrays
-        boost::mpi::communicator comm = utility::get_communicator(A);
-
-        // tell MPI that we will not use locks
-        MPI_Info info;
-        MPI_Info_create(&info);
-        MPI_Info_set(info, "no_locks", "true");
-
-        MPI_Win start_offset_win, idx_win, val_win;
-
-        MPI_Win_create(&proc_start_idx[0], sizeof(size_t) * (comm_size + 1),
-                       sizeof(size_t), info, comm, &start_offset_win);
-
-        MPI_Win_create(&indicies[0], sizeof(index_type) * indicies.size(),
-                       sizeof(index_type), info, comm, &idx_win);
-
-        MPI_Win_create(&values[0], sizeof(value_type) * values.size(),
-                       sizeof(value_type), info, comm, &val_win);
-
-        MPI_Info_free(&info);
-
-        // Synchronize epoch, no subsequent put operations (read only) and no
-        // preceding fence calls.
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, start_offset_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, idx_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, val_win);
-
-
-        // accumulate values from other procs
-        for(size_t p = 0; p < comm_size; ++p) {
+                const size_t target = utility::owner(
+                        sketch_of_A, p / ncols, p % ncols);
+                assert(target < comm_size);
 
-            // get the start/end offset
-            std::vector<size_t> offset(2);
-            MPI_Get(&(offset[0]), 2, boost::mpi::get_mpi_datatype<size_t>(),
-                    p, rank, 2, boost::mpi::get_mpi_datatype<size_t>(),
-                    start_offset_win);
-
-            MPI_Win_fence(MPI_MODE_NOPUT, start_offset_win);
-            size_t num_values = offset[1] - offset[0];
-
-            // and fill indices/values.
-            std::vector<index_type> add_idx(num_values);
-            std::vector<value_type> add_val(num_values);
-            MPI_Get(&(add_idx[0]), num_values,
-                    boost::mpi::get_mpi_datatype<index_type>(), p, offset[0],
-                    num_values, boost::mpi::get_mpi_datatype<index_type>(),
-                    idx_win);
-
-            MPI_Get(&(add_val[0]), num_values,
-                    boost::mpi::get_mpi_datatype<value_type>(), p, offset[0],
-                    num_values, boost::mpi::get_mpi_datatype<value_type>(),
-                    val_win);
-
-            MPI_Win_fence(MPI_MODE_NOPUT, idx_win);
-            MPI_Win_fence(MPI_MODE_NOPUT, val_win);
-
-            // finally, set data in local buffer
-            for(size_t i = 0; i < num_values; ++i) {
-                index_type lrow = sketch_of_A.LocalRow(add_idx[i] / ncols);
-                index_type lcol = sketch_of_A.LocalCol(add_idx[i] % ncols);
-                sketch_of_A.UpdateLocal(lrow, lcol, add_val[i]);
+                targets.push_back(target);
+                pos.push_back(p);
+                vals.push_back(nz.value() *
+                    data_type::getValue(rowid, colid, dist));
             }
         }
 
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, start_offset_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, idx_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, val_win);
+        // values sorted by processor id in one continuous array, one
+        // entry per distinct target position.
+        std::vector<size_t> proc_start_idx;
+        std::vector<index_type> indices;
+        std::vector<value_type> values;
+        internal::mixed_combine(comm_size, targets, pos, vals,
+            proc_start_idx, indices, values);
 
-        MPI_Win_free(&start_offset_win);
-        MPI_Win_free(&idx_win);
-        MPI_Win_free(&val_win);
+        boost::mpi::communicator comm = utility::get_communicator(A);
+        internal::mixed_exchange(comm, proc_start_idx, indices, values,
+            ncols, sketch_of_A);
     }
 
     inline index_type getPos(index_type rowid, index_type colid, size_t ncols,
@@ -1,25 +1,29 @@
 #ifndef SKYLARK_HASH_TRANSFORM_LOCAL_SPARSE_HPP
 #define SKYLARK_HASH_TRANSFORM_LOCAL_SPARSE_HPP
 
+#include <vector>
+
 #include <boost/dynamic_bitset.hpp>
 
 namespace skylark { namespace sketch {
 
-/* Specialization: local SpMat for input, output */
+/* Specialization: local SpMat for input, output (any index type) */
 template <typename ValueType,
+          typename IndexType,
           template <typename> class IdxDistributionType,
           template <typename> class ValueDistribution>
 struct hash_transform_t <
-    base::sparse_matrix_t<ValueType>,
-    base::sparse_matrix_t<ValueType>,
+    base::sparse_matrix_t<ValueType, IndexType>,
+    base::sparse_matrix_t<ValueType, IndexType>,
     IdxDistributionType,
     ValueDistribution > :
         public hash_transform_data_t<IdxDistributionType,
                                      ValueDistribution> {
     typedef size_t index_type;
     typedef ValueType value_type;
-    typedef base::sparse_matrix_t<ValueType> matrix_type;
-    typedef base::sparse_matrix_t<ValueType> output_matrix_type;
+    typedef base::sparse_matrix_t<ValueType, IndexType> matrix_type;
+    typedef base::sparse_matrix_t<ValueType, IndexType> output_matrix_type;
+    typedef IndexType sparse_index_type;
     typedef IdxDistributionType<index_type> idx_distribution_type;
     typedef ValueDistribution<value_type> value_distribution_type;
     typedef hash_transform_data_t<IdxDistributionType,
@@ -31,7 +35,7 @@ struct hash_transform_t <
      */
     hash_transform_t (int N, int S, base::context_t& context) :
         data_type(N, S, context) {
-
+        build_inverse_mapping();
     }
 
     /**
@@ -43,14 +47,18 @@ struct hash_transform_t <
                                        OutputMatrixType,
                                        IdxDistributionType,
                                        ValueDistribution>& other) :
-        data_type(other) {}
+        data_type(other) {
+        build_inverse_mapping();
+    }
 
     /**
      * Constructor from data
      */
     hash_transform_t (hash_transform_data_t<IdxDistributionType,
                                             ValueDistribution>& other_data) :
-        data_type(other_data) {}
+        data_type(other_data) {
+        build_inverse_mapping();
+    }
 
     /**
      * Apply the sketching transform that is described in by the sketch_of_A.
@@ -81,63 +89,122 @@ struct hash_transform_t <
     const sketch_transform_data_t* get_data() const { return this; }
 
 private:
+    /// Inverse of row_idx in CSC-like form: the input columns hashed to
+    /// target column t are _inv_idx[_inv_ptr[t]] ... _inv_idx[_inv_ptr[t+1]-1],
+    /// in increasing order. Built once per transform, used rowwise.
+    std::vector<sparse_index_type> _inv_ptr;
+    std::vector<sparse_index_type> _inv_idx;
+
+    void build_inverse_mapping() {
+        const std::vector<size_t> &row_idx = data_type::row_idx;
+
+        _inv_ptr.assign(data_type::_S + 1, 0);
+        _inv_idx.resize(row_idx.size());
+
+        for(size_t idx = 0; idx < row_idx.size(); ++idx)
+            _inv_ptr[row_idx[idx] + 1]++;
+        for(int t = 0; t < data_type::_S; ++t)
+            _inv_ptr[t + 1] += _inv_ptr[t];
+
+        std::vector<sparse_index_type> pos(_inv_ptr.begin(),
+            _inv_ptr.end() - 1);
+        for(size_t idx = 0; idx < row_idx.size(); ++idx)
+            _inv_idx[pos[row_idx[idx]]++] = idx;
+    }
+
     /**
      * Apply the sketching transform that is described in by the sketch_of_A
      * columnwise.
+     *
+     * Columns of the output are independent, so both passes are distributed
+     * over blocks of columns. The first pass counts the distinct target rows
+     * of every column, the second pass fills the (prefix summed) slots in
+     * place. Within a column entries are emitted in order of first
+     * appearance, and accumulated in input order, so the result does not
+     * depend on the number of threads.
      */
     void apply_impl (const matrix_type &A,
                      output_matrix_type &sketch_of_A,
                      columnwise_tag) const {
 
-        index_type col_idx = 0;
-
-        const int* indptr  = A.indptr();
-        const int* indices = A.indices();
+        const sparse_index_type* indptr  = A.indptr();
+        const sparse_index_type* indices = A.indices();
         const value_type* values = A.locked_values();
 
-        index_type n_rows = data_type::_S;
-        index_type n_cols = A.width();
+        const size_t *row_idx = &data_type::row_idx[0];
+        const double *row_value = &data_type::row_value[0];
 
-        int nnz = 0;
-        int *indptr_new = new int[n_cols + 1];
-        std::vector<int> final_rows(A.nonzeros());
-        std::vector<value_type> final_vals(A.nonzeros());
+        sparse_index_type n_rows = data_type::_S;
+        sparse_index_type n_cols = A.width();
 
+        sparse_index_type *indptr_new = new sparse_index_type[n_cols + 1];
         indptr_new[0] = 0;
-        std::vector<index_type> idx_map(n_rows, -1);
 
-        for(index_type col = 0; col < A.width(); col++) {
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel
+#       endif
+        {
+        // Pass 1: count distinct target rows per column. Marking with the
+        // column index avoids resetting the marker between columns.
+        std::vector<sparse_index_type> marker(n_rows, -1);
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(dynamic, 64)
+#       endif
+        for(sparse_index_type col = 0; col < n_cols; col++) {
+            sparse_index_type count = 0;
+            for(sparse_index_type idx = indptr[col];
+                 idx < indptr[col + 1]; idx++) {
+                sparse_index_type row = row_idx[indices[idx]];
+                if (marker[row] != col) {
+                    marker[row] = col;
+                    count++;
+                }
+            }
+            indptr_new[col + 1] = count;
+        }
+        }
 
+        for(sparse_index_type col = 0; col < n_cols; col++)
+            indptr_new[col + 1] += indptr_new[col];
 
-            for(index_type idx = indptr[col]; idx < indptr[col + 1]; idx++) {
+        sparse_index_type nnz = indptr_new[n_cols];
+        sparse_index_type *indices_new = new sparse_index_type[nnz];
+        value_type *values_new = new value_type[nnz];
 
-                index_type row = indices[idx];
-                value_type val = values[idx] * data_type::row_value[row];
-                row            = data_type::row_idx[row];
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel
+#       endif
+        {
+        // Pass 2: scatter into the final position
+        std::vector<sparse_index_type> idx_map(n_rows, -1);
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(dynamic, 64)
+#       endif
+        for(sparse_index_type col = 0; col < n_cols; col++) {
+            sparse_index_type pos = indptr_new[col];
+
+            for(sparse_index_type idx = indptr[col];
+                 idx < indptr[col + 1]; idx++) {
+                sparse_index_type orig = indices[idx];
+                sparse_index_type row = row_idx[orig];
+                value_type val = values[idx] * row_value[orig];
 
-                //XXX: I think we should get rid of the if here...
                 if(idx_map[row] == -1) {
-                    idx_map[row] = nnz;
-                    final_rows[nnz] = row;
-                    final_vals[nnz] = val;
-                    nnz++;
-                } else {
-                    final_vals[idx_map[row]] += val;
-                }
+                    idx_map[row] = pos;
+                    indices_new[pos] = row;
+                    values_new[pos] = val;
+                    pos++;
+                } else
+                    values_new[idx_map[row]] += val;
             }
 
-            indptr_new[col + 1] = nnz;
-
             // reset idx_map
-            for(int i = indptr_new[col]; i < nnz; ++i)
-                idx_map[final_rows[i]] = -1;
+            for(sparse_index_type i = indptr_new[col]; i < pos; ++i)
+                idx_map[indices_new[i]] = -1;
+        }
         }
-
-        int *indices_new = new int[nnz];
-        std::copy(final_rows.begin(), final_rows.begin() + nnz, indices_new);
-
-        value_type *values_new = new value_type[nnz];
-        std::copy(final_vals.begin(), final_vals.begin() + nnz, values_new);
 
         // let the sparse structure take ownership of the data
         sketch_of_A.attach(indptr_new, indices_new, values_new,
@@ -148,75 +215,102 @@ private:
     /**
      * Apply the sketching transform that is described in by the sketch_of_A
      * rowwise.
+     *
+     * Same two-pass scheme as the columnwise case, over target columns, with
+     * the (cached) inverse mapping giving the input columns that hash to
+     * each target column.
      */
     void apply_impl (const matrix_type &A,
                      output_matrix_type &sketch_of_A,
                      rowwise_tag) const {
 
-        index_type col_idx = 0;
-
-        const int* indptr = A.indptr();
-        const int* indices = A.indices();
+        const sparse_index_type* indptr = A.indptr();
+        const sparse_index_type* indices = A.indices();
         const value_type* values = A.locked_values();
 
-        // target size
-        index_type n_rows = A.height();
-        index_type n_cols = data_type::_S;
+        const double *row_value = &data_type::row_value[0];
+        const sparse_index_type *inv_ptr = &_inv_ptr[0];
+        const sparse_index_type *inv_idx = &_inv_idx[0];
 
-        int nnz = 0;
-        int *indptr_new = new int[n_cols + 1];
-        std::vector<int> final_rows(A.nonzeros());
-        std::vector<value_type> final_vals(A.nonzeros());
+        // target size
+        sparse_index_type n_rows = A.height();
+        sparse_index_type n_cols = data_type::_S;
 
+        sparse_index_type *indptr_new = new sparse_index_type[n_cols + 1];
         indptr_new[0] = 0;
 
-        // we adapt transversal order for this case
-        //XXX: or transpose A (maybe better for cache)
-        std::vector< std::vector<int> > inv_mapping(data_type::_S);
-        for(int idx = 0; idx < data_type::row_idx.size(); ++idx) {
-            inv_mapping[data_type::row_idx[idx]].push_back(idx);
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel
+#       endif
+        {
+        std::vector<sparse_index_type> marker(n_rows, -1);
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(dynamic, 16)
+#       endif
+        for(sparse_index_type target_col = 0; target_col < n_cols;
+             ++target_col) {
+            sparse_index_type count = 0;
+            for(sparse_index_type j = inv_ptr[target_col];
+                j < inv_ptr[target_col + 1]; ++j) {
+                sparse_index_type col = inv_idx[j];
+                for(sparse_index_type idx = indptr[col];
+                    idx < indptr[col + 1]; idx++) {
+                    sparse_index_type row = indices[idx];
+                    if (marker[row] != target_col) {
+                        marker[row] = target_col;
+                        count++;
+                    }
+                }
+            }
+            indptr_new[target_col + 1] = count;
+        }
         }
 
-        std::vector<index_type> idx_map(n_rows, -1);
+        for(sparse_index_type col = 0; col < n_cols; col++)
+            indptr_new[col + 1] += indptr_new[col];
 
-        for(index_type target_col = 0; target_col < data_type::_S;
-            ++target_col) {
+        sparse_index_type nnz = indptr_new[n_cols];
+        sparse_index_type *indices_new = new sparse_index_type[nnz];
+        value_type *values_new = new value_type[nnz];
 
-            std::vector<int>::iterator itr;
-            for(itr = inv_mapping[target_col].begin();
-                itr != inv_mapping[target_col].end(); itr++) {
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel
+#       endif
+        {
+        std::vector<sparse_index_type> idx_map(n_rows, -1);
 
-                int col = *itr;
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(dynamic, 16)
+#       endif
+        for(sparse_index_type target_col = 0; target_col < n_cols;
+             ++target_col) {
+            sparse_index_type pos = indptr_new[target_col];
 
-                for(index_type idx = indptr[col]; idx < indptr[col + 1]; idx++) {
+            for(sparse_index_type j = inv_ptr[target_col];
+                j < inv_ptr[target_col + 1]; ++j) {
+                sparse_index_type col = inv_idx[j];
 
-                    index_type row = indices[idx];
-                    value_type val = values[idx] * data_type::row_value[col];
+                for(sparse_index_type idx = indptr[col];
+                    idx < indptr[col + 1]; idx++) {
+                    sparse_index_type row = indices[idx];
+                    value_type val = values[idx] * row_value[col];
 
-                    //XXX: I think we should get rid of the if here...
                     if(idx_map[row] == -1) {
-                        idx_map[row] = nnz;
-                        final_rows[nnz] = row;
-                        final_vals[nnz] = val;
-                        nnz++;
-                    } else {
-                        final_vals[idx_map[row]] += val;
-                    }
+                        idx_map[row] = pos;
+                        indices_new[pos] = row;
+                        values_new[pos] = val;
+                        pos++;
+                    } else
+                        values_new[idx_map[row]] += val;
                 }
             }
 
-            indptr_new[target_col + 1] = nnz;
-
             // reset idx_map
-            for(int i = indptr_new[target_col]; i < nnz; ++i)
-                idx_map[final_rows[i]] = -1;
+            for(sparse_index_type i = indptr_new[target_col]; i < pos; ++i)
+                idx_map[indices_new[i]] = -1;
+        }
         }
-
-        int *indices_new = new int[nnz];
-        std::copy(final_rows.begin(), final_rows.begin() + nnz, indices_new);
-
-        value_type *values_new = new value_type[nnz];
-        std::copy(final_vals.begin(), final_vals.begin() + nnz, values_new);
 
         sketch_of_A.attach(indptr_new, indices_new, values_new,
                            nnz, n_rows, n_cols, true);
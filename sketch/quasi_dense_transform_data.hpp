@@ -5,6 +5,7 @@
 #error "Include top-level sketch.hpp instead of including individuals headers"
 #endif
 
+#include <algorithm>
 #include <vector>
 #include <boost/math/distributions.hpp>
 
@@ -62,6 +63,37 @@ public:
         return boost::math::quantile(_distribution, baseval);
     }
 
+    /**
+     * Entries are the coordinates of consecutive points, _d per point, so a
+     * range is a (partial) first point, a block of whole points and a
+     * (partial) last point, each generated with the sequence's block fill.
+     */
+    template<typename OutputType>
+    void fill(size_t begin, size_t count, OutputType *out) const {
+        std::vector<value_type> baseval(count);
+        value_type *b = baseval.data();
+        size_t end = begin + count;
+
+        while (begin < end) {
+            size_t idx = begin / _d, i = begin % _d;
+            size_t n;
+            if (i != 0 || end - begin < _d) {
+                n = std::min(_d - i, end - begin);
+                _sequence.fill(_skip + idx, 1, i, i + n, b);
+            } else {
+                size_t points = (end - begin) / _d;
+                n = points * _d;
+                _sequence.fill(_skip + idx, points, 0, _d, b);
+            }
+            begin += n;
+            b += n;
+        }
+
+        for(size_t k = 0; k < count; k++)
+            out[k] = static_cast<OutputType>(
+                boost::math::quantile(_distribution, baseval[k]));
+    }
+
 private:
     size_t _d;
     size_t _N;
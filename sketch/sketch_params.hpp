@@ -1,9 +1,40 @@
 #ifndef SKYLARK_SKETCH_PARAMS_HPP
 #define SKYLARK_SKETCH_PARAMS_HPP
 
+#include <cstddef>
 
 namespace skylark { namespace sketch {
 
+/**
+ * How hash transforms from distributed sparse to distributed dense matrices
+ * exchange their contributions.
+ */
+enum mixed_exchange_t {
+    MIXED_EXCHANGE_ALLTOALL = 0, /**< single MPI_Alltoallv */
+    MIXED_EXCHANGE_ONESIDED = 1  /**< MPI_Get per peer, fenced epochs */
+};
+
+/**
+ * Accuracy of the cosine in random features transforms.
+ */
+enum cosine_accuracy_t {
+    COSINE_EXACT = 0,    /**< std::cos */
+    COSINE_ACCURATE = 1, /**< vectorized, absolute error ~2e-16 */
+    COSINE_FAST = 2,     /**< vectorized, absolute error ~3e-7 */
+    COSINE_COARSE = 3    /**< parabola, absolute error ~1e-1, |x| <= 3 pi */
+};
+
+/**
+ * Planner rigor for FFT based transforms. Higher rigor gives faster
+ * transforms but planning takes longer (plans are cached per process, and
+ * can be saved and restored as FFTW wisdom). Ignored without FFTW.
+ */
+enum fft_planning_t {
+    FFT_PLANNING_ESTIMATE = 0, /**< FFTW_ESTIMATE, no measurements */
+    FFT_PLANNING_MEASURE = 1,  /**< FFTW_MEASURE */
+    FFT_PLANNING_PATIENT = 2   /**< FFTW_PATIENT */
+};
+
 /**
  * Set value to 0 to force no-blocking in sketching.
  * Better performance, but much more memory.
@@ -17,6 +48,51 @@ int blocksize = 1000;
 
 double factor = 20.;
 
+/**
+ * Memory budget (in bytes) for the realized part of a dense transform
+ * when applying to local matrices: the transform is then realized in panels
+ * of columns. 0 (the default) realizes the entire transform at once.
+ */
+size_t panel_memory = 0;
+
+/**
+ * Realize the next panel of a dense transform while the current one is
+ * multiplied. The budget then covers both panels.
+ */
+bool panel_overlap = false;
+
+/**
+ * Memory budget (in bytes, for the whole process) for dense transforms that
+ * keep their realized matrix once it is first realized, instead of
+ * regenerating it on every application. Transforms claim the budget in the
+ * order they are first applied, and release it when destroyed. Useful when
+ * the same transforms are applied many times to small matrices (e.g. when
+ * serving predictions). 0 disables.
+ */
+size_t realized_memory = 0;
+
+/**
+ * Exchange engine for hash transforms with sparse distributed input and
+ * dense distributed output.
+ */
+mixed_exchange_t mixed_exchange = MIXED_EXCHANGE_ALLTOALL;
+
+/**
+ * Accuracy of the cosine in random features transforms. The default is
+ * std::cos, as before the vectorized levels were added; defining
+ * SKYLARK_INEXACT_COSINE makes the coarse approximation the default.
+ */
+#ifndef SKYLARK_INEXACT_COSINE
+cosine_accuracy_t cosine_accuracy = COSINE_EXACT;
+#else
+cosine_accuracy_t cosine_accuracy = COSINE_COARSE;
+#endif
+
+/**
+ * Planner rigor for FFT based transforms.
+ */
+fft_planning_t fft_planning = FFT_PLANNING_ESTIMATE;
+
 }
 
 void set_blocksize(int blocksize) {
@@ -35,6 +111,54 @@ double get_factor() {
     return params::factor;
 }
 
+void set_panel_memory(size_t panel_memory) {
+    params::panel_memory = panel_memory;
+}
+
+size_t get_panel_memory() {
+    return params::panel_memory;
+}
+
+void set_panel_overlap(bool panel_overlap) {
+    params::panel_overlap = panel_overlap;
+}
+
+bool get_panel_overlap() {
+    return params::panel_overlap;
+}
+
+void set_realized_memory(size_t realized_memory) {
+    params::realized_memory = realized_memory;
+}
+
+size_t get_realized_memory() {
+    return params::realized_memory;
+}
+
+void set_mixed_exchange(mixed_exchange_t mixed_exchange) {
+    params::mixed_exchange = mixed_exchange;
+}
+
+mixed_exchange_t get_mixed_exchange() {
+    return params::mixed_exchange;
+}
+
+void set_cosine_accuracy(cosine_accuracy_t cosine_accuracy) {
+    params::cosine_accuracy = cosine_accuracy;
+}
+
+cosine_accuracy_t get_cosine_accuracy() {
+    return params::cosine_accuracy;
+}
+
+void set_fft_planning(fft_planning_t fft_planning) {
+    params::fft_planning = fft_planning;
+}
+
+fft_planning_t get_fft_planning() {
+    return params::fft_planning;
+}
+
 } } /** namespace skylark::sketch */
 
 #endif // SKYLARK_SKETCH_PARAMS_HPP
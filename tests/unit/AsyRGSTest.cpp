@@ -0,0 +1,95 @@
+/**
+ *  This test checks that the partitioned (owner-computes) mode of AsyRGS
+ *  solves a small SPD system as the shared mode does, for one and several
+ *  right-hand sides.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <string>
+
+typedef El::Matrix<double> dense_type;
+typedef skylark::base::sparse_matrix_t<double> sparse_type;
+
+#if SKYLARK_HAVE_OPENMP
+
+dense_type solve(const sparse_type& A, const dense_type& B,
+    bool partitioned, const std::string& what) {
+
+    skylark::base::context_t context(2718);
+    skylark::algorithms::asy_iter_params_t params;
+    params.tolerance = 1e-10;
+    params.syn_sweeps = 10;
+    params.sweeps_lim = 1000;
+    params.partitioned = partitioned;
+
+    dense_type X;
+    El::Zeros(X, B.Height(), B.Width());
+    if (skylark::algorithms::AsyRGS(A, B, X, context, params) != -1)
+        BOOST_FAIL((what + ": no convergence").c_str());
+    return X;
+}
+
+void check(const sparse_type& A, const dense_type& Ad, const dense_type& B,
+    const std::string& what) {
+
+    dense_type X = solve(A, B, false, what + " shared");
+    dense_type Xp = solve(A, B, true, what + " partitioned");
+
+    // Residual of the partitioned solution, and distance to the shared one.
+    dense_type R = B;
+    El::Gemm(El::NORMAL, El::NORMAL, -1.0, Ad, Xp, 1.0, R);
+    if (El::FrobeniusNorm(R) > 1e-9 * El::FrobeniusNorm(B)) {
+        std::cout << what << ": residual " << El::FrobeniusNorm(R)
+                  << std::endl;
+        BOOST_FAIL((what + ": residual").c_str());
+    }
+
+    El::Axpy(-1.0, X, Xp);
+    if (El::FrobeniusNorm(Xp) > 1e-8 * El::FrobeniusNorm(X)) {
+        std::cout << what << ": difference " << El::FrobeniusNorm(Xp)
+                  << std::endl;
+        BOOST_FAIL((what + ": partitioned != shared").c_str());
+    }
+}
+
+#endif
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+#if SKYLARK_HAVE_OPENMP
+
+    // Periodic tridiagonal, diagonally dominant: SPD.
+    const int n = 200;
+    sparse_type::coords_t coords;
+    for(int i = 0; i < n; i++) {
+        coords.push_back(std::make_tuple(i, i, 4.0));
+        coords.push_back(std::make_tuple(i, (i + 1) % n, -1.0));
+        coords.push_back(std::make_tuple((i + 1) % n, i, -1.0));
+    }
+    sparse_type A;
+    A.set(coords, n, n);
+
+    dense_type Ad;
+    skylark::base::DenseCopy(A, Ad);
+
+    dense_type B;
+    El::Uniform(B, n, 1);
+    check(A, Ad, B, "one right-hand side");
+    El::Uniform(B, n, 3);
+    check(A, Ad, B, "three right-hand sides");
+
+#endif
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ *  This test checks the factors of I + Z Z' used by BlockADMMSolver, in the
+ *  direct (Z wide) and Woodbury (Z tall) forms, against the explicit
+ *  inverse; that they only match the same Z (not one with reordered
+ *  columns); and that they are unchanged by a save/load round trip.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <sstream>
+#include <string>
+
+typedef El::Matrix<double> dense_type;
+typedef skylark::ml::block_factor_t<double> factor_type;
+
+void check(const dense_type& C, const dense_type& expected,
+    const std::string& what) {
+
+    dense_type D = C;
+    El::Axpy(-1.0, expected, D);
+    if (El::MaxNorm(D) > 1e-10 * El::MaxNorm(expected)) {
+        std::cout << what << ": error " << El::MaxNorm(D) << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    // sj x ni: direct, then Woodbury.
+    const int shapes[][2] = { { 40, 150 }, { 150, 40 } };
+
+    for(int s = 0; s < 2; s++) {
+        const int sj = shapes[s][0], ni = shapes[s][1];
+        const std::string tag = s == 0 ? "direct" : "woodbury";
+
+        dense_type Z, B;
+        El::Uniform(Z, sj, ni);
+        El::Uniform(B, sj, 3);
+
+        // Explicit inverse, as the solver used to keep it.
+        dense_type M, expected;
+        El::Identity(M, sj, sj);
+        El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, Z, Z, 1.0, M);
+        El::Inverse(M);
+        El::Gemm(El::NORMAL, El::NORMAL, 1.0, M, B, expected);
+
+        factor_type F;
+        F.factor(Z);
+        if (F.is_woodbury() != (s == 1))
+            BOOST_FAIL(("form " + tag).c_str());
+
+        dense_type X = B;
+        F.apply(Z, X);
+        check(X, expected, "apply " + tag);
+
+        if (!F.matches(Z))
+            BOOST_FAIL(("match " + tag).c_str());
+
+        // Same dimensions and entries, other order of the examples.
+        dense_type P = Z;
+        El::ColSwap(P, 0, ni - 1);
+        if (F.matches(P))
+            BOOST_FAIL(("reordered match " + tag).c_str());
+
+        std::stringstream stream;
+        F.save(stream);
+        factor_type G;
+        if (!G.load(stream) || !G.matches(Z))
+            BOOST_FAIL(("load " + tag).c_str());
+
+        dense_type Y = B;
+        G.apply(Z, Y);
+        El::Axpy(-1.0, X, Y);
+        if (El::MaxNorm(Y) != 0)
+            BOOST_FAIL(("loaded apply " + tag).c_str());
+
+        // A truncated file is refused.
+        std::stringstream truncated(stream.str().substr(0, 64));
+        factor_type H;
+        if (H.load(truncated) || !H.empty())
+            BOOST_FAIL(("truncated load " + tag).c_str());
+    }
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ *  This test ensures that local sparse matrices survive a round trip through
+ *  the binary CSC container format, both mapped and copied, and that
+ *  truncated or corrupt files are rejected instead of read out of bounds.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <skylark.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+typedef skylark::base::sparse_matrix_t<double> matrix_type;
+
+/** Whether mapping and attaching the file fails with an exception. */
+bool rejected(const std::string& fname) {
+    try {
+        skylark::utility::io::csc_mapping_t mapping(fname);
+        matrix_type B;
+        mapping.attach(B);
+    } catch (skylark::base::skylark_exception ex) {
+        return true;
+    }
+    return false;
+}
+
+/** Writes bytes, after patching the header field at offset. */
+template<typename F>
+void write_patched(const std::string& fname, std::string bytes,
+    size_t offset, F value) {
+    std::memcpy(&bytes[offset], &value, sizeof(value));
+    std::ofstream out(fname.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+}
+
+int test_main(int argc, char *argv[]) {
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    matrix_type::coords_t coords;
+    for(int k = 0; k < 1000; k++)
+        coords.push_back(std::make_tuple(k % 37, (7 * k) % 53, 0.5 * k));
+
+    matrix_type A;
+    A.set(coords);
+
+    std::string fname = "csc_io_test.csc";
+    skylark::utility::io::WriteCSC(fname, A);
+
+    {
+        skylark::utility::io::csc_mapping_t mapping(fname);
+        matrix_type B;
+        mapping.attach(B);
+
+        BOOST_REQUIRE(B.height() == A.height());
+        BOOST_REQUIRE(B.width() == A.width());
+        BOOST_REQUIRE(B.nonzeros() == A.nonzeros());
+        BOOST_REQUIRE(A == B);
+        BOOST_REQUIRE(reinterpret_cast<size_t>(B.locked_values()) % 64 == 0);
+    }
+
+    matrix_type C;
+    skylark::utility::io::ReadCSC(fname, C);
+    BOOST_REQUIRE(A == C);
+
+    // Truncated and corrupt copies.
+    typedef skylark::utility::io::internal::csc_header_t header_type;
+    std::string bytes;
+    {
+        std::ifstream in(fname.c_str(), std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>());
+    }
+    header_type h;
+    std::memcpy(&h, bytes.data(), sizeof(h));
+
+    std::string bad = "csc_io_test_bad.csc";
+    const uint64_t cut = h.file_size - 8;
+
+    // Truncated file.
+    write_patched(bad, bytes.substr(0, cut), 0, h.magic[0]);
+    BOOST_REQUIRE(rejected(bad));
+
+    // Truncated file, with the recorded size matching.
+    write_patched(bad, bytes.substr(0, cut),
+        offsetof(header_type, file_size), cut);
+    BOOST_REQUIRE(rejected(bad));
+
+    // More non-zeros than the arrays (and indptr) hold.
+    write_patched(bad, bytes, offsetof(header_type, nnz), h.nnz + 1);
+    BOOST_REQUIRE(rejected(bad));
+
+    // Misaligned values.
+    write_patched(bad, bytes, offsetof(header_type, values_offset),
+        h.values_offset + 1);
+    BOOST_REQUIRE(rejected(bad));
+
+    // Array beyond the end of the file.
+    write_patched(bad, bytes, offsetof(header_type, indices_offset),
+        uint64_t(1) << 62);
+    BOOST_REQUIRE(rejected(bad));
+
+    // Dimensions that do not fit the index type.
+    write_patched(bad, bytes, offsetof(header_type, width),
+        int64_t(1) << 40);
+    BOOST_REQUIRE(rejected(bad));
+
+    // The unmodified bytes are fine.
+    write_patched(bad, bytes, 0, h.magic[0]);
+    BOOST_REQUIRE(!rejected(bad));
+
+    std::remove(bad.c_str());
+    std::remove(fname.c_str());
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ *  This test assembles coordinate updates with many duplicates into CSC
+ *  arrays and compares against a serial (std::map) reference: with updates
+ *  queued from a parallel region and from nested ones, and with assembly
+ *  called from inside a parallel region (where the team of a nested region
+ *  is smaller than requested).
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+typedef skylark::base::detail::coo_assembly_buffer_t<double> buffer_type;
+typedef std::map<std::pair<int, int>, double> reference_type;
+
+const int N = 400000, m = 3000, n = 500;
+
+int row(int k) { return static_cast<int>((7919LL * k) % m); }
+int col(int k) { return static_cast<int>((1LL * k * k + 3LL * k) % n); }
+double value(int k) { return 0.001 * (k % 1000) - 0.5; }
+
+bool matches(buffer_type& buffer, const reference_type& reference) {
+
+    int height = 0, width = 0;
+    std::vector<int> indptr, indices;
+    std::vector<double> values;
+    buffer.assemble(height, width, indptr, indices, values);
+
+    if (height != m || width != n ||
+        static_cast<size_t>(indptr[width]) != reference.size())
+        return false;
+
+    reference_type::const_iterator it = reference.begin();
+    for(int c = 0; c < width; c++)
+        for(int l = indptr[c]; l < indptr[c + 1]; l++, it++)
+            if (it->first.first != c || it->first.second != indices[l] ||
+                std::abs(it->second - values[l]) > 1e-9)
+                return false;
+    return true;
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    // (col, row) ordered, as the CSC arrays.
+    reference_type reference;
+    for(int k = 0; k < N; k++)
+        reference[std::make_pair(col(k), row(k))] += value(k);
+
+    {
+        // Small compaction threshold, so buffers are reduced in place too.
+        buffer_type buffer(1 << 14);
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for
+#       endif
+        for(int k = 0; k < N; k++)
+            buffer.push(row(k), col(k), value(k));
+        if (!matches(buffer, reference))
+            BOOST_FAIL("Parallel push");
+    }
+
+    {
+        buffer_type buffer;
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for
+#       endif
+        for(int a = 0; a < 8; a++) {
+#           if SKYLARK_HAVE_OPENMP
+#           pragma omp parallel for
+#           endif
+            for(int k = a; k < N; k += 8)
+                buffer.push(row(k), col(k), value(k));
+        }
+        if (!matches(buffer, reference))
+            BOOST_FAIL("Nested push");
+    }
+
+    int ok = 1;
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel num_threads(4) reduction(&:ok)
+#   endif
+    {
+        buffer_type buffer;
+        for(int k = 0; k < N; k++)
+            buffer.push(row(k), col(k), value(k));
+        ok &= matches(buffer, reference);
+    }
+    if (!ok)
+        BOOST_FAIL("Assembly inside a parallel region");
+
+    El::Finalize();
+    return 0;
+}
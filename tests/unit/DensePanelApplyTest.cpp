@@ -0,0 +1,109 @@
+/**
+ *  This test checks that applying a dense transform to local matrices in
+ *  panels (a memory budget set with sketch::set_panel_memory, with and
+ *  without overlap) gives the same sketch as realizing the transform at
+ *  once, for dense and sparse inputs, columnwise and rowwise.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <string>
+
+typedef El::Matrix<double> dense_type;
+typedef skylark::base::sparse_matrix_t<double> sparse_type;
+
+void check(const dense_type& C, const dense_type& expected,
+    const std::string& what) {
+
+    dense_type D = C;
+    El::Axpy(-1.0, expected, D);
+    if (El::MaxNorm(D) > 1e-12 * El::MaxNorm(expected)) {
+        std::cout << what << ": error " << El::MaxNorm(D) << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+template<typename InputType>
+void resize(dense_type& SA, const InputType& A, int S,
+    skylark::sketch::columnwise_tag) {
+    El::Zeros(SA, S, skylark::base::Width(A));
+}
+
+template<typename InputType>
+void resize(dense_type& SA, const InputType& A, int S,
+    skylark::sketch::rowwise_tag) {
+    El::Zeros(SA, skylark::base::Height(A), S);
+}
+
+template<typename InputType, typename Dimension>
+dense_type sketch(const InputType& A, int N, int S, Dimension dimension,
+    size_t panel_memory, bool overlap) {
+
+    typedef skylark::sketch::JLT_t<InputType, dense_type> transform_type;
+
+    skylark::sketch::set_panel_memory(panel_memory);
+    skylark::sketch::set_panel_overlap(overlap);
+
+    skylark::base::context_t context(1234);
+    transform_type T(N, S, context);
+
+    dense_type SA;
+    resize(SA, A, S, dimension);
+    T.apply(A, SA, dimension);
+    return SA;
+}
+
+template<typename InputType, typename Dimension>
+void check_panels(const InputType& A, int N, int S, Dimension dimension,
+    const std::string& what) {
+
+    dense_type expected = sketch(A, N, S, dimension, 0, false);
+
+    // One column per panel, a few columns per panel (not dividing N), and
+    // a budget larger than the transform.
+    const size_t column = S * sizeof(double);
+    const size_t budgets[] = { column, 7 * column, 2 * N * column };
+    for(size_t b : budgets)
+        for(int overlap = 0; overlap < 2; overlap++)
+            check(sketch(A, N, S, dimension, b, overlap), expected,
+                what + (overlap ? " (overlap)" : ""));
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    const int m = 101, n = 37, S = 30;
+
+    dense_type A;
+    El::Uniform(A, m, n);
+
+    sparse_type::coords_t coords;
+    for(int l = 0; l < 600; l++)
+        coords.push_back(std::make_tuple((13 * l) % m, (l * l + 3 * l) % n,
+                0.001 * l - 0.3));
+    sparse_type As;
+    As.set(coords, m, n);
+
+    check_panels(A, m, S, skylark::sketch::columnwise_tag(),
+        "dense columnwise");
+    check_panels(A, n, S, skylark::sketch::rowwise_tag(),
+        "dense rowwise");
+    check_panels(As, m, S, skylark::sketch::columnwise_tag(),
+        "sparse columnwise");
+    check_panels(As, n, S, skylark::sketch::rowwise_tag(),
+        "sparse rowwise");
+
+    skylark::sketch::set_panel_memory(0);
+    skylark::sketch::set_panel_overlap(false);
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,194 @@
+/**
+ *  This test checks the kernel Gram matrices, computed by the fused tiled
+ *  Gram engine, against the kernel formulas evaluated entry by entry, for
+ *  all combinations of point directions. Sizes are chosen so that partial
+ *  tiles are exercised. The symmetric Gram matrices have to agree with the
+ *  general ones on the requested triangle.
+ *
+ *  Points are in [0, 1]^d, where all kernels (the exponential semigroup
+ *  one takes square roots of coordinates) are defined. NaNs fail.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <cmath>
+#include <string>
+
+typedef El::Matrix<double> dense_type;
+
+namespace skyml = skylark::ml;
+namespace skyb = skylark::base;
+
+/** Point i of X (X's columns if dir is COLUMNS, rows otherwise). */
+double coord(skyb::direction_t dir, const dense_type& X, int i, int k) {
+    return dir == skyb::COLUMNS ? X.Get(k, i) : X.Get(i, k);
+}
+
+/** max(err, |a - b|), and NaN once either is NaN (std::max drops it). */
+double max_error(double err, double a, double b) {
+    double e = std::abs(a - b);
+    return (e <= err || err != err) ? err : e;
+}
+
+/**
+ * If near, the points of Y are those of X, moved by at most 5e-3 in each
+ * coordinate, so the distances are close to 0.
+ */
+template<typename KernelType, typename F>
+void check_kernel(const KernelType& k, F f, const std::string& what,
+    bool near = false) {
+
+    // 301 points (> the Gemm tile) against 70 (> the direct tile), dim 11.
+    const int m = 301, n = 70, d = 11;
+    const skyb::direction_t dirs[] = { skyb::COLUMNS, skyb::ROWS };
+
+    for(int a = 0; a < 2; a++)
+        for(int b = 0; b < 2; b++) {
+            dense_type X, Y, K;
+            if (dirs[a] == skyb::COLUMNS)
+                El::Uniform(X, d, m, 0.5, 0.5);
+            else
+                El::Uniform(X, m, d, 0.5, 0.5);
+            if (dirs[b] == skyb::COLUMNS)
+                El::Uniform(Y, d, n, 0.5, 0.5);
+            else
+                El::Uniform(Y, n, d, 0.5, 0.5);
+
+            if (near)
+                for(int j = 0; j < n; j++)
+                    for(int l = 0; l < d; l++) {
+                        double y = coord(dirs[a], X, j, l) +
+                            1e-2 * (coord(dirs[b], Y, j, l) - 0.5);
+                        if (dirs[b] == skyb::COLUMNS)
+                            Y.Set(l, j, y);
+                        else
+                            Y.Set(j, l, y);
+                    }
+
+            k.gram(dirs[a], dirs[b], X, Y, K);
+
+            double err = 0.0;
+            for(int i = 0; i < m; i++)
+                for(int j = 0; j < n; j++) {
+                    double v = f(dirs[a], X, i, dirs[b], Y, j);
+                    err = max_error(err, K.Get(i, j), v);
+                }
+            if (!(err <= 1e-10)) {
+                std::cout << what << " gram: error " << err << std::endl;
+                BOOST_FAIL((what + " gram").c_str());
+            }
+
+            if (a != b)
+                continue;
+
+            // Symmetric Gram of X, both triangles.
+            dense_type G;
+            k.gram(dirs[a], dirs[a], X, X, G);
+            const El::UpperOrLower uplos[] = { El::LOWER, El::UPPER };
+            for(int u = 0; u < 2; u++) {
+                dense_type S;
+                k.symmetric_gram(uplos[u], dirs[a], X, S);
+                double serr = 0.0;
+                for(int j = 0; j < m; j++)
+                    for(int i = 0; i < m; i++)
+                        if ((uplos[u] == El::LOWER && i >= j) ||
+                            (uplos[u] == El::UPPER && i <= j))
+                            serr = max_error(serr, S.Get(i, j), G.Get(i, j));
+                if (!(serr <= 1e-10)) {
+                    std::cout << what << " symmetric gram: error " << serr
+                              << std::endl;
+                    BOOST_FAIL((what + " symmetric gram").c_str());
+                }
+            }
+        }
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    const int d = 11;
+
+    auto sqdist = [d] (skyb::direction_t dx, const dense_type& X, int i,
+        skyb::direction_t dy, const dense_type& Y, int j) {
+        double s = 0.0;
+        for(int k = 0; k < d; k++) {
+            double t = coord(dx, X, i, k) - coord(dy, Y, j, k);
+            s += t * t;
+        }
+        return s;
+    };
+
+    check_kernel(skyml::gaussian_t(d, 0.8),
+        [&] (skyb::direction_t dx, const dense_type& X, int i,
+            skyb::direction_t dy, const dense_type& Y, int j) {
+            return std::exp(-sqdist(dx, X, i, dy, Y, j) / (2 * 0.8 * 0.8));
+        }, "gaussian");
+
+    check_kernel(skyml::polynomial_t(d, 3, 0.5, 0.2),
+        [d] (skyb::direction_t dx, const dense_type& X, int i,
+            skyb::direction_t dy, const dense_type& Y, int j) {
+            double s = 0.0;
+            for(int k = 0; k < d; k++)
+                s += coord(dx, X, i, k) * coord(dy, Y, j, k);
+            return std::pow(0.2 * s + 0.5, 3);
+        }, "polynomial");
+
+    check_kernel(skyml::laplacian_t(d, 1.5),
+        [d] (skyb::direction_t dx, const dense_type& X, int i,
+            skyb::direction_t dy, const dense_type& Y, int j) {
+            double s = 0.0;
+            for(int k = 0; k < d; k++)
+                s += std::abs(coord(dx, X, i, k) - coord(dy, Y, j, k));
+            return std::exp(-s / 1.5);
+        }, "laplacian");
+
+    check_kernel(skyml::expsemigroup_t(d, 0.7),
+        [d] (skyb::direction_t dx, const dense_type& X, int i,
+            skyb::direction_t dy, const dense_type& Y, int j) {
+            double s = 0.0;
+            for(int k = 0; k < d; k++)
+                s += std::sqrt(coord(dx, X, i, k) + coord(dy, Y, j, k));
+            return std::exp(-0.7 * s);
+        }, "expsemigroup");
+
+    // Matern with nu = 3/2 (closed form) and nu = 0.8 (Bessel function).
+    check_kernel(skyml::matern_t(d, 1.5, 0.9),
+        [&] (skyb::direction_t dx, const dense_type& X, int i,
+            skyb::direction_t dy, const dense_type& Y, int j) {
+            double r = std::sqrt(3.0 * sqdist(dx, X, i, dy, Y, j)) / 0.9;
+            return (1.0 + r) * std::exp(-r);
+        }, "matern 3/2");
+
+    check_kernel(skyml::matern_t(d, 0.8, 0.9),
+        [&] (skyb::direction_t dx, const dense_type& X, int i,
+            skyb::direction_t dy, const dense_type& Y, int j) {
+            double r = std::sqrt(1.6 * sqdist(dx, X, i, dy, Y, j)) / 0.9;
+            if (r == 0.0)
+                return 1.0;
+            return std::pow(2.0, 1.0 - 0.8) / boost::math::tgamma(0.8) *
+                std::pow(r, 0.8) * boost::math::cyl_bessel_k(0.8, r);
+        }, "matern 0.8");
+
+    // Small nu near r = 0, where x^nu K_nu(x) is the product of a vanishing
+    // and a diverging factor, and the kernel is steepest.
+    check_kernel(skyml::matern_t(d, 0.2, 0.9),
+        [&] (skyb::direction_t dx, const dense_type& X, int i,
+            skyb::direction_t dy, const dense_type& Y, int j) {
+            double r = std::sqrt(0.4 * sqdist(dx, X, i, dy, Y, j)) / 0.9;
+            if (r == 0.0)
+                return 1.0;
+            return std::pow(2.0, 1.0 - 0.2) / boost::math::tgamma(0.2) *
+                std::pow(r, 0.2) * boost::math::cyl_bessel_k(0.2, r);
+        }, "matern 0.2 near 0", true);
+
+    El::Finalize();
+    return 0;
+}
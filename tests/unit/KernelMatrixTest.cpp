@@ -0,0 +1,74 @@
+/**
+ *  This test checks products with the matrix-free kernel matrix against
+ *  products with the materialized kernel matrix, for points given as
+ *  columns and as rows. The tile size is chosen so that partial tiles are
+ *  exercised, and the test runs on several ranks so that the blocks of
+ *  points circulate.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <string>
+
+typedef El::DistMatrix<double> dense_type;
+
+void check(const dense_type& C, const dense_type& expected,
+    const std::string& what) {
+
+    dense_type D = C;
+    El::Axpy(-1.0, expected, D);
+    if (El::MaxNorm(D) > 1e-10 * El::MaxNorm(expected)) {
+        std::cout << what << ": error " << El::MaxNorm(D) << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    namespace skyb = skylark::base;
+
+    const int n = 301, d = 5, k = 4;
+    skylark::ml::gaussian_t kernel(d, 1.2);
+
+    const skyb::direction_t dirs[] = { skyb::COLUMNS, skyb::ROWS };
+    const std::string names[] = { "columns", "rows" };
+
+    for(int t = 0; t < 2; t++) {
+        dense_type X;
+        if (dirs[t] == skyb::COLUMNS)
+            El::Uniform(X, d, n);
+        else
+            El::Uniform(X, n, d);
+
+        skyb::kernel_matrix_t<double, skylark::ml::gaussian_t>
+            KM(dirs[t], kernel, X, 0.1, 64);
+        dense_type K = KM.materialize();
+
+        dense_type B, C, expected;
+        El::Uniform(B, n, k);
+        El::Uniform(C, n, k);
+        expected = C;
+
+        skyb::Symm(El::LEFT, El::LOWER, 2.0, KM, B, 0.5, C);
+        El::Gemm(El::NORMAL, El::NORMAL, 2.0, K, B, 0.5, expected);
+        check(C, expected, "Symm " + names[t]);
+
+        dense_type BT;
+        El::Transpose(B, BT);
+        skyb::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, KM, BT, 0.0, C);
+        El::Gemm(El::NORMAL, El::NORMAL, 1.0, K, B, 0.0, expected);
+        check(C, expected, "Gemm " + names[t]);
+    }
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ *  This test checks the (parallel, two-pass) hashing transform of local
+ *  sparse matrices against a serial reference, the single-pass scheme it
+ *  replaced: same structure, same order of entries within a column and the
+ *  same values, bit for bit. The input has empty rows and columns, and the
+ *  transforms are sized so that the output has empty columns too. Both
+ *  32-bit and 64-bit indices are covered.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+template<typename MatrixType>
+struct hash_t : public skylark::sketch::hash_transform_t<
+    MatrixType, MatrixType,
+    boost::random::uniform_int_distribution,
+    skylark::utility::rademacher_distribution_t > {
+
+    typedef skylark::sketch::hash_transform_t<
+        MatrixType, MatrixType,
+        boost::random::uniform_int_distribution,
+        skylark::utility::rademacher_distribution_t > base_type;
+
+    hash_t(int N, int S, skylark::base::context_t& context)
+        : base_type(N, S, context) {}
+
+    const std::vector<size_t>& get_row_idx() const {
+        return base_type::row_idx;
+    }
+
+    const std::vector<double>& get_row_value() const {
+        return base_type::row_value;
+    }
+};
+
+/**
+ * The serial scheme: entries in order of first appearance of their target
+ * row, accumulated in input order.
+ */
+template<typename IndexType>
+struct reference_t {
+    std::vector<IndexType> indptr, indices;
+    std::vector<double> values;
+    std::vector<IndexType> map;
+
+    reference_t(IndexType n_rows) : indptr(1, 0), map(n_rows, -1) {}
+
+    void add(IndexType row, double val) {
+        if (map[row] == -1) {
+            map[row] = indices.size();
+            indices.push_back(row);
+            values.push_back(val);
+        } else
+            values[map[row]] += val;
+    }
+
+    void end_column() {
+        for(IndexType i = indptr.back(); i < IndexType(indices.size()); i++)
+            map[indices[i]] = -1;
+        indptr.push_back(indices.size());
+    }
+};
+
+template<typename MatrixType, typename IndexType>
+void check(const MatrixType& SA, const reference_t<IndexType>& expected,
+    IndexType height, IndexType width, const std::string& what) {
+
+    if (SA.height() != height || SA.width() != width ||
+        SA.nonzeros() != IndexType(expected.indices.size()))
+        BOOST_FAIL((what + ": structure").c_str());
+
+    for(IndexType c = 0; c <= width; c++)
+        if (SA.indptr()[c] != expected.indptr[c])
+            BOOST_FAIL((what + ": column pointers").c_str());
+
+    for(IndexType l = 0; l < SA.nonzeros(); l++)
+        if (SA.indices()[l] != expected.indices[l] ||
+            SA.locked_values()[l] != expected.values[l])
+            BOOST_FAIL((what + ": entries").c_str());
+}
+
+template<typename IndexType>
+void check_index_type(const std::string& what) {
+
+    typedef skylark::base::sparse_matrix_t<double, IndexType> matrix_type;
+
+    // 257 x 600, with empty rows (every 7th) and columns (every 5th, and
+    // the last one), and several entries of a column hashed together.
+    const IndexType m = 257, n = 600;
+    typename matrix_type::coords_t coords;
+    for(IndexType j = 0; j < n - 1; j++) {
+        if (j % 5 == 0)
+            continue;
+        for(IndexType k = 0; k < j % 9 + 1; k++) {
+            IndexType i = (31 * j + 17 * k) % m;
+            if (i % 7 != 0)
+                coords.push_back(std::make_tuple(i, j, 0.01 * (j - k) - 1.0));
+        }
+    }
+    matrix_type A;
+    A.set(coords, m, n);
+
+    const IndexType *indptr = A.indptr();
+    const IndexType *indices = A.indices();
+    const double *values = A.locked_values();
+
+    // Columnwise: few (collisions) and many (empty output rows) targets.
+    const IndexType sizes[] = { 10, 500 };
+    for(IndexType S : sizes) {
+        skylark::base::context_t context(1234);
+        hash_t<matrix_type> T(m, S, context);
+        const std::vector<size_t>& row_idx = T.get_row_idx();
+        const std::vector<double>& row_value = T.get_row_value();
+
+        reference_t<IndexType> expected(S);
+        for(IndexType c = 0; c < n; c++) {
+            for(IndexType l = indptr[c]; l < indptr[c + 1]; l++)
+                expected.add(row_idx[indices[l]],
+                    values[l] * row_value[indices[l]]);
+            expected.end_column();
+        }
+
+        matrix_type SA;
+        T.apply(A, SA, skylark::sketch::columnwise_tag());
+        check(SA, expected, S, n,
+            what + " columnwise, S = " + std::to_string(S));
+    }
+
+    // Rowwise: with 900 targets for 600 columns some output columns are
+    // empty.
+    const IndexType row_sizes[] = { 10, 900 };
+    for(IndexType S : row_sizes) {
+        skylark::base::context_t context(1234);
+        hash_t<matrix_type> T(n, S, context);
+        const std::vector<size_t>& row_idx = T.get_row_idx();
+        const std::vector<double>& row_value = T.get_row_value();
+
+        reference_t<IndexType> expected(m);
+        for(IndexType t = 0; t < S; t++) {
+            for(IndexType c = 0; c < n; c++)
+                if (IndexType(row_idx[c]) == t)
+                    for(IndexType l = indptr[c]; l < indptr[c + 1]; l++)
+                        expected.add(indices[l], values[l] * row_value[c]);
+            expected.end_column();
+        }
+
+        matrix_type SA;
+        T.apply(A, SA, skylark::sketch::rowwise_tag());
+        check(SA, expected, m, S,
+            what + " rowwise, S = " + std::to_string(S));
+    }
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    check_index_type<int>("32-bit");
+    check_index_type<int64_t>("64-bit");
+
+    El::Finalize();
+    return 0;
+}
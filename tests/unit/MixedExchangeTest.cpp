@@ -0,0 +1,175 @@
+/**
+ *  This test hashes a sparse [VC, STAR] matrix into [MC, MR] and [VC, STAR]
+ *  outputs, columnwise and rowwise, with both ways of shipping the
+ *  contributions to their owners (sketch::set_mixed_exchange: one
+ *  MPI_Alltoallv, or one-sided MPI_Get). The sketches of both exchanges
+ *  must be equal, and equal to the product of the dense hash matrix with the
+ *  dense input. Run on more than two processes, so that contributions go
+ *  to several ranks.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <string>
+#include <vector>
+
+typedef El::Matrix<double> dense_type;
+typedef skylark::base::sparse_vc_star_matrix_t<double> sparse_type;
+
+namespace skys = skylark::sketch;
+
+template < typename InputMatrixType,
+           typename OutputMatrixType = InputMatrixType >
+struct Dummy_t : public skys::hash_transform_t<
+    InputMatrixType, OutputMatrixType,
+    boost::random::uniform_int_distribution,
+    skylark::utility::rademacher_distribution_t > {
+
+    typedef skys::hash_transform_t<
+        InputMatrixType, OutputMatrixType,
+        boost::random::uniform_int_distribution,
+        skylark::utility::rademacher_distribution_t >
+            hash_t;
+
+    Dummy_t(int N, int S, skylark::base::context_t& context)
+        : hash_t(N, S, context)
+    {}
+
+    std::vector<size_t> getRowIdx() { return hash_t::row_idx; }
+    std::vector<double> getRowValues() { return hash_t::row_value; }
+};
+
+void check(const dense_type& C, const dense_type& expected, double tol,
+    const std::string& what) {
+
+    dense_type D = C;
+    El::Axpy(-1.0, expected, D);
+    if (C.Height() != expected.Height() || C.Width() != expected.Width() ||
+        El::MaxNorm(D) > tol * El::MaxNorm(expected)) {
+        std::cout << what << ": error " << El::MaxNorm(D) << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+template<typename OutputType>
+void resize(OutputType& SA, El::Int m, El::Int n, int S,
+    skys::columnwise_tag) {
+    El::Zeros(SA, S, n);
+}
+
+template<typename OutputType>
+void resize(OutputType& SA, El::Int m, El::Int n, int S,
+    skys::rowwise_tag) {
+    El::Zeros(SA, m, S);
+}
+
+/** Sketch of A with the given exchange, on every rank. */
+template<typename OutputType, typename Dimension>
+dense_type sketch(const sparse_type& A, int N, int S, Dimension dimension,
+    skys::mixed_exchange_t exchange, const El::Grid& grid) {
+
+    skys::set_mixed_exchange(exchange);
+
+    skylark::base::context_t context(1234);
+    Dummy_t<sparse_type, OutputType> T(N, S, context);
+
+    OutputType SA(grid);
+    resize(SA, A.height(), A.width(), S, dimension);
+    T.apply(A, SA, dimension);
+
+    El::DistMatrix<double, El::STAR, El::STAR> SA_STAR_STAR(SA);
+    return SA_STAR_STAR.Matrix();
+}
+
+void multiply(const dense_type& Pi, const dense_type& A, dense_type& SA,
+    skys::columnwise_tag) {
+    El::Gemm(El::NORMAL, El::NORMAL, 1.0, Pi, A, 0.0, SA);
+}
+
+void multiply(const dense_type& Pi, const dense_type& A, dense_type& SA,
+    skys::rowwise_tag) {
+    El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, A, Pi, 0.0, SA);
+}
+
+/** The hash as a dense S x N matrix, applied to A. */
+template<typename Dimension>
+dense_type reference(const dense_type& A, int N, int S,
+    Dimension dimension) {
+
+    skylark::base::context_t context(1234);
+    Dummy_t<sparse_type, El::DistMatrix<double> > T(N, S, context);
+    std::vector<size_t> row_idx = T.getRowIdx();
+    std::vector<double> row_val = T.getRowValues();
+
+    dense_type Pi;
+    El::Zeros(Pi, S, N);
+    for(size_t i = 0; i < row_idx.size(); ++i)
+        Pi.Set(row_idx[i], i, row_val[i]);
+
+    dense_type SA;
+    resize(SA, A.Height(), A.Width(), S, dimension);
+    multiply(Pi, A, SA, dimension);
+    return SA;
+}
+
+template<typename OutputType, typename Dimension>
+void check_exchanges(const sparse_type& A, const dense_type& Al, int N,
+    int S, Dimension dimension, const El::Grid& grid,
+    const std::string& what) {
+
+    dense_type expected = reference(Al, N, S, dimension);
+
+    dense_type SA_alltoall = sketch<OutputType>(A, N, S, dimension,
+        skys::MIXED_EXCHANGE_ALLTOALL, grid);
+    dense_type SA_onesided = sketch<OutputType>(A, N, S, dimension,
+        skys::MIXED_EXCHANGE_ONESIDED, grid);
+
+    // Both exchanges add the contributions in the same order.
+    check(SA_alltoall, SA_onesided, 0.0, what + " alltoall vs one-sided");
+    check(SA_alltoall, expected, 1e-12, what + " alltoall");
+    check(SA_onesided, expected, 1e-12, what + " one-sided");
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+    mpi::communicator world;
+
+    El::Grid grid(world);
+
+    const int m = 101, n = 37, S = 30;
+
+    // The same entries on every rank; each rank keeps its own rows. Some
+    // positions get more than one entry.
+    sparse_type A(m, n, grid);
+    dense_type Al;
+    El::Zeros(Al, m, n);
+    for(int l = 0; l < 600; l++) {
+        int i = (13 * l) % m, j = (l * l + 3 * l) % n;
+        double v = 0.001 * l - 0.3;
+        A.queue_update(i, j, v);
+        Al.Update(i, j, v);
+    }
+    A.finalize();
+
+    check_exchanges<El::DistMatrix<double> >(A, Al, m, S,
+        skys::columnwise_tag(), grid, "[MC, MR] columnwise");
+    check_exchanges<El::DistMatrix<double> >(A, Al, n, S,
+        skys::rowwise_tag(), grid, "[MC, MR] rowwise");
+    check_exchanges<El::DistMatrix<double, El::VC, El::STAR> >(A, Al, m, S,
+        skys::columnwise_tag(), grid, "[VC, STAR] columnwise");
+    check_exchanges<El::DistMatrix<double, El::VC, El::STAR> >(A, Al, n, S,
+        skys::rowwise_tag(), grid, "[VC, STAR] rowwise");
+
+    skys::set_mixed_exchange(skys::MIXED_EXCHANGE_ALLTOALL);
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ *  This test writes matrices to model files in both formats and reads them
+ *  back: distributed matrices through the parallel reads (also into the
+ *  other precision), and local matrices through the memory mapping.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <cstdio>
+#include <string>
+
+namespace skyml = skylark::ml;
+
+template<typename T, typename S>
+void check(const El::Matrix<T>& A, const El::Matrix<S>& B, double tol,
+    const std::string& what) {
+
+    double err = 0.0;
+    for(El::Int j = 0; j < A.Width(); j++)
+        for(El::Int i = 0; i < A.Height(); i++)
+            err = std::max(err,
+                std::abs(double(A.Get(i, j)) - double(B.Get(i, j))));
+    if (A.Height() != B.Height() || A.Width() != B.Width() || err > tol) {
+        std::cout << what << ": error " << err << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+    mpi::communicator world;
+
+    const std::string fname = "model_io_test.dat";
+    const El::Int m = 37, n = 5;
+
+    El::DistMatrix<double> A;
+    El::Uniform(A, m, n);
+    El::Matrix<double> w;
+    El::Uniform(w, 11, 3);
+
+    El::DistMatrix<double, El::STAR, El::STAR> A_STAR_STAR(A);
+    const El::Matrix<double> &Al = A_STAR_STAR.LockedMatrix();
+    mpi::broadcast(world, w.Buffer(), w.Height() * w.Width(), 0);
+
+    const skyml::model_format_t formats[] =
+        { skyml::MODEL_FORMAT_TEXT, skyml::MODEL_FORMAT_BINARY };
+    for(int f = 0; f < 2; f++) {
+        std::string tag = (f == 0) ? "text " : "binary ";
+
+        skyml::model_writer_t writer(formats[f]);
+        boost::property_tree::ptree pt;
+        pt.put("name", "test");
+        writer.put(pt, "A", A);
+        writer.put(pt, "w", w);
+        writer.write(fname, "# Model IO test\n", pt, world);
+
+        skyml::model_reader_t reader(fname, true);
+        const boost::property_tree::ptree &rpt = reader.get_ptree();
+        if (reader.format() != formats[f] ||
+            rpt.get<std::string>("name") != "test")
+            BOOST_FAIL((tag + "format").c_str());
+
+        // Text is printed with limited precision.
+        double tol = (f == 0) ? 1e-5 : 0.0;
+
+        El::DistMatrix<double> B;
+        reader.get(rpt, "A", m, n, B);
+        El::DistMatrix<double, El::STAR, El::STAR> B_STAR_STAR(B);
+        check(Al, B_STAR_STAR.LockedMatrix(), tol, tag + "distributed");
+
+        El::DistMatrix<float> Bf;
+        reader.get(rpt, "A", m, n, Bf);
+        El::DistMatrix<float, El::STAR, El::STAR> Bf_STAR_STAR(Bf);
+        check(Al, Bf_STAR_STAR.LockedMatrix(), 1e-5, tag + "distributed float");
+
+        El::Matrix<double> v;
+        reader.get(rpt, "w", 11, 3, v);
+        check(w, v, tol, tag + "local");
+
+        El::Matrix<float> vf;
+        reader.get(rpt, "w", 11, 3, vf);
+        check(w, vf, 1e-5, tag + "local float");
+
+        world.barrier();
+    }
+
+    if (world.rank() == 0)
+        std::remove(fname.c_str());
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ *  This test checks that reading a libsvm file on several processes (where
+ *  ReadLIBSVM hands over to ParallelReadLIBSVM) gives the same matrices as
+ *  the serial reader, for dense and sparse outputs, both directions, and
+ *  with min_d and max_n. The file has blank and comment lines, which both
+ *  readers skip, so the result does not depend on the number of processes.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+typedef El::Matrix<double> dense_type;
+typedef skylark::base::sparse_vc_star_matrix_t<double> sparse_type;
+
+namespace skyb = skylark::base;
+namespace skyio = skylark::utility::io;
+
+void check(const dense_type& A, const dense_type& expected,
+    const std::string& what) {
+
+    if (A.Height() != expected.Height() || A.Width() != expected.Width()) {
+        std::cout << what << ": " << A.Height() << " x " << A.Width()
+                  << " != " << expected.Height() << " x " << expected.Width()
+                  << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+
+    for(El::Int j = 0; j < A.Width(); j++)
+        for(El::Int i = 0; i < A.Height(); i++)
+            if (A.Get(i, j) != expected.Get(i, j))
+                BOOST_FAIL(what.c_str());
+}
+
+/** All of a distributed matrix, on every rank. */
+template<typename MatrixType>
+dense_type gather(const MatrixType& A) {
+    El::DistMatrix<double, El::STAR, El::STAR> A_star(A);
+    return A_star.Matrix();
+}
+
+/** Reference: the serial reader, on a grid of this process only. */
+void read_serial(const std::string& fname, skyb::direction_t direction,
+    int min_d, int max_n, dense_type& X, dense_type& Y) {
+
+    El::Grid self(El::mpi::COMM_SELF);
+    El::DistMatrix<double, El::VC, El::STAR> Xs(self), Ys(self);
+    skyio::ReadLIBSVM(fname, Xs, Ys, direction, min_d, max_n);
+    X = Xs.Matrix();
+    Y = Ys.Matrix();
+}
+
+/** The serial reader has all examples, blank and comment lines skipped. */
+void check_labels(const dense_type& Y, skyb::direction_t direction,
+    int max_n, const std::string& what) {
+
+    const int n = max_n >= 0 ? max_n : 41;
+    dense_type expected(1, n);
+    for(int e = 0; e < n; e++)
+        expected.Set(0, e, (e % 3) - 1);
+
+    if (direction == skyb::COLUMNS)
+        check(Y, expected, what + " serial Y");
+    else {
+        dense_type expected_t;
+        El::Transpose(expected, expected_t);
+        check(Y, expected_t, what + " serial Y");
+    }
+}
+
+void check_dense(const std::string& fname, const El::Grid& grid,
+    skyb::direction_t direction, int min_d, int max_n,
+    const std::string& what) {
+
+    dense_type X_ref, Y_ref;
+    read_serial(fname, direction, min_d, max_n, X_ref, Y_ref);
+    check_labels(Y_ref, direction, max_n, what);
+
+    El::DistMatrix<double> X(grid), Y(grid);
+    skyio::ReadLIBSVM(fname, X, Y, direction, min_d, max_n);
+    check(gather(X), X_ref, what + " X");
+    check(gather(Y), Y_ref, what + " Y");
+}
+
+void check_sparse(const std::string& fname, const El::Grid& grid,
+    skyb::direction_t direction, int min_d, int max_n,
+    const std::string& what) {
+
+    dense_type X_ref, Y_ref;
+    read_serial(fname, direction, min_d, max_n, X_ref, Y_ref);
+
+    sparse_type X(0, 0, grid);
+    El::DistMatrix<double, El::VC, El::STAR> Y(grid);
+    skyio::ReadLIBSVM(fname, X, Y, direction, min_d, max_n);
+
+    if (X.height() != X_ref.Height() || X.width() != X_ref.Width())
+        BOOST_FAIL((what + " X size").c_str());
+
+    // The local rows of X, densified, against the same rows of X_ref.
+    dense_type L;
+    El::Zeros(L, X.local_height(), X.width());
+    const int *indptr = X.indptr();
+    const int *indices = X.indices();
+    const double *values = X.locked_values();
+    for(El::Int j = 0; j < X.local_width(); j++)
+        for(int k = indptr[j]; k < indptr[j + 1]; k++)
+            L.Set(indices[k], j, L.Get(indices[k], j) + values[k]);
+
+    for(El::Int j = 0; j < L.Width(); j++)
+        for(El::Int i = 0; i < L.Height(); i++)
+            if (L.Get(i, j) != X_ref.Get(X.global_row(i), j))
+                BOOST_FAIL((what + " X").c_str());
+
+    check(gather(Y), Y_ref, what + " Y");
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+    mpi::communicator world;
+
+    El::Grid grid(world);
+
+    // 41 examples with up to 4 features; every fifth one has none, the
+    // first one included. A comment line leads, and blank and comment lines
+    // are spread over the file.
+    std::string fname = "parallel_libsvm_test.txt";
+    if (world.rank() == 0) {
+        std::ofstream out(fname);
+        out << "# generated by parallel_libsvm_test\n";
+        for(int e = 0; e < 41; e++) {
+            if (e % 11 == 4)
+                out << "\n";
+            if (e % 13 == 9)
+                out << "# example " << e << "\n";
+            out << (e % 3) - 1;
+            for(int k = 0; k < e % 5; k++)
+                out << " " << 6 * k + e % 6 + 1 << ":"
+                    << (e + 1) * 1e-3 * (k + 1) - 0.25 * k;
+            out << "\n";
+        }
+    }
+    world.barrier();
+
+    const skyb::direction_t directions[] = { skyb::COLUMNS, skyb::ROWS };
+    for(skyb::direction_t direction : directions) {
+        std::string dir = direction == skyb::COLUMNS ? "columns" : "rows";
+
+        check_dense(fname, grid, direction, 0, -1, "dense " + dir);
+        check_dense(fname, grid, direction, 40, 17,
+            "dense, min_d and max_n, " + dir);
+        check_sparse(fname, grid, direction, 0, -1, "sparse " + dir);
+        check_sparse(fname, grid, direction, 40, 17,
+            "sparse, min_d and max_n, " + dir);
+    }
+
+    world.barrier();
+    if (world.rank() == 0)
+        std::remove(fname.c_str());
+
+    El::Finalize();
+    return 0;
+}
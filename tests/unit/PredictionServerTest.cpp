@@ -0,0 +1,126 @@
+/**
+ *  This test drives the prediction server from a stream of libsvm lines and
+ *  checks its answers (labels, and decision values) against predicting the
+ *  same examples with the model directly. Batches of several sizes are
+ *  used, so requests are split into micro-batches in different ways, and
+ *  an empty batch size is rejected.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace skyml = skylark::ml;
+namespace skys = skylark::sketch;
+
+typedef El::Matrix<double> dense_type;
+
+/** Serves the requests, and returns the answers as lines. */
+std::vector<std::string> serve(const skyml::hilbert_model_t& model,
+    const std::string& requests,
+    const skyml::prediction_server_params_t& params) {
+
+    skyml::prediction_server_t server(model, params);
+    std::istringstream in(requests);
+    std::ostringstream out;
+    server.serve(in, out);
+
+    std::vector<std::string> answers;
+    std::istringstream lines(out.str());
+    std::string line;
+    while (std::getline(lines, line))
+        answers.push_back(line);
+    return answers;
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    const int d = 10, n = 45, S = 20, k = 3;
+
+    // A model of two Gaussian feature maps with random coefficients.
+    typedef skys::GaussianRFT_t<dense_type, dense_type> map_type;
+    skylark::base::context_t context(1234);
+    map_type map1(d, S, 2.0, context), map2(d, S, 3.0, context);
+    std::vector<const map_type *> maps;
+    maps.push_back(&map1);
+    maps.push_back(&map2);
+    skyml::hilbert_model_t model(maps, true, 2 * S, k, false);
+    El::Uniform(model.get_coef(), 2 * S, k);
+
+    // Examples, with a few zero features that the requests leave out.
+    dense_type X;
+    El::Uniform(X, d, n);
+    std::ostringstream requests;
+    requests << std::setprecision(17);
+    for(int j = 0; j < n; j++) {
+        if (j % 3 == 0)
+            X.Set(j % d, j, 0.0);
+        requests << j % k;
+        for(int i = 0; i < d; i++)
+            if (X.Get(i, j) != 0.0)
+                requests << " " << i + 1 << ":" << X.Get(i, j);
+        requests << "\n";
+    }
+
+    dense_type DV;
+    El::Matrix<El::Int> PV;
+    model.predict(X, PV, DV);
+
+    const int batches[] = { 1, 7, 64 };
+    for(int b : batches) {
+        std::string tag = "batch " + std::to_string(b);
+
+        skyml::prediction_server_params_t params(b, 1e-3);
+        std::vector<std::string> labels = serve(model, requests.str(), params);
+        if (labels.size() != size_t(n))
+            BOOST_FAIL((tag + " number of labels").c_str());
+        for(int j = 0; j < n; j++)
+            if (labels[j] != std::to_string(PV.Get(j, 0)))
+                BOOST_FAIL((tag + " labels").c_str());
+
+        params.decision_values = true;
+        std::vector<std::string> values = serve(model, requests.str(), params);
+        if (values.size() != size_t(n))
+            BOOST_FAIL((tag + " number of decision values").c_str());
+        for(int j = 0; j < n; j++) {
+            std::istringstream line(values[j]);
+            for(int c = 0; c < k; c++) {
+                double v;
+                if (!(line >> v) ||
+                    std::abs(v - DV.Get(j, c)) >
+                    1e-5 * std::max(1.0, std::abs(DV.Get(j, c))))
+                    BOOST_FAIL((tag + " decision values").c_str());
+            }
+        }
+    }
+
+    // Batches without room for a request are rejected.
+    bool rejected = false;
+    try {
+        skyml::prediction_server_t server(model,
+            skyml::prediction_server_params_t(0, 1e-3));
+    } catch (skylark::base::skylark_exception ex) {
+        rejected = true;
+    }
+    if (!rejected)
+        BOOST_FAIL("batch 0 accepted");
+
+    skys::set_realized_memory(0);
+
+    El::Finalize();
+    return 0;
+}
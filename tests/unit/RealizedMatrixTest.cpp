@@ -0,0 +1,146 @@
+/**
+ *  This test checks that dense transforms (JLT and Gaussian RFT) give the
+ *  same sketch whether they keep their realized matrix (a budget set with
+ *  sketch::set_realized_memory), realize it on every application, or have
+ *  a budget too small to keep it. Local and [MC, MR] matrices are sketched
+ *  columnwise and rowwise; the latter realize strided parts of the matrix.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <memory>
+#include <string>
+
+typedef El::Matrix<double> dense_type;
+typedef El::DistMatrix<double> dist_type;
+
+void check(const dense_type& C, const dense_type& expected,
+    const std::string& what) {
+
+    dense_type D = C;
+    El::Axpy(-1.0, expected, D);
+    if (El::MaxNorm(D) > 1e-12 * El::MaxNorm(expected)) {
+        std::cout << what << ": error " << El::MaxNorm(D) << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+/** All of the matrix, on every rank. */
+dense_type gather(const dense_type& A) {
+    return A;
+}
+
+dense_type gather(const dist_type& A) {
+    El::DistMatrix<double, El::STAR, El::STAR> A_STAR_STAR(A);
+    return A_STAR_STAR.Matrix();
+}
+
+template<typename MatrixType>
+void resize(MatrixType& SA, const MatrixType& A, int S,
+    skylark::sketch::columnwise_tag) {
+    El::Zeros(SA, S, A.Width());
+}
+
+template<typename MatrixType>
+void resize(MatrixType& SA, const MatrixType& A, int S,
+    skylark::sketch::rowwise_tag) {
+    El::Zeros(SA, A.Height(), S);
+}
+
+/** Transforms from the same seed, so equal apart from the budget. */
+template<typename MatrixType>
+struct jlt_maker_t {
+    typedef skylark::sketch::JLT_t<MatrixType, MatrixType> transform_type;
+
+    transform_type *operator()(int N, int S) const {
+        skylark::base::context_t context(1234);
+        return new transform_type(N, S, context);
+    }
+};
+
+template<typename MatrixType>
+struct rft_maker_t {
+    typedef skylark::sketch::GaussianRFT_t<MatrixType, MatrixType>
+    transform_type;
+
+    transform_type *operator()(int N, int S) const {
+        skylark::base::context_t context(1234);
+        return new transform_type(N, S, 2.0, context);
+    }
+};
+
+template<typename TransformType, typename MatrixType, typename Dimension>
+dense_type sketch(const TransformType& T, const MatrixType& A, int S,
+    Dimension dimension) {
+
+    MatrixType SA;
+    resize(SA, A, S, dimension);
+    T.apply(A, SA, dimension);
+    return gather(SA);
+}
+
+template<template<typename> class Maker, typename MatrixType,
+         typename Dimension>
+void check_realized(const MatrixType& A, int N, int S, Dimension dimension,
+    const std::string& what) {
+
+    typedef typename Maker<MatrixType>::transform_type transform_type;
+    Maker<MatrixType> make;
+
+    skylark::sketch::set_realized_memory(0);
+    std::unique_ptr<transform_type> T0(make(N, S));
+    dense_type expected = sketch(*T0, A, S, dimension);
+
+    // A budget that keeps the matrix (the second application uses the kept
+    // one), and one that is just too small for it.
+    const size_t budgets[] = { size_t(1) << 30, S * N * sizeof(double) - 1 };
+    for(size_t b : budgets) {
+        skylark::sketch::set_realized_memory(b);
+        std::unique_ptr<transform_type> T(make(N, S));
+        std::string tag = what + (b > S * N * sizeof(double) ?
+            " (kept)" : " (not kept)");
+        check(sketch(*T, A, S, dimension), expected, tag);
+        check(sketch(*T, A, S, dimension), expected, tag + " again");
+    }
+
+    skylark::sketch::set_realized_memory(0);
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    const int m = 101, n = 37, S = 30;
+
+    dist_type A;
+    El::Uniform(A, m, n);
+    dense_type Al = gather(A);
+
+    check_realized<jlt_maker_t>(Al, m, S, skylark::sketch::columnwise_tag(),
+        "JLT local columnwise");
+    check_realized<jlt_maker_t>(Al, n, S, skylark::sketch::rowwise_tag(),
+        "JLT local rowwise");
+    check_realized<jlt_maker_t>(A, m, S, skylark::sketch::columnwise_tag(),
+        "JLT [MC, MR] columnwise");
+    check_realized<jlt_maker_t>(A, n, S, skylark::sketch::rowwise_tag(),
+        "JLT [MC, MR] rowwise");
+
+    check_realized<rft_maker_t>(Al, m, S, skylark::sketch::columnwise_tag(),
+        "RFT local columnwise");
+    check_realized<rft_maker_t>(Al, n, S, skylark::sketch::rowwise_tag(),
+        "RFT local rowwise");
+    check_realized<rft_maker_t>(A, m, S, skylark::sketch::columnwise_tag(),
+        "RFT [MC, MR] columnwise");
+    check_realized<rft_maker_t>(A, n, S, skylark::sketch::rowwise_tag(),
+        "RFT [MC, MR] rowwise");
+
+    El::Finalize();
+    return 0;
+}
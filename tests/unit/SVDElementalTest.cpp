@@ -1,4 +1,5 @@
 #include <iostream>
+#include <string>
 #include "boost/program_options.hpp"
 
 #include "config.h"
@@ -6,6 +7,42 @@
 
 namespace po = boost::program_options;
 
+/**
+ * Single-pass ApproximateSVD of an exactly rank r, m x n matrix: the rank r
+ * factorization has to reproduce the matrix.
+ */
+template<typename MatrixType>
+void check_single_pass(int m, int n, int r, const std::string& what) {
+    skylark::base::context_t context(38734);
+
+    MatrixType L, R, A;
+    skylark::base::GaussianMatrix(L, m, r, context);
+    skylark::base::GaussianMatrix(R, r, n, context);
+    El::Zeros(A, m, n);
+    El::Gemm(El::NORMAL, El::NORMAL, 1.0, L, R, 0.0, A);
+
+    skylark::nla::approximate_svd_params_t params;
+    params.single_pass = true;
+
+    MatrixType U, S, V;
+    skylark::nla::ApproximateSVD(A, U, S, V, r, context, params);
+
+    if (U.Height() != m || U.Width() != r || V.Height() != n ||
+        V.Width() != r || S.Height() != r)
+        BOOST_FAIL(("Wrong single-pass factor dimensions, " + what).c_str());
+
+    // A - U diag(S) V^T should vanish.
+    El::DiagonalScale(El::RIGHT, El::NORMAL, S, U);
+    MatrixType D = A;
+    El::Gemm(El::NORMAL, El::ADJOINT, -1.0, U, V, 1.0, D);
+    if (El::FrobeniusNorm(D) > 1e-8 * El::FrobeniusNorm(A)) {
+        std::cout << what << ": relative error " <<
+            El::FrobeniusNorm(D) / El::FrobeniusNorm(A) << std::endl;
+        BOOST_FAIL(("Single-pass SVD does not reproduce a low-rank matrix, "
+                + what).c_str());
+    }
+}
+
 int test_main(int argc, char* argv[]) {
     El::Initialize(argc, argv);
 
@@ -61,6 +98,12 @@ int test_main(int argc, char* argv[]) {
     test::util::check(A_VR_STAR);
     test::util::check(A_STAR_VR);
 
+    // Single-pass approximate SVD, tall and wide.
+    check_single_pass<El::Matrix<double> >(200, 60, 7, "local tall");
+    check_single_pass<El::Matrix<double> >(60, 200, 7, "local wide");
+    check_single_pass<El::DistMatrix<double> >(200, 60, 7, "[MC, MR] tall");
+    check_single_pass<El::DistMatrix<double> >(60, 200, 7, "[MC, MR] wide");
+
     El::Finalize();
     return 0;
 }
@@ -0,0 +1,111 @@
+/**
+ *  This test checks the unscrambled Sobol sequence, point by point and in
+ *  blocks, against boost::random::sobol (from the first point on). The
+ *  scrambled sequence has to stay in [0, 1), differ from the unscrambled
+ *  one, depend only on the seed, and fill blocks like coordinate(). The
+ *  blocks of the leaped Halton sequence have to match its coordinate().
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+#include <boost/version.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#if BOOST_VERSION >= 107100
+#include <boost/random/sobol.hpp>
+#endif
+
+#include <cmath>
+#include <vector>
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+#if BOOST_VERSION >= 107100
+    const size_t d = 40, N = 1000;
+    const size_t b0 = 517, bn = 300, i0 = 5;
+
+    skylark::base::sobol_sequence_t<double> seq(d, false);
+    boost::random::sobol_engine<boost::uint32_t, 32> gen(d);
+
+    std::vector<double> block(N * d), part(bn * (d - i0));
+    seq.fill(0, N, 0, d, block.data());
+    seq.fill(b0, bn, i0, d, part.data());
+
+    for(size_t k = 0; k < N; k++)
+        for(size_t i = 0; i < d; i++) {
+            // Midpoint of the cell of the 32 bit integer point.
+            double expected = (gen() + 0.5) / 4294967296.0;
+
+            if (std::abs(seq.coordinate(k, i) - expected) > 1e-15)
+                BOOST_FAIL("coordinate");
+            if (std::abs(block[k * d + i] - expected) > 1e-15)
+                BOOST_FAIL("fill");
+            if (k >= b0 && k < b0 + bn && i >= i0 &&
+                std::abs(part[(k - b0) * (d - i0) + i - i0] - expected) > 1e-15)
+                BOOST_FAIL("partial fill");
+        }
+
+    // The first point is (the midpoint of the cell of) the center, not the
+    // (degenerate) zero point.
+    if (std::abs(seq.coordinate(0, 0) - 0.5) > 1e-9 ||
+        std::abs(seq.coordinate(0, d - 1) - 0.5) > 1e-9)
+        BOOST_FAIL("first point");
+
+    // Scrambled: same seed, same points; another seed, other points.
+    skylark::base::sobol_sequence_t<double> scrambled(d, true, 1234),
+        same(d, true, 1234), other(d, true, 4321);
+    std::vector<double> sblock(N * d);
+    scrambled.fill(0, N, 0, d, sblock.data());
+
+    size_t moved = 0, reseeded = 0;
+    for(size_t k = 0; k < N; k++)
+        for(size_t i = 0; i < d; i++) {
+            double x = scrambled.coordinate(k, i);
+            if (!(x >= 0.0 && x < 1.0))
+                BOOST_FAIL("scrambled point outside [0, 1)");
+            if (sblock[k * d + i] != x)
+                BOOST_FAIL("scrambled fill");
+            if (same.coordinate(k, i) != x)
+                BOOST_FAIL("scrambled not reproducible");
+            moved += (x != block[k * d + i]);
+            reseeded += (x != other.coordinate(k, i));
+        }
+
+    if (moved < N * d / 2)
+        BOOST_FAIL("scrambled too close to unscrambled");
+    if (reseeded < N * d / 2)
+        BOOST_FAIL("scrambled does not depend on the seed");
+#endif
+
+    // Leaped Halton, from the first point and from an offset, against
+    // coordinate().
+    {
+        const size_t hd = 30, hN = 700, hb0 = 333, hbn = 200, hi0 = 7;
+        skylark::base::leaped_halton_sequence_t<double> halton(hd);
+
+        std::vector<double> hblock(hN * hd), hpart(hbn * (hd - hi0));
+        halton.fill(0, hN, 0, hd, hblock.data());
+        halton.fill(hb0, hbn, hi0, hd, hpart.data());
+
+        for(size_t k = 0; k < hN; k++)
+            for(size_t i = 0; i < hd; i++) {
+                double expected = halton.coordinate(k, i);
+                if (std::abs(hblock[k * hd + i] - expected) > 1e-15)
+                    BOOST_FAIL("Halton fill");
+                if (k >= hb0 && k < hb0 + hbn && i >= hi0 &&
+                    std::abs(hpart[(k - hb0) * (hd - hi0) + i - hi0] -
+                        expected) > 1e-15)
+                    BOOST_FAIL("Halton partial fill");
+            }
+    }
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ *  This test checks the local dense x sparse and sparse x dense Gemm kernels
+ *  in all orientations against El::Gemm on a dense copy of the sparse
+ *  matrix. Shapes are chosen so that both the panel and the register
+ *  blocked kernels, including partial blocks, are exercised, and so are
+ *  the kernels splitting S among the threads (1 to 8 right-hand sides).
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <string>
+
+typedef El::Matrix<double> dense_type;
+typedef skylark::base::sparse_matrix_t<double> sparse_type;
+
+void check(const dense_type& C, const dense_type& expected,
+    const std::string& what) {
+
+    dense_type D = C;
+    El::Axpy(-1.0, expected, D);
+    if (El::MaxNorm(D) > 1e-10 * El::MaxNorm(expected)) {
+        std::cout << what << ": error " << El::MaxNorm(D) << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    const El::Orientation orientations[] = { El::NORMAL, El::TRANSPOSE };
+    const std::string names = "NT";
+
+    // S is 301 x 173, dense operands have 290 (> panel width) or 1 to 8
+    // "free" rows / columns.
+    const int m = 301, n = 173;
+    const int free_dims[] = { 290, 1, 2, 3, 4, 5, 6, 7, 8 };
+
+    sparse_type::coords_t coords;
+    for(int k = 0; k < 5000; k++)
+        coords.push_back(std::make_tuple((13 * k) % m, (k * k + 3 * k) % n,
+                0.001 * k - 1.0));
+    sparse_type S;
+    S.set(coords, m, n);
+
+    dense_type Sd;
+    skylark::base::DenseCopy(S, Sd);
+
+    for(int p : free_dims) {
+
+        for(int a = 0; a < 2; a++)
+            for(int b = 0; b < 2; b++) {
+                El::Orientation oA = orientations[a], oB = orientations[b];
+                std::string tag = std::string() + names[a] + names[b] +
+                    " k = " + std::to_string(p);
+
+                // C = op(A) op(S), A dense.
+                dense_type A;
+                if (oA == El::NORMAL)
+                    El::Uniform(A, p, (oB == El::NORMAL) ? m : n);
+                else
+                    El::Uniform(A, (oB == El::NORMAL) ? m : n, p);
+
+                dense_type C, expected;
+                El::Uniform(C, p, (oB == El::NORMAL) ? n : m);
+                expected = C;
+                skylark::base::Gemm(oA, oB, 1.5, A, S, -0.5, C);
+                El::Gemm(oA, oB, 1.5, A, Sd, -0.5, expected);
+                check(C, expected, "dense x sparse " + tag);
+
+                // C = op(S) op(B), B dense.
+                dense_type B;
+                if (oB == El::NORMAL)
+                    El::Uniform(B, (oA == El::NORMAL) ? n : m, p);
+                else
+                    El::Uniform(B, p, (oA == El::NORMAL) ? n : m);
+
+                El::Uniform(C, (oA == El::NORMAL) ? m : n, p);
+                expected = C;
+                skylark::base::Gemm(oA, oB, 1.5, S, B, -0.5, C);
+                El::Gemm(oA, oB, 1.5, Sd, B, -0.5, expected);
+                check(C, expected, "sparse x dense " + tag);
+            }
+    }
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ *  This test checks that local sparse matrices with 64-bit indices give the
+ *  same results as the (default) 32-bit ones: construction, transposition,
+ *  Gemm, Symm, hashing (CWT) and, with FFTW, PPT sketches, and the binary
+ *  CSC format.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+typedef El::Matrix<double> dense_type;
+typedef skylark::base::sparse_matrix_t<double> sparse32_type;
+typedef skylark::base::sparse_matrix_t<double, int64_t> sparse64_type;
+
+void check(const dense_type& C, const dense_type& expected,
+    const std::string& what) {
+
+    dense_type D = C;
+    El::Axpy(-1.0, expected, D);
+    if (El::MaxNorm(D) > 1e-12 * El::MaxNorm(expected)) {
+        std::cout << what << ": error " << El::MaxNorm(D) << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+template<typename Dimension>
+void check_sketch(const sparse32_type& A32, const sparse64_type& A64, int N,
+    int S, Dimension dimension, const std::string& what) {
+
+    typedef skylark::sketch::CWT_t<sparse32_type, sparse32_type> cwt32_type;
+    typedef skylark::sketch::CWT_t<sparse64_type, sparse64_type> cwt64_type;
+
+    skylark::base::context_t context32(1234), context64(1234);
+    cwt32_type T32(N, S, context32);
+    cwt64_type T64(N, S, context64);
+
+    sparse32_type SA32;
+    sparse64_type SA64;
+    T32.apply(A32, SA32, dimension);
+    T64.apply(A64, SA64, dimension);
+
+    dense_type D32, D64;
+    skylark::base::DenseCopy(SA32, D32);
+    skylark::base::DenseCopy(SA64, D64);
+    check(D64, D32, what);
+}
+
+#if SKYLARK_HAVE_FFTW
+
+template<typename Dimension>
+void check_ppt(const sparse32_type& A32, const sparse64_type& A64, int N,
+    int S, int height, int width, Dimension dimension,
+    const std::string& what) {
+
+    typedef skylark::sketch::PPT_t<sparse32_type, dense_type> ppt32_type;
+    typedef skylark::sketch::PPT_t<sparse64_type, dense_type> ppt64_type;
+
+    skylark::base::context_t context32(1234), context64(1234);
+    ppt32_type T32(N, S, 3, 1.0, 1.0, context32);
+    ppt64_type T64(N, S, 3, 1.0, 1.0, context64);
+
+    dense_type SA32(height, width), SA64(height, width);
+    T32.apply(A32, SA32, dimension);
+    T64.apply(A64, SA64, dimension);
+    check(SA64, SA32, what);
+}
+
+#endif
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    const int m = 301, n = 173, k = 5;
+
+    sparse32_type::coords_t coords32;
+    sparse64_type::coords_t coords64;
+    for(int l = 0; l < 5000; l++) {
+        int i = (13 * l) % m, j = (l * l + 3 * l) % n;
+        coords32.push_back(std::make_tuple(i, j, 0.001 * l - 1.0));
+        coords64.push_back(std::make_tuple(int64_t(i), int64_t(j),
+                0.001 * l - 1.0));
+    }
+    sparse32_type A32;
+    A32.set(coords32, m, n);
+    sparse64_type A64;
+    A64.set(coords64, m, n);
+
+    if (A64.height() != m || A64.width() != n ||
+        A64.nonzeros() != A32.nonzeros())
+        BOOST_FAIL("Structure");
+
+    dense_type A, A64d;
+    skylark::base::DenseCopy(A32, A);
+    skylark::base::DenseCopy(A64, A64d);
+    check(A64d, A, "set");
+
+    // Transpose
+    sparse64_type At64;
+    skylark::base::Transpose(A64, At64);
+    dense_type At, At64d;
+    El::Transpose(A, At);
+    skylark::base::DenseCopy(At64, At64d);
+    check(At64d, At, "transpose");
+
+    // Gemm, both sides.
+    dense_type B, C32, C64;
+    El::Uniform(B, n, k);
+    skylark::base::Gemm(El::NORMAL, El::NORMAL, 1.0, A32, B, C32);
+    skylark::base::Gemm(El::NORMAL, El::NORMAL, 1.0, A64, B, C64);
+    check(C64, C32, "sparse-dense gemm");
+
+    El::Uniform(B, k, m);
+    skylark::base::Gemm(El::NORMAL, El::NORMAL, 1.0, B, A32, C32);
+    skylark::base::Gemm(El::NORMAL, El::NORMAL, 1.0, B, A64, C64);
+    check(C64, C32, "dense-sparse gemm");
+
+    // Symm, on the leading square part.
+    sparse32_type::coords_t sq32;
+    sparse64_type::coords_t sq64;
+    for(size_t l = 0; l < coords32.size(); l++)
+        if (std::get<0>(coords32[l]) < n) {
+            sq32.push_back(coords32[l]);
+            sq64.push_back(coords64[l]);
+        }
+    sparse32_type Sq32;
+    sparse64_type Sq64;
+    Sq32.set(sq32, n, n);
+    Sq64.set(sq64, n, n);
+
+    dense_type Q32, Q64;
+    El::Uniform(B, n, k);
+    El::Zeros(Q32, n, k);
+    El::Zeros(Q64, n, k);
+    skylark::base::Symm(El::LEFT, El::LOWER, 1.0, Sq32, B, Q32);
+    skylark::base::Symm(El::LEFT, El::LOWER, 1.0, Sq64, B, Q64);
+    check(Q64, Q32, "symm");
+
+    // Hashing sketches
+    check_sketch(A32, A64, m, 50, skylark::sketch::columnwise_tag(),
+        "columnwise sketch");
+    check_sketch(A32, A64, n, 40, skylark::sketch::rowwise_tag(),
+        "rowwise sketch");
+
+#if SKYLARK_HAVE_FFTW
+    check_ppt(A32, A64, m, 64, 64, n, skylark::sketch::columnwise_tag(),
+        "columnwise PPT");
+    check_ppt(A32, A64, n, 64, m, 64, skylark::sketch::rowwise_tag(),
+        "rowwise PPT");
+#endif
+
+    // Binary CSC format
+    std::string fname = "sparse_index64_test.csc";
+    skylark::utility::io::WriteCSC(fname, A64);
+    sparse64_type R64;
+    skylark::utility::io::ReadCSC(fname, R64);
+    if (!(R64 == A64))
+        BOOST_FAIL("CSC");
+    std::remove(fname.c_str());
+
+    El::Finalize();
+    return 0;
+}
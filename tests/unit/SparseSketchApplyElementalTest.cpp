@@ -10,6 +10,7 @@
  */
 
 
+#include <cmath>
 #include <vector>
 
 #include <El.hpp>
@@ -50,8 +51,10 @@ int test_main(int argc, char *argv[]) {
     //[> Parameters <]
 
     //FIXME: use random sizes?
-    const size_t n   = 10;
-    const size_t m   = 5;
+    // Large enough for the reduce-scatter paths on 3 processes (they need
+    // S (P - 1) <= N).
+    const size_t n   = 20;
+    const size_t m   = 8;
     const size_t n_s = 6;
     const size_t m_s = 3;
 
@@ -79,6 +82,9 @@ int test_main(int argc, char *argv[]) {
         for( size_t i = 0; i < A.Width(); i++ )
             A.Set(j, i, count++);
 
+    // All of A on every rank, for the reference products.
+    El::DistMatrix<double, El::STAR, El::STAR> A_star(A);
+
 
     //////////////////////////////////////////////////////////////////////////
     //[> Column wise application <]
@@ -89,9 +95,8 @@ int test_main(int argc, char *argv[]) {
     std::vector<double> row_val = Sparse.getRowValues();
 
     // PI generated by random number gen
-    El::DistMatrix<double, El::VR, El::STAR> pi_sketch(grid);
-    El::Uniform(pi_sketch, n_s, n);
-    El::Zero(pi_sketch);
+    El::Matrix<double> pi_sketch;
+    El::Zeros(pi_sketch, n_s, n);
     for(size_t i = 0; i < row_idx.size(); ++i)
         pi_sketch.Set(row_idx[i], i, row_val[i]);
 
@@ -102,11 +107,11 @@ int test_main(int argc, char *argv[]) {
     Sparse.apply(A, sketch_A, skylark::sketch::columnwise_tag());
 
     /* 4. Build structure to compare */
-    El::DistMatrix<double, El::VR, El::STAR> expected_A(grid);
-    El::Uniform (expected_A, n_s, m);
+    El::Matrix<double> expected_A;
+    El::Zeros(expected_A, n_s, m);
     El::Gemm(El::NORMAL, El::NORMAL,
-               1.0, pi_sketch.LockedMatrix(), A.LockedMatrix(),
-               0.0, expected_A.Matrix());
+               1.0, pi_sketch, A_star.LockedMatrix(),
+               0.0, expected_A);
 
     for(size_t j = 0; j < sketch_A.Height(); j++ )
         for(size_t i = 0; i < sketch_A.Width(); i++ )
@@ -128,9 +133,8 @@ int test_main(int argc, char *argv[]) {
     row_val = Sparse_r.getRowValues();
 
     // PI^T generated by random number gen
-    El::DistMatrix<double, El::VR, El::STAR> pi_sketch_r(grid);
-    El::Uniform(pi_sketch_r, m, m_s);
-    El::Zero(pi_sketch_r);
+    El::Matrix<double> pi_sketch_r;
+    El::Zeros(pi_sketch_r, m, m_s);
     for(size_t i = 0; i < row_idx.size(); ++i)
         pi_sketch_r.Set(i, row_idx[i], row_val[i]);
 
@@ -141,11 +145,11 @@ int test_main(int argc, char *argv[]) {
     Sparse_r.apply (A, sketch_A_r, skylark::sketch::rowwise_tag());
 
     /* 4. Build structure to compare */
-    El::DistMatrix<double, El::VR, El::STAR> expected_AR(grid);
-    El::Uniform (expected_AR, n, m_s);
+    El::Matrix<double> expected_AR;
+    El::Zeros(expected_AR, n, m_s);
     El::Gemm(El::NORMAL, El::NORMAL,
-               1.0, A.LockedMatrix(), pi_sketch_r.Matrix(),
-               0.0, expected_AR.Matrix());
+               1.0, A_star.LockedMatrix(), pi_sketch_r,
+               0.0, expected_AR);
 
     for(size_t j = 0; j < sketch_A_r.Height(); j++ )
         for(size_t i = 0; i < sketch_A_r.Width(); i++ )
@@ -156,6 +160,71 @@ int test_main(int argc, char *argv[]) {
             }
 
 
+    //////////////////////////////////////////////////////////////////////////
+    //[> [MC, MR], [VC, STAR] and [STAR, VC] (reduce-scatter) applications <]
+
+    typedef El::DistMatrix<double> MCMRMatrixType;
+    typedef El::DistMatrix<double, El::VC, El::STAR> VCMatrixType;
+    typedef El::DistMatrix<double, El::STAR, El::VC> STARVCMatrixType;
+
+    MCMRMatrixType A_mcmr = A;
+    VCMatrixType A_vc = A;
+    STARVCMatrixType A_starvc = A;
+
+    // Same seed and order: the columnwise transforms have the same data,
+    // and so do the rowwise ones.
+    skylark::base::context_t context_mcmr(1), context_vc(1);
+    Dummy_t<MCMRMatrixType> Sparse_mcmr(n, n_s, context_mcmr);
+    Dummy_t<VCMatrixType> Sparse_vc(n, n_s, context_vc);
+    Dummy_t<MCMRMatrixType> Sparse_mcmr_r(m, m_s, context_mcmr);
+    Dummy_t<STARVCMatrixType> Sparse_starvc_r(m, m_s, context_vc);
+
+    El::Matrix<double> pi_c, pi_r;
+    El::Zeros(pi_c, n_s, n);
+    row_idx = Sparse_mcmr.getRowIdx();
+    row_val = Sparse_mcmr.getRowValues();
+    for(size_t i = 0; i < row_idx.size(); ++i)
+        pi_c.Set(row_idx[i], i, row_val[i]);
+    El::Zeros(pi_r, m, m_s);
+    row_idx = Sparse_mcmr_r.getRowIdx();
+    row_val = Sparse_mcmr_r.getRowValues();
+    for(size_t i = 0; i < row_idx.size(); ++i)
+        pi_r.Set(i, row_idx[i], row_val[i]);
+
+    El::Matrix<double> expected_c, expected_r;
+    El::Zeros(expected_c, n_s, m);
+    El::Gemm(El::NORMAL, El::NORMAL, 1.0, pi_c, A_star.LockedMatrix(),
+        0.0, expected_c);
+    El::Zeros(expected_r, n, m_s);
+    El::Gemm(El::NORMAL, El::NORMAL, 1.0, A_star.LockedMatrix(), pi_r,
+        0.0, expected_r);
+
+    MCMRMatrixType sketch_mcmr(n_s, m, grid), sketch_mcmr_r(n, m_s, grid);
+    Sparse_mcmr.apply(A_mcmr, sketch_mcmr, skylark::sketch::columnwise_tag());
+    Sparse_mcmr_r.apply(A_mcmr, sketch_mcmr_r, skylark::sketch::rowwise_tag());
+
+    VCMatrixType sketch_vc(n_s, m, grid);
+    Sparse_vc.apply(A_vc, sketch_vc, skylark::sketch::columnwise_tag());
+
+    STARVCMatrixType sketch_starvc_r(n, m_s, grid);
+    Sparse_starvc_r.apply(A_starvc, sketch_starvc_r,
+        skylark::sketch::rowwise_tag());
+
+    for(size_t j = 0; j < n_s; j++)
+        for(size_t i = 0; i < m; i++)
+            if (std::abs(sketch_mcmr.Get(j, i) - expected_c.Get(j, i)) > 1e-12 ||
+                std::abs(sketch_vc.Get(j, i) - expected_c.Get(j, i)) > 1e-12)
+                BOOST_FAIL("Result of [MC, MR]/[VC, STAR] colwise application "
+                    "not as expected");
+
+    for(size_t j = 0; j < n; j++)
+        for(size_t i = 0; i < m_s; i++)
+            if (std::abs(sketch_mcmr_r.Get(j, i) - expected_r.Get(j, i)) > 1e-12 ||
+                std::abs(sketch_starvc_r.Get(j, i) - expected_r.Get(j, i)) > 1e-12)
+                BOOST_FAIL("Result of [MC, MR]/[STAR, VC] rowwise application "
+                    "not as expected");
+
+
     El::Finalize();
     return 0;
 }
@@ -0,0 +1,95 @@
+/**
+ *  This test checks the local sparse Symm, from both sides and with both
+ *  triangles, against El::Symm on a dense copy of the sparse matrix. The
+ *  sparse matrix is not symmetric, so referencing the wrong triangle shows.
+ *  The numbers of right-hand sides cover the unrolled and generic kernels.
+ *  Symm is also called from inside a parallel region, where its own region
+ *  gets a smaller team.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <string>
+
+typedef El::Matrix<double> dense_type;
+typedef skylark::base::sparse_matrix_t<double> sparse_type;
+
+void check(const dense_type& C, const dense_type& expected,
+    const std::string& what) {
+
+    dense_type D = C;
+    El::Axpy(-1.0, expected, D);
+    if (El::MaxNorm(D) > 1e-10 * El::MaxNorm(expected)) {
+        std::cout << what << ": error " << El::MaxNorm(D) << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    const int n = 301;
+    const int rhs[] = { 1, 4, 7, 8, 33 };
+
+    sparse_type::coords_t coords;
+    for(int k = 0; k < 3000; k++)
+        coords.push_back(std::make_tuple((13 * k) % n, (k * k + 3 * k) % n,
+                0.001 * k - 1.0));
+    sparse_type S;
+    S.set(coords, n, n);
+
+    dense_type Sd;
+    skylark::base::DenseCopy(S, Sd);
+
+    const El::UpperOrLower uplos[] = { El::LOWER, El::UPPER };
+    for(int u = 0; u < 2; u++)
+        for(int r = 0; r < 5; r++) {
+            std::string tag = std::string(u == 0 ? "lower" : "upper") +
+                " k = " + std::to_string(rhs[r]);
+
+            dense_type B, C, expected;
+            El::Uniform(B, n, rhs[r]);
+            El::Uniform(C, n, rhs[r]);
+            expected = C;
+            skylark::base::Symm(El::LEFT, uplos[u], 1.5, S, B, -0.5, C);
+            El::Symm(El::LEFT, uplos[u], 1.5, Sd, B, -0.5, expected);
+            check(C, expected, "left " + tag);
+
+            El::Uniform(B, rhs[r], n);
+            El::Uniform(C, rhs[r], n);
+            expected = C;
+            skylark::base::Symm(El::RIGHT, uplos[u], 1.5, S, B, -0.5, C);
+            El::Symm(El::RIGHT, uplos[u], 1.5, Sd, B, -0.5, expected);
+            check(C, expected, "right " + tag);
+        }
+
+    dense_type B, expected;
+    El::Uniform(B, n, 8);
+    El::Zeros(expected, n, 8);
+    El::Symm(El::LEFT, El::LOWER, 1.0, Sd, B, 0.0, expected);
+
+    int ok = 1;
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel num_threads(2) reduction(&:ok)
+#   endif
+    {
+        dense_type C;
+        El::Zeros(C, n, 8);
+        skylark::base::Symm(El::LEFT, El::LOWER, 1.0, S, B, 0.0, C);
+        El::Axpy(-1.0, expected, C);
+        ok &= El::MaxNorm(C) <= 1e-10 * El::MaxNorm(expected);
+    }
+    if (!ok)
+        BOOST_FAIL("symm inside a parallel region");
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ *  This test checks the (multithreaded) sparse Transpose against the dense
+ *  one, the caching of the CSR companion, and the rowwise hashing sketch of
+ *  local sparse matrices (which goes through the companion) against the
+ *  same sketch of a dense copy.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <string>
+
+typedef El::Matrix<double> dense_type;
+typedef skylark::base::sparse_matrix_t<double> sparse_type;
+
+void check(const dense_type& C, const dense_type& expected,
+    const std::string& what) {
+
+    dense_type D = C;
+    El::Axpy(-1.0, expected, D);
+    if (El::MaxNorm(D) > 1e-12 * El::MaxNorm(expected)) {
+        std::cout << what << ": error " << El::MaxNorm(D) << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    // Wide, tall, and with (many) empty rows and columns.
+    const int shapes[][3] = { { 301, 173, 5000 }, { 17, 4000, 30000 },
+                              { 5000, 31, 2000 }, { 1000, 1000, 100 } };
+
+    for(int s = 0; s < 4; s++) {
+        const int m = shapes[s][0], n = shapes[s][1];
+        std::string tag = std::to_string(m) + " x " + std::to_string(n);
+
+        sparse_type::coords_t coords;
+        for(int k = 0; k < shapes[s][2]; k++)
+            coords.push_back(std::make_tuple((13 * k) % m,
+                    (k * k + 3 * k) % n, 0.001 * k - 1.0));
+        sparse_type A;
+        A.set(coords, m, n);
+
+        dense_type Ad, At, Bd;
+        skylark::base::DenseCopy(A, Ad);
+        El::Transpose(Ad, At);
+
+        sparse_type B;
+        skylark::base::Transpose(A, B);
+        skylark::base::DenseCopy(B, Bd);
+        check(Bd, At, "transpose " + tag);
+
+        // Row indices come out sorted.
+        for(int c = 0; c < B.width(); c++)
+            for(int l = B.indptr()[c] + 1; l < B.indptr()[c + 1]; l++)
+                if (B.indices()[l - 1] >= B.indices()[l])
+                    BOOST_FAIL(("unsorted transpose " + tag).c_str());
+
+        // CSR companion
+        if (A.has_transposed())
+            BOOST_FAIL("companion built too early");
+        const sparse_type& T = A.transposed();
+        if (!(T == B) || &A.transposed() != &T)
+            BOOST_FAIL(("companion " + tag).c_str());
+
+        // Rowwise sketch through the companion.
+        skylark::base::context_t context1(1234), context2(1234);
+        skylark::sketch::CWT_t<sparse_type, dense_type> Ss(n, 40, context1);
+        skylark::sketch::CWT_t<dense_type, dense_type> Sd(n, 40, context2);
+        dense_type SA(m, 40), SAd(m, 40);
+        Ss.apply(A, SA, skylark::sketch::rowwise_tag());
+        Sd.apply(Ad, SAd, skylark::sketch::rowwise_tag());
+        check(SA, SAd, "rowwise sketch " + tag);
+
+        // Modifiable values drop the companion.
+        A.values();
+        if (A.has_transposed())
+            BOOST_FAIL("companion not dropped");
+    }
+
+    El::Finalize();
+    return 0;
+}
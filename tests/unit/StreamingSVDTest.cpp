@@ -0,0 +1,165 @@
+/**
+ *  This test checks StreamingApproximateSVD on an exactly low-rank matrix
+ *  served in row blocks of uneven heights from memory: the rank-r
+ *  approximation has to reproduce the matrix. The same blocks, written as a
+ *  directory of libsvm files and streamed by libsvm_dir_block_reader_t,
+ *  have to give the same factorization.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+typedef El::Matrix<double> dense_type;
+
+struct memory_block_reader_t :
+    public skylark::utility::io::row_block_reader_t<dense_type> {
+
+    memory_block_reader_t(const dense_type& A, const std::vector<int>& splits)
+        : _A(A), _splits(splits) {
+
+    }
+
+    int num_blocks() const { return _splits.size() - 1; }
+
+    int width() const { return _A.Width(); }
+
+    void read(int b, dense_type& Ab) {
+        dense_type view;
+        El::LockedView(view, _A, _splits[b], 0,
+            _splits[b + 1] - _splits[b], _A.Width());
+        El::Copy(view, Ab);
+    }
+
+private:
+    const dense_type& _A;
+    std::vector<int> _splits;
+};
+
+/** U diag(S) V^T */
+dense_type product(const dense_type& U, const dense_type& S,
+    const dense_type& V) {
+
+    dense_type US = U, A;
+    El::DiagonalScale(El::RIGHT, El::NORMAL, S, US);
+    El::Zeros(A, U.Height(), V.Height());
+    El::Gemm(El::NORMAL, El::ADJOINT, 1.0, US, V, 0.0, A);
+    return A;
+}
+
+#if SKYLARK_HAVE_BOOST_FILESYSTEM
+
+/** Writes the row blocks of A as libsvm files, in file name order. */
+void write_libsvm_dir(const std::string& dname, const dense_type& A,
+    const std::vector<int>& splits) {
+
+    boost::filesystem::remove_all(dname);
+    boost::filesystem::create_directory(dname);
+    for(size_t b = 0; b + 1 < splits.size(); b++) {
+        std::ofstream out(dname + "/block" + (b < 10 ? "0" : "") +
+            std::to_string(b) + ".txt");
+        out << std::setprecision(17);
+        for(int i = splits[b]; i < splits[b + 1]; i++) {
+            out << 1;
+            for(int j = 0; j < A.Width(); j++)
+                out << " " << j + 1 << ":" << A.Get(i, j);
+            out << "\n";
+        }
+    }
+}
+
+#endif
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    skylark::base::context_t context(38734);
+
+    const int m = 500, n = 120, r = 10;
+
+    dense_type L, R, A;
+    skylark::base::GaussianMatrix(L, m, r, context);
+    skylark::base::GaussianMatrix(R, r, n, context);
+    El::Gemm(El::NORMAL, El::NORMAL, 1.0, L, R, A);
+
+    int splits[] = { 0, 1, 77, 200, 201, 450, 500 };
+    std::vector<int> block_splits(splits,
+        splits + sizeof(splits) / sizeof(int));
+    memory_block_reader_t reader(A, block_splits);
+
+    // No power iterations, two power iterations, and single pass.
+    for(int c = 0; c < 3; c++) {
+        skylark::nla::approximate_svd_params_t params;
+        params.num_iterations = (c == 1) ? 2 : 0;
+        params.single_pass = (c == 2);
+
+        dense_type U, S, V;
+        skylark::nla::StreamingApproximateSVD(reader, U, S, V, r, context,
+            params);
+
+        if (U.Height() != m || U.Width() != r || V.Height() != n ||
+            V.Width() != r || S.Height() != r)
+            BOOST_FAIL("Wrong factor dimensions");
+
+        // A - U diag(S) V^T should vanish.
+        El::DiagonalScale(El::RIGHT, El::NORMAL, S, U);
+        dense_type D = A;
+        El::Gemm(El::NORMAL, El::ADJOINT, -1.0, U, V, 1.0, D);
+        if (El::FrobeniusNorm(D) > 1e-8 * El::FrobeniusNorm(A)) {
+            std::cout << "Relative error " <<
+                El::FrobeniusNorm(D) / El::FrobeniusNorm(A) << std::endl;
+            BOOST_FAIL("Streaming SVD does not reproduce a low-rank matrix");
+        }
+    }
+
+#if SKYLARK_HAVE_BOOST_FILESYSTEM
+
+    // The blocks from libsvm files (written exactly), against the blocks
+    // from memory, with the same seed.
+    const std::string dname = "streaming_svd_test_dir";
+    write_libsvm_dir(dname, A, block_splits);
+
+    skylark::utility::io::libsvm_dir_block_reader_t<dense_type>
+        dir_reader(dname);
+    if (dir_reader.num_blocks() != reader.num_blocks() ||
+        dir_reader.width() != n)
+        BOOST_FAIL("Wrong directory reader dimensions");
+
+    for(int c = 0; c < 3; c++) {
+        skylark::nla::approximate_svd_params_t params;
+        params.num_iterations = (c == 1) ? 2 : 0;
+        params.single_pass = (c == 2);
+
+        dense_type U, S, V, Ud, Sd, Vd;
+        skylark::base::context_t memory_context(1234), dir_context(1234);
+        skylark::nla::StreamingApproximateSVD(reader, U, S, V, r,
+            memory_context, params);
+        skylark::nla::StreamingApproximateSVD(dir_reader, Ud, Sd, Vd, r,
+            dir_context, params);
+
+        dense_type D = product(Ud, Sd, Vd);
+        El::Axpy(-1.0, product(U, S, V), D);
+        El::Axpy(-1.0, S, Sd);
+        if (El::FrobeniusNorm(D) > 1e-10 * El::FrobeniusNorm(A) ||
+            El::MaxNorm(Sd) > 1e-10 * El::MaxNorm(S))
+            BOOST_FAIL("Directory and memory streaming SVDs differ");
+    }
+
+    boost::filesystem::remove_all(dname);
+
+#endif
+
+    El::Finalize();
+    return 0;
+}
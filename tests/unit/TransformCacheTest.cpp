@@ -0,0 +1,141 @@
+/**
+ *  This test checks the cache of feature matrices used by BlockADMMSolver:
+ *  bfloat16 rounding (to nearest even, NaNs kept), how partitions are split
+ *  between memory, the scratch file and recomputation under a budget, that
+ *  stored partitions load back (exactly, or rounded to the precision), and
+ *  that native precision loads are views of the cache.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <El.hpp>
+#include <skylark.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef El::Matrix<double> dense_type;
+typedef skylark::ml::transform_cache_t<double> cache_type;
+
+namespace skyml = skylark::ml;
+
+float from_bits(uint32_t bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+void check_bfloat16(uint32_t in, uint16_t expected, const std::string& what) {
+    uint16_t out = skyml::detail::float_to_bfloat16(from_bits(in));
+    if (out != expected) {
+        std::cout << what << ": " << std::hex << out << " != " << expected
+                  << std::dec << std::endl;
+        BOOST_FAIL(what.c_str());
+    }
+}
+
+/** Z(i, j) of partition j, rounded as the precision does. */
+double expected_entry(skyml::transform_cache_precision_t precision,
+    const dense_type& Z, int i, int j) {
+
+    switch (precision) {
+    case skyml::CACHE_FLOAT:
+        return float(Z.Get(i, j));
+    case skyml::CACHE_BFLOAT16:
+        return skyml::detail::bfloat16_to_float(
+            skyml::detail::float_to_bfloat16(float(Z.Get(i, j))));
+    default:
+        return Z.Get(i, j);
+    }
+}
+
+int test_main(int argc, char *argv[]) {
+
+    El::Initialize(argc, argv);
+
+    namespace mpi = boost::mpi;
+    mpi::environment env(argc, argv);
+
+    // Round to nearest, ties to even (on the lowest kept bit).
+    check_bfloat16(0x3f800000u, 0x3f80, "exact");
+    check_bfloat16(0x3f807fffu, 0x3f80, "below half");
+    check_bfloat16(0x3f808000u, 0x3f80, "half, to even (down)");
+    check_bfloat16(0x3f808001u, 0x3f81, "above half");
+    check_bfloat16(0x3f818000u, 0x3f82, "half, to even (up)");
+    check_bfloat16(0xbf818000u, 0xbf82, "negative half, to even");
+    check_bfloat16(0x7f7fffffu, 0x7f80, "overflow to infinity");
+    check_bfloat16(0x7f800000u, 0x7f80, "infinity");
+
+    // NaNs stay NaNs, also if only low mantissa bits are set (truncating or
+    // rounding those would give infinity).
+    const uint32_t nans[] = { 0x7fc00000u, 0x7f800001u, 0xff80ffffu,
+                              0x7fffffffu };
+    for(uint32_t nan : nans) {
+        float f = skyml::detail::bfloat16_to_float(
+            skyml::detail::float_to_bfloat16(from_bits(nan)));
+        if (!std::isnan(f))
+            BOOST_FAIL("NaN");
+    }
+
+    // Three partitions of 10, 20 and 30 rows with 5 columns, in double:
+    // 400, 800 and 1200 bytes.
+    const int n = 5;
+    const std::vector<El::Int> heights = { 10, 20, 30 };
+    std::vector<dense_type> Z(heights.size());
+    for(size_t j = 0; j < heights.size(); j++)
+        El::Uniform(Z[j], heights[j], n);
+
+    // With a budget of 1300 bytes the first two partitions are in memory;
+    // the third is spilled if there is a scratch directory, and not cached
+    // otherwise. No budget keeps all in memory.
+    const std::string scratches[] = { "", "." };
+    const size_t budgets[] = { 0, 1300 };
+    for(size_t budget : budgets)
+        for(const std::string& scratch : scratches) {
+            cache_type cache(heights, n, skyml::CACHE_NATIVE, budget,
+                scratch);
+            for(int j = 0; j < 3; j++) {
+                bool in_memory = budget == 0 || j < 2;
+                bool cached = in_memory || !scratch.empty();
+                if (cache.in_memory(j) != in_memory ||
+                    cache.cached(j) != cached)
+                    BOOST_FAIL("Budget split");
+            }
+        }
+
+    const skyml::transform_cache_precision_t precisions[] = {
+        skyml::CACHE_NATIVE, skyml::CACHE_FLOAT, skyml::CACHE_BFLOAT16 };
+    for(skyml::transform_cache_precision_t precision : precisions) {
+        // The last partition in the scratch file.
+        cache_type cache(heights, n, precision, 1300, ".");
+        for(int j = 0; j < 3; j++)
+            cache.store(j, Z[j]);
+
+        for(int j = 0; j < 3; j++) {
+            dense_type L;
+            cache.load(j, L);
+            if (L.Height() != heights[j] || L.Width() != n)
+                BOOST_FAIL("Loaded size");
+            for(int c = 0; c < n; c++)
+                for(int i = 0; i < heights[j]; i++)
+                    if (L.Get(i, c) != expected_entry(precision, Z[j], i, c))
+                        BOOST_FAIL("Loaded values");
+
+            // Native precision: a view of the cache, no copy.
+            if (precision == skyml::CACHE_NATIVE) {
+                dense_type L2;
+                cache.load(j, L2);
+                if (L.LockedBuffer() != L2.LockedBuffer() ||
+                    L.LockedBuffer() == Z[j].LockedBuffer())
+                    BOOST_FAIL("Native load is not a view of the cache");
+            }
+        }
+    }
+
+    El::Finalize();
+    return 0;
+}
@@ -1,44 +1,47 @@
 
 #include <fftw3.h>
+
+/**
+ * Real-to-real FFTW transform. Matrices are transformed in place without
+ * transposing them, 16 columns or rows at a time by one batched
+ * (fftw_plan_many_r2r) plan. Plans come from the process-wide plan cache
+ * (see fftw_plan_cache.hpp), one per size and kind, so only the first
+ * transform of a given size pays for planning.
+ */
 template < typename ValueType,
            typename PlanType, typename KindType,
            KindType Kind, KindType KindInverse,
-           PlanType (*PlanFun)(int, ValueType*, ValueType*, KindType, unsigned),
            void (*ExecuteFun)(PlanType, ValueType*, ValueType*),
-           void (*DestroyFun)(PlanType),
            int ScaleVal >
 struct fftw_r2r_fut_t {
 
+    typedef internal::fftw_plan_cache_t<ValueType> plan_cache_type;
+    typedef typename plan_cache_type::precision_type precision_type;
+
     fftw_r2r_fut_t<ValueType,
                    PlanType, KindType,
                    Kind, KindInverse,
-                   PlanFun, ExecuteFun, DestroyFun, ScaleVal>(int N) : _N(N) {
-        ValueType *tmp = new ValueType[N];
-        _plan = PlanFun(N, tmp, tmp, Kind, FFTW_UNALIGNED | FFTW_ESTIMATE);
-        _plan_inverse = PlanFun(N, tmp, tmp, KindInverse,
-            FFTW_UNALIGNED | FFTW_ESTIMATE);
-        delete[] tmp;
-
-        // TODO: detect failure to form plans.
+                   ExecuteFun, ScaleVal>(int N) : _N(N) {
+
     }
 
+    // Plans are owned by the cache.
     virtual ~fftw_r2r_fut_t<ValueType,
                             PlanType, KindType,
                             Kind, KindInverse,
-                            PlanFun, ExecuteFun, DestroyFun, ScaleVal>() {
-        DestroyFun(_plan);
-        DestroyFun(_plan_inverse);
+                            ExecuteFun, ScaleVal>() {
+
     }
 
 
     template <typename Dimension>
     void apply(El::Matrix<ValueType>& A, Dimension dimension) const {
-        return apply_impl (A, dimension);
+        return apply_impl (A, Kind, dimension);
     }
 
     template <typename Dimension>
     void apply_inverse(El::Matrix<ValueType>& A, Dimension dimension) const {
-        return apply_inverse_impl (A, dimension);
+        return apply_impl (A, KindInverse, dimension);
     }
 
     double scale() const {
@@ -47,69 +50,133 @@ struct fftw_r2r_fut_t {
 
 private:
 
-    void apply_impl(El::Matrix<ValueType>& A,
+    void apply_impl(El::Matrix<ValueType>& A, KindType kind,
                     skylark::sketch::columnwise_tag) const {
-        ValueType* AA = A.Buffer();
-        int j;
-
-#       ifdef SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for private(j)
-#       endif
-        for (j = 0; j < A.Width(); j++)
-            ExecuteFun(_plan, AA + j * A.LDim(), AA + j * A.LDim());
+        execute_many(kind, A.Buffer(), A.Width(), 1, A.LDim());
     }
 
-    void apply_inverse_impl(El::Matrix<ValueType>& A,
-                            skylark::sketch::columnwise_tag) const {
-        ValueType* AA = A.Buffer();
-        int j;
-
-#       ifdef SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for private(j)
-#       endif
-        for (j = 0; j < A.Width(); j++)
-            ExecuteFun(_plan_inverse, AA + j * A.LDim(), AA + j * A.LDim());
+    void apply_impl(El::Matrix<ValueType>& A, KindType kind,
+                    skylark::sketch::rowwise_tag) const {
+        execute_many(kind, A.Buffer(), A.Height(), A.LDim(), 1);
     }
 
-    void apply_impl(El::Matrix<ValueType>& A,
-                    skylark::sketch::rowwise_tag) const {
-        // Using transpositions instead of moving to the advanced interface
-        // of FFTW
-        El::Matrix<ValueType> matrix;
-        El::Transpose(A, matrix);
-        ValueType* matrix_buffer = matrix.Buffer();
-        int j;
+    /**
+     * In-place transform of howmany vectors of length _N, with elements
+     * stride apart and consecutive vectors dist apart. The vectors go
+     * through the batched plan of the cache (r2r_block), a block at a time:
+     * in place if they are the columns of an aligned matrix whose leading
+     * dimension is the block pitch, otherwise copied to an aligned buffer
+     * of the thread and back. A last, partial block is transformed one
+     * vector at a time with the 1D plans. All plans are fetched before the
+     * parallel region, so threads never wait for the planner.
+     */
+    void execute_many(KindType kind, ValueType* A,
+                      int howmany, int stride, int dist) const {
+        if (howmany == 0 || _N == 0)
+            return;
+
+        plan_cache_type &cache = plan_cache_type::instance();
+        const int block = plan_cache_type::block_size;
+        const size_t pitch = plan_cache_type::block_pitch(_N);
+        const int nblocks = (howmany + block - 1) / block;
+        const int tail = howmany % block;
+        const bool columns = stride == 1;
+        const bool direct = columns && static_cast<size_t>(dist) == pitch &&
+            precision_type::aligned(A);
+
+        PlanType block_plan =
+            howmany >= block ? cache.r2r_block(_N, kind) : nullptr;
+
+        // 1D plans for the partial block. Its rows are transformed in the
+        // buffer, its columns in place, aligned or not.
+        bool any_aligned = !columns && tail > 0, any_unaligned = false;
+        for (int v = howmany - tail; columns && v < howmany; v++)
+            if (precision_type::aligned(A + static_cast<size_t>(v) * dist))
+                any_aligned = true;
+            else
+                any_unaligned = true;
+        PlanType plan =
+            any_aligned ? cache.r2r(_N, kind, true) : nullptr;
+        PlanType unaligned_plan =
+            any_unaligned ? cache.r2r(_N, kind, false) : nullptr;
+
+        // Whether any block goes through the buffer.
+        const bool buffered = !direct && (!columns || howmany >= block);
 
 #       ifdef SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for private(j)
+#       pragma omp parallel if (nblocks > 1)
 #       endif
-        for (j = 0; j < matrix.Width(); j++)
-            ExecuteFun(_plan, matrix_buffer + j * matrix.LDim(),
-                matrix_buffer + j * matrix.LDim());
-        El::Transpose(matrix, A);
+        {
+            ValueType *buf =
+                buffered ? precision_type::allocate(pitch * block) : nullptr;
+
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp for schedule(static)
+#           endif
+            for (int b = 0; b < nblocks; b++) {
+                ValueType *x = A + static_cast<size_t>(b) * block * dist;
+                const int count = std::min(block, howmany - b * block);
+
+                if (count < block && columns) {
+                    for (int v = 0; v < count; v++) {
+                        ValueType *xv = x + static_cast<size_t>(v) * dist;
+                        ExecuteFun(precision_type::aligned(xv) ?
+                            plan : unaligned_plan, xv, xv);
+                    }
+                    continue;
+                }
+
+                if (direct) {
+                    ExecuteFun(block_plan, x, x);
+                    continue;
+                }
+
+                gather(x, count, stride, dist, buf, pitch);
+                if (count == block)
+                    ExecuteFun(block_plan, buf, buf);
+                else
+                    for (int v = 0; v < count; v++)
+                        ExecuteFun(plan, buf + v * pitch, buf + v * pitch);
+                scatter(buf, pitch, x, count, stride, dist);
+            }
+
+            if (buffered)
+                precision_type::deallocate(buf);
+        }
     }
 
-    void apply_inverse_impl(El::Matrix<ValueType>& A,
-                            skylark::sketch::rowwise_tag) const {
-        // Using transpositions instead of moving to the advanced interface
-        // of FFTW
-        El::Matrix<ValueType> matrix;
-        El::Transpose(A, matrix);
-        ValueType* matrix_buffer = matrix.Buffer();
-        int j;
+    /// Copies count vectors of x to buf, pitch apart.
+    void gather(const ValueType* x, int count, int stride, int dist,
+                ValueType* buf, size_t pitch) const {
+        if (stride == 1)
+            for (int v = 0; v < count; v++)
+                std::copy(x + static_cast<size_t>(v) * dist,
+                    x + static_cast<size_t>(v) * dist + _N, buf + v * pitch);
+        else
+            for (int j = 0; j < _N; j++) {
+                const ValueType *xj = x + static_cast<size_t>(j) * stride;
+                for (int v = 0; v < count; v++)
+                    buf[v * pitch + j] = xj[v * dist];
+            }
+    }
 
-#       ifdef SKYLARK_HAVE_OPENMP
-#       pragma omp parallel for private(j)
-#       endif
-        for (j = 0; j < matrix.Width(); j++)
-            ExecuteFun(_plan_inverse, matrix_buffer + j * matrix.LDim(),
-                matrix_buffer + j * matrix.LDim());
-        El::Transpose(matrix, A);
+    /// Copies count vectors of buf, pitch apart, back to x.
+    void scatter(const ValueType* buf, size_t pitch, ValueType* x,
+                 int count, int stride, int dist) const {
+        if (stride == 1)
+            for (int v = 0; v < count; v++)
+                std::copy(buf + v * pitch, buf + v * pitch + _N,
+                    x + static_cast<size_t>(v) * dist);
+        else
+            for (int j = 0; j < _N; j++) {
+                ValueType *xj = x + static_cast<size_t>(j) * stride;
+                for (int v = 0; v < count; v++)
+                    xj[v * dist] = buf[v * pitch + j];
+            }
     }
 
 private:
     const int _N;
-    PlanType _plan, _plan_inverse;
 };
 
 
@@ -118,11 +185,11 @@ template<>
 struct fft_futs<double> {
     typedef fftw_r2r_fut_t <
             double, fftw_plan, fftw_r2r_kind, FFTW_REDFT10, FFTW_REDFT01,
-            fftw_plan_r2r_1d, fftw_execute_r2r, fftw_destroy_plan, 2 > DCT_t;
+            fftw_execute_r2r, 2 > DCT_t;
 
     typedef fftw_r2r_fut_t <
             double, fftw_plan, fftw_r2r_kind, FFTW_DHT, FFTW_DHT,
-            fftw_plan_r2r_1d, fftw_execute_r2r, fftw_destroy_plan, 1 > DHT_t;
+            fftw_execute_r2r, 1 > DHT_t;
 };
 
 #endif
@@ -133,11 +200,11 @@ template<>
 struct fft_futs<float> {
     typedef fftw_r2r_fut_t <
             float, fftwf_plan, fftwf_r2r_kind, FFTW_REDFT10, FFTW_REDFT01,
-            fftwf_plan_r2r_1d, fftwf_execute_r2r, fftwf_destroy_plan, 2 > DCT_t;
+            fftwf_execute_r2r, 2 > DCT_t;
 
     typedef fftw_r2r_fut_t <
             float, fftwf_plan, fftwf_r2r_kind, FFTW_DHT, FFTW_DHT,
-            fftwf_plan_r2r_1d, fftwf_execute_r2r, fftwf_destroy_plan, 1 > DHT_t;
+            fftwf_execute_r2r, 1 > DHT_t;
 };
 #else
 template<>
@@ -0,0 +1,355 @@
+#ifndef SKYLARK_FFTW_PLAN_CACHE_HPP
+#define SKYLARK_FFTW_PLAN_CACHE_HPP
+
+#include <fftw3.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "../../sketch/sketch_params.hpp"
+
+namespace skylark { namespace sketch {
+
+namespace internal {
+
+/**
+ * FFTW's planner (and wisdom) is not thread safe, in any precision.
+ */
+inline std::mutex& fftw_planner_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+inline unsigned fftw_planner_flags(fft_planning_t planning) {
+    switch (planning) {
+    case FFT_PLANNING_MEASURE:
+        return FFTW_MEASURE;
+    case FFT_PLANNING_PATIENT:
+        return FFTW_PATIENT;
+    default:
+        return FFTW_ESTIMATE;
+    }
+}
+
+/**
+ * Per-precision entry points of FFTW used by the plan cache.
+ */
+template<typename T>
+struct fftw_precision_t {
+
+};
+
+#ifdef SKYLARK_HAVE_FFTW
+
+template<>
+struct fftw_precision_t<double> {
+    typedef fftw_plan plan_t;
+    typedef fftw_complex complex_t;
+
+    static plan_t plan_r2r(int N, int kind, unsigned flags) {
+        double *tmp = static_cast<double *>(fftw_malloc(sizeof(double) * N));
+        plan_t plan = fftw_plan_r2r_1d(N, tmp, tmp,
+            static_cast<fftw_r2r_kind>(kind), flags);
+        fftw_free(tmp);
+        return plan;
+    }
+
+    static plan_t plan_r2c(int N, unsigned flags) {
+        double *dtmp = static_cast<double *>(fftw_malloc(sizeof(double) * N));
+        complex_t *ctmp =
+            static_cast<complex_t *>(fftw_malloc(sizeof(complex_t) * N));
+        plan_t plan = fftw_plan_dft_r2c_1d(N, dtmp, ctmp, flags);
+        fftw_free(dtmp);
+        fftw_free(ctmp);
+        return plan;
+    }
+
+    static plan_t plan_r2r_many(int N, int kind, int howmany, int dist,
+        unsigned flags) {
+        double *tmp = static_cast<double *>(
+            fftw_malloc(sizeof(double) * dist * howmany));
+        fftw_r2r_kind k = static_cast<fftw_r2r_kind>(kind);
+        plan_t plan = fftw_plan_many_r2r(1, &N, howmany,
+            tmp, nullptr, 1, dist, tmp, nullptr, 1, dist, &k, flags);
+        fftw_free(tmp);
+        return plan;
+    }
+
+    static plan_t plan_c2r(int N, unsigned flags) {
+        double *dtmp = static_cast<double *>(fftw_malloc(sizeof(double) * N));
+        complex_t *ctmp =
+            static_cast<complex_t *>(fftw_malloc(sizeof(complex_t) * N));
+        plan_t plan = fftw_plan_dft_c2r_1d(N, ctmp, dtmp, flags);
+        fftw_free(dtmp);
+        fftw_free(ctmp);
+        return plan;
+    }
+
+    static void destroy(plan_t plan) { fftw_destroy_plan(plan); }
+
+    static double *allocate(size_t n) {
+        return static_cast<double *>(fftw_malloc(sizeof(double) * n));
+    }
+
+    static void deallocate(double *p) { fftw_free(p); }
+
+    static bool aligned(const void *p) {
+        return fftw_alignment_of(
+            const_cast<double *>(static_cast<const double *>(p))) == 0;
+    }
+
+    static bool import_wisdom(const std::string& fname) {
+        return fftw_import_wisdom_from_filename(fname.c_str()) != 0;
+    }
+
+    static bool export_wisdom(const std::string& fname) {
+        return fftw_export_wisdom_to_filename(fname.c_str()) != 0;
+    }
+};
+
+#endif /* SKYLARK_HAVE_FFTW */
+
+#ifdef SKYLARK_HAVE_FFTWF
+
+template<>
+struct fftw_precision_t<float> {
+    typedef fftwf_plan plan_t;
+    typedef fftwf_complex complex_t;
+
+    static plan_t plan_r2r(int N, int kind, unsigned flags) {
+        float *tmp = static_cast<float *>(fftwf_malloc(sizeof(float) * N));
+        plan_t plan = fftwf_plan_r2r_1d(N, tmp, tmp,
+            static_cast<fftwf_r2r_kind>(kind), flags);
+        fftwf_free(tmp);
+        return plan;
+    }
+
+    static plan_t plan_r2c(int N, unsigned flags) {
+        float *dtmp = static_cast<float *>(fftwf_malloc(sizeof(float) * N));
+        complex_t *ctmp =
+            static_cast<complex_t *>(fftwf_malloc(sizeof(complex_t) * N));
+        plan_t plan = fftwf_plan_dft_r2c_1d(N, dtmp, ctmp, flags);
+        fftwf_free(dtmp);
+        fftwf_free(ctmp);
+        return plan;
+    }
+
+    static plan_t plan_r2r_many(int N, int kind, int howmany, int dist,
+        unsigned flags) {
+        float *tmp = static_cast<float *>(
+            fftwf_malloc(sizeof(float) * dist * howmany));
+        fftwf_r2r_kind k = static_cast<fftwf_r2r_kind>(kind);
+        plan_t plan = fftwf_plan_many_r2r(1, &N, howmany,
+            tmp, nullptr, 1, dist, tmp, nullptr, 1, dist, &k, flags);
+        fftwf_free(tmp);
+        return plan;
+    }
+
+    static plan_t plan_c2r(int N, unsigned flags) {
+        float *dtmp = static_cast<float *>(fftwf_malloc(sizeof(float) * N));
+        complex_t *ctmp =
+            static_cast<complex_t *>(fftwf_malloc(sizeof(complex_t) * N));
+        plan_t plan = fftwf_plan_dft_c2r_1d(N, ctmp, dtmp, flags);
+        fftwf_free(dtmp);
+        fftwf_free(ctmp);
+        return plan;
+    }
+
+    static void destroy(plan_t plan) { fftwf_destroy_plan(plan); }
+
+    static float *allocate(size_t n) {
+        return static_cast<float *>(fftwf_malloc(sizeof(float) * n));
+    }
+
+    static void deallocate(float *p) { fftwf_free(p); }
+
+    static bool aligned(const void *p) {
+        return fftwf_alignment_of(
+            const_cast<float *>(static_cast<const float *>(p))) == 0;
+    }
+
+    static bool import_wisdom(const std::string& fname) {
+        return fftwf_import_wisdom_from_filename(fname.c_str()) != 0;
+    }
+
+    static bool export_wisdom(const std::string& fname) {
+        return fftwf_export_wisdom_to_filename(fname.c_str()) != 0;
+    }
+};
+
+#endif /* SKYLARK_HAVE_FFTWF */
+
+/**
+ * Process-wide cache of 1D FFTW plans of one precision.
+ *
+ * Plans are keyed on (size, kind, alignment, planner rigor, batch) and live
+ * until the cache is cleared (or the process ends), so transforms of equal
+ * size share plans and only the first one pays for planning. This is what
+ * makes FFTW_MEASURE/FFTW_PATIENT planning (see set_fft_planning)
+ * affordable.
+ *
+ * Aligned plans are planned on fftw_malloc'ed buffers and may only be
+ * executed on arrays for which aligned() holds; unaligned plans are planned
+ * with FFTW_UNALIGNED and can be executed on any array. Cached plans are
+ * only used through FFTW's new-array execute functions, which are thread
+ * safe.
+ *
+ * Besides single vectors, there is one batched (fftw_plan_many_r2r) plan
+ * per size and kind, for a block of block_size contiguous vectors that are
+ * block_pitch(N) apart. The pitch does not depend on the matrix being
+ * transformed, so one plan serves every shape; callers copy vectors to an
+ * aligned block buffer, or use matrices whose leading dimension is the
+ * pitch.
+ */
+template<typename T>
+class fftw_plan_cache_t {
+public:
+
+    typedef fftw_precision_t<T> precision_type;
+    typedef typename precision_type::plan_t plan_t;
+
+    /// Kinds for complex transforms (r2r kinds are FFTW's, all >= 0).
+    enum { KIND_R2C = -1, KIND_C2R = -2 };
+
+    /// Number of vectors in a block of r2r_block.
+    enum { block_size = 16 };
+
+    /// Distance between the vectors of a block: N, padded to keep each
+    /// vector as aligned as the block.
+    static size_t block_pitch(int N) {
+        return (static_cast<size_t>(N) + 15) / 16 * 16;
+    }
+
+    static fftw_plan_cache_t& instance() {
+        static fftw_plan_cache_t cache;
+        return cache;
+    }
+
+    /**
+     * Real-to-real plan of size N and the given FFTW_R2HC, FFTW_REDFT10, ...
+     * kind, for in-place or out-of-place use.
+     */
+    plan_t r2r(int N, int kind, bool aligned) {
+        return get(N, kind, aligned, 1);
+    }
+
+    /**
+     * Real-to-real plan of size N and the given kind for block_size vectors
+     * at stride 1, block_pitch(N) apart, on aligned arrays.
+     */
+    plan_t r2r_block(int N, int kind) {
+        return get(N, kind, true, block_size);
+    }
+
+    /// Real to half-complex (fftw_plan_dft_r2c_1d) plan of size N.
+    plan_t r2c(int N, bool aligned) {
+        return get(N, KIND_R2C, aligned, 1);
+    }
+
+    /// Half-complex to real (fftw_plan_dft_c2r_1d) plan of size N.
+    plan_t c2r(int N, bool aligned) {
+        return get(N, KIND_C2R, aligned, 1);
+    }
+
+    /**
+     * Destroy all cached plans. Only safe when no transform that got its
+     * plans from the cache is alive.
+     */
+    void clear() {
+        std::lock_guard<std::mutex> lock(fftw_planner_mutex());
+        for(auto it = _plans.begin(); it != _plans.end(); it++)
+            precision_type::destroy(it->second);
+        _plans.clear();
+    }
+
+    ~fftw_plan_cache_t() {
+        clear();
+    }
+
+private:
+
+    typedef std::tuple<int, int, bool, unsigned, int> key_t;
+
+    std::map<key_t, plan_t> _plans;
+
+    fftw_plan_cache_t() {
+        // Construct the mutex first, so it outlives the cache.
+        fftw_planner_mutex();
+    }
+    fftw_plan_cache_t(const fftw_plan_cache_t&);
+    fftw_plan_cache_t& operator=(const fftw_plan_cache_t&);
+
+    plan_t get(int N, int kind, bool aligned, int howmany) {
+        unsigned flags = fftw_planner_flags(get_fft_planning());
+        if (!aligned)
+            flags |= FFTW_UNALIGNED;
+
+        std::lock_guard<std::mutex> lock(fftw_planner_mutex());
+
+        key_t key(N, kind, aligned, flags, howmany);
+        auto it = _plans.find(key);
+        if (it != _plans.end())
+            return it->second;
+
+        plan_t plan;
+        if (kind == KIND_R2C)
+            plan = precision_type::plan_r2c(N, flags);
+        else if (kind == KIND_C2R)
+            plan = precision_type::plan_c2r(N, flags);
+        else if (howmany > 1)
+            plan = precision_type::plan_r2r_many(N, kind, howmany,
+                block_pitch(N), flags);
+        else
+            plan = precision_type::plan_r2r(N, kind, flags);
+
+        if (plan == nullptr)
+            SKYLARK_THROW_EXCEPTION (
+                base::sketch_exception()
+                    << base::error_msg("Unable to create FFTW plan."));
+
+        _plans[key] = plan;
+        return plan;
+    }
+};
+
+} // namespace internal
+
+/**
+ * Import FFTW wisdom of the given precision from a file, typically one
+ * written by ExportFFTWWisdom in an earlier run. Import before creating
+ * transforms: plans already in the cache are not replanned.
+ *
+ * \returns false if the file could not be read or parsed.
+ */
+template<typename T>
+bool ImportFFTWWisdom(const std::string& fname) {
+    std::lock_guard<std::mutex> lock(internal::fftw_planner_mutex());
+    return internal::fftw_precision_t<T>::import_wisdom(fname);
+}
+
+/**
+ * Export the FFTW wisdom of the given precision accumulated so far (all the
+ * plans made by this process, plus imported wisdom) to a file.
+ *
+ * \returns false if the file could not be written.
+ */
+template<typename T>
+bool ExportFFTWWisdom(const std::string& fname) {
+    std::lock_guard<std::mutex> lock(internal::fftw_planner_mutex());
+    return internal::fftw_precision_t<T>::export_wisdom(fname);
+}
+
+/**
+ * Destroy the cached FFTW plans of the given precision. Only safe when no
+ * FFT based transform of that precision is alive.
+ */
+template<typename T>
+void ClearFFTWPlanCache() {
+    internal::fftw_plan_cache_t<T>::instance().clear();
+}
+
+} } /** namespace skylark::sketch */
+
+#endif // SKYLARK_FFTW_PLAN_CACHE_HPP
@@ -22,8 +22,8 @@ namespace skylark { namespace utility {
 // namespace alias
 namespace mpi = boost::mpi;
 
-template<typename T>
-mpi::communicator get_communicator(const base::sparse_matrix_t<T>& A,
+template<typename T, typename I>
+mpi::communicator get_communicator(const base::sparse_matrix_t<T, I>& A,
     mpi::comm_create_kind kind = mpi::comm_attach) {
     return mpi::communicator(MPI_COMM_SELF, kind);
 }
@@ -0,0 +1,123 @@
+#ifndef SKYLARK_BLOCK_READER_HPP
+#define SKYLARK_BLOCK_READER_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace skylark { namespace utility { namespace io {
+
+/**
+ * Access to a matrix stored as a sequence of row blocks (e.g. one block per
+ * file), for algorithms that stream over matrices too large to be held in
+ * memory. Blocks are read in full on every pass, so a block should be a
+ * comfortable fraction of the available memory.
+ *
+ * read() may be called from a thread other than the one that created the
+ * reader (to prefetch the next block), but never concurrently.
+ */
+template<typename BlockType>
+struct row_block_reader_t {
+    typedef BlockType block_type;
+
+    virtual ~row_block_reader_t() {
+
+    }
+
+    /// Number of row blocks.
+    virtual int num_blocks() const = 0;
+
+    /// Number of columns of the matrix (and of every block).
+    virtual int width() const = 0;
+
+    /// Read the b-th row block into A.
+    virtual void read(int b, block_type& A) = 0;
+};
+
+#if SKYLARK_HAVE_BOOST_FILESYSTEM
+
+/**
+ * Row blocks of a directory of files in libsvm format (as read by
+ * ReadDirLIBSVM), one block per file in file name order. Labels are
+ * discarded.
+ */
+template<typename BlockType>
+struct libsvm_dir_block_reader_t : public row_block_reader_t<BlockType> {
+    typedef BlockType block_type;
+    typedef typename utility::typer_t<block_type>::value_type value_type;
+
+    /**
+     * @param dname directory name.
+     * @param width number of columns. If 0, determined by scanning the files
+     *              (the largest feature index).
+     */
+    libsvm_dir_block_reader_t(const std::string& dname, int width = 0) :
+        _width(width) {
+
+        boostfs::path full_path(boostfs::system_complete(boostfs::path(dname)));
+        boostfs::directory_iterator end_iter;
+
+        for(boostfs::directory_iterator dirit(full_path); dirit != end_iter;
+            dirit++) {
+            std::string fname = dirit->path().filename().string();
+            if (fname == "." || fname == ".." || fname[0] == '.')
+                continue;
+            _files.push_back(dirit->path().string());
+        }
+        std::sort(_files.begin(), _files.end());
+
+        if (_width == 0)
+            for(size_t f = 0; f < _files.size(); f++)
+                _width = std::max(_width, scan_width(_files[f]));
+    }
+
+    int num_blocks() const {
+        return _files.size();
+    }
+
+    int width() const {
+        return _width;
+    }
+
+    void read(int b, block_type& A) {
+        El::Matrix<value_type> Y;
+        ReadLIBSVM(_files[b], A, Y, base::ROWS, _width);
+    }
+
+private:
+    std::vector<std::string> _files;
+    int _width;
+
+    /** Largest feature index in a file (indices in a line are sorted). */
+    static int scan_width(const std::string& fname) {
+        std::ifstream in(fname);
+        if ((in.rdstate() & std::ifstream::failbit) != 0)
+            SKYLARK_THROW_EXCEPTION (
+                base::io_exception()
+                    << base::error_msg("Failed to open file " + fname));
+
+        std::string line;
+        int d = 0;
+        while(getline(in, line)) {
+            if (line.length() == 0 || line[0] == '#')
+                continue;
+
+            size_t delim = line.find_last_of(":");
+            if (delim == std::string::npos)
+                continue;
+            size_t t = line.find_last_of(" \t", delim);
+            t = (t == std::string::npos) ? 0 : t + 1;
+            d = std::max(d, atoi(line.substr(t, delim - t).c_str()));
+        }
+
+        return d;
+    }
+};
+
+#endif
+
+} } } // namespace skylark::utility::io
+
+#endif // SKYLARK_BLOCK_READER_HPP
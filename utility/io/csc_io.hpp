@@ -0,0 +1,305 @@
+#ifndef SKYLARK_CSC_IO_HPP
+#define SKYLARK_CSC_IO_HPP
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+
+namespace skylark { namespace utility { namespace io {
+
+namespace internal {
+
+/**
+ * Binary CSC container format (version 1).
+ *
+ * A fixed 128 byte header, followed by indptr (width + 1 entries), indices
+ * and values (nnz entries each). Every array starts at a 64 byte aligned
+ * offset, so that after mapping the file the arrays are properly aligned for
+ * vectorized access. All numbers are in native byte order; the byte order
+ * mark is used to detect files written on a machine with a different one.
+ */
+struct csc_header_t {
+    char magic[8];              /**< "SKYLCSC" */
+    uint32_t byte_order;        /**< 0x01020304 as written */
+    uint32_t version;
+    uint32_t index_size;        /**< sizeof(index_type) */
+    uint32_t value_code;        /**< see csc_value_code_t */
+    int64_t height;
+    int64_t width;
+    int64_t nnz;
+    uint64_t indptr_offset;
+    uint64_t indices_offset;
+    uint64_t values_offset;
+    uint64_t file_size;
+    char reserved[48];
+};
+
+static_assert(sizeof(csc_header_t) == 128, "CSC header must be 128 bytes");
+
+static const char csc_magic[8] = "SKYLCSC";
+static const uint32_t csc_byte_order = 0x01020304;
+static const uint32_t csc_version = 1;
+static const uint64_t csc_alignment = 64;
+
+template<typename T>
+struct csc_value_code_t { };
+
+template<>
+struct csc_value_code_t<float> { static const uint32_t value = 1; };
+
+template<>
+struct csc_value_code_t<double> { static const uint32_t value = 2; };
+
+inline uint64_t csc_align(uint64_t offset) {
+    return (offset + csc_alignment - 1) / csc_alignment * csc_alignment;
+}
+
+/**
+ * Whether an array of count elements of size bytes at offset lies within a
+ * file of file_size bytes (past the header) and is aligned for the element.
+ */
+inline bool csc_array_ok(uint64_t offset, int64_t count, uint64_t size,
+    uint64_t file_size) {
+
+    if (count < 0 || offset < sizeof(csc_header_t) || offset % size != 0 ||
+        offset > file_size)
+        return false;
+    return static_cast<uint64_t>(count) <= (file_size - offset) / size;
+}
+
+} // namespace internal
+
+/**
+ * Writes a local sparse matrix in the binary CSC container format.
+ *
+ * @param fname output file name.
+ * @param A matrix to write.
+ */
+template<typename T, typename I>
+void WriteCSC(const std::string& fname, const base::sparse_matrix_t<T, I>& A) {
+
+    typedef typename base::sparse_matrix_t<T, I>::index_type index_type;
+
+    internal::csc_header_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, internal::csc_magic, sizeof(header.magic));
+    header.byte_order = internal::csc_byte_order;
+    header.version = internal::csc_version;
+    header.index_size = sizeof(index_type);
+    header.value_code = internal::csc_value_code_t<T>::value;
+    header.height = A.height();
+    header.width = A.width();
+    header.nnz = A.nonzeros();
+
+    header.indptr_offset = internal::csc_align(sizeof(header));
+    header.indices_offset = internal::csc_align(header.indptr_offset +
+        (header.width + 1) * sizeof(index_type));
+    header.values_offset = internal::csc_align(header.indices_offset +
+        header.nnz * sizeof(index_type));
+    header.file_size = header.values_offset + header.nnz * sizeof(T);
+
+    std::ofstream out(fname.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception()
+                << base::error_msg("Unable to open file " + fname));
+
+    const char zeros[internal::csc_alignment] = { 0 };
+    uint64_t pos = 0;
+    auto write_at = [&](uint64_t offset, const void *data, uint64_t len) {
+        out.write(zeros, offset - pos);
+        out.write(static_cast<const char *>(data), len);
+        pos = offset + len;
+    };
+
+    write_at(0, &header, sizeof(header));
+    write_at(header.indptr_offset, A.indptr(),
+        (header.width + 1) * sizeof(index_type));
+    write_at(header.indices_offset, A.indices(),
+        header.nnz * sizeof(index_type));
+    write_at(header.values_offset, A.locked_values(), header.nnz * sizeof(T));
+
+    if (!out)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception()
+                << base::error_msg("Error while writing " + fname));
+}
+
+/**
+ * A read-only memory mapping of a file in the binary CSC container format.
+ *
+ * Matrices attached to the mapping are non-owning, read-only views of the
+ * mapped pages, so loading is essentially free and ranks on the same node
+ * share the page cache. The mapping has to outlive every attached matrix.
+ */
+class csc_mapping_t {
+public:
+
+    /**
+     * Map a file.
+     *
+     * @param fname input file name.
+     */
+    csc_mapping_t(const std::string& fname) : _data(nullptr), _size(0) {
+
+        int fd = open(fname.c_str(), O_RDONLY);
+        if (fd < 0)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Unable to open file " + fname));
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 ||
+            static_cast<size_t>(st.st_size) < sizeof(internal::csc_header_t)) {
+            close(fd);
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Not a CSC file: " + fname));
+        }
+
+        _size = st.st_size;
+        void *data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Unable to map file " + fname));
+        _data = static_cast<const char *>(data);
+
+        const internal::csc_header_t &h = header();
+        std::string error;
+        if (std::memcmp(h.magic, internal::csc_magic, sizeof(h.magic)) != 0)
+            error = "Not a CSC file: ";
+        else if (h.byte_order != internal::csc_byte_order)
+            error = "CSC file has a different byte order: ";
+        else if (h.version != internal::csc_version)
+            error = "Unsupported CSC file version: ";
+        else if (h.file_size > _size)
+            error = "Truncated CSC file: ";
+
+        if (!error.empty()) {
+            munmap(const_cast<char *>(_data), _size);
+            _data = nullptr;
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception() << base::error_msg(error + fname));
+        }
+    }
+
+    ~csc_mapping_t() {
+        if (_data != nullptr)
+            munmap(const_cast<char *>(_data), _size);
+    }
+
+    int64_t height() const { return header().height; }
+    int64_t width() const { return header().width; }
+    int64_t nonzeros() const { return header().nnz; }
+
+    /**
+     * Size in bytes of the indices in the file; the matrix attached to
+     * the mapping must have an index type of that size.
+     */
+    int index_size() const { return header().index_size; }
+
+    /**
+     * Make A a read-only view of the mapped matrix. The header is checked
+     * against the file first: dimensions that fit the index type, arrays
+     * that are aligned and lie within the file, and indptr consistent with
+     * the number of non-zeros at both ends.
+     *
+     * @param A output matrix.
+     */
+    template<typename T, typename I>
+    void attach(base::sparse_matrix_t<T, I>& A) const {
+
+        typedef typename base::sparse_matrix_t<T, I>::index_type index_type;
+
+        const internal::csc_header_t &h = header();
+        if (h.index_size != sizeof(index_type) ||
+            h.value_code != internal::csc_value_code_t<T>::value)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("CSC file index/value type mismatch"));
+
+        const int64_t max_index = std::numeric_limits<index_type>::max();
+        if (h.height < 0 || h.width < 0 || h.nnz < 0 ||
+            h.height > max_index || h.width >= max_index ||
+            h.nnz > max_index)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("CSC file dimensions do not fit the "
+                        "index type"));
+
+        if (!internal::csc_array_ok(h.indptr_offset, h.width + 1,
+                sizeof(index_type), _size) ||
+            !internal::csc_array_ok(h.indices_offset, h.nnz,
+                sizeof(index_type), _size) ||
+            !internal::csc_array_ok(h.values_offset, h.nnz, sizeof(T), _size))
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Corrupt or truncated CSC file"));
+
+        const index_type *indptr =
+            reinterpret_cast<const index_type *>(_data + h.indptr_offset);
+        if (indptr[0] != 0 || indptr[h.width] != h.nnz)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Corrupt CSC file: indptr does not "
+                        "match the number of non-zeros"));
+
+        A.readonly_attach(indptr,
+            reinterpret_cast<const index_type *>(_data + h.indices_offset),
+            reinterpret_cast<const T *>(_data + h.values_offset),
+            h.nnz, h.height, h.width, false, false, false);
+    }
+
+private:
+    const char *_data;
+    size_t _size;
+
+    csc_mapping_t(const csc_mapping_t&);
+    csc_mapping_t& operator=(const csc_mapping_t&);
+
+    const internal::csc_header_t& header() const {
+        return *reinterpret_cast<const internal::csc_header_t *>(_data);
+    }
+};
+
+/**
+ * Reads a local sparse matrix from a file in the binary CSC container format,
+ * copying the data into memory owned by A. Use csc_mapping_t to avoid the
+ * copy.
+ *
+ * @param fname input file name.
+ * @param A output matrix.
+ */
+template<typename T, typename I>
+void ReadCSC(const std::string& fname, base::sparse_matrix_t<T, I>& A) {
+
+    typedef typename base::sparse_matrix_t<T, I>::index_type index_type;
+
+    csc_mapping_t mapping(fname);
+    base::sparse_matrix_t<T, I> V;
+    mapping.attach(V);
+
+    index_type n = V.width(), nnz = V.nonzeros();
+    index_type *indptr = new index_type[n + 1];
+    index_type *indices = new index_type[nnz];
+    T *values = new T[nnz];
+
+    std::copy(V.indptr(), V.indptr() + n + 1, indptr);
+    std::copy(V.indices(), V.indices() + nnz, indices);
+    std::copy(V.locked_values(), V.locked_values() + nnz, values);
+
+    A.attach(indptr, indices, values, nnz, V.height(), n, true);
+}
+
+} } } // namespace skylark::utility::io
+
+#endif // SKYLARK_CSC_IO_HPP
@@ -10,7 +10,10 @@ enum fileformat_t : int {
 } } }
 
 #include "libsvm_io.hpp"
+#include "libsvm_parallel_io.hpp"
 #include "arc_list.hpp"
+#include "csc_io.hpp"
+#include "block_reader.hpp"
 
 #ifdef SKYLARK_HAVE_HDF5
 #include "hdf5_io.hpp"
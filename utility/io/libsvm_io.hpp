@@ -14,6 +14,7 @@ namespace boostfs = boost::filesystem;
 
 #include "../types.hpp"
 #include "../get_communicator.hpp"
+#include "libsvm_parallel_io.hpp"
 
 namespace skylark { namespace utility { namespace io {
 
@@ -151,6 +152,9 @@ void ReadLIBSVM(const std::string& fname,
  * @param max_n stop reading after n rows. If -1 then will read all rows.
  * @param min_d minimum number of rows in the matrix.
  * @param blocksize blocksize for blocking of read.
+ *
+ * On more than one process all of them read and parse a part of the file
+ * (see ParallelReadLIBSVM); blocksize then does not matter.
  */
 template<typename T, El::Distribution UX, El::Distribution VX,
          typename R, El::Distribution UY, El::Distribution VY>
@@ -159,6 +163,11 @@ void ReadLIBSVM(const std::string& fname,
     base::direction_t direction, int min_d = 0, int max_n = -1,
     int blocksize = 10000) {
 
+    if (X.Grid().Size() > 1) {
+        ParallelReadLIBSVM(fname, X, Y, direction, min_d, max_n);
+        return;
+    }
+
     std::string line;
     std::string token, val, ind;
     R label;
@@ -184,7 +193,7 @@ void ReadLIBSVM(const std::string& fname,
 
             // Ignore empty lines and comment lines (begin with #)
             if(line.length() == 0 || line[0] == '#')
-                break;
+                continue;
 
             n++;
 
@@ -268,7 +277,7 @@ void ReadLIBSVM(const std::string& fname,
 
                 // Ignore empty lines and comment lines (begin with #)
                 if(line.length() == 0 || line[0] == '#')
-                    break;
+                    continue;
 
                 std::istringstream tokenstream(line);
 
@@ -490,6 +499,9 @@ void ReadLIBSVM(const std::string& fname,
  * @param direction whether the examples are to be put in rows or columns
  * @param min_d minimum number of rows in the matrix.
  * @param blocksize blocksize for blocking of read.
+ *
+ * On more than one process all of them read and parse a part of the file
+ * (see ParallelReadLIBSVM); blocksize then does not matter.
  */
 template<typename T,
          typename R, El::Distribution UY, El::Distribution VY>
@@ -498,6 +510,11 @@ void ReadLIBSVM(const std::string& fname,
     base::direction_t direction, int min_d = 0, int max_n = -1,
     int blocksize = 10000) {
 
+    if (Y.Grid().Size() > 1) {
+        ParallelReadLIBSVM(fname, X, Y, direction, min_d, max_n);
+        return;
+    }
+
 
     std::string line;
     std::string token, val, ind;
@@ -524,24 +541,30 @@ void ReadLIBSVM(const std::string& fname,
     if (rank==0) {
         while(!in.eof() && n != max_n) {
             getline(in, line);
-            if(line.length()==0)
-                break;
-            delim = line.find_last_of(":");
-            if(delim > line.length())
+
+            // Ignore empty lines and comment lines (begin with #)
+            if(line.length() == 0 || line[0] == '#')
                 continue;
+
             n++;
 
-            // Figure out number of targets
+            // Figure out number of targets (only first line)
             if (n == 1) {
                 std::string tstr;
                 std::istringstream tokenstream (line);
                 tokenstream >> tstr;
                 while (tstr.find(":") == std::string::npos) {
                     nt++;
+                    if (tokenstream.eof())
+                        break;
                     tokenstream >> tstr;
                 }
             }
 
+            delim = line.find_last_of(":");
+            if(delim > line.length())
+                continue;
+
             t = delim;
             while(line[t]!=' ') {
                 t--;
@@ -598,8 +621,10 @@ void ReadLIBSVM(const std::string& fname,
             t = 0;
             while(!in.eof() && t<block) {
                 getline(in, line);
-                if( line.length()==0)
-                    break;
+
+                // Ignore empty lines and comment lines (begin with #)
+                if(line.length() == 0 || line[0] == '#')
+                    continue;
 
                 std::istringstream tokenstream (line);
                 for(int r = 0; r < nt; r++) {
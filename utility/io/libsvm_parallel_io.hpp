@@ -0,0 +1,670 @@
+#ifndef SKYLARK_LIBSVM_PARALLEL_IO_HPP
+#define SKYLARK_LIBSVM_PARALLEL_IO_HPP
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <boost/mpi.hpp>
+
+#include "../get_communicator.hpp"
+
+namespace skylark { namespace utility { namespace io {
+
+namespace detail {
+
+/**
+ * Read len bytes at offset, in pieces that fit MPI's int counts.
+ */
+inline void libsvm_read_at(MPI_File file, MPI_Offset offset,
+    char *buf, size_t len) {
+
+    while (len > 0) {
+        int count = static_cast<int>(std::min(len,
+                static_cast<size_t>(INT_MAX)));
+        MPI_Status status;
+        int err = MPI_File_read_at(file, offset, buf, count, MPI_BYTE,
+            &status);
+        if (err != MPI_SUCCESS)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Error while MPI_File_read_at!"));
+
+        offset += count;
+        buf += count;
+        len -= count;
+    }
+}
+
+/**
+ * Reads the lines of a text file that start in this rank's (equal) byte
+ * range. A line belongs to the rank whose range contains its first byte,
+ * so no communication is needed to agree on the split.
+ *
+ * On return buf holds the owned lines, followed by a terminating '\0'.
+ *
+ * \param fname name of the file
+ * \param comm communicator over which the file is split
+ * \param buf output buffer
+ */
+inline void ReadLineAlignedChunk(const std::string& fname,
+    const boost::mpi::communicator &comm, std::vector<char>& buf) {
+
+    MPI_File file;
+    int rc = MPI_File_open(comm, const_cast<char *>(fname.c_str()),
+        MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+    if (rc)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception()
+                << base::error_msg("Unable to open file " + fname));
+
+    MPI_Offset size;
+    MPI_File_get_size(file, &size);
+
+    int rank = comm.rank();
+    int num_partitions = comm.size();
+    MPI_Offset start = static_cast<MPI_Offset>(
+        static_cast<double>(size) * rank / num_partitions);
+    MPI_Offset end = (rank == num_partitions - 1) ? size :
+        static_cast<MPI_Offset>(
+            static_cast<double>(size) * (rank + 1) / num_partitions);
+
+    // Include the byte before our range: if it is a newline our first line
+    // starts exactly at start.
+    MPI_Offset read_start = (start > 0) ? start - 1 : 0;
+    buf.resize(end - read_start);
+    libsvm_read_at(file, read_start, buf.data(), buf.size());
+
+    size_t first = 0;
+    if (start > 0) {
+        while (first < buf.size() && buf[first] != '\n')
+            first++;
+        first++;
+    }
+
+    if (first >= static_cast<size_t>(end - read_start)) {
+        // No line starts in this range.
+        buf.assign(1, '\0');
+        MPI_File_close(&file);
+        return;
+    }
+
+    // Finish the line containing the last byte of the range.
+    const size_t step = 1 << 16;
+    MPI_Offset pos = end;
+    while ((buf.empty() || buf.back() != '\n') && pos < size) {
+        size_t len = std::min(step, static_cast<size_t>(size - pos));
+        size_t old = buf.size();
+        buf.resize(old + len);
+        libsvm_read_at(file, pos, buf.data() + old, len);
+        pos += len;
+
+        size_t k = old;
+        while (k < buf.size() && buf[k] != '\n')
+            k++;
+        if (k < buf.size())
+            buf.resize(k + 1);
+    }
+
+    MPI_File_close(&file);
+
+    buf.erase(buf.begin(), buf.begin() + first);
+    buf.push_back('\0');
+}
+
+inline bool libsvm_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool libsvm_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * Parses a decimal integer at p, and advances p.
+ */
+inline int libsvm_parse_int(const char *&p) {
+    bool neg = false;
+    if (*p == '-' || *p == '+')
+        neg = (*p++ == '-');
+
+    int v = 0;
+    while (libsvm_is_digit(*p))
+        v = 10 * v + (*p++ - '0');
+    return neg ? -v : v;
+}
+
+/**
+ * Parses a real number at p, and advances p.
+ *
+ * Up to 19 significant digits are accumulated in an integer mantissa. If the
+ * mantissa and the decimal exponent are both exactly representable as a
+ * double the result is a single correctly rounded multiplication or
+ * division (the result is then identical to strtod). Everything else
+ * (long mantissas, large exponents, inf, nan, ...) is handed to strtod.
+ * The buffer must be '\0' terminated.
+ */
+inline double libsvm_parse_real(const char *&p) {
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+        1e22 };
+
+    const char *s = p;
+    bool neg = false;
+    if (*p == '-' || *p == '+')
+        neg = (*p++ == '-');
+
+    uint64_t mant = 0;
+    int digits = 0, exp10 = 0;
+    bool any = false, exact = true;
+
+    for(; libsvm_is_digit(*p); p++) {
+        any = true;
+        if (digits < 19) {
+            mant = 10 * mant + (*p - '0');
+            if (mant) digits++;
+        } else {
+            exp10++;
+            exact = exact && (*p == '0');
+        }
+    }
+
+    if (*p == '.') {
+        p++;
+        for(; libsvm_is_digit(*p); p++) {
+            any = true;
+            if (digits < 19) {
+                mant = 10 * mant + (*p - '0');
+                if (mant) digits++;
+                exp10--;
+            } else
+                exact = exact && (*p == '0');
+        }
+    }
+
+    if (any && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        if (*e == '-' || *e == '+')
+            e++;
+        if (libsvm_is_digit(*e)) {
+            p++;
+            exp10 += libsvm_parse_int(p);
+        }
+    }
+
+    if (any && exact && mant < (uint64_t(1) << 53) &&
+        exp10 >= -22 && exp10 <= 22) {
+        double v = static_cast<double>(mant);
+        v = (exp10 < 0) ? v / pow10[-exp10] : v * pow10[exp10];
+        return neg ? -v : v;
+    }
+
+    char *end;
+    double v = std::strtod(s, &end);
+    p = (end == s) ? p : end;
+    return v;
+}
+
+/**
+ * Local portion of a libsvm file, in CSR form (one row per example).
+ */
+template<typename T, typename R>
+struct libsvm_chunk_t {
+    int n;                      /**< number of examples */
+    int nt;                     /**< number of targets of the first example */
+    int d;                      /**< largest (1-based) feature index */
+    std::vector<int> lblptr;    /**< per example offsets into labels */
+    std::vector<R> labels;
+    std::vector<int> rowptr;    /**< per example offsets into colind/values */
+    std::vector<int> colind;    /**< zero-based feature indices */
+    std::vector<T> values;
+
+    libsvm_chunk_t() : n(0), nt(0), d(0), lblptr(1, 0), rowptr(1, 0) {}
+};
+
+/**
+ * Parses a buffer of libsvm lines. Empty lines and lines starting with '#'
+ * are skipped.
+ */
+template<typename T, typename R>
+void ParseLIBSVMChunk(const std::vector<char>& buf,
+    libsvm_chunk_t<T, R>& chunk) {
+
+    // A rough guess (~12 bytes per feature) saves most reallocations.
+    chunk.colind.reserve(buf.size() / 12);
+    chunk.values.reserve(buf.size() / 12);
+
+    const char *p = buf.data();
+    while (*p != '\0') {
+        while (libsvm_is_space(*p))
+            p++;
+
+        if (*p == '\n' || *p == '#') {
+            while (*p != '\n' && *p != '\0')
+                p++;
+            if (*p == '\n')
+                p++;
+            continue;
+        }
+
+        if (*p == '\0')
+            break;
+
+        // Targets: tokens up to the first idx:val pair.
+        bool features = false;
+        while (*p != '\n' && *p != '\0') {
+            const char *t = p;
+            double v = libsvm_parse_real(p);
+            if (*p == ':') {
+                p = t;
+                features = true;
+                break;
+            }
+
+            if (p == t)
+                SKYLARK_THROW_EXCEPTION(
+                    base::io_exception()
+                        << base::error_msg("Invalid libsvm token"));
+
+            chunk.labels.push_back(static_cast<R>(v));
+            while (libsvm_is_space(*p))
+                p++;
+        }
+
+        if (chunk.n == 0)
+            chunk.nt = chunk.labels.size();
+
+        while (features && *p != '\n' && *p != '\0') {
+            int j = libsvm_parse_int(p);
+            if (*p != ':')
+                SKYLARK_THROW_EXCEPTION(
+                    base::io_exception()
+                        << base::error_msg("Invalid libsvm feature"));
+            p++;
+            T v = static_cast<T>(libsvm_parse_real(p));
+
+            chunk.colind.push_back(j - 1);
+            chunk.values.push_back(v);
+            chunk.d = std::max(chunk.d, j);
+
+            while (libsvm_is_space(*p))
+                p++;
+        }
+
+        if (*p == '\n')
+            p++;
+
+        chunk.n++;
+        chunk.lblptr.push_back(chunk.labels.size());
+        chunk.rowptr.push_back(chunk.colind.size());
+    }
+}
+
+/**
+ * Agree on the global dimensions, and find the global index of the first
+ * local example. Examples with global index max_n or beyond are dropped from
+ * the chunk.
+ */
+template<typename T, typename R>
+void AgreeLIBSVMDimensions(const boost::mpi::communicator &comm,
+    libsvm_chunk_t<T, R>& chunk, int min_d, int max_n,
+    int& offset, int& n, int& d, int& nt) {
+
+    std::vector<int> mine(3), all;
+    mine[0] = chunk.n; mine[1] = chunk.d; mine[2] = chunk.nt;
+    boost::mpi::all_gather(comm, mine.data(), 3, all);
+
+    offset = 0; n = 0; d = 0; nt = 0;
+    for(int r = 0; r < comm.size(); r++) {
+        if (r == comm.rank())
+            offset = n;
+        n += all[3 * r];
+        d = std::max(d, all[3 * r + 1]);
+        if (nt == 0)
+            nt = all[3 * r + 2];
+    }
+
+    if (max_n >= 0 && n > max_n) {
+        // Truncate, and recompute d on the examples that are kept.
+        int keep = std::max(0, std::min(chunk.n, max_n - offset));
+        chunk.n = keep;
+        chunk.d = 0;
+        for(int k = 0; k < chunk.rowptr[keep]; k++)
+            chunk.d = std::max(chunk.d, chunk.colind[k] + 1);
+
+        n = max_n;
+        boost::mpi::all_reduce(comm, chunk.d, d, boost::mpi::maximum<int>());
+    }
+
+    if (min_d > 0)
+        d = std::max(d, min_d);
+}
+
+/**
+ * Sends every local example to the rank owning it in a [VC, *] / [*, VC]
+ * distribution (global index modulo communicator size) using a single
+ * all-to-all exchange. On return chunk holds the received examples, and
+ * gidx their global indices.
+ */
+template<typename T, typename R>
+void ExchangeLIBSVMExamples(const boost::mpi::communicator &comm,
+    libsvm_chunk_t<T, R>& chunk, int offset, int nt,
+    std::vector<int>& gidx) {
+
+    int size = comm.size();
+
+    // Per example: [global index, nnz, colind...]; labels padded to nt.
+    std::vector<int> icount(size, 0), vcount(size, 0), lcount(size, 0);
+    for(int e = 0; e < chunk.n; e++) {
+        int owner = (offset + e) % size;
+        int nnz = chunk.rowptr[e + 1] - chunk.rowptr[e];
+        icount[owner] += 2 + nnz;
+        vcount[owner] += nnz;
+        lcount[owner] += nt;
+    }
+
+    std::vector<int> idispl(size + 1, 0), vdispl(size + 1, 0),
+        ldispl(size + 1, 0);
+    for(int r = 0; r < size; r++) {
+        idispl[r + 1] = idispl[r] + icount[r];
+        vdispl[r + 1] = vdispl[r] + vcount[r];
+        ldispl[r + 1] = ldispl[r] + lcount[r];
+    }
+
+    std::vector<int> ibuf(idispl[size]);
+    std::vector<T> vbuf(vdispl[size]);
+    std::vector<R> lbuf(ldispl[size], R(0));
+    std::vector<int> ipos(idispl.begin(), idispl.end() - 1),
+        vpos(vdispl.begin(), vdispl.end() - 1),
+        lpos(ldispl.begin(), ldispl.end() - 1);
+
+    for(int e = 0; e < chunk.n; e++) {
+        int owner = (offset + e) % size;
+        int s = chunk.rowptr[e], nnz = chunk.rowptr[e + 1] - s;
+
+        ibuf[ipos[owner]++] = offset + e;
+        ibuf[ipos[owner]++] = nnz;
+        std::copy(chunk.colind.begin() + s, chunk.colind.begin() + s + nnz,
+            ibuf.begin() + ipos[owner]);
+        std::copy(chunk.values.begin() + s, chunk.values.begin() + s + nnz,
+            vbuf.begin() + vpos[owner]);
+        ipos[owner] += nnz;
+        vpos[owner] += nnz;
+
+        int nl = std::min(nt, chunk.lblptr[e + 1] - chunk.lblptr[e]);
+        std::copy(chunk.labels.begin() + chunk.lblptr[e],
+            chunk.labels.begin() + chunk.lblptr[e] + nl,
+            lbuf.begin() + lpos[owner]);
+        lpos[owner] += nt;
+    }
+
+    std::vector<int> counts(3 * size), rcounts(3 * size);
+    for(int r = 0; r < size; r++) {
+        counts[3 * r] = icount[r];
+        counts[3 * r + 1] = vcount[r];
+        counts[3 * r + 2] = lcount[r];
+    }
+    MPI_Alltoall(counts.data(), 3, MPI_INT, rcounts.data(), 3, MPI_INT, comm);
+
+    std::vector<int> ircount(size), vrcount(size), lrcount(size);
+    std::vector<int> irdispl(size + 1, 0), vrdispl(size + 1, 0),
+        lrdispl(size + 1, 0);
+    for(int r = 0; r < size; r++) {
+        ircount[r] = rcounts[3 * r];
+        vrcount[r] = rcounts[3 * r + 1];
+        lrcount[r] = rcounts[3 * r + 2];
+        irdispl[r + 1] = irdispl[r] + ircount[r];
+        vrdispl[r + 1] = vrdispl[r] + vrcount[r];
+        lrdispl[r + 1] = lrdispl[r] + lrcount[r];
+    }
+
+    std::vector<int> ibufr(irdispl[size]);
+    std::vector<T> vbufr(vrdispl[size]);
+    std::vector<R> lbufr(lrdispl[size]);
+
+    MPI_Alltoallv(ibuf.data(), icount.data(), idispl.data(), MPI_INT,
+        ibufr.data(), ircount.data(), irdispl.data(), MPI_INT, comm);
+    MPI_Alltoallv(vbuf.data(), vcount.data(), vdispl.data(),
+        boost::mpi::get_mpi_datatype<T>(),
+        vbufr.data(), vrcount.data(), vrdispl.data(),
+        boost::mpi::get_mpi_datatype<T>(), comm);
+    MPI_Alltoallv(lbuf.data(), lcount.data(), ldispl.data(),
+        boost::mpi::get_mpi_datatype<R>(),
+        lbufr.data(), lrcount.data(), lrdispl.data(),
+        boost::mpi::get_mpi_datatype<R>(), comm);
+
+    // Unpack into the chunk.
+    libsvm_chunk_t<T, R> received;
+    received.nt = nt;
+    received.d = chunk.d;
+    received.labels.swap(lbufr);
+    received.values.swap(vbufr);
+    received.colind.reserve(received.values.size());
+    gidx.clear();
+
+    for(size_t k = 0; k < ibufr.size(); ) {
+        gidx.push_back(ibufr[k]);
+        int nnz = ibufr[k + 1];
+        received.colind.insert(received.colind.end(),
+            ibufr.begin() + k + 2, ibufr.begin() + k + 2 + nnz);
+        k += 2 + nnz;
+
+        received.n++;
+        received.rowptr.push_back(received.colind.size());
+        received.lblptr.push_back(received.n * nt);
+    }
+
+    std::swap(chunk, received);
+}
+
+} // namespace detail
+
+/**
+ * Reads X and Y from a file in libsvm format, in parallel.
+ * X and Y are Elemental distributed matrices.
+ *
+ * Every rank reads and parses the lines starting in an equal byte range of
+ * the file, the ranks agree on the dimensions with a single collective, and
+ * the examples are sent to their owners in one all-to-all exchange.
+ *
+ * @param fname input file name.
+ * @param X output X
+ * @param Y output Y
+ * @param direction whether the examples are to be put in rows or columns
+ * @param min_d minimum number of rows in the matrix.
+ * @param max_n stop reading after n rows. If -1 then will read all rows.
+ */
+template<typename T, El::Distribution UX, El::Distribution VX,
+         typename R, El::Distribution UY, El::Distribution VY>
+void ParallelReadLIBSVM(const std::string& fname,
+    El::DistMatrix<T, UX, VX>& X, El::DistMatrix<R, UY, VY>& Y,
+    base::direction_t direction, int min_d = 0, int max_n = -1) {
+
+    const El::Grid& grid = X.Grid();
+    boost::mpi::communicator comm(grid.VCComm().comm,
+        boost::mpi::comm_attach);
+
+    std::vector<char> buf;
+    detail::ReadLineAlignedChunk(fname, comm, buf);
+
+    detail::libsvm_chunk_t<T, R> chunk;
+    detail::ParseLIBSVMChunk(buf, chunk);
+    std::vector<char>().swap(buf);
+
+    int offset, n, d, nt;
+    detail::AgreeLIBSVMDimensions(comm, chunk, min_d, max_n, offset, n, d, nt);
+
+    std::vector<int> gidx;
+    detail::ExchangeLIBSVMExamples(comm, chunk, offset, nt, gidx);
+
+    // Example i is now on VC rank i % p, as local row/column i / p.
+    int p = comm.size();
+    if (direction == base::COLUMNS) {
+        El::DistMatrix<T, El::STAR, El::VC> XVC(grid);
+        El::DistMatrix<R, El::STAR, El::VC> YVC(grid);
+        El::Zeros(XVC, d, n);
+        El::Zeros(YVC, nt, n);
+
+        T *Xdata = XVC.Buffer();
+        R *Ydata = YVC.Buffer();
+        int ldX = XVC.LDim(), ldY = YVC.LDim();
+        for(int e = 0; e < chunk.n; e++) {
+            int jl = gidx[e] / p;
+            for(int k = chunk.rowptr[e]; k < chunk.rowptr[e + 1]; k++)
+                Xdata[static_cast<size_t>(jl) * ldX + chunk.colind[k]] =
+                    chunk.values[k];
+            for(int r = 0; r < nt; r++)
+                Ydata[static_cast<size_t>(jl) * ldY + r] =
+                    chunk.labels[e * nt + r];
+        }
+
+        X = XVC;
+        Y = YVC;
+    } else {
+        El::DistMatrix<T, El::VC, El::STAR> XVC(grid);
+        El::DistMatrix<R, El::VC, El::STAR> YVC(grid);
+        El::Zeros(XVC, n, d);
+        El::Zeros(YVC, n, nt);
+
+        T *Xdata = XVC.Buffer();
+        R *Ydata = YVC.Buffer();
+        int ldX = XVC.LDim(), ldY = YVC.LDim();
+        for(int e = 0; e < chunk.n; e++) {
+            int il = gidx[e] / p;
+            for(int k = chunk.rowptr[e]; k < chunk.rowptr[e + 1]; k++)
+                Xdata[static_cast<size_t>(chunk.colind[k]) * ldX + il] =
+                    chunk.values[k];
+            for(int r = 0; r < nt; r++)
+                Ydata[static_cast<size_t>(r) * ldY + il] =
+                    chunk.labels[e * nt + r];
+        }
+
+        X = XVC;
+        Y = YVC;
+    }
+}
+
+/**
+ * Reads X and Y from a file in libsvm format, in parallel.
+ * X is a sparse distributed VC/STAR matrix and Y is a dense distributed
+ * matrix.
+ *
+ * @param fname input file name.
+ * @param X output X
+ * @param Y output Y
+ * @param direction whether the examples are to be put in rows or columns
+ * @param min_d minimum number of rows in the matrix.
+ * @param max_n stop reading after n rows. If -1 then will read all rows.
+ */
+template<typename T,
+         typename R, El::Distribution UY, El::Distribution VY>
+void ParallelReadLIBSVM(const std::string& fname,
+    base::sparse_vc_star_matrix_t<T>& X, El::DistMatrix<R, UY, VY>& Y,
+    base::direction_t direction, int min_d = 0, int max_n = -1) {
+
+    const El::Grid& grid = Y.Grid();
+    boost::mpi::communicator comm(grid.VCComm().comm,
+        boost::mpi::comm_attach);
+
+    std::vector<char> buf;
+    detail::ReadLineAlignedChunk(fname, comm, buf);
+
+    detail::libsvm_chunk_t<T, R> chunk;
+    detail::ParseLIBSVMChunk(buf, chunk);
+    std::vector<char>().swap(buf);
+
+    int offset, n, d, nt;
+    detail::AgreeLIBSVMDimensions(comm, chunk, min_d, max_n, offset, n, d, nt);
+
+    if (direction == base::COLUMNS)
+        X.resize(d, n);
+    else
+        X.resize(n, d);
+
+    // Route the nonzeros to their owners in X. Rows of X are distributed
+    // over the VC ranks, which are the ranks of comm; row_owner() gives the
+    // VC rank.
+    int size = comm.size();
+    std::vector<int> count(size, 0);
+    for(int e = 0; e < chunk.n; e++)
+        for(int k = chunk.rowptr[e]; k < chunk.rowptr[e + 1]; k++) {
+            int i = offset + e, j = chunk.colind[k];
+            count[X.row_owner((direction == base::COLUMNS) ? j : i)]++;
+        }
+
+    std::vector<int> displ(size + 1, 0);
+    for(int r = 0; r < size; r++)
+        displ[r + 1] = displ[r] + count[r];
+
+    std::vector<int> ibuf(displ[size]), jbuf(displ[size]);
+    std::vector<T> vbuf(displ[size]);
+    std::vector<int> pos(displ.begin(), displ.end() - 1);
+    for(int e = 0; e < chunk.n; e++)
+        for(int k = chunk.rowptr[e]; k < chunk.rowptr[e + 1]; k++) {
+            int i = offset + e, j = chunk.colind[k];
+            if (direction == base::COLUMNS)
+                std::swap(i, j);
+            int q = pos[X.row_owner(i)]++;
+            ibuf[q] = i;
+            jbuf[q] = j;
+            vbuf[q] = chunk.values[k];
+        }
+
+    std::vector<int> rcount(size), rdispl(size + 1, 0);
+    MPI_Alltoall(count.data(), 1, MPI_INT, rcount.data(), 1, MPI_INT, comm);
+    for(int r = 0; r < size; r++)
+        rdispl[r + 1] = rdispl[r] + rcount[r];
+
+    std::vector<int> ibufr(rdispl[size]), jbufr(rdispl[size]);
+    std::vector<T> vbufr(rdispl[size]);
+    MPI_Alltoallv(ibuf.data(), count.data(), displ.data(), MPI_INT,
+        ibufr.data(), rcount.data(), rdispl.data(), MPI_INT, comm);
+    MPI_Alltoallv(jbuf.data(), count.data(), displ.data(), MPI_INT,
+        jbufr.data(), rcount.data(), rdispl.data(), MPI_INT, comm);
+    MPI_Alltoallv(vbuf.data(), count.data(), displ.data(),
+        boost::mpi::get_mpi_datatype<T>(),
+        vbufr.data(), rcount.data(), rdispl.data(),
+        boost::mpi::get_mpi_datatype<T>(), comm);
+
+    for(size_t k = 0; k < ibufr.size(); k++)
+        X.queue_update(ibufr[k], jbufr[k], vbufr[k]);
+    X.finalize();
+
+    // Labels go through the dense path.
+    std::vector<int> gidx;
+    chunk.rowptr.assign(chunk.n + 1, 0);
+    chunk.colind.clear();
+    chunk.values.clear();
+    detail::ExchangeLIBSVMExamples(comm, chunk, offset, nt, gidx);
+
+    int p = size;
+    if (direction == base::COLUMNS) {
+        El::DistMatrix<R, El::STAR, El::VC> YVC(grid);
+        El::Zeros(YVC, nt, n);
+        R *Ydata = YVC.Buffer();
+        int ldY = YVC.LDim();
+        for(int e = 0; e < chunk.n; e++)
+            for(int r = 0; r < nt; r++)
+                Ydata[static_cast<size_t>(gidx[e] / p) * ldY + r] =
+                    chunk.labels[e * nt + r];
+        Y = YVC;
+    } else {
+        El::DistMatrix<R, El::VC, El::STAR> YVC(grid);
+        El::Zeros(YVC, n, nt);
+        R *Ydata = YVC.Buffer();
+        int ldY = YVC.LDim();
+        for(int e = 0; e < chunk.n; e++)
+            for(int r = 0; r < nt; r++)
+                Ydata[static_cast<size_t>(r) * ldY + gidx[e] / p] =
+                    chunk.labels[e * nt + r];
+        Y = YVC;
+    }
+}
+
+} } } // namespace skylark::utility::io
+
+#endif // SKYLARK_LIBSVM_PARALLEL_IO_HPP